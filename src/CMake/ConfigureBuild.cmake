@@ -48,4 +48,16 @@ IF (APPLE)
   ADD_DEFINITIONS('-DGTEST_NOT_MAC_FRAMEWORK_MODE')
 ENDIF (APPLE)
 
-FIND_PACKAGE(Qt4)
\ No newline at end of file
+FIND_PACKAGE(Qt4)
+
+# Independent work (pyramid levels, hypotheses, points) is spread over the
+# cores with OpenMP when the compiler supports it. Without it the pragmas are
+# ignored and the code runs serially.
+OPTION(WITH_OPENMP "Use OpenMP to parallelize independent loops." ON)
+IF (WITH_OPENMP)
+  FIND_PACKAGE(OpenMP)
+  IF (OPENMP_FOUND)
+    SET(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${OpenMP_C_FLAGS}")
+    SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+  ENDIF (OPENMP_FOUND)
+ENDIF (WITH_OPENMP)
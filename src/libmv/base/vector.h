@@ -111,7 +111,7 @@ class vector {
   }
 
   void reserve(unsigned int size) {
-    if (size > size_) {
+    if (size > capacity_) {
       T *data = static_cast<T *>(allocate(size));
       memcpy(data, data_, sizeof(*data)*size_);
       allocator_.deallocate(data_, capacity_);
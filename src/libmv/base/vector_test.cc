@@ -142,6 +142,18 @@ TEST_F(VectorTest, ResizeConstructsAndDestructsAsExpected) {
   EXPECT_EQ(3, foo_destruct_calls);
 }
 
+TEST_F(VectorTest, ResizeWithinCapacityKeepsStorage) {
+  vector<int> v;
+  v.reserve(8);
+  const int *data = v.begin();
+  v.resize(8);
+  v.resize(0);
+  v.resize(5);
+  EXPECT_EQ(5, v.size());
+  EXPECT_EQ(8, v.capacity());
+  EXPECT_EQ(data, v.begin());
+}
+
 TEST_F(VectorTest, PushPopBack) {
   vector<Foo> v;
 
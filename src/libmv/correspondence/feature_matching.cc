@@ -20,6 +20,7 @@
 
 #include "libmv/correspondence/feature_matching.h"
 
+#include "libmv/base/scoped_ptr.h"
 #include "libmv/correspondence/ArrayMatcher.h"
 #include "libmv/correspondence/ArrayMatcher_BruteForce.h"
 #include "libmv/correspondence/ArrayMatcher_Kdtree_Flann.h"
@@ -291,3 +292,110 @@ void FindCorrespondences(const FeatureSet &left,
     LOG(INFO) << "[FindCandidateMatches_Ratio] Unknow input match method.";
   }
 }
+
+namespace {
+
+correspondence::ArrayMatcher<float> *CreateArrayMatcher(
+    eLibmvMatchMethod eMatchMethod) {
+  switch (eMatchMethod) {
+    case eMATCH_KDTREE:
+      return new correspondence::ArrayMatcher_Kdtree<float>;
+    case eMATCH_KDTREE_FLANN:
+      return new correspondence::ArrayMatcher_Kdtree_Flann<float>;
+    case eMATCH_LINEAR:
+      return new correspondence::ArrayMatcher_BruteForce<float>;
+  }
+  return NULL;
+}
+
+}  // namespace
+
+void FindCandidateMatches(const RMatf &left,
+                          const RMatf &right,
+                          std::map<size_t, size_t> *correspondences,
+                          eLibmvMatchMethod eMatchMethod) {
+  if (left.rows() == 0 || right.rows() == 0) {
+    return;
+  }
+  CHECK(left.cols() == right.cols());
+
+  scoped_ptr<correspondence::ArrayMatcher<float> >
+      matcherA(CreateArrayMatcher(eMatchMethod));
+  scoped_ptr<correspondence::ArrayMatcher<float> >
+      matcherB(CreateArrayMatcher(eMatchMethod));
+  if (!matcherA.get() || !matcherB.get()) {
+    LOG(INFO) << "[FindCandidateMatches] Unknown input match method.";
+    return;
+  }
+
+  libmv::vector<int> indices, indicesReverse;
+  libmv::vector<float> distances, distancesReverse;
+  const int NN = 1;
+  if (!matcherA->build(left.data(), left.rows(), left.cols()) ||
+      !matcherB->build(right.data(), right.rows(), right.cols()) ||
+      !matcherB->searchNeighbours(left.data(), left.rows(),
+                                  &indices, &distances, NN) ||
+      !matcherA->searchNeighbours(right.data(), right.rows(),
+                                  &indicesReverse, &distancesReverse, NN)) {
+    LOG(INFO) << "[FindCandidateMatches] Cannot compute symmetric matches.";
+    return;
+  }
+  // Keep only the symmetric matches.
+  for (int i = 0; i < indices.size(); ++i) {
+    if (i == indicesReverse[indices[i]]) {
+      (*correspondences)[i] = indices[i];
+    }
+  }
+}
+
+void FindCorrespondences(const RMatf &left,
+                         const RMatf &right,
+                         std::map<size_t, size_t> *correspondences,
+                         eLibmvMatchMethod eMatchMethod,
+                         float fRatio) {
+  if (left.rows() == 0 || right.rows() == 0) {
+    return;
+  }
+  CHECK(left.cols() == right.cols());
+
+  if (eMatchMethod == eMATCH_LINEAR) {
+    LOG(INFO) << "Not yet implemented.";
+    return;
+  }
+  scoped_ptr<correspondence::ArrayMatcher<float> >
+      matcher(CreateArrayMatcher(eMatchMethod));
+  if (!matcher.get()) {
+    LOG(INFO) << "[FindCorrespondences] Unknown input match method.";
+    return;
+  }
+
+  libmv::vector<int> indices;
+  libmv::vector<float> distances;
+  const int NN = 2;
+  if (!matcher->build(right.data(), right.rows(), right.cols()) ||
+      !matcher->searchNeighbours(left.data(), left.rows(),
+                                 &indices, &distances, NN)) {
+    LOG(INFO) << "[FindCorrespondences] Cannot compute matches.";
+    return;
+  }
+  // From putative matches get matches that fit the "Ratio" heuristic.
+  for (int i = 0; i < left.rows(); ++i) {
+    float distance0 = distances[i*NN];
+    float distance1 = distances[i*NN+NN-1];
+    if (distance0 < fRatio * distance1) {
+      (*correspondences)[i] = indices[i*NN];
+    }
+  }
+}
+
+void FeatureTableToFeatureSet(const PointFeatureTable &features,
+                              const RMatf &descriptors,
+                              FeatureSet *feature_set) {
+  CHECK(features.size() == descriptors.rows());
+  feature_set->features.resize(features.size());
+  for (int i = 0; i < features.size(); ++i) {
+    KeypointFeature &feature = feature_set->features[i];
+    *(PointFeature*)(&feature) = features.Point(i);
+    feature.descriptor.coords = descriptors.row(i).transpose();
+  }
+}
@@ -25,6 +25,7 @@
 #include "libmv/base/vector.h"
 #include "libmv/correspondence/kdtree.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_table.h"
 #include "libmv/correspondence/matches.h"
 #include "libmv/descriptor/descriptor.h"
 #include "libmv/descriptor/vector_descriptor.h"
@@ -88,4 +89,27 @@ void FindCorrespondences(const FeatureSet &left,
                          eLibmvMatchMethod eMatchMethod = eMATCH_KDTREE_FLANN,
                          float fRatio = 0.8f);
 
+// Batch versions working on descriptor matrices (one descriptor per row, in
+// the order of a PointFeatureTable). The matrices are handed to the
+// ArrayMatcher as they are, without FeatureSetDescriptorsToContiguousArray
+// copies. correspondences maps a row of left to a row of right.
+
+/// Symmetric nearest neighbour matches.
+void FindCandidateMatches(const RMatf &left,
+                          const RMatf &right,
+                          std::map<size_t, size_t> *correspondences,
+                          eLibmvMatchMethod eMatchMethod = eMATCH_KDTREE_FLANN);
+
+/// Nearest neighbour matches that pass the distance ratio test.
+void FindCorrespondences(const RMatf &left,
+                         const RMatf &right,
+                         std::map<size_t, size_t> *correspondences,
+                         eLibmvMatchMethod eMatchMethod = eMATCH_KDTREE_FLANN,
+                         float fRatio = 0.8f);
+
+/// Fills a FeatureSet of KeypointFeatures from a table and its descriptors.
+void FeatureTableToFeatureSet(const PointFeatureTable &features,
+                              const RMatf &descriptors,
+                              FeatureSet *feature_set);
+
 #endif //LIBMV_CORRESPONDENCE_FEATURE_MATCHING_H_
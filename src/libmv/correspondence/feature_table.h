@@ -0,0 +1,109 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_CORRESPONDENCE_FEATURE_TABLE_H_
+#define LIBMV_CORRESPONDENCE_FEATURE_TABLE_H_
+
+#include "libmv/base/vector.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+/**
+ * Point features of one image stored as a structure of arrays.
+ *
+ * This is the batch counterpart of vector<Feature *>: the features live in
+ * five parallel columns, so a detector fills the table without one heap
+ * allocation per feature and consumers read it without dynamic_cast. The
+ * descriptors that go with a table are stored in a row-major RMatf whose row
+ * i describes feature i; its Data() can be handed directly to
+ * ArrayMatcher::build.
+ */
+struct PointFeatureTable {
+  int size() const { return x.size(); }
+
+  void Reserve(int n) {
+    x.reserve(n);
+    y.reserve(n);
+    scale.reserve(n);
+    orientation.reserve(n);
+    score.reserve(n);
+  }
+
+  /// Removes all the features but keeps the allocated memory.
+  void Clear() {
+    x.resize(0);
+    y.resize(0);
+    scale.resize(0);
+    orientation.resize(0);
+    score.resize(0);
+  }
+
+  void Append(float xx, float yy, float s, float o, float sc = 0.0f) {
+    x.push_back(xx);
+    y.push_back(yy);
+    scale.push_back(s);
+    orientation.push_back(o);
+    score.push_back(sc);
+  }
+
+  void Append(const PointFeature &feature, float sc = 0.0f) {
+    Append(feature.x(), feature.y(), feature.scale, feature.orientation, sc);
+  }
+
+  /// Builds the feature i as a PointFeature, for code using the old API.
+  PointFeature Point(int i) const {
+    PointFeature feature(x[i], y[i]);
+    feature.scale = scale[i];
+    feature.orientation = orientation[i];
+    return feature;
+  }
+
+  /**
+   * Keeps only the features whose indices are given, in increasing order.
+   * The corresponding descriptor rows must be compacted by the caller.
+   */
+  void Select(const vector<int> &indices) {
+    for (int i = 0; i < indices.size(); ++i) {
+      const int j = indices[i];
+      x[i] = x[j];
+      y[i] = y[j];
+      scale[i] = scale[j];
+      orientation[i] = orientation[j];
+      score[i] = score[j];
+    }
+    x.resize(indices.size());
+    y.resize(indices.size());
+    scale.resize(indices.size());
+    orientation.resize(indices.size());
+    score.resize(indices.size());
+  }
+
+  vector<float> x;            // Column, in pixels.
+  vector<float> y;            // Row, in pixels.
+  vector<float> scale;        // In pixels.
+  vector<float> orientation;  // In radians.
+  vector<float> score;        // Detector response; 0 if not provided.
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_CORRESPONDENCE_FEATURE_TABLE_H_
@@ -0,0 +1,153 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <map>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature_matching.h"
+#include "libmv/correspondence/feature_table.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/dipole_descriptor.h"
+#include "libmv/descriptor/simpliest_descriptor.h"
+#include "libmv/descriptor/vector_descriptor.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/fast_detector.h"
+#include "libmv/image/image.h"
+#include "testing/testing.h"
+
+namespace {
+
+using namespace libmv;
+
+TEST(PointFeatureTable, AppendAndSelect) {
+  PointFeatureTable table;
+  for (int i = 0; i < 5; ++i) {
+    table.Append(i, 10 + i, 2.0 * i, 0.1 * i, 100 + i);
+  }
+  EXPECT_EQ(5, table.size());
+  PointFeature point = table.Point(3);
+  EXPECT_EQ(3, point.x());
+  EXPECT_EQ(13, point.y());
+  EXPECT_FLOAT_EQ(6.0, point.scale);
+  EXPECT_FLOAT_EQ(0.3, point.orientation);
+
+  libmv::vector<int> keep;
+  keep.push_back(1);
+  keep.push_back(4);
+  table.Select(keep);
+  ASSERT_EQ(2, table.size());
+  EXPECT_EQ(1, table.x[0]);
+  EXPECT_EQ(14, table.y[1]);
+  EXPECT_EQ(104, table.score[1]);
+
+  table.Clear();
+  EXPECT_EQ(0, table.size());
+}
+
+// Draws a few random bright squares so that FAST and the describers have
+// something to work on.
+void TexturedImage(Array3Du *image) {
+  image->Resize(64, 64);
+  image->fill(0);
+  srand(3);
+  for (int k = 0; k < 12; ++k) {
+    int x = 8 + rand() % 44, y = 8 + rand() % 44, value = 64 + rand() % 192;
+    for (int r = y; r < y + 5; ++r) {
+      for (int c = x; c < x + 5; ++c) {
+        (*image)(r, c) = value;
+      }
+    }
+  }
+}
+
+void ExpectTableMatchesVectors(descriptor::Describer *describer) {
+  Array3Du array;
+  TexturedImage(&array);
+  Image image(new Array3Du(array));
+  scoped_ptr<detector::Detector> detector(detector::CreateFastDetector(9, 20));
+
+  vector<Feature *> features;
+  detector->Detect(image, &features, NULL);
+  vector<descriptor::Descriptor *> descriptors;
+  describer->Describe(features, image, NULL, &descriptors);
+
+  PointFeatureTable table;
+  detector->DetectTable(image, &table, NULL);
+  RMatf matrix;
+  describer->DescribeTable(&table, image, NULL, &matrix);
+
+  ASSERT_LT(0, features.size());
+  ASSERT_EQ(features.size(), table.size());
+  ASSERT_EQ(descriptors.size(), matrix.rows());
+  for (int i = 0; i < features.size(); ++i) {
+    PointFeature *point = static_cast<PointFeature *>(features[i]);
+    EXPECT_EQ(point->x(), table.x[i]);
+    EXPECT_EQ(point->y(), table.y[i]);
+    Vecf coords = static_cast<descriptor::VecfDescriptor *>(
+        descriptors[i])->coords;
+    ASSERT_EQ(coords.size(), matrix.cols());
+    for (int j = 0; j < coords.size(); ++j) {
+      EXPECT_FLOAT_EQ(coords(j), matrix(i, j));
+    }
+  }
+  DeleteElements(&features);
+  DeleteElements(&descriptors);
+}
+
+TEST(PointFeatureTable, SimpliestDescribeTable) {
+  scoped_ptr<descriptor::Describer> describer(
+      descriptor::CreateSimpliestDescriber());
+  ExpectTableMatchesVectors(describer.get());
+}
+
+TEST(PointFeatureTable, DipoleDescribeTable) {
+  scoped_ptr<descriptor::Describer> describer(
+      descriptor::CreateDipoleDescriber());
+  ExpectTableMatchesVectors(describer.get());
+}
+
+TEST(PointFeatureTable, MatchDescriptorMatrices) {
+  RMatf left(4, 2), right(5, 2);
+  for (int i = 0; i < 4; ++i) {
+    left.row(i) << 2 * i, 2 * i;
+  }
+  for (int i = 0; i < 5; ++i) {
+    right.row(i) << 2 * (4 - i) + 0.1, 2 * (4 - i);
+  }
+  std::map<size_t, size_t> matches;
+  FindCandidateMatches(left, right, &matches, eMATCH_LINEAR);
+  ASSERT_EQ(4, matches.size());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(4 - i, matches[i]);
+  }
+
+  FeatureSet feature_set;
+  PointFeatureTable table;
+  for (int i = 0; i < 4; ++i) {
+    table.Append(i, i, 1.0, 0.0);
+  }
+  FeatureTableToFeatureSet(table, left, &feature_set);
+  ASSERT_EQ(4, feature_set.features.size());
+  EXPECT_EQ(3, feature_set.features[3].x());
+  EXPECT_EQ(6, feature_set.features[3][1]);
+}
+
+}  // namespace
@@ -73,25 +73,17 @@ bool nRobustViewMatching::computeData(const string & filename)
     }
     Image im(img_array);
 
-    libmv::vector<libmv::Feature *> features;
-    m_pDetector->Detect( im, &features, NULL);
+    detector::DetectorData *detector_data = NULL;
+    PointFeatureTable features;
+    m_pDetector->DetectTable(im, &features, &detector_data);
 
-    libmv::vector<descriptor::Descriptor *> descriptors;
-    m_pDescriber->Describe(features, im, NULL, &descriptors);
+    RMatf descriptors;
+    m_pDescriber->DescribeTable(&features, im, detector_data, &descriptors);
+    delete detector_data;
 
     // Copy data.
     m_ViewData.insert( make_pair(filename,FeatureSet()) );
-    FeatureSet & KeypointData = m_ViewData[filename];
-    KeypointData.features.resize(descriptors.size());
-    for(int i = 0;i < descriptors.size(); ++i)
-    {
-      KeypointFeature & feat = KeypointData.features[i];
-      feat.descriptor = *(descriptor::VecfDescriptor*)descriptors[i];
-      *(PointFeature*)(&feat) = *(PointFeature*)features[i];
-    }
-
-    DeleteElements(&features);
-    DeleteElements(&descriptors);
+    FeatureTableToFeatureSet(features, descriptors, &m_ViewData[filename]);
 
     return true;
   }
@@ -251,7 +243,10 @@ bool nRobustViewMatching::computeConstrainMatches(const Matches & matchIn,
   //HomographyFromCorrespondences2PointRobust(x[0], x[1], 0.3, &H, &inliers);
   //HomographyFromCorrespondences4PointRobust(x[0], x[1], 0.3, &H, &inliers);
   //AffineFromCorrespondences2PointRobust(x[0], x[1], 1, &H, &inliers);
-  FundamentalFromCorrespondences7PointRobust(x[0], x[1], 1.0, &H, &inliers);
+  // The hypotheses are spread over the threads; the result does not depend
+  // on their number.
+  FundamentalFromCorrespondences7PointRobustParallel(x[0], x[1], 1.0,
+                                                     &H, &inliers);
 
   //TODO(pmoulon) insert an optimization phase.
   // Rerun Robust correspondance on the inliers.
@@ -23,6 +23,25 @@
 
 using namespace libmv;
 using namespace tracker;
+
+namespace {
+
+// Finds the matches consistent with a fundamental matrix.
+void EpipolarInliers(const Mat &x1, const Mat &x2, double max_error,
+                     double time_budget, vector<int> *inliers) {
+  Mat3 F;
+  if (time_budget > 0) {
+    PreemptiveOptions options;
+    options.time_budget = time_budget;
+    FundamentalFromCorrespondences7PointPreemptive(x1, x2, max_error, &F,
+                                                   inliers, options);
+  } else {
+    FundamentalFromCorrespondences7PointRobust(x1, x2, max_error, &F,
+                                               inliers);
+  }
+}
+
+}  // namespace
  
 bool RobustTracker::Track(const Image &image1,
                           const Image &image2, 
@@ -48,12 +67,7 @@ bool RobustTracker::Track(const Image &image1,
                      &x);
   
   vector<int> inliers;
-  Mat3 F;
-  FundamentalFromCorrespondences7PointRobust(x[0], 
-                                             x[1], 
-                                             rms_threshold_inlier_,
-                                             &F, 
-                                             &inliers);
+  EpipolarInliers(x[0], x[1], rms_threshold_inlier_, time_budget_, &inliers);
 
   // We remove correspondences that are not inliers
   size_t max_num_track = new_features_graph->matches_.GetMaxTrackID()+1;
@@ -136,12 +150,8 @@ bool RobustTracker::Track(const Image &image,
         }
       }
       vector<int> inliers;
-      Mat3 F;
-      FundamentalFromCorrespondences7PointRobust(x[0], 
-                                                 x[1], 
-                                                 rms_threshold_inlier_, 
-                                                 &F,
-                                                 &inliers);
+      EpipolarInliers(x[0], x[1], rms_threshold_inlier_, time_budget_,
+                      &inliers);
       VLOG(2) << "#inliers = "<< inliers.size() << std::endl;
       VLOG(2) << "#outliers = "<< tracks.size()-inliers.size() << std::endl;
       // We remove correspondences that are not inliers
@@ -34,6 +34,7 @@ class RobustTracker : public Tracker {
                  Tracker(detector, describer, matcher) {
     minimum_number_inliers_ = 8; // from the 8 point algorithm
     rms_threshold_inlier_   = 0.3;
+    time_budget_            = 0;
   }
                   
   virtual ~RobustTracker() {}
@@ -54,10 +55,19 @@ class RobustTracker : public Tracker {
   void set_rms_threshold_inlier(double threshold) {
     rms_threshold_inlier_ = threshold;
   }
+
+  // Bounds the time spent in each epipolar filtering (in seconds). When it
+  // is positive, the fundamental matrix is estimated with preemptive RANSAC
+  // and the best model found in time is used.
+  void set_time_budget(double seconds) {
+    time_budget_ = seconds;
+  }
  protected:
   size_t  minimum_number_inliers_;
   // Maxmimum distance with the epipolar line (px) to be an inlier
   double  rms_threshold_inlier_;
+  // Seconds per epipolar filtering; 0 means no limit.
+  double  time_budget_;
 };
 
 } // using namespace tracker
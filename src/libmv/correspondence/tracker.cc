@@ -30,38 +30,29 @@ bool Tracker::Track(const Image &image1,
                     FeaturesGraph *new_features_graph,
                     bool keep_single_feature) {
   // we detect good features to track
-  detector::DetectorData **data = NULL;
-  vector<Feature *> features1;
-  detector_->Detect(image1, &features1, data);
+  detector::DetectorData *detector_data1 = NULL;
+  PointFeatureTable features1;
+  detector_->DetectTable(image1, &features1, &detector_data1);
         
-  vector<Feature *> features2;
-  detector_->Detect(image2, &features2, data);
+  detector::DetectorData *detector_data2 = NULL;
+  PointFeatureTable features2;
+  detector_->DetectTable(image2, &features2, &detector_data2);
 
   // we compute the feature descriptors on every feature
-  detector::DetectorData *detector_data = NULL;
-  vector<descriptor::Descriptor *> descriptors1;
-  
-  describer_->Describe(features1, image1, detector_data, &descriptors1);
-  vector<descriptor::Descriptor *> descriptors2;
-  describer_->Describe(features2, image2, detector_data, &descriptors2);
+  RMatf descriptors1;
+  describer_->DescribeTable(&features1, image1, detector_data1, &descriptors1);
+  RMatf descriptors2;
+  describer_->DescribeTable(&features2, image2, detector_data2, &descriptors2);
+  delete detector_data1;
+  delete detector_data2;
   
   // Copy data form generic feature to Keypoints since the matcher is
   // a point matcher
   FeatureSet *feature_set1 = new_features_graph->CreateNewFeatureSet();
-  feature_set1->features.resize(descriptors1.size());
-  for (size_t i = 0; i < descriptors1.size(); i++) {
-    KeypointFeature& feature = feature_set1->features[i];
-    feature.descriptor = *(descriptor::VecfDescriptor*) descriptors1[i];
-    *(PointFeature*)(&feature) = *(PointFeature*)features1[i];
-  }
+  FeatureTableToFeatureSet(features1, descriptors1, feature_set1);
   
   FeatureSet *feature_set2 = new_features_graph->CreateNewFeatureSet();
-  feature_set2->features.resize(descriptors2.size());
-  for (size_t i = 0; i < descriptors2.size(); i++) {
-    KeypointFeature& feature = feature_set2->features[i];
-    feature.descriptor = *(descriptor::VecfDescriptor*) descriptors2[i];
-    *(PointFeature*)(&feature) = *(PointFeature*)features2[i];
-  }
+  FeatureTableToFeatureSet(features2, descriptors2, feature_set2);
   
   // we match them
   //TODO (jmichot) use the matcher_ to match and not the generic function
@@ -109,11 +100,6 @@ bool Tracker::Track(const Image &image1,
     }
   }
   
-  DeleteElements(&descriptors1);
-  DeleteElements(&descriptors2);
-  DeleteElements(&features1);
-  DeleteElements(&features2);
-  
   return true;
 }
 
@@ -123,24 +109,19 @@ bool Tracker::Track(const Image &image,
                     Matches::ImageID *image_id,
                     bool keep_single_feature) {
   // we detect good features to track
-  detector::DetectorData **data = NULL;
-  vector<Feature *> features;
-  detector_->Detect(image, &features, data);
+  detector::DetectorData *detector_data = NULL;
+  PointFeatureTable features;
+  detector_->DetectTable(image, &features, &detector_data);
   
   // we compute the feature descriptors on every feature
-  detector::DetectorData *detector_data = NULL;
-  vector<descriptor::Descriptor *> descriptors;
-  describer_->Describe(features, image, detector_data, &descriptors);
+  RMatf descriptors;
+  describer_->DescribeTable(&features, image, detector_data, &descriptors);
+  delete detector_data;
   
   // Copy data form generic feature to Keypoints since the matcher is
   // a point matcher
   FeatureSet *feature_set = new_features_graph->CreateNewFeatureSet();
-  feature_set->features.resize(descriptors.size());
-  for (size_t i = 0; i < descriptors.size(); i++) {
-    KeypointFeature& feature = feature_set->features[i];
-    feature.descriptor = *(descriptor::VecfDescriptor*) descriptors[i];
-    *(PointFeature*)(&feature) = *(PointFeature*)features[i];
-  }
+  FeatureTableToFeatureSet(features, descriptors, feature_set);
   if (known_features_graph.matches_.NumImages() == 0)
     *image_id = 0;
   else
@@ -208,8 +189,5 @@ bool Tracker::Track(const Image &image,
     }
   }
   
-  DeleteElements(&descriptors);
-  DeleteElements(&features);  
-  
   return true;
 }
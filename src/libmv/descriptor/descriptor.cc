@@ -0,0 +1,61 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/vector_descriptor.h"
+
+namespace libmv {
+namespace descriptor {
+
+void Describer::DescribeTable(PointFeatureTable *features,
+                              const Image &image,
+                              const detector::DetectorData *detector_data,
+                              RMatf *descriptors) {
+  vector<PointFeature> points(features->size());
+  vector<Feature *> pointers(features->size());
+  for (int i = 0; i < features->size(); ++i) {
+    points[i] = features->Point(i);
+    pointers[i] = &points[i];
+  }
+  vector<Descriptor *> described;
+  Describe(pointers, image, detector_data, &described);
+
+  vector<int> valid;
+  int size = 0;
+  for (int i = 0; i < described.size(); ++i) {
+    VecfDescriptor *vecf = dynamic_cast<VecfDescriptor *>(described[i]);
+    if (vecf) {
+      valid.push_back(i);
+      size = vecf->coords.size();
+    }
+  }
+  descriptors->resize(valid.size(), size);
+  for (int i = 0; i < valid.size(); ++i) {
+    descriptors->row(i) =
+        static_cast<VecfDescriptor *>(described[valid[i]])->coords.transpose();
+  }
+  features->Select(valid);
+  DeleteElements(&described);
+}
+
+}  // namespace descriptor
+}  // namespace libmv
@@ -22,6 +22,8 @@
 #define LIBMV_DESCRIPTOR_DESCRIPTOR_H
 
 #include "libmv/base/vector.h"
+#include "libmv/correspondence/feature_table.h"
+#include "libmv/numeric/numeric.h"
 
 namespace libmv {
 
@@ -69,6 +71,26 @@ class Describer {
                         const Image &image,
                         const detector::DetectorData *detector_data,
                         vector<Descriptor *> *descriptors) = 0;
+
+  /**
+   * Describes a table of point features into a row-major matrix.
+   *
+   * \param[in,out] features     The features to describe. Features whose
+   *                             description couldn't be computed are removed
+   *                             so that the table and the matrix stay aligned.
+   * \param[in]     image        The image to compute descriptions from.
+   * \param[in]     detector_data Data from the detector or NULL.
+   * \param[out]    descriptors  One descriptor per row, in the order of the
+   *                             features table.
+   *
+   * This is the batch version of Describe. The default implementation builds
+   * the Feature and Descriptor objects, runs Describe and copies the result;
+   * describers that can write into the matrix rows override it.
+   */
+  virtual void DescribeTable(PointFeatureTable *features,
+                             const Image &image,
+                             const detector::DetectorData *detector_data,
+                             RMatf *descriptors);
 };
 
 }  // namespace descriptor
@@ -23,6 +23,7 @@
 #include "libmv/descriptor/descriptor.h"
 #include "libmv/descriptor/vector_descriptor.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/detector/pyramid_detector.h"
 #include "libmv/image/convolve.h"
 #include "libmv/image/image.h"
 #include "libmv/image/sample.h"
@@ -90,13 +91,32 @@ void PickDipole(const TImage & image, float x, float y, float scale,
   // Normalize to be affine luminance invariant (a*I(x,y)+b).
 }
 
+// Samples the dipoles on the pyramid level matching the spacing of the
+// second order dipoles when the detector exported a pyramid, on the input
+// image otherwise.
+template <typename T>
+void PickDipoleAtScale(const Image &image,
+                       const detector::PyramidDetectorData *pyramid,
+                       float x, float y, float scale, double angle, T *data) {
+  const int level = pyramid ? pyramid->LevelForStep(scale / 2) : 0;
+  if (level == 0) {
+    PickDipole(*(image.AsArray3Du()), x, y, scale, angle, data);
+  } else {
+    PickDipole(pyramid->pyramid()->Level(level),
+               detector::PyramidDetectorData::ToLevel(x, level),
+               detector::PyramidDetectorData::ToLevel(y, level),
+               scale / (1 << level), angle, data);
+  }
+}
+
 class DipoleDescriber : public Describer {
  public:
   virtual void Describe(const vector<Feature *> &features,
                         const Image &image,
                         const detector::DetectorData *detector_data,
                         vector<Descriptor *> *descriptors) {
-    (void) detector_data; // There is no matching detector for DipoleDescriptor.
+    const detector::PyramidDetectorData *pyramid =
+        dynamic_cast<const detector::PyramidDetectorData *>(detector_data);
 
     const int DIPOLE_DESC_SIZE = 20;
     descriptors->resize(features.size());
@@ -105,7 +125,7 @@ class DipoleDescriber : public Describer {
       VecfDescriptor *descriptor = NULL;
       if (point) {
         descriptor = new VecfDescriptor(DIPOLE_DESC_SIZE);
-        PickDipole( *(image.AsArray3Du()),
+        PickDipoleAtScale(image, pyramid,
                   point->x(),
                   point->y(),
                   point->scale,
@@ -115,6 +135,26 @@ class DipoleDescriber : public Describer {
       (*descriptors)[i] = descriptor;
     }
   }
+
+  virtual void DescribeTable(PointFeatureTable *features,
+                             const Image &image,
+                             const detector::DetectorData *detector_data,
+                             RMatf *descriptors) {
+    const detector::PyramidDetectorData *pyramid =
+        dynamic_cast<const detector::PyramidDetectorData *>(detector_data);
+
+    const int DIPOLE_DESC_SIZE = 20;
+    descriptors->resize(features->size(), DIPOLE_DESC_SIZE);
+    for (int i = 0; i < features->size(); ++i) {
+      Map<Vecf> row(descriptors->row(i).data(), DIPOLE_DESC_SIZE);
+      PickDipoleAtScale(image, pyramid,
+                features->x[i],
+                features->y[i],
+                features->scale[i],
+                features->orientation[i],
+                &row);
+    }
+  }
 };
 
 Describer *CreateDipoleDescriber() {
@@ -23,6 +23,7 @@
 #include "libmv/descriptor/descriptor.h"
 #include "libmv/descriptor/vector_descriptor.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/detector/pyramid_detector.h"
 #include "libmv/image/image.h"
 #include "libmv/image/sample.h"
 #include <cmath>
@@ -101,13 +102,31 @@ void PickPatch(const TImage & image, float x, float y, float scale,
   normalize(data,data,WINDOW_SIZE*WINDOW_SIZE,mean,stddev);
 }
 
+// Samples the patch on the pyramid level matching the feature scale when the
+// detector exported a pyramid, on the input image otherwise.
+template <typename T>
+void PickPatchAtScale(const Image &image,
+                      const detector::PyramidDetectorData *pyramid,
+                      float x, float y, float scale, double angle, T *data) {
+  const int level = pyramid ? pyramid->LevelForStep(scale) : 0;
+  if (level == 0) {
+    PickPatch(*(image.AsArray3Du()), x, y, scale, angle, data);
+  } else {
+    PickPatch(pyramid->pyramid()->Level(level),
+              detector::PyramidDetectorData::ToLevel(x, level),
+              detector::PyramidDetectorData::ToLevel(y, level),
+              scale / (1 << level), angle, data);
+  }
+}
+
 class SimpliestDescriber : public Describer {
  public:
   virtual void Describe(const vector<Feature *> &features,
                         const Image &image,
                         const detector::DetectorData *detector_data,
                         vector<Descriptor *> *descriptors) {
-    (void) detector_data;  // There is no matching detector for SIMPLIEST.
+    const detector::PyramidDetectorData *pyramid =
+        dynamic_cast<const detector::PyramidDetectorData *>(detector_data);
 
     const int SIMPLIEST_DESC_SIZE = 64;
     descriptors->resize(features.size());
@@ -116,7 +135,7 @@ class SimpliestDescriber : public Describer {
       VecfDescriptor *descriptor = NULL;
       if (point) {
         descriptor = new VecfDescriptor(SIMPLIEST_DESC_SIZE);
-        PickPatch( *(image.AsArray3Du()),
+        PickPatchAtScale(image, pyramid,
                   point->x(),
                   point->y(),
                   point->scale,
@@ -126,6 +145,25 @@ class SimpliestDescriber : public Describer {
       (*descriptors)[i] = descriptor;
     }
   }
+
+  virtual void DescribeTable(PointFeatureTable *features,
+                             const Image &image,
+                             const detector::DetectorData *detector_data,
+                             RMatf *descriptors) {
+    const detector::PyramidDetectorData *pyramid =
+        dynamic_cast<const detector::PyramidDetectorData *>(detector_data);
+
+    const int SIMPLIEST_DESC_SIZE = 64;
+    descriptors->resize(features->size(), SIMPLIEST_DESC_SIZE);
+    for (int i = 0; i < features->size(); ++i) {
+      PickPatchAtScale(image, pyramid,
+                features->x[i],
+                features->y[i],
+                features->scale[i],
+                features->orientation[i],
+                descriptors->row(i).data());
+    }
+  }
 };
 
 Describer *CreateSimpliestDescriber() {
@@ -22,6 +22,7 @@
 #define LIBMV_DETECTOR_DETECTOR_H
 
 #include "libmv/base/vector.h"
+#include "libmv/correspondence/feature_table.h"
 
 namespace libmv {
 
@@ -68,6 +69,22 @@ class Detector {
   virtual void Detect(const Image &image,
                       vector<Feature *> *features,
                       DetectorData **data) = 0;
+
+  /**
+   * Detects point features in an image into a structure of arrays.
+   *
+   * \param[in]  image     The image to detect features in.
+   * \param[out] features  The detected features, appended to the table.
+   * \param[out] data      Same as for Detect.
+   *
+   * This is the batch version of Detect. The default implementation runs
+   * Detect and copies the PointFeatures into the table; detectors that can
+   * write the table directly override it to avoid the per feature
+   * allocations.
+   */
+  virtual void DetectTable(const Image &image,
+                           PointFeatureTable *features,
+                           DetectorData **data);
 };
 
 }  // namespace detector
@@ -18,9 +18,11 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include "libmv/base/vector_utils.h"
 #include "libmv/detector/detector.h"
 #include "libmv/detector/detector_factory.h"
 #include "libmv/detector/fast_detector.h"
+#include "libmv/detector/pyramid_detector.h"
 #include "libmv/detector/star_detector.h"
 #include "libmv/detector/surf_detector.h"
 #include "libmv/logging/logging.h"
@@ -46,11 +48,30 @@ Detector *detectorFactory(eDetector edetector)  {
     break;
   case MSER_DETECTOR:
     break;
+  case FAST_GRID_DETECTOR:
+    return detector::CreateFastGridDetector();
+    break;
   default:
     LOG(FATAL) << "ERROR : undefined Detector value : " << edetector;
   }
   return NULL;
 }
 
+Detector *detectorFactory(eDetector edetector, int num_levels)  {
+  if (num_levels <= 1) {
+    return detectorFactory(edetector);
+  }
+  vector<Detector *> level_detectors;
+  for (int i = 0; i < num_levels; ++i) {
+    Detector *level_detector = detectorFactory(edetector);
+    if (!level_detector) {
+      DeleteElements(&level_detectors);
+      return NULL;
+    }
+    level_detectors.push_back(level_detector);
+  }
+  return new PyramidDetector(level_detectors, PyramidDetectorOptions());
+}
+
 }  // namespace detector
 }  // namespace libmv
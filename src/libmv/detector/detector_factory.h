@@ -32,7 +32,8 @@ enum eDetector
   FAST_LIMITED_DETECTOR,
   SURF_DETECTOR,
   STAR_DETECTOR,
-  MSER_DETECTOR
+  MSER_DETECTOR,
+  FAST_GRID_DETECTOR
 };
 /**
  * Creates the corresponding detector.
@@ -41,6 +42,13 @@ enum eDetector
  */
 Detector *detectorFactory(eDetector edetector = FAST_LIMITED_DETECTOR);
 
+/**
+ * Creates a PyramidDetector searching num_levels pyramid levels, each with its
+ * own detector of the wanted type. With num_levels = 1 this is the same as
+ * detectorFactory(edetector).
+ */
+Detector *detectorFactory(eDetector edetector, int num_levels);
+
 } // namespace detector
 } // namespace libmv
 
@@ -44,6 +44,16 @@ class FastDetector : public Detector {
   virtual void Detect(const Image &image,
                       vector<Feature *> *features,
                       DetectorData **data) {
+    PointFeatureTable table;
+    DetectTable(image, &table, data);
+    for (int i = 0; i < table.size(); ++i) {
+      features->push_back(new PointFeature(table.Point(i)));
+    }
+  }
+
+  virtual void DetectTable(const Image &image,
+                           PointFeatureTable *features,
+                           DetectorData **data) {
     int num_corners = 0;
     ByteImage *byte_image = image.AsArray3Du();
     if (byte_image) {
@@ -51,17 +61,15 @@ class FastDetector : public Detector {
           byte_image->Width(), byte_image->Height(), byte_image->Width(),
           threshold_, &num_corners);
 
+      const int first = features->size();
+      features->Reserve(first + num_corners);
       for (int i = 0; i < num_corners; ++i) {
-        PointFeature *f = new PointFeature(detections[i].x, detections[i].y);
-        f->scale = 3.0;
-        f->orientation = 0.0;
-        features->push_back(f);
+        features->Append(detections[i].x, detections[i].y, 3.0, 0.0);
       }
       free( detections );
 
       if (bRotationInvariant_) {
-        fastRotationEstimation(*byte_image,*features);
-        //gradientBoxesRotationEstimation(*byte_image,*features);
+        FastRingOrientations(*byte_image, features, first);
       }
     }
     else  {
@@ -60,6 +60,25 @@ Detector *CreateFastDetectorLimited(int threshold = 30,
                               bool bRotationInvariant = false,
                               int nKeypointMax = 256);
 
+/**
+ * Creates the in-tree FAST-9 detector (see fast_grid_detector.h). The image
+ * is split in a grid of tiles whose thresholds adapt between calls so that
+ * each tile contributes about nKeypointMax / (grid_rows * grid_cols) corners.
+ * The implementation never returns detection data.
+ *
+ * \param nKeypointMax How many points could be detected.
+ * \param grid_rows    Number of tiles along the image height.
+ * \param grid_cols    Number of tiles along the image width.
+ * \param threshold    Initial barrier of every tile.
+ * \param bRotationInvariant Tell if orientation of detected features must
+ *                            be estimated.
+ */
+Detector *CreateFastGridDetector(int nKeypointMax = 512,
+                                 int grid_rows = 4,
+                                 int grid_cols = 4,
+                                 int threshold = 30,
+                                 bool bRotationInvariant = false);
+
 }  // namespace detector
 }  // namespace libmv
 
@@ -89,6 +89,16 @@ class FastDetectorLimited : public Detector {
   virtual void Detect(const Image &image,
                       vector<Feature *> *features,
                       DetectorData **data) {
+    PointFeatureTable table;
+    DetectTable(image, &table, data);
+    for (int i = 0; i < table.size(); ++i) {
+      features->push_back(new PointFeature(table.Point(i)));
+    }
+  }
+
+  virtual void DetectTable(const Image &image,
+                           PointFeatureTable *features,
+                           DetectorData **data) {
     int num_corners = 0;
     ByteImage *byte_image = image.AsArray3Du();
     if (byte_image) {
@@ -116,18 +126,16 @@ class FastDetectorLimited : public Detector {
       free(scores);
       free(corners);
 
+      const int first = features->size();
       for (int i = 0; i < std::min(expectedFeatureNumber_,ret_num_corners);
           ++i) {
-        PointFeature *f = new PointFeature(ptScores[i].first->x,
-                            ptScores[i].first->y);
-        f->scale = 3.0;
-        f->orientation = 0.0;
-        features->push_back(f);
+        features->Append(ptScores[i].first->x, ptScores[i].first->y,
+                         3.0, 0.0, ptScores[i].second);
       }
       free( nonmax );
 
       if (bRotationInvariant_) {
-        fastRotationEstimation(*byte_image,*features);
+        FastRingOrientations(*byte_image, features, first);
       }
     }
     else  {
@@ -0,0 +1,471 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "libmv/correspondence/feature.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/fast_detector.h"
+#include "libmv/detector/fast_grid_detector.h"
+#include "libmv/detector/orientation_detector.h"
+#include "libmv/image/image.h"
+#include "libmv/logging/logging.h"
+
+namespace libmv {
+namespace detector {
+namespace {
+
+// Bresenham circle of radius 3, clockwise starting on the right.
+const int kRingX[16] = {3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1, 0, 1, 2, 3};
+const int kRingY[16] = {0, 1, 2, 3, 3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1};
+
+const int kBorder = 3;
+
+void RingOffsets(int stride, int offsets[16]) {
+  for (int i = 0; i < 16; ++i) {
+    offsets[i] = kRingX[i] + stride * kRingY[i];
+  }
+}
+
+// True if 9 contiguous bits are set in the circular 16 bit mask.
+inline bool HasArc9(unsigned int mask) {
+  unsigned int doubled = mask | (mask << 16);
+  unsigned int arc = doubled;
+  for (int k = 1; k < 9; ++k) {
+    arc &= doubled >> k;
+  }
+  return (arc & 0xFFFF) != 0;
+}
+
+// Sum of the absolute differences between the center and the ring pixels
+// that pass the barrier, on the brighter or darker side whichever is larger.
+// It does not depend on the barrier itself beyond the pixel selection, so
+// scores of tiles using different barriers can be compared.
+inline int SadScore(const unsigned char *p, const int offsets[16],
+                    int threshold) {
+  const int center = *p;
+  int bright = 0, dark = 0;
+  for (int i = 0; i < 16; ++i) {
+    int v = p[offsets[i]];
+    if (v > center + threshold) {
+      bright += v - center;
+    } else if (v < center - threshold) {
+      dark += center - v;
+    }
+  }
+  return std::max(bright, dark);
+}
+
+inline int ScalarCornerScore(const unsigned char *p, const int offsets[16],
+                             int threshold) {
+  const int center = *p;
+  unsigned int bright = 0, dark = 0;
+  for (int i = 0; i < 16; ++i) {
+    int v = p[offsets[i]];
+    if (v > center + threshold) {
+      bright |= 1 << i;
+    } else if (v < center - threshold) {
+      dark |= 1 << i;
+    }
+  }
+  if (!HasArc9(bright) && !HasArc9(dark)) {
+    return 0;
+  }
+  return SadScore(p, offsets, threshold);
+}
+
+#ifdef __SSE2__
+// Returns a 16 bit mask with bit i set if pixel p[i] passes the FAST-9
+// segment test. All the 16 pixels are tested at once.
+inline int SegmentTest16(const unsigned char *p, const int offsets[16],
+                         int threshold) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_cmpeq_epi8(zero, zero);
+  const __m128i barrier = _mm_set1_epi8(static_cast<char>(threshold));
+  const __m128i center = _mm_loadu_si128((const __m128i *) p);
+  const __m128i high = _mm_adds_epu8(center, barrier);
+  const __m128i low = _mm_subs_epu8(center, barrier);
+
+#define LIBMV_FAST_BRIGHT(v) \
+  _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8((v), high), zero), ones)
+#define LIBMV_FAST_DARK(v) \
+  _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(low, (v)), zero), ones)
+
+  // An arc of 9 contains two consecutive compass points; use them to reject
+  // most of the pixels before loading the whole ring.
+  __m128i b[16], d[16];
+  for (int i = 0; i < 16; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *) (p + offsets[i]));
+    b[i] = LIBMV_FAST_BRIGHT(v);
+    d[i] = LIBMV_FAST_DARK(v);
+  }
+  __m128i possible = zero;
+  for (int i = 0; i < 16; i += 4) {
+    possible = _mm_or_si128(possible,
+                            _mm_and_si128(b[i], b[(i + 4) & 15]));
+    possible = _mm_or_si128(possible,
+                            _mm_and_si128(d[i], d[(i + 4) & 15]));
+  }
+  if (_mm_movemask_epi8(possible) == 0) {
+    return 0;
+  }
+  for (int i = 0; i < 16; ++i) {
+    if (i % 4 == 0) {
+      continue;
+    }
+    __m128i v = _mm_loadu_si128((const __m128i *) (p + offsets[i]));
+    b[i] = LIBMV_FAST_BRIGHT(v);
+    d[i] = LIBMV_FAST_DARK(v);
+  }
+#undef LIBMV_FAST_BRIGHT
+#undef LIBMV_FAST_DARK
+
+  // Contiguous arcs by doubling: arc of 2, 4, 8 and finally 9.
+  __m128i b2[16], d2[16], b4[16], d4[16];
+  for (int i = 0; i < 16; ++i) {
+    b2[i] = _mm_and_si128(b[i], b[(i + 1) & 15]);
+    d2[i] = _mm_and_si128(d[i], d[(i + 1) & 15]);
+  }
+  for (int i = 0; i < 16; ++i) {
+    b4[i] = _mm_and_si128(b2[i], b2[(i + 2) & 15]);
+    d4[i] = _mm_and_si128(d2[i], d2[(i + 2) & 15]);
+  }
+  __m128i corner = zero;
+  for (int i = 0; i < 16; ++i) {
+    __m128i b9 = _mm_and_si128(_mm_and_si128(b4[i], b4[(i + 4) & 15]),
+                               b[(i + 8) & 15]);
+    __m128i d9 = _mm_and_si128(_mm_and_si128(d4[i], d4[(i + 4) & 15]),
+                               d[(i + 8) & 15]);
+    corner = _mm_or_si128(corner, _mm_or_si128(b9, d9));
+  }
+  return _mm_movemask_epi8(corner);
+}
+#endif  // __SSE2__
+
+struct CornerScoreGreater {
+  template<typename T>
+  bool operator()(const T &a, const T &b) const {
+    return a.score > b.score;
+  }
+};
+
+}  // namespace
+
+int FastCornerScore(const unsigned char *p, int stride, int threshold) {
+  int offsets[16];
+  RingOffsets(stride, offsets);
+  return ScalarCornerScore(p, offsets, threshold);
+}
+
+FastGridDetector::FastGridDetector(const FastGridOptions &options)
+    : options_(options),
+      thresholds_(std::max(1, options.grid_rows * options.grid_cols),
+                  options.initial_threshold),
+      map_width_(0),
+      map_height_(0) {
+  CHECK(options_.grid_rows > 0);
+  CHECK(options_.grid_cols > 0);
+  CHECK(options_.min_threshold > 0);
+  CHECK(options_.min_threshold <= options_.max_threshold);
+  CHECK(options_.max_threshold < 256);
+  for (int i = 0; i < thresholds_.size(); ++i) {
+    thresholds_[i] = std::min(options_.max_threshold,
+                              std::max(options_.min_threshold, thresholds_[i]));
+  }
+}
+
+int FastGridDetector::TileThreshold(int row, int col) const {
+  return thresholds_[row * options_.grid_cols + col];
+}
+
+void FastGridDetector::DetectTile(const ByteImage &image,
+                                  int x0, int y0, int x1, int y1,
+                                  int threshold,
+                                  vector<Corner> *corners) {
+  const int stride = image.Width();
+  int offsets[16];
+  RingOffsets(stride, offsets);
+  Corner corner;
+  for (int y = y0; y < y1; ++y) {
+    const unsigned char *row = image.Data() + y * stride;
+    unsigned short *scores = &score_map_[y * stride];
+    int x = x0;
+#ifdef __SSE2__
+    for (; x + 16 <= x1; x += 16) {
+      int mask = SegmentTest16(row + x, offsets, threshold);
+      while (mask) {
+        int lane = 0;
+        while (!(mask & (1 << lane))) {
+          ++lane;
+        }
+        mask &= ~(1 << lane);
+        corner.x = x + lane;
+        corner.y = y;
+        corner.score = SadScore(row + corner.x, offsets, threshold);
+        scores[corner.x] = std::min(corner.score, 65535);
+        corners->push_back(corner);
+      }
+    }
+#endif  // __SSE2__
+    for (; x < x1; ++x) {
+      int score = ScalarCornerScore(row + x, offsets, threshold);
+      if (score) {
+        corner.x = x;
+        corner.y = y;
+        corner.score = score;
+        scores[x] = std::min(score, 65535);
+        corners->push_back(corner);
+      }
+    }
+  }
+}
+
+void FastGridDetector::DetectCorners(const ByteImage &image) {
+  // resize(0) rather than clear() keeps the capacity between frames.
+  selected_.resize(0);
+  const int width = image.Width();
+  const int height = image.Height();
+  if (image.Depth() != 1) {
+    LOG(ERROR) << "FastGridDetector expects a single channel image.";
+    return;
+  }
+  if (width <= 2 * kBorder || height <= 2 * kBorder) {
+    return;
+  }
+  if (width != map_width_ || height != map_height_) {
+    score_map_.resize(width * height);
+    std::fill(score_map_.begin(), score_map_.end(), 0);
+    map_width_ = width;
+    map_height_ = height;
+  }
+
+  const int grid_rows = options_.grid_rows;
+  const int grid_cols = options_.grid_cols;
+  const int num_tiles = grid_rows * grid_cols;
+  const int per_tile = std::max(1, options_.max_features / num_tiles);
+  const int tile_width =
+      (width - 2 * kBorder + grid_cols - 1) / grid_cols;
+  const int tile_height =
+      (height - 2 * kBorder + grid_rows - 1) / grid_rows;
+
+  // Pass 1: segment test of every tile, lowering the barrier of starving
+  // tiles a bounded number of times.
+  candidates_.resize(0);
+  tile_begin_.resize(num_tiles + 1);
+  for (int r = 0; r < grid_rows; ++r) {
+    for (int c = 0; c < grid_cols; ++c) {
+      const int tile = r * grid_cols + c;
+      const int x0 = kBorder + c * tile_width;
+      const int y0 = kBorder + r * tile_height;
+      const int x1 = std::min(x0 + tile_width, width - kBorder);
+      const int y1 = std::min(y0 + tile_height, height - kBorder);
+      const int begin = candidates_.size();
+      tile_begin_[tile] = begin;
+      int threshold = thresholds_[tile];
+      for (int retry = 0; ; ++retry) {
+        candidates_.resize(begin);
+        DetectTile(image, x0, y0, x1, y1, threshold, &candidates_);
+        DCHECK_LE(begin, candidates_.size());
+        const int num_tile_candidates = candidates_.size() - begin;
+        if (num_tile_candidates >= per_tile ||
+            threshold <= options_.min_threshold ||
+            retry >= options_.max_retries) {
+          break;
+        }
+        threshold = std::max(options_.min_threshold, threshold / 2);
+      }
+      thresholds_[tile] = threshold;
+    }
+  }
+  tile_begin_[num_tiles] = candidates_.size();
+
+  // Pass 2: 3x3 non-maximum suppression on the score map, then keep the
+  // strongest corners of each tile. Ties are broken in raster order so that a
+  // plateau produces exactly one corner.
+  leftovers_.resize(0);
+  const unsigned short *map = &score_map_[0];
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    const int begin = selected_.size();
+    for (int i = tile_begin_[tile]; i < tile_begin_[tile + 1]; ++i) {
+      const Corner &corner = candidates_[i];
+      const unsigned short *s = map + corner.y * width + corner.x;
+      const int score = *s;
+      if (s[-width - 1] >= score || s[-width] >= score ||
+          s[-width + 1] >= score || s[-1] >= score ||
+          s[1] > score || s[width - 1] > score ||
+          s[width] > score || s[width + 1] > score) {
+        continue;
+      }
+      selected_.push_back(corner);
+    }
+    const int num_maxima = selected_.size() - begin;
+    if (num_maxima > per_tile) {
+      std::nth_element(selected_.begin() + begin,
+                       selected_.begin() + begin + per_tile,
+                       selected_.end(),
+                       CornerScoreGreater());
+      for (int i = begin + per_tile; i < selected_.size(); ++i) {
+        leftovers_.push_back(selected_[i]);
+      }
+      selected_.resize(begin + per_tile);
+    }
+
+    // Adapt the barrier for the next frame.
+    int &threshold = thresholds_[tile];
+    const int step = std::max(1, threshold / 4);
+    if (num_maxima > 2 * per_tile) {
+      threshold = std::min(options_.max_threshold, threshold + step);
+    } else if (num_maxima < per_tile) {
+      threshold = std::max(options_.min_threshold, threshold - step);
+    }
+  }
+  for (int i = 0; i < candidates_.size(); ++i) {
+    score_map_[candidates_[i].y * width + candidates_[i].x] = 0;
+  }
+
+  // Spend the budget left by textureless tiles on the best other corners.
+  const int budget = options_.max_features - int(selected_.size());
+  if (budget > 0 && leftovers_.size() > 0) {
+    const int extra = std::min(budget, int(leftovers_.size()));
+    std::nth_element(leftovers_.begin(), leftovers_.begin() + extra,
+                     leftovers_.end(), CornerScoreGreater());
+    for (int i = 0; i < extra; ++i) {
+      selected_.push_back(leftovers_[i]);
+    }
+  }
+
+  // Estimate orientation from the intensity centroid of the ring while the
+  // corner pixels are hot in cache.
+  if (!options_.rotation_invariant) {
+    for (int i = 0; i < selected_.size(); ++i) {
+      selected_[i].orientation = 0.0;
+    }
+    return;
+  }
+  int offsets[16];
+  RingOffsets(width, offsets);
+  float ring_dx[16], ring_dy[16];
+  for (int i = 0; i < 16; ++i) {
+    float norm = std::sqrt(float(kRingX[i] * kRingX[i] +
+                                 kRingY[i] * kRingY[i]));
+    ring_dx[i] = kRingX[i] / norm;
+    ring_dy[i] = kRingY[i] / norm;
+  }
+  for (int i = 0; i < selected_.size(); ++i) {
+    Corner &corner = selected_[i];
+    const unsigned char *p = image.Data() + corner.y * width + corner.x;
+    const int center = *p;
+    float dx = 0, dy = 0;
+    for (int k = 0; k < 16; ++k) {
+      int diff = p[offsets[k]] - center;
+      dx += diff * ring_dx[k];
+      dy += diff * ring_dy[k];
+    }
+    corner.orientation = 0.0;
+    if (dx != 0 || dy != 0) {
+      corner.orientation = getCoterminalAngle(atan2(dy, dx));
+    }
+  }
+}
+
+void FastGridDetector::DetectInto(const ByteImage &image,
+                                  vector<PointFeature> *features,
+                                  vector<float> *scores) {
+  DetectCorners(image);
+  features->resize(selected_.size());
+  if (scores) {
+    scores->resize(selected_.size());
+  }
+  for (int i = 0; i < selected_.size(); ++i) {
+    const Corner &corner = selected_[i];
+    PointFeature &feature = (*features)[i];
+    feature.coords(0) = corner.x;
+    feature.coords(1) = corner.y;
+    feature.scale = 3.0;
+    feature.orientation = corner.orientation;
+    if (scores) {
+      (*scores)[i] = corner.score;
+    }
+  }
+}
+
+void FastGridDetector::DetectTable(const Image &image,
+                                   PointFeatureTable *features,
+                                   DetectorData **data) {
+  ByteImage *byte_image = image.AsArray3Du();
+  if (byte_image) {
+    DetectCorners(*byte_image);
+    features->Reserve(features->size() + selected_.size());
+    for (int i = 0; i < selected_.size(); ++i) {
+      const Corner &corner = selected_[i];
+      features->Append(corner.x, corner.y, 3.0, corner.orientation,
+                       corner.score);
+    }
+  } else {
+    LOG(ERROR) << "Invalid input image type for FastGridDetector";
+  }
+  if (data) {
+    *data = NULL;
+  }
+}
+
+void FastGridDetector::Detect(const Image &image,
+                              vector<Feature *> *features,
+                              DetectorData **data) {
+  ByteImage *byte_image = image.AsArray3Du();
+  if (byte_image) {
+    vector<PointFeature> detections;
+    DetectInto(*byte_image, &detections, NULL);
+    features->reserve(features->size() + detections.size());
+    for (int i = 0; i < detections.size(); ++i) {
+      features->push_back(new PointFeature(detections[i]));
+    }
+  } else {
+    LOG(ERROR) << "Invalid input image type for FastGridDetector";
+  }
+
+  // FAST doesn't have a corresponding descriptor, so there's no extra data
+  // to export.
+  if (data) {
+    *data = NULL;
+  }
+}
+
+Detector *CreateFastGridDetector(int nKeypointMax,
+                                 int grid_rows,
+                                 int grid_cols,
+                                 int threshold,
+                                 bool bRotationInvariant) {
+  FastGridOptions options;
+  options.max_features = nKeypointMax;
+  options.grid_rows = grid_rows;
+  options.grid_cols = grid_cols;
+  options.initial_threshold = threshold;
+  options.rotation_invariant = bRotationInvariant;
+  return new FastGridDetector(options);
+}
+
+}  // namespace detector
+}  // namespace libmv
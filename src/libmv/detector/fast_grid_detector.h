@@ -0,0 +1,137 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_DETECTOR_FAST_GRID_DETECTOR_H
+#define LIBMV_DETECTOR_FAST_GRID_DETECTOR_H
+
+#include "libmv/base/vector.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/detector/detector.h"
+#include "libmv/image/image.h"
+
+namespace libmv {
+namespace detector {
+
+/**
+ * Options of the in-tree FAST-9 detector.
+ *
+ * The image is split in grid_rows x grid_cols tiles. Each tile owns a
+ * threshold that is adapted from frame to frame so that the tile produces
+ * about max_features / (grid_rows * grid_cols) corners. The detector never
+ * returns more than max_features corners.
+ */
+struct FastGridOptions {
+  FastGridOptions()
+    : max_features(512),
+      grid_rows(4),
+      grid_cols(4),
+      initial_threshold(30),
+      min_threshold(5),
+      max_threshold(120),
+      max_retries(2),
+      rotation_invariant(false) {}
+
+  int max_features;       // Upper bound on the number of returned corners.
+  int grid_rows;          // Number of tiles along the image height.
+  int grid_cols;          // Number of tiles along the image width.
+  int initial_threshold;  // Barrier used for a tile the first time it is seen.
+  int min_threshold;      // The per-tile barrier never goes below this value.
+  int max_threshold;      // The per-tile barrier never goes above this value.
+  int max_retries;        // Number of lowered-barrier re-detections per tile.
+  bool rotation_invariant;
+};
+
+/**
+ * FAST-9 corner detector with a per tile adaptive threshold [1].
+ *
+ * Unlike the third_party wrapper (CreateFastDetector) the segment test is
+ * done 16 pixels at a time with SSE2 when available, the corner score,
+ * non-maximum suppression and orientation are computed while walking the
+ * candidate list once, and the result is written into a contiguous buffer.
+ * The detector keeps per tile thresholds between calls, so it is meant to be
+ * used on a video stream: the work per frame is bounded by the number of
+ * tiles times (1 + max_retries) segment test passes.
+ *
+ * [1] Machine learning for high-speed corner detection,
+ *     E. Rosten and T. Drummond, ECCV 2006
+ */
+class FastGridDetector : public Detector {
+ public:
+  FastGridDetector(const FastGridOptions &options);
+  virtual ~FastGridDetector() {}
+
+  virtual void Detect(const Image &image,
+                      vector<Feature *> *features,
+                      DetectorData **data);
+
+  /**
+   * Detects corners without allocating a Feature per corner.
+   *
+   * \param[in]  image    Single channel byte image.
+   * \param[out] features Detected corners, grouped by tile. Previous contents
+   *                      are discarded.
+   * \param[out] scores   Corner scores (sum of the absolute differences
+   *                      between the center and the arc pixels), parallel to
+   *                      features. May be NULL.
+   */
+  void DetectInto(const ByteImage &image,
+                  vector<PointFeature> *features,
+                  vector<float> *scores);
+
+  virtual void DetectTable(const Image &image,
+                           PointFeatureTable *features,
+                           DetectorData **data);
+
+  /// Current barrier of tile (row, col); mostly useful for tests.
+  int TileThreshold(int row, int col) const;
+
+ private:
+  struct Corner {
+    int x, y;
+    int score;
+    float orientation;
+  };
+
+  // Fills selected_ with the corners of the image.
+  void DetectCorners(const ByteImage &image);
+  void DetectTile(const ByteImage &image, int x0, int y0, int x1, int y1,
+                  int threshold, vector<Corner> *corners);
+
+  FastGridOptions options_;
+  vector<int> thresholds_;           // One barrier per tile, row major.
+  vector<unsigned short> score_map_; // Reused between frames.
+  vector<Corner> candidates_;        // Reused between frames.
+  vector<Corner> selected_;          // Reused between frames.
+  vector<Corner> leftovers_;         // Reused between frames.
+  vector<int> tile_begin_;           // Candidate range of each tile.
+  int map_width_, map_height_;
+};
+
+/**
+ * Segment test of one pixel for FAST-9, exposed for testing the vectorized
+ * code path. Returns the corner score or 0 if the pixel is not a corner.
+ * The pixel must be at least 3 pixels away from the image border.
+ */
+int FastCornerScore(const unsigned char *p, int stride, int threshold);
+
+}  // namespace detector
+}  // namespace libmv
+
+#endif  // LIBMV_DETECTOR_FAST_GRID_DETECTOR_H
@@ -0,0 +1,189 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <set>
+#include <utility>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/fast_detector.h"
+#include "libmv/detector/fast_grid_detector.h"
+#include "libmv/image/image.h"
+#include "testing/testing.h"
+
+static const int indX[16] = {3,3,2,1,0,-1,-2,-3,-3,-3,-2,-1,0,1,2,3};
+static const int indY[16] = {0,1,2,3,3,3,2,1,0,-1,-2,-3,-3,-3,-2,-1};
+
+namespace libmv {
+namespace detector {
+namespace {
+
+void DrawRing(int x, int y, Array3Du *image) {
+  for(int j = 0; j < 16; ++j) {
+    (*image)(y + indY[j], x + indX[j]) = 255;
+  }
+}
+
+void RandomImage(int width, int height, Array3Du *image) {
+  image->Resize(height, width);
+  srand(5);
+  for (int i = 0; i < width * height; ++i) {
+    image->Data()[i] = rand() % 256;
+  }
+}
+
+// Constant barrier and unbounded budget: the output must be the set of 3x3
+// local maxima of the scalar segment test.
+FastGridOptions FixedThresholdOptions(int threshold) {
+  FastGridOptions options;
+  options.max_features = 1 << 20;
+  options.grid_rows = 1;
+  options.grid_cols = 1;
+  options.initial_threshold = threshold;
+  options.min_threshold = threshold;
+  options.max_threshold = threshold;
+  return options;
+}
+
+TEST(FastGridDetector, Localisation) {
+  Array3Du image(20, 20);
+  image.fill(0);
+
+  int x = 15, y = 10;
+  DrawRing(x, y, &image);
+
+  scoped_ptr<Detector> detector(CreateFastGridDetector(16, 1, 1, 20));
+
+  vector<Feature *> features;
+  Image im(new Array3Du(image));
+  detector->Detect(im, &features, NULL);
+
+  // The isolated ring pixels are corners too; the center must be found once.
+  int found = 0;
+  for (int i = 0; i < features.size(); ++i) {
+    PointFeature *pt = static_cast<PointFeature *>(features[i]);
+    found += (pt->x() == x && pt->y() == y);
+  }
+  EXPECT_EQ(1, found);
+
+  DeleteElements(&features);
+}
+
+TEST(FastGridDetector, MatchesScalarSegmentTest) {
+  const int width = 67, height = 45, threshold = 40;
+  Array3Du image;
+  RandomImage(width, height, &image);
+
+  Array3Di scores(height, width);
+  scores.fill(0);
+  for (int y = 3; y < height - 3; ++y) {
+    for (int x = 3; x < width - 3; ++x) {
+      scores(y, x) = FastCornerScore(&image(y, x), width, threshold);
+    }
+  }
+  std::set<std::pair<int, int> > expected;
+  for (int y = 3; y < height - 3; ++y) {
+    for (int x = 3; x < width - 3; ++x) {
+      int s = scores(y, x);
+      if (s && s > scores(y - 1, x - 1) && s > scores(y - 1, x) &&
+          s > scores(y - 1, x + 1) && s > scores(y, x - 1) &&
+          s >= scores(y, x + 1) && s >= scores(y + 1, x - 1) &&
+          s >= scores(y + 1, x) && s >= scores(y + 1, x + 1)) {
+        expected.insert(std::make_pair(x, y));
+      }
+    }
+  }
+  ASSERT_LT(0, expected.size());
+
+  FastGridDetector detector(FixedThresholdOptions(threshold));
+  vector<PointFeature> features;
+  vector<float> feature_scores;
+  detector.DetectInto(image, &features, &feature_scores);
+
+  ASSERT_EQ(expected.size(), features.size());
+  ASSERT_EQ(features.size(), feature_scores.size());
+  for (int i = 0; i < features.size(); ++i) {
+    int x = features[i].x(), y = features[i].y();
+    EXPECT_TRUE(expected.count(std::make_pair(x, y)));
+    EXPECT_EQ(scores(y, x), feature_scores[i]);
+  }
+}
+
+TEST(FastGridDetector, RespectsBudgetAndBalancesTiles) {
+  const int width = 128, height = 128;
+  Array3Du image;
+  RandomImage(width, height, &image);
+
+  FastGridOptions options;
+  options.max_features = 64;
+  options.grid_rows = 2;
+  options.grid_cols = 2;
+  FastGridDetector detector(options);
+  vector<PointFeature> features;
+  detector.DetectInto(image, &features, NULL);
+
+  ASSERT_EQ(64, features.size());
+  int per_tile[2][2] = {{0, 0}, {0, 0}};
+  for (int i = 0; i < features.size(); ++i) {
+    int r = features[i].y() < 3 + (height - 6) / 2 ? 0 : 1;
+    int c = features[i].x() < 3 + (width - 6) / 2 ? 0 : 1;
+    per_tile[r][c]++;
+  }
+  EXPECT_EQ(16, per_tile[0][0]);
+  EXPECT_EQ(16, per_tile[0][1]);
+  EXPECT_EQ(16, per_tile[1][0]);
+  EXPECT_EQ(16, per_tile[1][1]);
+}
+
+TEST(FastGridDetector, AdaptsTileThreshold) {
+  const int width = 128, height = 128;
+  Array3Du image;
+  RandomImage(width, height, &image);
+
+  // Random noise yields far too many corners at a low barrier, so the tile
+  // barrier must go up between frames.
+  FastGridOptions options;
+  options.max_features = 8;
+  options.grid_rows = 1;
+  options.grid_cols = 1;
+  options.initial_threshold = 10;
+  FastGridDetector detector(options);
+  vector<PointFeature> features;
+  detector.DetectInto(image, &features, NULL);
+  int first = detector.TileThreshold(0, 0);
+  EXPECT_LT(10, first);
+  detector.DetectInto(image, &features, NULL);
+  EXPECT_LT(first, detector.TileThreshold(0, 0));
+  EXPECT_EQ(8, features.size());
+
+  // A flat image starves the tile, so its barrier is lowered.
+  Array3Du flat(64, 64);
+  flat.fill(128);
+  detector.DetectInto(flat, &features, NULL);
+  EXPECT_EQ(0, features.size());
+  EXPECT_GT(first, detector.TileThreshold(0, 0));
+}
+
+}  // namespace
+}  // namespace detector
+}  // namespace libmv
@@ -0,0 +1,308 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "libmv/detector/orientation_detector.h"
+#include "libmv/image/integral_image.h"
+#include "libmv/logging/logging.h"
+
+namespace libmv {
+namespace detector {
+namespace {
+
+const int kNumBins = 36;
+
+// The bin of gradientBoxesRotationEstimation for a gradient direction.
+inline int OrientationBin(double dy, double dx) {
+  float orientation = getCoterminalAngle(atan2(dy, dx));
+  int bin = static_cast<int>(orientation * 180.0 / M_PI) / 10;
+  return bin < kNumBins ? bin : kNumBins - 1;
+}
+
+// Bins of all the byte gradients, indexed by (dy + 255) * 511 + dx + 255.
+class ByteOrientationBins {
+ public:
+  ByteOrientationBins() : bins_(511 * 511) {
+    for (int dy = -255; dy <= 255; ++dy) {
+      for (int dx = -255; dx <= 255; ++dx) {
+        bins_[(dy + 255) * 511 + dx + 255] = OrientationBin(dy, dx);
+      }
+    }
+  }
+
+  int operator()(int dy, int dx) const {
+    return bins_[(dy + 255) * 511 + dx + 255];
+  }
+
+ private:
+  vector<unsigned char> bins_;
+};
+
+const ByteOrientationBins &GetByteOrientationBins() {
+  static ByteOrientationBins bins;
+  return bins;
+}
+
+// The pixels of the disk of gradientBoxesRotationEstimation for one radius:
+// row dr spans the columns [-extent[dr + radius], extent[dr + radius]] and
+// weights holds the distance to the center over the radius, row major.
+struct Disk {
+  int radius;
+  vector<int> extent;
+  vector<float> weights;
+
+  void Init(int r) {
+    radius = r;
+    const int size = 2 * radius + 1;
+    extent.resize(size);
+    weights.resize(size * size);
+    for (int dr = -radius; dr <= radius; ++dr) {
+      extent[dr + radius] = -1;
+      for (int dc = -radius; dc <= radius; ++dc) {
+        double w = sqrt(double(dc * dc + dr * dr)) / radius;
+        weights[(dr + radius) * size + dc + radius] = w;
+        if (w <= 1.0) {
+          extent[dr + radius] = std::max(extent[dr + radius], dc);
+        }
+      }
+    }
+  }
+};
+
+// Disks of all the radii used by the features [first, size()).
+void BuildDisks(const PointFeatureTable &features, int first,
+                std::map<int, Disk> *disks) {
+  for (int i = first; i < features.size(); ++i) {
+    const int radius = 3 * features.scale[i];
+    if (radius > 0 && !disks->count(radius)) {
+      (*disks)[radius].Init(radius);
+    }
+  }
+}
+
+float PeakOrientation(const float *histogram) {
+  int index = 0;
+  for (int k = 1; k < kNumBins; ++k) {
+    if (histogram[index] < histogram[k]) {
+      index = k;
+    }
+  }
+  return getCoterminalAngle(index * 10.0 * M_PI / 180.0);
+}
+
+// Adds the columns [c0, c1] of row r to the histogram; generic pixel type.
+template <typename T>
+void AccumulateRow(const Array3D<T> &image, int r, int c0, int c1,
+                   const float *weights, float *histogram) {
+  for (int c = c0; c <= c1; ++c) {
+    double dx = double(image(r, c + 1)) - image(r, c - 1);
+    double dy = double(image(r + 1, c)) - image(r - 1, c);
+    histogram[OrientationBin(dy, dx)] += sqrt(dx * dx + dy * dy) * weights[c];
+  }
+}
+
+#ifdef __SSE2__
+inline __m128i LoadFourBytes(const unsigned char *p) {
+  int value;
+  memcpy(&value, p, sizeof(value));
+  const __m128i zero = _mm_setzero_si128();
+  return _mm_unpacklo_epi16(
+      _mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero);
+}
+#endif
+
+// Byte images: the bin comes from the lookup table and the magnitudes are
+// computed with SSE2 when available.
+void AccumulateRow(const Array3Du &image, int r, int c0, int c1,
+                   const float *weights, float *histogram) {
+  const ByteOrientationBins &bins = GetByteOrientationBins();
+  const unsigned char *row = &image(r, 0);
+  const unsigned char *up = &image(r - 1, 0);
+  const unsigned char *down = &image(r + 1, 0);
+  int c = c0;
+#ifdef __SSE2__
+  int dx[4], dy[4];
+  float values[4];
+  for (; c + 3 <= c1; c += 4) {
+    __m128i gx = _mm_sub_epi32(LoadFourBytes(row + c + 1),
+                               LoadFourBytes(row + c - 1));
+    __m128i gy = _mm_sub_epi32(LoadFourBytes(down + c),
+                               LoadFourBytes(up + c));
+    __m128 fx = _mm_cvtepi32_ps(gx);
+    __m128 fy = _mm_cvtepi32_ps(gy);
+    __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(fx, fx),
+                                              _mm_mul_ps(fy, fy)));
+    _mm_storeu_ps(values, _mm_mul_ps(magnitude, _mm_loadu_ps(weights + c)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dx), gx);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dy), gy);
+    for (int k = 0; k < 4; ++k) {
+      histogram[bins(dy[k], dx[k])] += values[k];
+    }
+  }
+#endif
+  for (; c <= c1; ++c) {
+    int gx = int(row[c + 1]) - row[c - 1];
+    int gy = int(down[c]) - up[c];
+    histogram[bins(gy, gx)] += sqrtf(float(gx * gx + gy * gy)) * weights[c];
+  }
+}
+
+template <typename T>
+void GradientHistogramOrientationsImpl(const Array3D<T> &image,
+                                       PointFeatureTable *features,
+                                       int first) {
+  CHECK_EQ(1, image.Depth());
+  std::map<int, Disk> disks;
+  BuildDisks(*features, first, &disks);
+
+  const int width = image.Width(), height = image.Height();
+  const int num_features = features->size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int i = first; i < num_features; ++i) {
+    const int x = features->x[i], y = features->y[i];
+    const int radius = 3 * features->scale[i];
+    float histogram[kNumBins];
+    std::fill(histogram, histogram + kNumBins, 0.0f);
+    if (radius > 0) {
+      const Disk &disk = disks.find(radius)->second;
+      const int size = 2 * radius + 1;
+      for (int dr = -radius; dr <= radius; ++dr) {
+        const int r = y + dr;
+        const int extent = disk.extent[dr + radius];
+        if (r <= 0 || r >= height - 1 || extent < 0) {
+          continue;
+        }
+        const int c0 = std::max(x - extent, 1);
+        const int c1 = std::min(x + extent, width - 2);
+        // Shifted so that weights[c] is the weight of column c.
+        const float *weights =
+            &disk.weights[(dr + radius) * size + radius] - x;
+        AccumulateRow(image, r, c0, c1, weights, histogram);
+      }
+    }
+    features->orientation[i] = PeakOrientation(histogram);
+  }
+}
+
+}  // namespace
+
+void FastRingOrientations(const ByteImage &image,
+                          PointFeatureTable *features,
+                          int first) {
+  CHECK_EQ(1, image.Depth());
+  static const int ring_x[16] = {3,3,2,1,0,-1,-2,-3,-3,-3,-2,-1,0,1,2,3};
+  static const int ring_y[16] = {0,1,2,3,3,3,2,1,0,-1,-2,-3,-3,-3,-2,-1};
+  // Unit direction of the ring pixels, as in fastRotationEstimation.
+  const double a = 1 / sqrt(10.), b = 1 / sqrt(2.), c = 3 / sqrt(10.);
+  const double direction_x[16] = {0, a, b, c, 1, c, b, a,
+                                  0, -a, -b, -c, -1, -c, -b, -a};
+  const double direction_y[16] = {-1, -c, -b, -a, 0, a, b, c,
+                                  1, c, b, a, 0, -a, -b, -c};
+  const int stride = image.Width();
+  int offsets[16];
+  for (int k = 0; k < 16; ++k) {
+    offsets[k] = ring_y[k] * stride + ring_x[k];
+  }
+
+  const int width = image.Width(), height = image.Height();
+  const int num_features = features->size();
+#pragma omp parallel for schedule(static)
+  for (int i = first; i < num_features; ++i) {
+    const int x = features->x[i], y = features->y[i];
+    if (x < 3 || y < 3 || x >= width - 3 || y >= height - 3) {
+      features->orientation[i] = 0;
+      continue;
+    }
+    const unsigned char *center = &image(y, x);
+    double dx = 0.0, dy = 0.0;
+    for (int k = 0; k < 16; ++k) {
+      double difference = double(center[offsets[k]]) - center[0];
+      dx += difference * direction_x[k];
+      dy += difference * direction_y[k];
+    }
+    double angle = 0.0;
+    if (std::max(fabs(dy), fabs(dx)) > 0) {
+      angle = atan2(dy, dx);
+    }
+    features->orientation[i] = getCoterminalAngle(angle);
+  }
+}
+
+void GradientHistogramOrientations(const ByteImage &image,
+                                   PointFeatureTable *features,
+                                   int first) {
+  GradientHistogramOrientationsImpl(image, features, first);
+}
+
+void GradientHistogramOrientations(const FloatImage &image,
+                                   PointFeatureTable *features,
+                                   int first) {
+  GradientHistogramOrientationsImpl(image, features, first);
+}
+
+void GradientHistogramOrientations(const Matu &integral_image,
+                                   PointFeatureTable *features,
+                                   int first) {
+  const int height = integral_image.rows(), width = integral_image.cols();
+  const int num_features = features->size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int i = first; i < num_features; ++i) {
+    const float x = features->x[i], y = features->y[i];
+    const float radius = 3 * features->scale[i];
+    const int step = std::max(1, static_cast<int>(features->scale[i] / 2));
+    const int samples = static_cast<int>(radius / step);
+    float histogram[kNumBins];
+    std::fill(histogram, histogram + kNumBins, 0.0f);
+    for (int sr = -samples; sr <= samples; ++sr) {
+      const int r = static_cast<int>(y) + sr * step;
+      for (int sc = -samples; sc <= samples; ++sc) {
+        const int c = static_cast<int>(x) + sc * step;
+        const double weight = sqrt(double(sr * sr + sc * sc)) * step / radius;
+        if (weight > 1.0 || r < 0 || c < 0 || r >= height || c >= width) {
+          continue;
+        }
+        // Difference of the step x (2 step + 1) boxes on each side.
+        const double dx =
+            double(BoxIntegral(integral_image, r - step, c + 1,
+                               2 * step + 1, step)) -
+            double(BoxIntegral(integral_image, r - step, c - step,
+                               2 * step + 1, step));
+        const double dy =
+            double(BoxIntegral(integral_image, r + 1, c - step,
+                               step, 2 * step + 1)) -
+            double(BoxIntegral(integral_image, r - step, c - step,
+                               step, 2 * step + 1));
+        histogram[OrientationBin(dy, dx)] +=
+            sqrt(dx * dx + dy * dy) * weight;
+      }
+    }
+    features->orientation[i] = PeakOrientation(histogram);
+  }
+}
+
+}  // namespace detector
+}  // namespace libmv
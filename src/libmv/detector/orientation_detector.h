@@ -23,6 +23,9 @@
 
 #include "libmv/base/vector.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_table.h"
+#include "libmv/image/image.h"
+#include "libmv/numeric/numeric.h"
 
 namespace libmv {
 
@@ -137,6 +140,44 @@ void gradientBoxesRotationEstimation(const Image & ima, vector<Feature *> & feat
   }
 }
 
+/**
+ * Batch version of fastRotationEstimation.
+ *
+ * Estimates the orientation of the features [first, features->size()) of the
+ * table. The ring is read through precomputed pointer offsets and the
+ * features are processed in parallel. Features closer than 3 pixels to the
+ * image border get the orientation 0.
+ */
+void FastRingOrientations(const ByteImage &image,
+                          PointFeatureTable *features,
+                          int first = 0);
+
+/**
+ * Batch version of gradientBoxesRotationEstimation.
+ *
+ * Builds the same 36 bin histogram of the gradients in a disk of radius
+ * 3 * scale around the features [first, features->size()). The disk extents
+ * and weights are computed once per radius and the features are processed in
+ * parallel. For byte images the gradient direction is binned with a lookup
+ * table instead of atan2 and the gradient magnitudes are computed four
+ * pixels at a time with SSE2.
+ */
+void GradientHistogramOrientations(const ByteImage &image,
+                                   PointFeatureTable *features,
+                                   int first = 0);
+void GradientHistogramOrientations(const FloatImage &image,
+                                   PointFeatureTable *features,
+                                   int first = 0);
+
+/**
+ * Same as above with box gradients read from an integral image (see
+ * IntegralImage), for features with a large scale: the disk is sampled every
+ * max(1, scale / 2) pixels with boxes of the same size, so the cost per
+ * feature does not depend on the scale.
+ */
+void GradientHistogramOrientations(const Matu &integral_image,
+                                   PointFeatureTable *features,
+                                   int first = 0);
 
 }  // namespace detector
 }  // namespace libmv
@@ -18,9 +18,14 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature_table.h"
 #include "libmv/detector/orientation_detector.h"
 #include "libmv/detector/detector.h"
+#include "libmv/detector/surf_detector.h"
 #include "libmv/image/image.h"
+#include "libmv/image/integral_image.h"
 #include "testing/testing.h"
 
 namespace libmv {
@@ -158,6 +163,146 @@ TEST(GradientOrientationDetector, GradientRotEstimatorDegree45)  {
   EXPECT_NEAR( ptFeat.orientation, 7*M_PI/4.0, 1e-1);
 }
 
+// Random image and features on a grid, with various scales.
+template <typename TImage>
+void RandomImageAndFeatures(TImage *image, PointFeatureTable *table,
+                            vector<Feature *> *features,
+                            vector<PointFeature> *points) {
+  image->Resize(80, 100);
+  srand(3);
+  for (int i = 0; i < image->Width() * image->Height(); ++i) {
+    image->Data()[i] = rand() % 256;
+  }
+  for (int y = 3; y < image->Height() - 3; y += 5) {
+    for (int x = 3; x < image->Width() - 3; x += 7) {
+      table->Append(x, y, 1 + (x + y) % 4, 0.0);
+    }
+  }
+  points->resize(table->size());
+  for (int i = 0; i < table->size(); ++i) {
+    (*points)[i] = table->Point(i);
+    features->push_back(&(*points)[i]);
+  }
+}
+
+TEST(BatchOrientationDetector, FastRingMatchesPerFeature) {
+  Array3Du image;
+  PointFeatureTable table;
+  vector<Feature *> features;
+  vector<PointFeature> points;
+  RandomImageAndFeatures(&image, &table, &features, &points);
+
+  fastRotationEstimation(image, features);
+  FastRingOrientations(image, &table);
+  for (int i = 0; i < table.size(); ++i) {
+    EXPECT_FLOAT_EQ(points[i].orientation, table.orientation[i]);
+  }
+}
+
+TEST(BatchOrientationDetector, OnlyFeaturesFromFirstAreEstimated) {
+  Array3Du image;
+  PointFeatureTable table;
+  vector<Feature *> features;
+  vector<PointFeature> points;
+  RandomImageAndFeatures(&image, &table, &features, &points);
+
+  table.orientation[0] = 42;
+  FastRingOrientations(image, &table, 1);
+  EXPECT_EQ(42, table.orientation[0]);
+}
+
+TEST(BatchOrientationDetector, ByteGradientHistogramMatchesPerFeature) {
+  Array3Du image;
+  PointFeatureTable table;
+  vector<Feature *> features;
+  vector<PointFeature> points;
+  RandomImageAndFeatures(&image, &table, &features, &points);
+
+  gradientBoxesRotationEstimation(image, features);
+  GradientHistogramOrientations(image, &table);
+  // The magnitudes are summed in single precision, which may only flip
+  // histogram peaks that are equal up to rounding.
+  int same = 0;
+  for (int i = 0; i < table.size(); ++i) {
+    same += points[i].orientation == table.orientation[i];
+  }
+  EXPECT_LE(table.size() - 1, same);
+}
+
+TEST(BatchOrientationDetector, FloatGradientHistogramMatchesPerFeature) {
+  Array3Df image;
+  PointFeatureTable table;
+  vector<Feature *> features;
+  vector<PointFeature> points;
+  RandomImageAndFeatures(&image, &table, &features, &points);
+
+  gradientBoxesRotationEstimation(image, features);
+  GradientHistogramOrientations(image, &table);
+  for (int i = 0; i < table.size(); ++i) {
+    EXPECT_EQ(points[i].orientation, table.orientation[i]);
+  }
+}
+
+TEST(BatchOrientationDetector, IntegralGradientHistogram)  {
+  Array3Du test(64, 64);
+  test.fill(0);
+  // Fill the left part with 255.
+  for (int j = 0; j < 64; ++j)  {
+    for (int i = 0; i < 32; ++i)  {
+      test(j, i) = 255;
+    }
+  }
+  Matu integral_image;
+  IntegralImage(test, &integral_image);
+
+  PointFeatureTable table;
+  table.Append(32, 32, 6.0, 0.0);
+  table.Append(32, 32, 1.0, 0.0);
+  GradientHistogramOrientations(integral_image, &table);
+  // Angle must be PI, as for the per pixel gradients.
+  EXPECT_NEAR(M_PI, table.orientation[0], 1e-5);
+  EXPECT_NEAR(M_PI, table.orientation[1], 1e-5);
+}
+
+TEST(BatchOrientationDetector, RotationInvariantSurfDetector)  {
+  // Bright squares on a horizontal ramp.
+  Array3Du test(128, 128);
+  for (int j = 0; j < 128; ++j)  {
+    for (int i = 0; i < 128; ++i)  {
+      test(j, i) = i;
+    }
+  }
+  for (int j = 40; j < 56; ++j)  {
+    for (int i = 30; i < 46; ++i)  {
+      test(j, i) = 255;
+      test(j + 40, i + 50) = 255;
+    }
+  }
+  Image image(new Array3Du(test));
+
+  scoped_ptr<Detector> detector(CreateSURFDetector(4, 4, true));
+  vector<Feature *> features;
+  detector->Detect(image, &features, NULL);
+  ASSERT_LT(0, features.size());
+
+  // The orientations are those of the integral image estimator.
+  Matu integral_image;
+  IntegralImage(test, &integral_image);
+  PointFeatureTable table;
+  for (int i = 0; i < features.size(); ++i) {
+    table.Append(*static_cast<PointFeature *>(features[i]));
+  }
+  GradientHistogramOrientations(integral_image, &table);
+  int num_oriented = 0;
+  for (int i = 0; i < features.size(); ++i) {
+    const float orientation =
+        static_cast<PointFeature *>(features[i])->orientation;
+    EXPECT_EQ(table.orientation[i], orientation);
+    num_oriented += orientation != 0;
+  }
+  EXPECT_LT(0, num_oriented);
+  DeleteElements(&features);
+}
 
 } // namespace
 } // namespace detector
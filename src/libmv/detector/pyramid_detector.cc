@@ -0,0 +1,272 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/detector/pyramid_detector.h"
+#include "libmv/logging/logging.h"
+
+namespace libmv {
+namespace detector {
+namespace {
+
+// Copies the first channel of the image, cropped to a multiple of the given
+// size so that MakeImagePyramid can halve it down to the coarsest level.
+void CroppedFloatImage(const Image &image, int multiple, FloatImage *out) {
+  const Array3Du *bytes = image.AsArray3Du();
+  const Array3Df *floats = image.AsArray3Df();
+  int width = bytes ? bytes->Width() : floats->Width();
+  int height = bytes ? bytes->Height() : floats->Height();
+  width -= width % multiple;
+  height -= height % multiple;
+  out->Resize(height, width);
+  for (int r = 0; r < height; ++r) {
+    for (int c = 0; c < width; ++c) {
+      (*out)(r, c) = bytes ? (*bytes)(r, c) : (*floats)(r, c);
+    }
+  }
+}
+
+Array3Du *ByteLevel(const FloatImage &level) {
+  Array3Du *bytes = new Array3Du(level.Height(), level.Width());
+  for (int r = 0; r < level.Height(); ++r) {
+    for (int c = 0; c < level.Width(); ++c) {
+      float value = level(r, c, 0) + 0.5f;
+      (*bytes)(r, c) = value < 0 ? 0 : (value > 255 ? 255 : value);
+    }
+  }
+  return bytes;
+}
+
+Array3Df *FloatLevel(const FloatImage &level) {
+  Array3Df *floats = new Array3Df(level.Height(), level.Width());
+  for (int r = 0; r < level.Height(); ++r) {
+    for (int c = 0; c < level.Width(); ++c) {
+      (*floats)(r, c) = level(r, c, 0);
+    }
+  }
+  return floats;
+}
+
+}  // namespace
+
+PyramidDetectorData::~PyramidDetectorData() {}
+
+int PyramidDetectorData::LevelForStep(float step) const {
+  int level = 0;
+  while (level + 1 < NumLevels() && (2 << level) <= step) {
+    ++level;
+  }
+  return level;
+}
+
+struct PyramidDetector::StrongerCandidate {
+  StrongerCandidate(const vector<Candidate> &candidates)
+    : candidates(candidates) {}
+
+  bool operator()(int a, int b) const {
+    const Candidate &ca = candidates[a], &cb = candidates[b];
+    if (ca.score != cb.score) {
+      return ca.score > cb.score;
+    }
+    if (ca.level != cb.level) {
+      return ca.level < cb.level;
+    }
+    return a < b;
+  }
+
+  const vector<Candidate> &candidates;
+};
+
+PyramidDetector::PyramidDetector(const vector<Detector *> &level_detectors,
+                                 const PyramidDetectorOptions &options)
+  : detectors_(level_detectors), options_(options) {
+  CHECK_GT(detectors_.size(), 0);
+}
+
+PyramidDetector::~PyramidDetector() {
+  DeleteElements(&detectors_);
+}
+
+void PyramidDetector::Detect(const Image &image,
+                             vector<Feature *> *features,
+                             DetectorData **data) {
+  PointFeatureTable table;
+  DetectTable(image, &table, data);
+  for (int i = 0; i < table.size(); ++i) {
+    features->push_back(new PointFeature(table.Point(i)));
+  }
+}
+
+void PyramidDetector::DetectTable(const Image &image,
+                                  PointFeatureTable *features,
+                                  DetectorData **data) {
+  if (data) {
+    *data = NULL;
+  }
+  const Array3Du *byte_image = image.AsArray3Du();
+  const Array3Df *float_image = image.AsArray3Df();
+  if (!byte_image && !float_image) {
+    LOG(ERROR) << "Invalid input image type for the pyramid detector";
+    return;
+  }
+  const int width = byte_image ? byte_image->Width() : float_image->Width();
+  const int height = byte_image ? byte_image->Height() : float_image->Height();
+
+  int num_levels = 1;
+  while (num_levels < detectors_.size() &&
+         (std::min(width, height) >> num_levels) >= options_.min_level_size) {
+    ++num_levels;
+  }
+
+  scoped_ptr<ImagePyramid> pyramid(NULL);
+  if (num_levels > 1 || data) {
+    FloatImage base;
+    CroppedFloatImage(image, 1 << (num_levels - 1), &base);
+    pyramid.reset(MakeImagePyramid(base, num_levels, options_.sigma));
+  }
+
+  // Level 0 is searched on the input image itself, so that a one level
+  // pyramid gives the same features as the wrapped detector.
+  level_features_.resize(num_levels);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int level = 0; level < num_levels; ++level) {
+    PointFeatureTable *level_features = &level_features_[level];
+    level_features->Clear();
+    if (level == 0) {
+      detectors_[0]->DetectTable(image, level_features, NULL);
+    } else {
+      const FloatImage &blurred = pyramid->Level(level);
+      scoped_ptr<Image> level_image(byte_image ?
+                                    new Image(ByteLevel(blurred)) :
+                                    new Image(FloatLevel(blurred)));
+      detectors_[level]->DetectTable(*level_image, level_features, NULL);
+    }
+  }
+
+  // Map the detections back to full resolution.
+  candidates_.resize(0);
+  for (int level = 0; level < num_levels; ++level) {
+    PointFeatureTable &level_features = level_features_[level];
+    for (int i = 0; i < level_features.size(); ++i) {
+      level_features.x[i] = PyramidDetectorData::FromLevel(
+          level_features.x[i], level);
+      level_features.y[i] = PyramidDetectorData::FromLevel(
+          level_features.y[i], level);
+      level_features.scale[i] *= 1 << level;
+
+      Candidate candidate;
+      candidate.x = level_features.x[i];
+      candidate.y = level_features.y[i];
+      candidate.score = level_features.score[i];
+      candidate.level = level;
+      candidate.index = i;
+      candidates_.push_back(candidate);
+    }
+  }
+
+  SuppressAcrossLevels(num_levels, width, height);
+
+  features->Reserve(features->size() + candidates_.size());
+  for (int k = 0; k < candidates_.size(); ++k) {
+    if (keep_[k]) {
+      const PointFeatureTable &level_features =
+          level_features_[candidates_[k].level];
+      const int i = candidates_[k].index;
+      features->Append(level_features.x[i],
+                       level_features.y[i],
+                       level_features.scale[i],
+                       level_features.orientation[i],
+                       level_features.score[i]);
+    }
+  }
+
+  if (data) {
+    *data = new PyramidDetectorData(pyramid.release());
+  }
+}
+
+void PyramidDetector::SuppressAcrossLevels(int num_levels,
+                                           float level0_width,
+                                           float level0_height) {
+  const int num_candidates = candidates_.size();
+  keep_.resize(num_candidates);
+  std::fill(keep_.begin(), keep_.end(), true);
+  if (num_levels < 2) {
+    return;
+  }
+
+  order_.resize(num_candidates);
+  for (int k = 0; k < num_candidates; ++k) {
+    order_[k] = k;
+  }
+  std::sort(order_.begin(), order_.end(), StrongerCandidate(candidates_));
+
+  // The largest suppression radius is the cell size, so only the 3x3 cells
+  // around a candidate can hold a detection that shadows it.
+  const float cell = options_.nms_radius * (1 << (num_levels - 1));
+  const int cols = static_cast<int>(level0_width / cell) + 1;
+  const int rows = static_cast<int>(level0_height / cell) + 1;
+  cell_head_.resize(rows * cols);
+  std::fill(cell_head_.begin(), cell_head_.end(), -1);
+  next_in_cell_.resize(num_candidates);
+
+  for (int n = 0; n < num_candidates; ++n) {
+    const int k = order_[n];
+    const Candidate &candidate = candidates_[k];
+    const int col = std::max(0, std::min(cols - 1,
+        static_cast<int>(candidate.x / cell)));
+    const int row = std::max(0, std::min(rows - 1,
+        static_cast<int>(candidate.y / cell)));
+
+    bool suppressed = false;
+    for (int r = std::max(0, row - 1);
+         r <= std::min(rows - 1, row + 1) && !suppressed; ++r) {
+      for (int c = std::max(0, col - 1);
+           c <= std::min(cols - 1, col + 1) && !suppressed; ++c) {
+        for (int j = cell_head_[r * cols + c]; j != -1 && !suppressed;
+             j = next_in_cell_[j]) {
+          const Candidate &other = candidates_[j];
+          if (other.level == candidate.level) {
+            continue;
+          }
+          const float radius = options_.nms_radius *
+              (1 << std::max(other.level, candidate.level));
+          const float dx = other.x - candidate.x;
+          const float dy = other.y - candidate.y;
+          suppressed = dx * dx + dy * dy < radius * radius;
+        }
+      }
+    }
+
+    if (suppressed) {
+      keep_[k] = false;
+    } else {
+      next_in_cell_[k] = cell_head_[row * cols + col];
+      cell_head_[row * cols + col] = k;
+    }
+  }
+}
+
+}  // namespace detector
+}  // namespace libmv
@@ -0,0 +1,143 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_DETECTOR_PYRAMID_DETECTOR_H
+#define LIBMV_DETECTOR_PYRAMID_DETECTOR_H
+
+#include <vector>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector.h"
+#include "libmv/correspondence/feature_table.h"
+#include "libmv/detector/detector.h"
+#include "libmv/image/image.h"
+#include "libmv/image/image_pyramid.h"
+
+namespace libmv {
+namespace detector {
+
+struct PyramidDetectorOptions {
+  PyramidDetectorOptions()
+    : sigma(0.9),
+      nms_radius(2.0f),
+      min_level_size(32) {}
+
+  double sigma;        // Blur applied before each downsampling.
+  float nms_radius;    // Cross-level suppression radius, in level pixels.
+  int min_level_size;  // Coarser levels whose smaller side is below this
+                       // size are not built.
+};
+
+/**
+ * Detector data exported by the pyramid detector.
+ *
+ * It holds the image pyramid built for the detection so that a describer can
+ * sample a feature on the level that matches its scale instead of rebuilding
+ * the pyramid or aliasing at full resolution. Level 0 of the pyramid is the
+ * blurred full resolution image; describers are expected to use the input
+ * image at level 0 and the pyramid only for the coarser levels.
+ */
+class PyramidDetectorData : public DetectorData {
+ public:
+  // Takes ownership of the pyramid.
+  PyramidDetectorData(ImagePyramid *pyramid) : pyramid_(pyramid) {}
+  virtual ~PyramidDetectorData();
+
+  ImagePyramid *pyramid() const { return pyramid_.get(); }
+  int NumLevels() const { return pyramid_->NumLevels(); }
+
+  /// Coarsest level whose pixels are not bigger than step full size pixels.
+  int LevelForStep(float step) const;
+
+  /// Maps a full resolution coordinate to level and back.
+  static float ToLevel(float coordinate, int level) {
+    return (coordinate + 0.5f) / (1 << level) - 0.5f;
+  }
+  static float FromLevel(float coordinate, int level) {
+    return (coordinate + 0.5f) * (1 << level) - 0.5f;
+  }
+
+ private:
+  scoped_ptr<ImagePyramid> pyramid_;
+};
+
+/**
+ * Runs single scale detectors on the levels of an image pyramid.
+ *
+ * The pyramid is built once per frame with MakeImagePyramid; level l is
+ * searched by the l-th detector and the detections are mapped back to full
+ * resolution (positions and scales multiplied by 2^l). Levels are processed
+ * in parallel when OpenMP is available, so every level owns its detector:
+ * stateful detectors such as FastGridDetector then adapt their thresholds per
+ * level.
+ *
+ * A detection is dropped when a stronger detection of another level lies
+ * within nms_radius pixels of the coarser of the two levels; for equal
+ * scores the finer level wins. Detections of the same level are left to the
+ * wrapped detector.
+ */
+class PyramidDetector : public Detector {
+ public:
+  // Takes ownership of the detectors; level_detectors[l] handles level l.
+  PyramidDetector(const vector<Detector *> &level_detectors,
+                  const PyramidDetectorOptions &options);
+  virtual ~PyramidDetector();
+
+  virtual void Detect(const Image &image,
+                      vector<Feature *> *features,
+                      DetectorData **data);
+
+  /**
+   * Detects the features of all the levels.
+   *
+   * \param[out] data If not NULL, receives a PyramidDetectorData holding the
+   *                  pyramid of the image. The data of the wrapped detectors
+   *                  is not exported.
+   */
+  virtual void DetectTable(const Image &image,
+                           PointFeatureTable *features,
+                           DetectorData **data);
+
+ private:
+  struct Candidate {
+    float x, y;
+    float score;
+    int level;
+    int index;  // In the table of the level.
+  };
+  struct StrongerCandidate;
+
+  // Removes the detections shadowed by a detection of another level.
+  void SuppressAcrossLevels(int num_levels, float level0_width,
+                            float level0_height);
+
+  vector<Detector *> detectors_;
+  PyramidDetectorOptions options_;
+  std::vector<PointFeatureTable> level_features_;  // Reused between frames.
+  vector<Candidate> candidates_;                   // In level order.
+  vector<int> order_;                              // Strongest first.
+  vector<bool> keep_;                              // Parallel to candidates_.
+  vector<int> cell_head_, next_in_cell_;           // Accepted, per grid cell.
+};
+
+}  // namespace detector
+}  // namespace libmv
+
+#endif  // LIBMV_DETECTOR_PYRAMID_DETECTOR_H
@@ -0,0 +1,226 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cmath>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/vector.h"
+#include "libmv/base/vector_utils.h"
+#include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_table.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/simpliest_descriptor.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/fast_detector.h"
+#include "libmv/detector/pyramid_detector.h"
+#include "libmv/image/image.h"
+#include "testing/testing.h"
+
+namespace libmv {
+namespace detector {
+namespace {
+
+// Returns the same detections, given in the coordinates of its level, for
+// every image.
+class MockDetector : public Detector {
+ public:
+  void Add(float x, float y, float score) {
+    detections_.Append(x, y, 3.0f, 0.0f, score);
+  }
+
+  virtual void Detect(const Image &image,
+                      vector<Feature *> *features,
+                      DetectorData **data) {
+    for (int i = 0; i < detections_.size(); ++i) {
+      features->push_back(new PointFeature(detections_.Point(i)));
+    }
+    if (data) {
+      *data = NULL;
+    }
+  }
+
+  virtual void DetectTable(const Image &image,
+                           PointFeatureTable *features,
+                           DetectorData **data) {
+    for (int i = 0; i < detections_.size(); ++i) {
+      features->Append(detections_.x[i], detections_.y[i],
+                       detections_.scale[i], detections_.orientation[i],
+                       detections_.score[i]);
+    }
+    if (data) {
+      *data = NULL;
+    }
+  }
+
+ private:
+  PointFeatureTable detections_;
+};
+
+void RandomImage(int width, int height, Array3Du *image) {
+  image->Resize(height, width);
+  srand(5);
+  for (int i = 0; i < width * height; ++i) {
+    image->Data()[i] = rand() % 256;
+  }
+}
+
+TEST(PyramidDetector, LevelCoordinates) {
+  EXPECT_FLOAT_EQ(0.5f, PyramidDetectorData::ToLevel(1.5f, 1));
+  EXPECT_FLOAT_EQ(1.5f, PyramidDetectorData::FromLevel(0.5f, 1));
+  EXPECT_FLOAT_EQ(0.0f, PyramidDetectorData::ToLevel(1.5f, 2));
+  EXPECT_FLOAT_EQ(13.0f, PyramidDetectorData::FromLevel(
+      PyramidDetectorData::ToLevel(13.0f, 3), 3));
+}
+
+TEST(PyramidDetector, SuppressesWeakerDetectionOfOtherLevel) {
+  MockDetector *level0 = new MockDetector;
+  level0->Add(40, 40, 1);
+  level0->Add(10, 10, 1);
+  MockDetector *level1 = new MockDetector;
+  level1->Add(PyramidDetectorData::ToLevel(41, 1),
+              PyramidDetectorData::ToLevel(41, 1), 2);
+  vector<Detector *> detectors;
+  detectors.push_back(level0);
+  detectors.push_back(level1);
+  PyramidDetector detector(detectors, PyramidDetectorOptions());
+
+  PointFeatureTable features;
+  Image image(new Array3Du(64, 64));
+  detector.DetectTable(image, &features, NULL);
+
+  ASSERT_EQ(2, features.size());
+  EXPECT_FLOAT_EQ(10, features.x[0]);
+  EXPECT_FLOAT_EQ(3, features.scale[0]);
+  EXPECT_FLOAT_EQ(41, features.x[1]);
+  EXPECT_FLOAT_EQ(41, features.y[1]);
+  EXPECT_FLOAT_EQ(6, features.scale[1]);
+  EXPECT_FLOAT_EQ(2, features.score[1]);
+}
+
+TEST(PyramidDetector, TiesKeepFinerLevel) {
+  MockDetector *level0 = new MockDetector;
+  level0->Add(40, 40, 0);
+  MockDetector *level1 = new MockDetector;
+  level1->Add(PyramidDetectorData::ToLevel(42, 1),
+              PyramidDetectorData::ToLevel(40, 1), 0);
+  // Far enough from the first one at the resolution of level 1.
+  level1->Add(PyramidDetectorData::ToLevel(48, 1),
+              PyramidDetectorData::ToLevel(40, 1), 0);
+  vector<Detector *> detectors;
+  detectors.push_back(level0);
+  detectors.push_back(level1);
+  PyramidDetector detector(detectors, PyramidDetectorOptions());
+
+  vector<Feature *> features;
+  Image image(new Array3Du(64, 64));
+  detector.Detect(image, &features, NULL);
+
+  ASSERT_EQ(2, features.size());
+  EXPECT_FLOAT_EQ(40, static_cast<PointFeature *>(features[0])->x());
+  EXPECT_FLOAT_EQ(3, static_cast<PointFeature *>(features[0])->scale);
+  EXPECT_FLOAT_EQ(48, static_cast<PointFeature *>(features[1])->x());
+  EXPECT_FLOAT_EQ(6, static_cast<PointFeature *>(features[1])->scale);
+  DeleteElements(&features);
+}
+
+TEST(PyramidDetector, OneLevelIsTheWrappedDetector) {
+  Array3Du *random = new Array3Du;
+  RandomImage(97, 61, random);
+  Image image(random);
+
+  scoped_ptr<Detector> fast(CreateFastGridDetector());
+  PointFeatureTable expected;
+  fast->DetectTable(image, &expected, NULL);
+  ASSERT_LT(0, expected.size());
+
+  vector<Detector *> detectors;
+  detectors.push_back(CreateFastGridDetector());
+  PyramidDetector detector(detectors, PyramidDetectorOptions());
+  PointFeatureTable features;
+  detector.DetectTable(image, &features, NULL);
+
+  ASSERT_EQ(expected.size(), features.size());
+  for (int i = 0; i < features.size(); ++i) {
+    EXPECT_EQ(expected.x[i], features.x[i]);
+    EXPECT_EQ(expected.y[i], features.y[i]);
+    EXPECT_EQ(expected.score[i], features.score[i]);
+  }
+}
+
+TEST(PyramidDetector, SharesPyramidWithDescribers) {
+  Array3Du *random = new Array3Du;
+  RandomImage(130, 100, random);
+  Image image(random);
+
+  vector<Detector *> detectors;
+  for (int i = 0; i < 4; ++i) {
+    detectors.push_back(CreateFastGridDetector());
+  }
+  PyramidDetector detector(detectors, PyramidDetectorOptions());
+
+  PointFeatureTable features;
+  DetectorData *data = NULL;
+  detector.DetectTable(image, &features, &data);
+  scoped_ptr<DetectorData> owned_data(data);
+
+  // 100 / 4 is below min_level_size, so only 2 levels are built.
+  PyramidDetectorData *pyramid = dynamic_cast<PyramidDetectorData *>(data);
+  ASSERT_TRUE(pyramid != NULL);
+  ASSERT_EQ(2, pyramid->NumLevels());
+  EXPECT_EQ(65, pyramid->pyramid()->Level(1).Width());
+  EXPECT_EQ(0, pyramid->LevelForStep(1.9f));
+  EXPECT_EQ(1, pyramid->LevelForStep(2.0f));
+  EXPECT_EQ(1, pyramid->LevelForStep(100.0f));
+
+  int coarse = 0;
+  for (int i = 0; i < features.size(); ++i) {
+    coarse += features.scale[i] == 6;
+  }
+  EXPECT_LT(0, coarse);
+  EXPECT_GT(features.size(), coarse);
+
+  scoped_ptr<descriptor::Describer> describer(
+      descriptor::CreateSimpliestDescriber());
+  RMatf descriptors;
+  describer->DescribeTable(&features, image, data, &descriptors);
+  ASSERT_EQ(features.size(), descriptors.rows());
+  for (int i = 0; i < descriptors.rows(); ++i) {
+    for (int j = 0; j < descriptors.cols(); ++j) {
+      EXPECT_TRUE(std::isfinite(descriptors(i, j)));
+    }
+  }
+
+  // Patches sampled more densely than the coarse level are taken from the
+  // input image, so the pyramid does not change them.
+  PointFeatureTable dense = features;
+  for (int i = 0; i < dense.size(); ++i) {
+    dense.scale[i] = 1.5;
+  }
+  PointFeatureTable dense_copy = dense;
+  RMatf with_pyramid, without_pyramid;
+  describer->DescribeTable(&dense, image, data, &with_pyramid);
+  describer->DescribeTable(&dense_copy, image, NULL, &without_pyramid);
+  ASSERT_EQ(without_pyramid.rows(), with_pyramid.rows());
+  EXPECT_EQ(0, (with_pyramid - without_pyramid).norm());
+}
+
+}  // namespace
+}  // namespace detector
+}  // namespace libmv
@@ -51,7 +51,16 @@ class StarDetector : public Detector {
     if (bRotationInvariant_)
     {
       // rotation response is more stable on response image
-      gradientBoxesRotationEstimation(responses,*features);
+      PointFeatureTable table;
+      table.Reserve(features->size());
+      for (int i = 0; i < features->size(); ++i) {
+        table.Append(*static_cast<PointFeature *>((*features)[i]));
+      }
+      GradientHistogramOrientations(responses, &table);
+      for (int i = 0; i < features->size(); ++i) {
+        static_cast<PointFeature *>((*features)[i])->orientation =
+            table.orientation[i];
+      }
     }
 
     // STAR doesn't have a corresponding descriptor, so there's no extra data
@@ -21,6 +21,8 @@
 #include "libmv/logging/logging.h"
 #include "libmv/detector/detector.h"
 #include "libmv/correspondence/feature.h"
+#include "libmv/correspondence/feature_table.h"
+#include "libmv/detector/orientation_detector.h"
 #include "libmv/image/image.h"
 #include "libmv/image/surf.h"
 
@@ -30,8 +32,9 @@ namespace detector {
 class SurfDetector : public Detector {
  public:
   virtual ~SurfDetector() {}
-  SurfDetector(int num_octaves, int num_intervals)
-    :num_octaves_(num_octaves), num_intervals_(num_intervals) {}
+  SurfDetector(int num_octaves, int num_intervals, bool bRotationInvariant)
+    :num_octaves_(num_octaves), num_intervals_(num_intervals),
+    bRotationInvariant_(bRotationInvariant) {}
 
   virtual void Detect(const Image &image,
                       vector<Feature *> *features,
@@ -46,6 +49,19 @@ class SurfDetector : public Detector {
     MultiscaleDetectFeatures(integral_image, num_octaves_, num_intervals_,
                            &detections);
 
+    if (bRotationInvariant_) {
+      // The integral image gives box gradients at the scale of each feature.
+      PointFeatureTable table;
+      table.Reserve(detections.size());
+      for (int i = 0; i < detections.size(); ++i) {
+        table.Append(detections[i]);
+      }
+      GradientHistogramOrientations(integral_image, &table);
+      for (int i = 0; i < detections.size(); ++i) {
+        detections[i].orientation = table.orientation[i];
+      }
+    }
+
     for (int i = 0; i < detections.size(); ++i) {
       PointFeature *f = new PointFeature(detections[i].x(), detections[i].y());
       f->scale = detections[i].scale;
@@ -62,10 +78,12 @@ class SurfDetector : public Detector {
  private:
   int num_octaves_;
   int num_intervals_;
+  bool bRotationInvariant_;
 };
 
-Detector *CreateSURFDetector(int num_octaves, int num_intervals) {
-  return new SurfDetector(num_octaves, num_intervals);
+Detector *CreateSURFDetector(int num_octaves, int num_intervals,
+                             bool bRotationInvariant) {
+  return new SurfDetector(num_octaves, num_intervals, bRotationInvariant);
 }
 
 }  // namespace detector
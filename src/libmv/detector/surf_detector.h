@@ -31,8 +31,12 @@ class Detector;
  *
  * \param num_octaves   The number of octave to consider.
  * \param num_intervals The number of intervals.
+ * \param bRotationInvariant Tell if orientation of detected features must
+ *                           be estimated, from the box gradients of the
+ *                           integral image of the detection.
  */
-Detector *CreateSURFDetector(int num_octaves = 4, int num_intervals = 4);
+Detector *CreateSURFDetector(int num_octaves = 4, int num_intervals = 4,
+                             bool bRotationInvariant = false);
 
 }  // namespace detector
 }  // namespace libmv
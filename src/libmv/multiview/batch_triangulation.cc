@@ -0,0 +1,128 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cmath>
+
+#include <Eigen/Eigenvalues>
+
+#include "libmv/logging/logging.h"
+#include "libmv/multiview/batch_triangulation.h"
+
+namespace libmv {
+
+int TriangulateTracks(const vector<Mat34> &Ps,
+                      const TrackObservations &observations,
+                      const BatchTriangulationOptions &options,
+                      Mat4X *X,
+                      vector<int> *status) {
+  const int num_tracks = observations.NumTracks();
+  const int num_observations = observations.camera.size();
+  const double *points = observations.points.begin();
+  X->resize(4, num_tracks);
+  status->resize(num_tracks);
+
+  // Isotropic preconditioning of all the observations, as
+  // IsotropicPreconditionerFromPoints does.
+  double mean[2] = {0, 0}, variance[2] = {0, 0};
+  for (int i = 0; i < num_observations; ++i) {
+    mean[0] += points[2 * i];
+    mean[1] += points[2 * i + 1];
+  }
+  for (int k = 0; k < 2 && num_observations; ++k) {
+    mean[k] /= num_observations;
+  }
+  for (int i = 0; i < num_observations; ++i) {
+    variance[0] += Square(points[2 * i] - mean[0]);
+    variance[1] += Square(points[2 * i + 1] - mean[1]);
+  }
+  for (int k = 0; k < 2 && num_observations; ++k) {
+    variance[k] /= num_observations;
+  }
+  double var_norm = std::sqrt(Square(variance[0]) + Square(variance[1]));
+  double factor = var_norm < 1e-8 ? 1.0 : std::sqrt(2.0 / var_norm);
+  double offset[2] = { -factor * mean[0], -factor * mean[1] };
+  Mat3 T;
+  T << factor, 0,      offset[0],
+       0,      factor, offset[1],
+       0,      0,      1;
+  // The depth of X in camera P has the sign of (P X)_3 X_4 det(M), where
+  // M is the left 3x3 block of P (HZ 6.2.3).
+  vector<Mat34> preconditioned_Ps(Ps.size());
+  vector<double> orientation(Ps.size());
+  for (int c = 0; c < Ps.size(); ++c) {
+    preconditioned_Ps[c] = T * Ps[c];
+    orientation[c] = Ps[c].block<3, 3>(0, 0).determinant() < 0 ? -1 : 1;
+  }
+
+  const double max_squared_error = Square(options.max_reprojection_error);
+  int num_triangulated = 0;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+:num_triangulated)
+  for (int t = 0; t < num_tracks; ++t) {
+    const int begin = observations.track_begin[t];
+    const int end = observations.track_begin[t + 1];
+    Vec4 X_t = Vec4::Zero();
+    int track_status = TRIANGULATION_OK;
+    if (end - begin < options.min_views) {
+      track_status = TRIANGULATION_TOO_FEW_VIEWS;
+    } else {
+      // Normal equations of the two rows SkewMatMinimal(x) * P of each view.
+      Mat4 AtA = Mat4::Zero();
+      for (int i = begin; i < end; ++i) {
+        const Mat34 &P = preconditioned_Ps[observations.camera[i]];
+        double x = factor * points[2 * i] + offset[0];
+        double y = factor * points[2 * i + 1] + offset[1];
+        Vec4 a = y * P.row(2).transpose() - P.row(1).transpose();
+        Vec4 b = P.row(0).transpose() - x * P.row(2).transpose();
+        AtA += a * a.transpose() + b * b.transpose();
+      }
+      // The eigenvalues are sorted in increasing order.
+      Eigen::SelfAdjointEigenSolver<Mat4> eigen_solver(AtA);
+      X_t = eigen_solver.eigenvectors().col(0);
+
+      if (isnan(X_t.sum()) || X_t(3) == 0) {
+        track_status = TRIANGULATION_DEGENERATE;
+      }
+      for (int i = begin; i < end && track_status == TRIANGULATION_OK; ++i) {
+        const int c = observations.camera[i];
+        const Mat34 &P = Ps[c];
+        Vec3 q = P * X_t;
+        if (options.check_cheirality && q(2) * X_t(3) * orientation[c] <= 0) {
+          track_status = TRIANGULATION_BEHIND_CAMERA;
+        } else if (options.max_reprojection_error > 0) {
+          double error = Square(q(0) / q(2) - points[2 * i]) +
+                         Square(q(1) / q(2) - points[2 * i + 1]);
+          if (!(error <= max_squared_error)) {
+            track_status = TRIANGULATION_REPROJECTION_ERROR;
+          }
+        }
+      }
+    }
+    X->col(t) = X_t;
+    (*status)[t] = track_status;
+    if (track_status == TRIANGULATION_OK) {
+      ++num_triangulated;
+    }
+  }
+  VLOG(2) << "Triangulated " << num_triangulated << " of " << num_tracks
+          << " tracks.";
+  return num_triangulated;
+}
+
+}  // namespace libmv
@@ -0,0 +1,117 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_MULTIVIEW_BATCH_TRIANGULATION_H_
+#define LIBMV_MULTIVIEW_BATCH_TRIANGULATION_H_
+
+#include "libmv/base/vector.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+/**
+ * Observations of many tracks by a set of cameras.
+ *
+ * The observations of track t are [track_begin[t], track_begin[t + 1]).
+ * Observation i is the point (points[2 * i], points[2 * i + 1]) in the image
+ * of camera camera[i], an index in the projection matrices given to
+ * TriangulateTracks. The cameras are stored once; a track only carries
+ * indices.
+ */
+struct TrackObservations {
+  TrackObservations() : track_begin(1, 0) {}
+
+  int NumTracks() const { return track_begin.size() - 1; }
+
+  /// Removes all the tracks but keeps the allocated memory.
+  void Clear() {
+    track_begin.resize(1);
+    camera.resize(0);
+    points.resize(0);
+  }
+
+  /// Starts a new, empty, track.
+  void StartTrack() {
+    track_begin.push_back(camera.size());
+  }
+
+  /// Adds an observation to the last track.
+  void Add(int camera_index, double x, double y) {
+    camera.push_back(camera_index);
+    points.push_back(x);
+    points.push_back(y);
+    track_begin[track_begin.size() - 1] = camera.size();
+  }
+
+  vector<int> track_begin;  // NumTracks() + 1 offsets.
+  vector<int> camera;       // One per observation.
+  vector<double> points;    // Two per observation.
+};
+
+struct BatchTriangulationOptions {
+  BatchTriangulationOptions()
+    : min_views(2),
+      check_cheirality(true),
+      max_reprojection_error(0) {}
+
+  // Tracks seen by fewer cameras are not triangulated.
+  int min_views;
+  // Rejects the points that are behind one of the cameras.
+  bool check_cheirality;
+  // Rejects the points that reproject further than this (in pixels) in one
+  // of the images; <= 0 disables the check.
+  double max_reprojection_error;
+};
+
+enum TriangulationStatus {
+  TRIANGULATION_OK,
+  TRIANGULATION_TOO_FEW_VIEWS,
+  TRIANGULATION_DEGENERATE,  // NaN or point at infinity.
+  TRIANGULATION_BEHIND_CAMERA,
+  TRIANGULATION_REPROJECTION_ERROR
+};
+
+/**
+ * Triangulates every track of observations with the algebraic DLT.
+ *
+ * Equivalent to NViewTriangulateAlgebraic per track, but the 2n x 4 design
+ * matrix is never formed: its 4x4 normal equations are accumulated on the
+ * stack and their smallest eigenvector is the point. The image points are
+ * preconditioned with one isotropic normalization computed on all the
+ * observations. The tracks are spread over the OpenMP threads.
+ *
+ * \param[in]  Ps           Projection matrices, indexed by observations.camera.
+ * \param[in]  observations The tracks.
+ * \param[in]  options      Which points to reject.
+ * \param[out] X            Homogeneous points, one column per track.
+ * \param[out] status       Outcome of each track; X.col(t) is only
+ *                          meaningful if status[t] is TRIANGULATION_OK.
+ *
+ * \return the number of tracks triangulated successfully.
+ */
+int TriangulateTracks(const vector<Mat34> &Ps,
+                      const TrackObservations &observations,
+                      const BatchTriangulationOptions &options,
+                      Mat4X *X,
+                      vector<int> *status);
+
+}  // namespace libmv
+
+#endif  // LIBMV_MULTIVIEW_BATCH_TRIANGULATION_H_
@@ -0,0 +1,133 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/base/vector.h"
+#include "libmv/multiview/batch_triangulation.h"
+#include "libmv/multiview/nviewtriangulation.h"
+#include "libmv/multiview/projection.h"
+#include "libmv/multiview/test_data_sets.h"
+#include "libmv/numeric/numeric.h"
+#include "testing/testing.h"
+
+namespace {
+
+using namespace libmv;
+
+// One track per point of d, seen by all the cameras.
+void AllPointsSeenByAllCameras(NViewDataSet &d,
+                               vector<Mat34> *Ps,
+                               TrackObservations *observations) {
+  Ps->resize(d.n);
+  for (int j = 0; j < d.n; ++j) {
+    (*Ps)[j] = d.P(j);
+  }
+  for (int i = 0; i < d.X.cols(); ++i) {
+    observations->StartTrack();
+    for (int j = 0; j < d.n; ++j) {
+      observations->Add(j, d.x[j](0, i), d.x[j](1, i));
+    }
+  }
+}
+
+TEST(TriangulateTracks, MatchesNViewTriangulateAlgebraic) {
+  int nviews = 5;
+  int npoints = 50;
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+  vector<Mat34> Ps;
+  TrackObservations observations;
+  AllPointsSeenByAllCameras(d, &Ps, &observations);
+  EXPECT_EQ(npoints, observations.NumTracks());
+
+  Mat4X X;
+  vector<int> status;
+  BatchTriangulationOptions options;
+  options.max_reprojection_error = 1e-6;
+  EXPECT_EQ(npoints, TriangulateTracks(Ps, observations, options,
+                                       &X, &status));
+  ASSERT_EQ(npoints, X.cols());
+  ASSERT_EQ(npoints, status.size());
+
+  for (int i = 0; i < npoints; ++i) {
+    EXPECT_EQ(TRIANGULATION_OK, status[i]);
+    Mat2X xs(2, nviews);
+    for (int j = 0; j < nviews; ++j) {
+      xs.col(j) = d.x[j].col(i);
+    }
+    Vec4 X_algebraic;
+    NViewTriangulateAlgebraic(xs, Ps, &X_algebraic);
+    Vec3 expected = HomogeneousToEuclidean(X_algebraic);
+    Vec3 actual = HomogeneousToEuclidean(Vec4(X.col(i)));
+    EXPECT_MATRIX_NEAR(expected, actual, 1e-8);
+    EXPECT_MATRIX_NEAR(d.X.col(i), actual, 1e-8);
+  }
+}
+
+TEST(TriangulateTracks, RejectsBadTracks) {
+  int nviews = 3;
+  int npoints = 4;
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+  vector<Mat34> Ps;
+  TrackObservations observations;
+  AllPointsSeenByAllCameras(d, &Ps, &observations);
+
+  // A track seen only once.
+  observations.StartTrack();
+  observations.Add(1, d.x[1](0, 0), d.x[1](1, 0));
+
+  // A track with one observation moved by 10 pixels.
+  observations.StartTrack();
+  for (int j = 0; j < nviews; ++j) {
+    observations.Add(j, d.x[j](0, 1) + (j == 2 ? 10 : 0), d.x[j](1, 1));
+  }
+
+  // A point behind the first camera.
+  Vec3 X_behind = 2 * d.C[0] - d.X.col(2);
+  observations.StartTrack();
+  for (int j = 0; j < nviews; ++j) {
+    Vec2 x = Project(Ps[j], X_behind);
+    observations.Add(j, x(0), x(1));
+  }
+
+  BatchTriangulationOptions options;
+  options.max_reprojection_error = 1;
+  Mat4X X;
+  vector<int> status;
+  EXPECT_EQ(npoints, TriangulateTracks(Ps, observations, options,
+                                       &X, &status));
+  ASSERT_EQ(npoints + 3, status.size());
+  EXPECT_EQ(TRIANGULATION_TOO_FEW_VIEWS,      status[npoints]);
+  EXPECT_EQ(TRIANGULATION_REPROJECTION_ERROR, status[npoints + 1]);
+  EXPECT_EQ(TRIANGULATION_BEHIND_CAMERA,      status[npoints + 2]);
+
+  // Without the checks, the outlier and the point behind are kept.
+  options.check_cheirality = false;
+  options.max_reprojection_error = 0;
+  EXPECT_EQ(npoints + 2, TriangulateTracks(Ps, observations, options,
+                                           &X, &status));
+  Vec3 X_behind_triangulated = HomogeneousToEuclidean(Vec4(X.col(npoints + 2)));
+  EXPECT_MATRIX_NEAR(X_behind, X_behind_triangulated, 1e-6);
+
+  // Clear keeps nothing.
+  observations.Clear();
+  EXPECT_EQ(0, observations.NumTracks());
+  EXPECT_EQ(0, TriangulateTracks(Ps, observations, options, &X, &status));
+}
+
+}  // namespace
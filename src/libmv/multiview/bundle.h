@@ -24,6 +24,7 @@
 
 #include "libmv/base/vector.h"
 #include "libmv/numeric/numeric.h"
+#include "libmv/numeric/robust_loss.h"
 
 namespace libmv {
   
@@ -88,7 +89,263 @@ double EuclideanBA(const vector<Mat2X> &x,
                    vector<Vec3> *ts,
                    Mat3X *X,
                    eLibmvBundleType type = eBUNDLE_FOCAL_LENGTH);
-                                                  
+
+// How the reduced camera system of the in-tree bundle adjuster is solved.
+enum eLibmvBundleLinearSolver
+{
+  // Sparse LDL^T factorization of the reduced camera matrix. Its memory
+  // grows with the number of pairs of cameras seeing a common point.
+  eBUNDLE_SPARSE_SCHUR = 0,
+  // Conjugate gradients on the implicit Schur complement: the reduced camera
+  // matrix is never formed and the memory grows with the number of
+  // observations.
+  eBUNDLE_ITERATIVE_SCHUR = 1
+};
+
+// Preconditioner of eBUNDLE_ITERATIVE_SCHUR.
+enum eLibmvBundlePreconditioner
+{
+  eBUNDLE_JACOBI = 0,        // Camera blocks of J^T J.
+  eBUNDLE_SCHUR_JACOBI = 1   // Diagonal blocks of the reduced camera matrix.
+};
+
+// Bits of BundleOptions::constant_camera_parameters and
+// BundleOptions::constant_intrinsics.
+enum eLibmvBundleConstantParameter
+{
+  eBUNDLE_CONSTANT_ROTATION = 1,
+  eBUNDLE_CONSTANT_TRANSLATION = 2,
+  eBUNDLE_CONSTANT_FOCAL_LENGTH = 4,
+  eBUNDLE_CONSTANT_PRINCIPAL_POINT = 8
+};
+
+// What happened at one iteration of the in-tree bundle adjuster.
+struct BundleIterationSummary {
+  BundleIterationSummary()
+    : iteration(0),
+      cost(0),
+      cost_change(0),
+      gradient_max_norm(0),
+      step_norm(0),
+      lambda(0),
+      step_quality(0),
+      step_is_successful(false),
+      linear_iterations(0),
+      jacobian_time(0),
+      linear_solver_time(0),
+      residual_time(0) {}
+
+  int iteration;
+  double cost;               // After the iteration.
+  double cost_change;        // Decrease of the cost, 0 if the step failed.
+  double gradient_max_norm;  // Before the step.
+  double step_norm;
+  double lambda;             // Damping of the step.
+  // Actual over predicted decrease of the cost; 0 if the reduced camera
+  // system could not be solved or the predicted decrease is 0.
+  double step_quality;
+  bool step_is_successful;
+  int linear_iterations;     // Conjugate gradient iterations.
+  // Seconds spent linearizing at the new parameters, solving the damped
+  // normal equations and evaluating the cost of the step.
+  double jacobian_time;
+  double linear_solver_time;
+  double residual_time;
+};
+
+// Called after each iteration of the in-tree bundle adjuster, e.g. to report
+// its progress.
+class BundleIterationCallback {
+ public:
+  virtual ~BundleIterationCallback() {}
+  // Returns false to stop the bundle adjustment.
+  virtual bool operator()(const BundleIterationSummary &summary) = 0;
+};
+
+// Options of the in-tree sparse bundle adjuster.
+struct BundleOptions {
+  BundleOptions()
+    : type(eBUNDLE_METRIC),
+      max_iterations(50),
+      gradient_tolerance(1e-10),
+      parameter_tolerance(1e-10),
+      function_tolerance(1e-12),
+      initial_lambda(1e-3),
+      linear_solver(eBUNDLE_SPARSE_SCHUR),
+      preconditioner(eBUNDLE_SCHUR_JACOBI),
+      max_linear_iterations(500),
+      linear_tolerance(1e-6),
+      callback(NULL) {}
+
+  // Which intrinsic parameters are refined. The lens distortion is not
+  // modelled: eBUNDLE_RADIAL and eBUNDLE_RADIAL_TANGENTIAL refine the same
+  // parameters as eBUNDLE_FOCAL_LENGTH_PP.
+  eLibmvBundleType type;
+  int max_iterations;
+  // Stop when the largest gradient component is below this.
+  double gradient_tolerance;
+  // Stop when |dx| < parameter_tolerance * (|x| + parameter_tolerance).
+  double parameter_tolerance;
+  // Stop when a step decreases the cost by less than this, relatively.
+  double function_tolerance;
+  // Initial Levenberg-Marquardt damping, relative to the diagonal of J^T J.
+  double initial_lambda;
+  // Indices of the cameras whose intrinsics and pose are held fixed. Their
+  // observations still constrain the points, so they can anchor the gauge
+  // of a local bundle adjustment.
+  vector<int> constant_cameras;
+  // Intrinsics group of each camera, or empty. The cameras of a group share
+  // the intrinsics refined by type, e.g. the cameras taken with one body in
+  // a dataset mixing several ones; they start from those of the first camera
+  // of the group that is not constant. Without groups each camera has its
+  // own intrinsics.
+  vector<int> intrinsics_groups;
+  // Parameters held fixed, as eLibmvBundleConstantParameter bits, or empty:
+  // the pose bits of camera i, and the intrinsics bits of group g (of camera
+  // g without groups). They are not unknowns of the reduced camera system; a
+  // camera left without any is treated as a constant camera.
+  vector<int> constant_camera_parameters;
+  vector<int> constant_intrinsics;
+
+  eLibmvBundleLinearSolver linear_solver;
+  // Used by eBUNDLE_ITERATIVE_SCHUR only.
+  eLibmvBundlePreconditioner preconditioner;
+  int max_linear_iterations;
+  // Stop the conjugate gradients when |S dc - b| < linear_tolerance * |b|.
+  double linear_tolerance;
+  // Applied to the reprojection error of each observation, in pixels. With a
+  // robust loss the outliers are downweighted during the optimization
+  // instead of being removed beforehand.
+  RobustLoss loss;
+  // Not owned; may be NULL.
+  BundleIterationCallback *callback;
+};
+
+// What happened during a bundle adjustment.
+struct BundleSummary {
+  BundleSummary()
+    : num_iterations(0),
+      num_successful_iterations(0),
+      num_linear_iterations(0),
+      initial_cost(0),
+      final_cost(0),
+      initial_rms(0),
+      final_rms(0),
+      reduced_system_nonzeros(0),
+      factor_nonzeros(0),
+      jacobian_time(0),
+      linear_solver_time(0),
+      residual_time(0),
+      total_time(0) {}
+
+  int num_iterations;             // Linear solves, successful or not.
+  int num_successful_iterations;  // Steps that decreased the cost.
+  int num_linear_iterations;      // Conjugate gradient iterations, in total.
+  double initial_cost;            // 1/2 sum of the robust losses.
+  double final_cost;
+  double initial_rms;             // In pixels.
+  double final_rms;               // In pixels.
+  // Scalar nonzeros of the reduced camera matrix and of its LDL^T factor; 0
+  // with eBUNDLE_ITERATIVE_SCHUR, which does not form them.
+  int reduced_system_nonzeros;
+  int factor_nonzeros;
+  // Seconds, in total. The total also counts setting up the solver.
+  double jacobian_time;
+  double linear_solver_time;
+  double residual_time;
+  double total_time;
+  vector<BundleIterationSummary> iterations;
+};
+
+/**
+ * \brief Euclidean bundle adjustment with per camera intrinsics.
+ *
+ * Same problem as the EuclideanBA above, solved in-tree without copying the
+ * problem into SSBA. Each camera has its own calibration matrix: the focal
+ * length (the aspect ratio and the skew are held fixed) and, depending on
+ * options.type, the principal point are refined per camera, or per group of
+ * cameras with options.intrinsics_groups. Parameters can be held fixed one
+ * by one; see options.constant_camera_parameters.
+ *
+ * The solver is Levenberg-Marquardt. The Jacobian blocks of the observations
+ * are computed on all the OpenMP threads, the points are eliminated with a
+ * Schur complement and the reduced camera system is either factored with a
+ * sparse LDL^T decomposition (LDL, ordered with SYMAMD) or, for problems too
+ * large for it, solved with preconditioned conjugate gradients that only
+ * multiply by the Jacobian blocks; see options.linear_solver. The sparsity
+ * pattern and the symbolic factorization are computed once per call.
+ *
+ * \return the final root mean square reprojection error, in pixels.
+ */
+double EuclideanBA(const vector<Mat2X> &x,
+                   const vector<Vecu> &x_ids,
+                   vector<Mat3> *Ks,
+                   vector<Mat3> *Rs,
+                   vector<Vec3> *ts,
+                   Mat3X *X,
+                   const BundleOptions &options,
+                   BundleSummary *summary = NULL);
+
+class BundleProblemImpl;
+
+/**
+ * \brief A bundle adjustment problem kept between incremental solves.
+ *
+ * Holds the cameras, points and observations of the EuclideanBA above, so
+ * that a reconstruction that grows one camera at a time is not gathered
+ * again before each bundle adjustment. They are referred to by the handles
+ * returned when they are added; the handles of removed ones are reused.
+ * Adding or removing an observation, a point or a camera is O(1), plus the
+ * observations removed with a point or a camera.
+ *
+ * Solve() sets up the solver again only if the problem changed since the
+ * previous call, and then keeps the fill reducing ordering of the reduced
+ * camera system: the cameras added since are eliminated last, until they
+ * are a quarter of the cameras and SYMAMD is run again. The
+ * Levenberg-Marquardt damping starts from where the previous call ended.
+ *
+ * options.constant_cameras is ignored: see SetCameraConstant(). So are the
+ * intrinsics groups and the constant parameters.
+ */
+class BundleProblem {
+ public:
+  BundleProblem(const BundleOptions &options);
+  ~BundleProblem();
+
+  int AddCamera(const Mat3 &K, const Mat3 &R, const Vec3 &t);
+  // Also removes the observations of the camera.
+  void RemoveCamera(int camera);
+  void SetCamera(int camera, const Mat3 &K, const Mat3 &R, const Vec3 &t);
+  void GetCamera(int camera, Mat3 *K, Mat3 *R, Vec3 *t) const;
+  // The intrinsics and the pose of a constant camera are held fixed.
+  void SetCameraConstant(int camera, bool constant);
+
+  int AddPoint(const Vec3 &X);
+  // Also removes the observations of the point.
+  void RemovePoint(int point);
+  void SetPoint(int point, const Vec3 &X);
+  Vec3 GetPoint(int point) const;
+
+  // x is the projection of point in camera.
+  int AddObservation(int camera, int point, const Vec2 &x);
+  void RemoveObservation(int observation);
+
+  int num_cameras() const;
+  int num_points() const;
+  int num_observations() const;
+
+  // Refines the cameras and the points. Returns the final root mean square
+  // reprojection error, in pixels.
+  double Solve(BundleSummary *summary = NULL);
+
+ private:
+  BundleProblemImpl *impl_;
+
+  // No copying allowed.
+  BundleProblem(const BundleProblem &);
+  void operator=(const BundleProblem &);
+};
+
 } // namespace libmv
 
 #endif  // LIBMV_MULTIVIEW_BUNDLE_H_
@@ -18,6 +18,8 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
+
 #include "testing/testing.h"
 #include "libmv/numeric/numeric.h"
 #include "libmv/multiview/test_data_sets.h"
@@ -112,4 +114,536 @@ TEST(EuclideanBA, NViews) {
     EXPECT_LT(FrobeniusNorm(error), 1e-3);
   }
 }
+
+// Adds noise to the motion and structure, and to the intrinsics when the
+// bundle adjustment has to refine them.
+void PerturbNViews(bool perturb_intrinsics,
+                   vector<Mat3> *K, vector<Mat3> *R, vector<Vec3> *t,
+                   Mat3X *X) {
+  srand(3);
+  for (int i = 0; i < R->size(); ++i) {
+    if (perturb_intrinsics) {
+      double scale = 1 + (rand() / double(RAND_MAX) - 0.5) * 0.05;
+      (*K)[i](0, 0) *= scale;
+      (*K)[i](1, 1) *= scale;
+      (*K)[i](0, 2) += (rand() / double(RAND_MAX) - 0.5) * 10;
+      (*K)[i](1, 2) += (rand() / double(RAND_MAX) - 0.5) * 10;
+    }
+    (*R)[i] *= RotationAroundX((rand() / double(RAND_MAX) - 0.5) * 0.02)
+             * RotationAroundY((rand() / double(RAND_MAX) - 0.5) * 0.02)
+             * RotationAroundZ((rand() / double(RAND_MAX) - 0.5) * 0.02);
+    (*t)[i] += Vec3::Random() * 0.05;
+  }
+  *X += Mat3X::Random(3, X->cols()) * 0.05;
+}
+
+TEST(EuclideanBA, NViewsSparseSchurMetric) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  vector<Mat3>  K = d.K;
+  vector<Mat3>  R = d.R;
+  vector<Vec3>  t = d.t;
+  Mat3X X = d.X;
+  PerturbNViews(false, &K, &R, &t, &X);
+
+  Mat34 P;
+  for (int i = 0; i < nviews; ++i) {         // Check there's enough error.
+    P_From_KRt(K[i], R[i], t[i], &P);
+    EXPECT_GT(FrobeniusNorm(d.x[i] - Project(P, X, d.x_ids[i])), 1);
+  }
+
+  BundleOptions options;
+  options.type = eBUNDLE_METRIC;
+  BundleSummary summary;
+  double rms = EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options, &summary);
+
+  EXPECT_LT(rms, 1e-6);
+  EXPECT_GT(summary.initial_rms, 1);
+  EXPECT_EQ(rms, summary.final_rms);
+  EXPECT_LT(0, summary.num_successful_iterations);
+  for (int i = 0; i < nviews; ++i) {
+    EXPECT_MATRIX_NEAR(d.K[i], K[i], 1e-12);  // Intrinsics are held fixed.
+    P_From_KRt(K[i], R[i], t[i], &P);
+    EXPECT_LT(FrobeniusNorm(d.x[i] - Project(P, X, d.x_ids[i])), 1e-5);
+  }
+}
+
+TEST(EuclideanBA, NViewsSparseSchurPerCameraIntrinsics) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  // Make every camera different.
+  for (int i = 0; i < nviews; ++i) {
+    d.K[i](0, 0) += 20 * i;
+    d.K[i](1, 1) += 20 * i;
+    d.K[i](0, 2) -= 3 * i;
+    d.x[i] = Project(d.P(i), d.X, d.x_ids[i]);
+  }
+  vector<Mat3>  K = d.K;
+  vector<Mat3>  R = d.R;
+  vector<Vec3>  t = d.t;
+  Mat3X X = d.X;
+  PerturbNViews(true, &K, &R, &t, &X);
+
+  BundleOptions options;
+  options.type = eBUNDLE_FOCAL_LENGTH_PP;
+  options.max_iterations = 200;
+  double rms = EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options);
+
+  EXPECT_LT(rms, 1e-5);
+  Mat34 P;
+  for (int i = 0; i < nviews; ++i) {
+    EXPECT_NEAR(K[i](1, 1) / K[i](0, 0), d.K[i](1, 1) / d.K[i](0, 0), 1e-12);
+    P_From_KRt(K[i], R[i], t[i], &P);
+    EXPECT_LT(FrobeniusNorm(d.x[i] - Project(P, X, d.x_ids[i])), 1e-4);
+  }
+}
+
+TEST(EuclideanBA, NViewsSparseSchurConstantCameras) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  vector<Mat3>  K = d.K;
+  vector<Mat3>  R = d.R;
+  vector<Vec3>  t = d.t;
+  Mat3X X = d.X;
+  PerturbNViews(false, &K, &R, &t, &X);
+  // The first two cameras anchor the gauge.
+  for (int i = 0; i < 2; ++i) {
+    R[i] = d.R[i];
+    t[i] = d.t[i];
+  }
+
+  BundleOptions options;
+  options.constant_cameras.push_back(0);
+  options.constant_cameras.push_back(1);
+  double rms = EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options);
+
+  EXPECT_LT(rms, 1e-6);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_MATRIX_NEAR(d.R[i], R[i], 1e-15);
+    EXPECT_MATRIX_NEAR(d.t[i], t[i], 1e-15);
+  }
+  // With the gauge fixed the other cameras go back to the ground truth.
+  for (int i = 2; i < nviews; ++i) {
+    EXPECT_MATRIX_NEAR(d.R[i], R[i], 1e-6);
+    EXPECT_MATRIX_NEAR(d.t[i], t[i], 1e-6);
+  }
+}
+
+TEST(EuclideanBA, NViewsIntrinsicsGroups) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  // Two camera bodies, taking every other view.
+  vector<int> groups(nviews);
+  for (int i = 0; i < nviews; ++i) {
+    groups[i] = i % 2;
+    d.K[i](0, 0) += 80 * groups[i];
+    d.K[i](1, 1) += 80 * groups[i];
+    d.K[i](1, 2) -= 10 * groups[i];
+    d.x[i] = Project(d.P(i), d.X, d.x_ids[i]);
+  }
+  for (int linear_solver = eBUNDLE_SPARSE_SCHUR;
+       linear_solver <= eBUNDLE_ITERATIVE_SCHUR; ++linear_solver) {
+    vector<Mat3>  K = d.K;
+    vector<Mat3>  R = d.R;
+    vector<Vec3>  t = d.t;
+    Mat3X X = d.X;
+    PerturbNViews(true, &K, &R, &t, &X);
+
+    BundleOptions options;
+    options.type = eBUNDLE_FOCAL_LENGTH_PP;
+    options.max_iterations = 200;
+    options.linear_solver = (eLibmvBundleLinearSolver) linear_solver;
+    options.linear_tolerance = 1e-10;
+    options.intrinsics_groups = groups;
+    double rms = EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options);
+
+    EXPECT_LT(rms, 1e-5);
+    Mat34 P;
+    for (int i = 0; i < nviews; ++i) {
+      EXPECT_MATRIX_NEAR(K[groups[i]], K[i], 1e-12);
+      P_From_KRt(K[i], R[i], t[i], &P);
+      EXPECT_LT(FrobeniusNorm(d.x[i] - Project(P, X, d.x_ids[i])), 1e-4);
+    }
+  }
+}
+
+TEST(EuclideanBA, NViewsConstantParameters) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  for (int linear_solver = eBUNDLE_SPARSE_SCHUR;
+       linear_solver <= eBUNDLE_ITERATIVE_SCHUR; ++linear_solver) {
+    // Only the translations, the focal lengths and the points are off.
+    vector<Mat3>  K = d.K;
+    vector<Mat3>  R = d.R;
+    vector<Vec3>  t = d.t;
+    Mat3X X = d.X;
+    PerturbNViews(false, &K, &R, &t, &X);
+    for (int i = 0; i < nviews; ++i) {
+      R[i] = d.R[i];
+      K[i](0, 0) *= 1.01;
+      K[i](1, 1) *= 1.01;
+    }
+    t[0] = d.t[0];
+
+    BundleOptions options;
+    options.type = eBUNDLE_FOCAL_LENGTH_PP;
+    options.max_iterations = 200;
+    options.linear_solver = (eLibmvBundleLinearSolver) linear_solver;
+    options.linear_tolerance = 1e-10;
+    BundleSummary free_summary;
+    vector<Mat3>  free_K = K;
+    vector<Mat3>  free_R = R;
+    vector<Vec3>  free_t = t;
+    Mat3X free_X = X;
+    EuclideanBA(d.x, d.x_ids, &free_K, &free_R, &free_t, &free_X, options,
+                &free_summary);
+
+    options.constant_camera_parameters.resize(nviews);
+    options.constant_intrinsics.resize(nviews);
+    for (int i = 0; i < nviews; ++i) {
+      options.constant_camera_parameters[i] = eBUNDLE_CONSTANT_ROTATION;
+      options.constant_intrinsics[i] = eBUNDLE_CONSTANT_PRINCIPAL_POINT;
+    }
+    options.constant_camera_parameters[0] |= eBUNDLE_CONSTANT_TRANSLATION;
+    BundleSummary summary;
+    double rms = EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options, &summary);
+
+    EXPECT_LT(rms, 1e-6);
+    EXPECT_MATRIX_NEAR(d.t[0], t[0], 1e-15);
+    Mat34 P;
+    for (int i = 0; i < nviews; ++i) {
+      EXPECT_MATRIX_NEAR(d.R[i], R[i], 1e-15);
+      EXPECT_NEAR(d.K[i](0, 2), K[i](0, 2), 1e-15);
+      EXPECT_NEAR(d.K[i](1, 2), K[i](1, 2), 1e-15);
+      P_From_KRt(K[i], R[i], t[i], &P);
+      EXPECT_LT(FrobeniusNorm(d.x[i] - Project(P, X, d.x_ids[i])), 1e-5);
+    }
+    // 4 of the 9 parameters of a camera are unknowns.
+    if (linear_solver == eBUNDLE_SPARSE_SCHUR) {
+      EXPECT_LT(0, summary.reduced_system_nonzeros);
+      EXPECT_LT(5 * summary.reduced_system_nonzeros,
+                free_summary.reduced_system_nonzeros);
+    }
+  }
+}
+
+TEST(EuclideanBA, NViewsRobustLoss) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  // Moves one observation out of 10 by 30 pixels.
+  vector<Mat2X> x = d.x;
+  for (int i = 0; i < nviews; ++i) {
+    for (int k = i % 10; k < x[i].cols(); k += 10) {
+      x[i].col(k) += Vec2(30, -20);
+    }
+  }
+
+  BundleOptions options;
+  options.constant_cameras.push_back(0);
+  options.constant_cameras.push_back(1);
+  options.max_iterations = 100;
+  RobustLossType types[] = { TRIVIAL_LOSS, HUBER_LOSS, CAUCHY_LOSS };
+  double camera_errors[3];
+  vector<Mat3> K, R;
+  vector<Vec3> t;
+  Mat3X X;
+  for (int l = 0; l < 3; ++l) {
+    K = d.K;
+    R = d.R;
+    t = d.t;
+    X = d.X;
+    PerturbNViews(false, &K, &R, &t, &X);
+    for (int i = 0; i < 2; ++i) {
+      R[i] = d.R[i];
+      t[i] = d.t[i];
+    }
+    options.loss = RobustLoss(types[l], 2.0);
+    BundleSummary summary;
+    EuclideanBA(x, d.x_ids, &K, &R, &t, &X, options, &summary);
+    EXPECT_LT(summary.final_cost, summary.initial_cost);
+    camera_errors[l] = 0;
+    for (int i = 2; i < nviews; ++i) {
+      camera_errors[l] = std::max(camera_errors[l], (d.t[i] - t[i]).norm());
+    }
+  }
+  // The outliers pull the least squares solution away from the truth.
+  EXPECT_GT(camera_errors[TRIVIAL_LOSS], 1e-3);
+  EXPECT_LT(camera_errors[HUBER_LOSS], camera_errors[TRIVIAL_LOSS] / 5);
+  EXPECT_LT(camera_errors[CAUCHY_LOSS], camera_errors[TRIVIAL_LOSS] / 5);
+
+  // The truncated loss ignores the outliers entirely, but needs to start
+  // close enough: here from the solution with the Cauchy loss.
+  options.loss = RobustLoss(TRUNCATED_LOSS, 2.0);
+  BundleSummary summary;
+  EuclideanBA(x, d.x_ids, &K, &R, &t, &X, options, &summary);
+  EXPECT_LT(summary.final_cost, summary.initial_cost);
+  double truncated_error = 0;
+  for (int i = 2; i < nviews; ++i) {
+    truncated_error = std::max(truncated_error, (d.t[i] - t[i]).norm());
+  }
+  EXPECT_LT(truncated_error, camera_errors[CAUCHY_LOSS]);
+}
+
+TEST(EuclideanBA, NViewsTrace) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  BundleOptions options;
+  options.type = eBUNDLE_METRIC;
+  for (int s = 0; s < 2; ++s) {
+    options.linear_solver = s ? eBUNDLE_ITERATIVE_SCHUR : eBUNDLE_SPARSE_SCHUR;
+    vector<Mat3>  K = d.K;
+    vector<Mat3>  R = d.R;
+    vector<Vec3>  t = d.t;
+    Mat3X X = d.X;
+    PerturbNViews(false, &K, &R, &t, &X);
+    BundleSummary summary;
+    EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options, &summary);
+
+    EXPECT_EQ(summary.num_iterations, summary.iterations.size());
+    double cost = summary.initial_cost;
+    int num_successful_iterations = 0, num_linear_iterations = 0;
+    for (int i = 0; i < summary.iterations.size(); ++i) {
+      const BundleIterationSummary &trace = summary.iterations[i];
+      EXPECT_EQ(i, trace.iteration);
+      EXPECT_LE(trace.cost, cost);
+      EXPECT_NEAR(cost - trace.cost, trace.cost_change, 1e-12 * cost);
+      if (trace.step_is_successful) {
+        num_successful_iterations++;
+        // Close to the solution the linearization is a good model.
+        EXPECT_GT(trace.step_quality, 0);
+      }
+      EXPECT_GE(trace.jacobian_time, 0);
+      EXPECT_GE(trace.linear_solver_time, 0);
+      EXPECT_GE(trace.residual_time, 0);
+      num_linear_iterations += trace.linear_iterations;
+      cost = trace.cost;
+    }
+    EXPECT_EQ(summary.final_cost, cost);
+    EXPECT_EQ(summary.num_successful_iterations, num_successful_iterations);
+    EXPECT_EQ(summary.num_linear_iterations, num_linear_iterations);
+    EXPECT_GE(summary.total_time, summary.linear_solver_time);
+    if (s == 0) {
+      // 6 x 6 blocks of 8 cameras, most of them seeing common points.
+      EXPECT_LT(6 * 6 * 8, summary.reduced_system_nonzeros);
+      EXPECT_GE(6 * 6 * 8 * 8, summary.reduced_system_nonzeros);
+      EXPECT_LT(0, summary.factor_nonzeros);
+      EXPECT_EQ(0, num_linear_iterations);
+    } else {
+      EXPECT_EQ(0, summary.reduced_system_nonzeros);
+      EXPECT_LT(0, num_linear_iterations);
+    }
+  }
+}
+
+// Stops after a given number of iterations.
+class StopAfter : public BundleIterationCallback {
+ public:
+  StopAfter(int num_iterations) : num_iterations_(num_iterations),
+                                  num_calls_(0) {}
+  virtual bool operator()(const BundleIterationSummary &summary) {
+    EXPECT_EQ(num_calls_, summary.iteration);
+    return ++num_calls_ < num_iterations_;
+  }
+
+ private:
+  int num_iterations_;
+  int num_calls_;
+};
+
+TEST(EuclideanBA, NViewsCallback) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  vector<Mat3>  K = d.K;
+  vector<Mat3>  R = d.R;
+  vector<Vec3>  t = d.t;
+  Mat3X X = d.X;
+  PerturbNViews(false, &K, &R, &t, &X);
+  StopAfter stop_after(2);
+  BundleOptions options;
+  options.callback = &stop_after;
+  BundleSummary summary;
+  double rms = EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options, &summary);
+  EXPECT_EQ(2, summary.iterations.size());
+  EXPECT_GT(rms, 1e-6);
+}
+
+// Adds the cameras of d to problem with the poses R, t and the points X
+// when they are first seen. point_handles maps the points of d to the
+// problem.
+void AddNViewsCamera(const NViewDataSet &d, int i,
+                     const Mat3 &R, const Vec3 &t, const Mat3X &X,
+                     vector<int> *point_handles, BundleProblem *problem) {
+  const int camera = problem->AddCamera(d.K[i], R, t);
+  for (int c = 0; c < d.x_ids[i].size(); ++c) {
+    const int j = d.x_ids[i][c];
+    if ((*point_handles)[j] < 0) {
+      (*point_handles)[j] = problem->AddPoint(X.col(j));
+    }
+    problem->AddObservation(camera, (*point_handles)[j], d.x[i].col(c));
+  }
+}
+
+TEST(BundleProblem, NViews) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  vector<Mat3>  K = d.K;
+  vector<Mat3>  R = d.R;
+  vector<Vec3>  t = d.t;
+  Mat3X X = d.X;
+  PerturbNViews(false, &K, &R, &t, &X);
+  for (int i = 0; i < 2; ++i) {
+    R[i] = d.R[i];
+    t[i] = d.t[i];
+  }
+
+  BundleProblem problem((BundleOptions()));
+  vector<int> point_handles(npoints, -1);
+  for (int i = 0; i < nviews; ++i) {
+    AddNViewsCamera(d, i, R[i], t[i], X, &point_handles, &problem);
+  }
+  problem.SetCameraConstant(0, true);
+  problem.SetCameraConstant(1, true);
+  EXPECT_EQ(nviews, problem.num_cameras());
+  EXPECT_EQ(npoints - std::count(point_handles.begin(), point_handles.end(),
+                                 -1),
+            problem.num_points());
+  BundleSummary summary;
+  double rms = problem.Solve(&summary);
+  EXPECT_LT(rms, 1e-6);
+  EXPECT_GT(summary.initial_rms, 1);
+
+  Mat3 K_i, R_i;
+  Vec3 t_i;
+  for (int i = 0; i < nviews; ++i) {
+    problem.GetCamera(i, &K_i, &R_i, &t_i);
+    EXPECT_MATRIX_NEAR(d.R[i], R_i, 1e-6);
+    EXPECT_MATRIX_NEAR(d.t[i], t_i, 1e-6);
+  }
+  for (int j = 0; j < npoints; ++j) {
+    if (point_handles[j] < 0) {
+      continue;
+    }
+    Vec3 X_j = problem.GetPoint(point_handles[j]);
+    Vec3 expected = d.X.col(j);
+    EXPECT_MATRIX_NEAR(expected, X_j, 1e-5);
+  }
+
+  // Solving again the same problem keeps the solver and does nothing.
+  problem.Solve(&summary);
+  EXPECT_EQ(0, summary.num_successful_iterations);
+}
+
+TEST(BundleProblem, IncrementalUpdates) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  vector<Mat3>  K = d.K;
+  vector<Mat3>  R = d.R;
+  vector<Vec3>  t = d.t;
+  Mat3X X = d.X;
+  PerturbNViews(false, &K, &R, &t, &X);
+
+  // The cameras are added one at a time, as in a video reconstruction.
+  BundleProblem problem((BundleOptions()));
+  vector<int> point_handles(npoints, -1);
+  AddNViewsCamera(d, 0, d.R[0], d.t[0], X, &point_handles, &problem);
+  AddNViewsCamera(d, 1, d.R[1], d.t[1], X, &point_handles, &problem);
+  problem.SetCameraConstant(0, true);
+  problem.SetCameraConstant(1, true);
+  BundleSummary summary;
+  for (int i = 2; i < nviews; ++i) {
+    AddNViewsCamera(d, i, R[i], t[i], X, &point_handles, &problem);
+    problem.Solve(&summary);
+    EXPECT_LE(summary.final_cost, summary.initial_cost);
+  }
+
+  // Some points of the data set are not seen.
+  vector<int> points;
+  for (int j = 0; j < npoints; ++j) {
+    if (point_handles[j] >= 0) {
+      points.push_back(point_handles[j]);
+    }
+  }
+  EXPECT_EQ(points.size(), problem.num_points());
+
+  // A wrong camera and a wrong observation, removed before the last solve.
+  const int wrong_camera = problem.AddCamera(d.K[0], d.R[3], d.t[5]);
+  for (int j = 0; j < 10; ++j) {
+    problem.AddObservation(wrong_camera, points[j], Vec2(100, 200));
+  }
+  const int wrong_observation =
+      problem.AddObservation(2, points[0], Vec2(-50, 50));
+  EXPECT_EQ(nviews + 1, problem.num_cameras());
+  EXPECT_EQ(nviews, wrong_camera);
+  problem.RemoveCamera(wrong_camera);
+  problem.RemoveObservation(wrong_observation);
+  EXPECT_EQ(nviews, problem.num_cameras());
+  int num_observations = 0;
+  for (int i = 0; i < nviews; ++i) {
+    num_observations += d.x_ids[i].size();
+  }
+  EXPECT_EQ(num_observations, problem.num_observations());
+
+  // A point that is added and removed with its observations.
+  const int wrong_point = problem.AddPoint(Vec3(1, 2, 3));
+  problem.AddObservation(3, wrong_point, Vec2(10, 20));
+  problem.RemovePoint(wrong_point);
+  EXPECT_EQ(points.size(), problem.num_points());
+  EXPECT_EQ(num_observations, problem.num_observations());
+
+  double rms = problem.Solve(&summary);
+  EXPECT_LT(rms, 1e-6);
+  Mat3 K_i, R_i;
+  Vec3 t_i;
+  for (int i = 2; i < nviews; ++i) {
+    problem.GetCamera(i, &K_i, &R_i, &t_i);
+    EXPECT_MATRIX_NEAR(d.R[i], R_i, 1e-6);
+    EXPECT_MATRIX_NEAR(d.t[i], t_i, 1e-6);
+  }
+
+  // The handles of the removed ones are reused.
+  EXPECT_EQ(wrong_camera, problem.AddCamera(d.K[0], d.R[0], d.t[0]));
+  EXPECT_EQ(wrong_point, problem.AddPoint(Vec3(1, 2, 3)));
+}
+
+TEST(EuclideanBA, NViewsIterativeSchur) {
+  int nviews = 8;
+  int npoints = 60;
+  NViewDataSet  d = NRealisticCamerasSparse(nviews, npoints);
+  for (int preconditioner = eBUNDLE_JACOBI;
+       preconditioner <= eBUNDLE_SCHUR_JACOBI; ++preconditioner) {
+    vector<Mat3>  K = d.K;
+    vector<Mat3>  R = d.R;
+    vector<Vec3>  t = d.t;
+    Mat3X X = d.X;
+    PerturbNViews(true, &K, &R, &t, &X);
+
+    BundleOptions options;
+    options.type = eBUNDLE_FOCAL_LENGTH_PP;
+    options.max_iterations = 200;
+    options.linear_solver = eBUNDLE_ITERATIVE_SCHUR;
+    options.preconditioner = (eLibmvBundlePreconditioner) preconditioner;
+    options.linear_tolerance = 1e-10;
+    BundleSummary summary;
+    double rms = EuclideanBA(d.x, d.x_ids, &K, &R, &t, &X, options,
+                             &summary);
+
+    EXPECT_LT(rms, 1e-5);
+    EXPECT_LT(0, summary.num_linear_iterations);
+    Mat34 P;
+    for (int i = 0; i < nviews; ++i) {
+      P_From_KRt(K[i], R[i], t[i], &P);
+      EXPECT_LT(FrobeniusNorm(d.x[i] - Project(P, X, d.x_ids[i])), 1e-4);
+    }
+  }
+}
 }
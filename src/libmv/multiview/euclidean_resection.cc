@@ -18,7 +18,9 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
 #include <cmath>
+#include <complex>
 #include <limits>
 
 #include <Eigen/SVD>
@@ -447,8 +449,9 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
   Mat4X alphas(4, num_points);
   ComputeBarycentricCoordinates(X_centered, X_control_points, &alphas);
    
-  // Estimates the M matrix with the barycentric coordinates
-  Mat M(2 * num_points, 12);
+  // Estimates M^T M, where M is the 2n x 12 matrix of the barycentric
+  // coordinates, one 2x12 block at a time so that M is never formed.
+  Eigen::Matrix<double, 12, 12> MtM = Eigen::Matrix<double, 12, 12>::Zero();
   Eigen::Matrix<double, 2, 12> sub_M;
   for (size_t c = 0; c < num_points; c++) {
     double a0 = alphas(0, c);
@@ -457,19 +460,21 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
     double a3 = alphas(3, c);
     double ui = x_camera(0, c);
     double vi = x_camera(1, c);
-    M.block(2*c, 0, 2, 12) << a0, 0, 
-                              a0*(-ui), a1, 0,
-                              a1*(-ui), a2, 0, 
-                              a2*(-ui), a3, 0,
-                              a3*(-ui), 0, 
-                              a0, a0*(-vi), 0,
-                              a1, a1*(-vi), 0,
-                              a2, a2*(-vi), 0,
-                              a3, a3*(-vi);
+    sub_M << a0, 0, 
+             a0*(-ui), a1, 0,
+             a1*(-ui), a2, 0, 
+             a2*(-ui), a3, 0,
+             a3*(-ui), 0, 
+             a0, a0*(-vi), 0,
+             a1, a1*(-vi), 0,
+             a2, a2*(-vi), 0,
+             a3, a3*(-vi);
+    MtM.noalias() += sub_M.transpose() * sub_M;
   }
   
   // TODO(julien): Avoid the transpose by rewriting the u2.block() calls.
-  Eigen::JacobiSVD<Mat> MtMsvd(M.transpose()*M, Eigen::ComputeFullU);
+  Eigen::JacobiSVD<Eigen::Matrix<double, 12, 12> > MtMsvd(MtM,
+                                                         Eigen::ComputeFullU);
   Eigen::Matrix<double, 12, 12> u2 = MtMsvd.matrixU().transpose();
 
   // Estimate the L matrix.
@@ -528,9 +533,9 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
   // (betas). Below, each one is solved for then the best one is chosen.
   Mat3X X_camera;
   Mat3 K; K.setIdentity();
-  vector<Mat3> Rs(3);
-  vector<Vec3> ts(3);
-  Vec rmse(3);
+  Mat3 Rs[3];
+  Vec3 ts[3];
+  Vec3 rmse;
 
   // TODO(julien): Document where the "1e-3" magical constant comes from below.
 
@@ -542,8 +547,8 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
   for (size_t r = 0; r < 6; r++) {
     l_6x4.row(r) << L(r, 0), L(r, 1), L(r, 3), L(r, 6); 
   }
-  Eigen::JacobiSVD<Mat> svd_of_l4(l_6x4, 
-                                  Eigen::ComputeFullU | Eigen::ComputeFullV);
+  Eigen::JacobiSVD<Eigen::Matrix<double, 6, 4> > svd_of_l4(
+      l_6x4, Eigen::ComputeFullU | Eigen::ComputeFullV);
   Vec4 b4 = svd_of_l4.solve(rho);
   if ((l_6x4 * b4).isApprox(rho, 1e-3)) {
     if (b4(0) < 0) {
@@ -566,8 +571,8 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
   betas.setZero();
   Eigen::Matrix<double, 6, 3> l_6x3;
   l_6x3 = L.block(0, 0, 6, 3);
-  Eigen::JacobiSVD<Mat> svdOfL3(l_6x3, 
-                                Eigen::ComputeFullU | Eigen::ComputeFullV);
+  Eigen::JacobiSVD<Eigen::Matrix<double, 6, 3> > svdOfL3(
+      l_6x3, Eigen::ComputeFullU | Eigen::ComputeFullV);
   Vec3 b3 = svdOfL3.solve(rho);
   VLOG(2) << " rho = " << rho;
   VLOG(2) << " l_6x3 * b3 = " << l_6x3 * b3;
@@ -599,8 +604,8 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
   betas.setZero();
   Eigen::Matrix<double, 6, 5> l_6x5;
   l_6x5 = L.block(0, 0, 6, 5);
-  Eigen::JacobiSVD<Mat> svdOfL5(l_6x5, 
-                                Eigen::ComputeFullU | Eigen::ComputeFullV);
+  Eigen::JacobiSVD<Eigen::Matrix<double, 6, 5> > svdOfL5(
+      l_6x5, Eigen::ComputeFullU | Eigen::ComputeFullV);
   Vec5 b5 = svdOfL5.solve(rho);
   if ((l_6x5 * b5).isApprox(rho, 1e-3)) {
     if (b5(0) < 0) {
@@ -650,5 +655,234 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
   // TODO(julien): Improve the solutions with non-linear refinement.
 }
 
+// Real roots of the quartic
+//   factors[0] x^4 + factors[1] x^3 + ... + factors[4].
+// The four roots are computed with Ferrari's method as in Kneip's
+// implementation and polished with a few Newton steps; the real parts of the
+// complex roots are then discarded since they do not cancel the polynomial.
+// Returns the number of real roots.
+static int SolveQuartic(const double *factors, double *roots) {
+  const double A = factors[0];
+  const double B = factors[1];
+  const double C = factors[2];
+  const double D = factors[3];
+  const double E = factors[4];
+  const double A_pw2 = A * A;
+  const double B_pw2 = B * B;
+  const double A_pw3 = A_pw2 * A;
+  const double B_pw3 = B_pw2 * B;
+  const double A_pw4 = A_pw3 * A;
+  const double B_pw4 = B_pw3 * B;
+
+  const double alpha = -3 * B_pw2 / (8 * A_pw2) + C / A;
+  const double beta = B_pw3 / (8 * A_pw3) - B * C / (2 * A_pw2) + D / A;
+  const double gamma = -3 * B_pw4 / (256 * A_pw4) + B_pw2 * C / (16 * A_pw3)
+                       - B * D / (4 * A_pw2) + E / A;
+  const double alpha_pw2 = alpha * alpha;
+  const double alpha_pw3 = alpha_pw2 * alpha;
+
+  typedef std::complex<double> Complex;
+  Complex P(-alpha_pw2 / 12 - gamma, 0);
+  Complex Q(-alpha_pw3 / 108 + alpha * gamma / 3 - beta * beta / 8, 0);
+  Complex R = -Q / 2.0 + std::sqrt(Q * Q / 4.0 + P * P * P / 27.0);
+  Complex U = std::pow(R, 1.0 / 3.0);
+  Complex y;
+  if (U.real() == 0) {
+    y = -5.0 * alpha / 6.0 - std::pow(Q, 1.0 / 3.0);
+  } else {
+    y = -5.0 * alpha / 6.0 - P / (3.0 * U) + U;
+  }
+  Complex w = std::sqrt(alpha + 2.0 * y);
+  Complex plus = std::sqrt(-(3.0 * alpha + 2.0 * y + 2.0 * beta / w));
+  Complex minus = std::sqrt(-(3.0 * alpha + 2.0 * y - 2.0 * beta / w));
+  roots[0] = (-B / (4.0 * A) + 0.5 * ( w + plus)).real();
+  roots[1] = (-B / (4.0 * A) + 0.5 * ( w - plus)).real();
+  roots[2] = (-B / (4.0 * A) + 0.5 * (-w + minus)).real();
+  roots[3] = (-B / (4.0 * A) + 0.5 * (-w - minus)).real();
+
+  const double tolerance = 1e-8 * (std::fabs(A) + std::fabs(B) + std::fabs(C) +
+                                   std::fabs(D) + std::fabs(E));
+  int num_roots = 0;
+  for (int i = 0; i < 4; ++i) {
+    double x = roots[i];
+    double f = (((A * x + B) * x + C) * x + D) * x + E;
+    for (int k = 0; k < 3 && f != 0; ++k) {
+      double df = ((4 * A * x + 3 * B) * x + 2 * C) * x + D;
+      if (df == 0) {
+        break;
+      }
+      double x_next = x - f / df;
+      double f_next = (((A * x_next + B) * x_next + C) * x_next + D) * x_next
+                      + E;
+      if (!(std::fabs(f_next) < std::fabs(f))) {
+        break;
+      }
+      x = x_next;
+      f = f_next;
+    }
+    if (std::fabs(f) <= tolerance) {
+      roots[num_roots++] = x;
+    }
+  }
+  return num_roots;
+}
+
+// Orthonormal frame whose rows are f1, a vector orthogonal to f1 in the plane
+// (f1, f2), and the normal of that plane. Returns false if f1 // f2.
+static bool IntermediateCameraFrame(const Vec3 &f1, const Vec3 &f2, Mat3 *T) {
+  Vec3 e3 = f1.cross(f2);
+  double norm = e3.norm();
+  if (norm == 0) {
+    return false;
+  }
+  e3 /= norm;
+  T->row(0) = f1.transpose();
+  T->row(1) = e3.cross(f1).transpose();
+  T->row(2) = e3.transpose();
+  return true;
+}
+
+int EuclideanResectionP3P(const Mat23 &x_camera,
+                          const Mat3 &X_world,
+                          Mat3 Rs[4], Vec3 ts[4]) {
+  Vec3 P1 = X_world.col(0);
+  Vec3 P2 = X_world.col(1);
+  Vec3 P3 = X_world.col(2);
+  Vec3 n3 = (P2 - P1).cross(P3 - P1);
+  if (n3.squaredNorm() == 0) {
+    VLOG(2) << "P3P: the world points are collinear.";
+    return 0;
+  }
+  Vec3 f1, f2, f3;
+  f1 << x_camera.col(0), 1;
+  f2 << x_camera.col(1), 1;
+  f3 << x_camera.col(2), 1;
+  f1.normalize();
+  f2.normalize();
+  f3.normalize();
+
+  // Intermediate camera frame, with the third bearing in its lower half so
+  // that the angle theta is in [0, pi].
+  Mat3 T;
+  if (!IntermediateCameraFrame(f1, f2, &T)) {
+    return 0;
+  }
+  Vec3 f3_T = T * f3;
+  if (f3_T(2) > 0) {
+    std::swap(f1, f2);
+    std::swap(P1, P2);
+    IntermediateCameraFrame(f1, f2, &T);
+    f3_T = T * f3;
+  }
+
+  // Intermediate world frame.
+  Mat3 N;
+  Vec3 n1 = (P2 - P1).normalized();
+  n3 = n1.cross(P3 - P1).normalized();
+  N.row(0) = n1.transpose();
+  N.row(1) = n3.cross(n1).transpose();
+  N.row(2) = n3.transpose();
+  Vec3 P3_N = N * (P3 - P1);
+
+  const double d_12 = (P2 - P1).norm();
+  const double f_1 = f3_T(0) / f3_T(2);
+  const double f_2 = f3_T(1) / f3_T(2);
+  const double p_1 = P3_N(0);
+  const double p_2 = P3_N(1);
+  const double cos_beta = f1.dot(f2);
+  double b = 1 / (1 - cos_beta * cos_beta) - 1;
+  b = cos_beta < 0 ? -std::sqrt(b) : std::sqrt(b);
+
+  const double f_1_pw2 = f_1 * f_1;
+  const double f_2_pw2 = f_2 * f_2;
+  const double p_1_pw2 = p_1 * p_1;
+  const double p_1_pw3 = p_1_pw2 * p_1;
+  const double p_1_pw4 = p_1_pw3 * p_1;
+  const double p_2_pw2 = p_2 * p_2;
+  const double p_2_pw3 = p_2_pw2 * p_2;
+  const double p_2_pw4 = p_2_pw3 * p_2;
+  const double d_12_pw2 = d_12 * d_12;
+  const double b_pw2 = b * b;
+
+  // Quartic in cos(theta).
+  double factors[5];
+  factors[0] = -f_2_pw2 * p_2_pw4 - p_2_pw4 * f_1_pw2 - p_2_pw4;
+  factors[1] = 2 * p_2_pw3 * d_12 * b
+             + 2 * f_2_pw2 * p_2_pw3 * d_12 * b
+             - 2 * f_2 * p_2_pw3 * f_1 * d_12;
+  factors[2] = -f_2_pw2 * p_2_pw2 * p_1_pw2
+             - f_2_pw2 * p_2_pw2 * d_12_pw2 * b_pw2
+             - f_2_pw2 * p_2_pw2 * d_12_pw2
+             + f_2_pw2 * p_2_pw4
+             + p_2_pw4 * f_1_pw2
+             + 2 * p_1 * p_2_pw2 * d_12
+             + 2 * f_1 * f_2 * p_1 * p_2_pw2 * d_12 * b
+             - p_2_pw2 * p_1_pw2 * f_1_pw2
+             + 2 * p_1 * p_2_pw2 * f_2_pw2 * d_12
+             - p_2_pw2 * d_12_pw2 * b_pw2
+             - 2 * p_1_pw2 * p_2_pw2;
+  factors[3] = 2 * p_1_pw2 * p_2 * d_12 * b
+             + 2 * f_2 * p_2_pw3 * f_1 * d_12
+             - 2 * f_2_pw2 * p_2_pw3 * d_12 * b
+             - 2 * p_1 * p_2 * d_12_pw2 * b;
+  factors[4] = -2 * f_2 * p_2_pw2 * f_1 * p_1 * d_12 * b
+             + f_2_pw2 * p_2_pw2 * d_12_pw2
+             + 2 * p_1_pw3 * d_12
+             - p_1_pw2 * d_12_pw2
+             + f_2_pw2 * p_2_pw2 * p_1_pw2
+             - p_1_pw4
+             - 2 * f_2_pw2 * p_2_pw2 * p_1 * d_12
+             + p_2_pw2 * f_1_pw2 * p_1_pw2
+             + f_2_pw2 * p_2_pw2 * d_12_pw2 * b_pw2;
+  double roots[4];
+  const int num_roots = SolveQuartic(factors, roots);
+
+  // Back substitution of each root.
+  int num_solutions = 0;
+  for (int i = 0; i < num_roots; ++i) {
+    const double cos_theta = roots[i];
+    if (!(std::fabs(cos_theta) <= 1)) {
+      continue;
+    }
+    const double cot_alpha = (-f_1 * p_1 / f_2 - cos_theta * p_2 + d_12 * b) /
+                             (-f_1 * cos_theta * p_2 / f_2 + p_1 - d_12);
+    const double sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+    const double sin_alpha = std::sqrt(1 / (cot_alpha * cot_alpha + 1));
+    double cos_alpha = std::sqrt(1 - sin_alpha * sin_alpha);
+    if (cot_alpha < 0) {
+      cos_alpha = -cos_alpha;
+    }
+
+    // Camera center and orientation (camera to world) in the intermediate
+    // world frame.
+    const double k = d_12 * sin_alpha * (sin_alpha * b + cos_alpha);
+    Vec3 C;
+    C << d_12 * cos_alpha * (sin_alpha * b + cos_alpha),
+         cos_theta * k,
+         sin_theta * k;
+    C = P1 + N.transpose() * C;
+    Mat3 Q;
+    Q << -cos_alpha, -sin_alpha * cos_theta, -sin_alpha * sin_theta,
+          sin_alpha, -cos_alpha * cos_theta, -cos_alpha * sin_theta,
+          0,         -sin_theta,              cos_theta;
+    Mat3 R = N.transpose() * Q.transpose() * T;
+    if (isnan(C.sum()) || isnan(R.sum())) {
+      continue;
+    }
+    // Some roots put the third point behind the camera.
+    Rs[num_solutions] = R.transpose();
+    ts[num_solutions] = -R.transpose() * C;
+    bool in_front = true;
+    for (int j = 0; j < 3; ++j) {
+      in_front &= Rs[num_solutions].row(2).dot(X_world.col(j)) +
+                  ts[num_solutions](2) > 0;
+    }
+    if (in_front) {
+      ++num_solutions;
+    }
+  }
+  return num_solutions;
+}
+
 } // namespace resection
 } // namespace libmv
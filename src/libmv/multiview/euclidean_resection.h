@@ -117,6 +117,28 @@ void EuclideanResectionEPnP(const Mat2X &x_camera,
                             const Mat3X &X_world, 
                             Mat3 *R, Vec3 *t);
 
+/**
+ * Computes the poses of a calibrated camera that sees 3 given 3D points at
+ * the given normalized image points. There are up to four solutions.
+ *
+ * \param x_camera Image points in normalized camera coordinates,
+ *                 e.g. x_camera = inv(K) * x_image
+ * \param X_world  3D points in the world coordinate system
+ * \param Rs       Solutions for the camera rotation matrix (room for 4)
+ * \param ts       Solutions for the camera translation vector (room for 4)
+ * \return the number of solutions, 0 if the configuration is degenerate.
+ *
+ * This is the closed-form algorithm described in:
+ * "A Novel Parametrization of the Perspective-Three-Point Problem for a
+ * Direct Computation of Absolute Camera Position and Orientation", by
+ * L. Kneip, D. Scaramuzza and R. Siegwart, CVPR 2011.
+ * It works on fixed-size matrices and does not allocate, so it is meant as
+ * the minimal solver of a robust estimation.
+ */
+int EuclideanResectionP3P(const Mat23 &x_camera,
+                          const Mat3 &X_world,
+                          Mat3 Rs[4], Vec3 ts[4]);
+
 } // namespace euclidean_resection
 } // namespace libmv
 
@@ -24,6 +24,7 @@
 #include "libmv/base/vector.h"
 #include "libmv/logging/logging.h"
 #include "libmv/multiview/euclidean_resection.h"
+#include "libmv/multiview/projection.h"
 #include "libmv/numeric/numeric.h"
 
 namespace libmv {
@@ -35,37 +36,100 @@ class Kernel {
   typedef Mat34 Model;
   enum { MINIMUM_SAMPLES = 5 };
   // TODO(julien) avoid the copy of x_camera: create a new Kernel ?
-  Kernel(const Mat2X &x_camera, const Mat3X &X) : x_camera_(x_camera), X_(X) {
+  Kernel(const Mat2X &x_camera, const Mat3X &X)
+    : x_camera_(x_camera), X_(X), rows_built_(false) {
     CHECK(x_camera.cols() == X.cols());
   }
-  Kernel(const Mat2X &x_image, const Mat3X &X, const Mat3 &K) : X_(X) {
+  Kernel(const Mat2X &x_image, const Mat3X &X, const Mat3 &K)
+    : X_(X), rows_built_(false) {
     CHECK(x_image.cols() == X.cols());
     // Conversion from image coordinates to normalized camera coordinates 
     EuclideanToNormalizedCamera(x_image, K, &x_camera_);
   }
   void Fit(const vector<int> &samples, vector<Model> *models) const {
-    Mat2X x = ExtractColumns(x_camera_, samples);
-    Mat3X X = ExtractColumns(X_, samples);
+    ExtractColumns(x_camera_, samples, &x_samples_);
+    ExtractColumns(X_, samples, &X_samples_);
     Mat34 P;
     Mat3 K; K.setIdentity();
     Mat3 R;
     Vec3 t;
-    EuclideanResection(x, X, &R, &t, RESECTION_EPNP);
+    EuclideanResection(x_samples_, X_samples_, &R, &t, RESECTION_EPNP);
     P_From_KRt(K, R, t, &P);
     models->push_back(P);
   }
   double Error(int sample, const Model &model) const {
-    Mat3X X = X_.col(sample);
-    Mat2X error = Project(model, X) - x_camera_.col(sample);
-    return error.col(0).norm();
+    const Vec3 X = X_.col(sample);
+    const Vec3 x = model.block<3, 3>(0, 0) * X + model.col(3);
+    const Vec2 error = x.head<2>() / x(2) - x_camera_.col(sample);
+    return error.norm();
+  }
+  void Errors(const Model &model, int begin, int end, double *errors) const {
+    BuildRows();
+    SquaredReprojectionErrors(model, X_rows_, x_rows_, begin, end, errors);
+    for (int i = begin; i < end; ++i) {
+      errors[i] = sqrt(errors[i]);
+    }
   }
   int NumSamples() const {
     return x_camera_.cols();
   }
- private:
+ protected:
+  // Copies the points to x_rows_ and X_rows_ on the first call, so that
+  // only the kernels scored by the batch error functors pay for it.
+  void BuildRows() const {
+    if (!rows_built_) {
+      x_rows_ = x_camera_;
+      X_rows_ = X_;
+      rows_built_ = true;
+    }
+  }
+
   // x_camera_ contains the normalized camera coordinates 
         Mat2X  x_camera_;
   const Mat3X &X_;
+  // Row-major copies of the points for Errors.
+  mutable RMat x_rows_;
+  mutable RMat X_rows_;
+  mutable bool rows_built_;
+  // Scratch space of Fit.
+  mutable Mat2X x_samples_;
+  mutable Mat3X X_samples_;
+};
+
+/**
+ * Same as Kernel, but the minimal samples are solved with the closed-form
+ * P3P solver, which gives up to four models from three points without
+ * allocating. Larger samples, e.g. the inliers of a local optimization, are
+ * solved with EPnP.
+ */
+class P3PKernel : public Kernel {
+ public:
+  enum { MINIMUM_SAMPLES = 3 };
+  P3PKernel(const Mat2X &x_camera, const Mat3X &X) : Kernel(x_camera, X) {}
+  P3PKernel(const Mat2X &x_image, const Mat3X &X, const Mat3 &K)
+    : Kernel(x_image, X, K) {}
+
+  void Fit(const vector<int> &samples, vector<Model> *models) const {
+    if (samples.size() > MINIMUM_SAMPLES) {
+      Kernel::Fit(samples, models);
+      return;
+    }
+    CHECK_EQ(samples.size(), MINIMUM_SAMPLES);
+    Mat23 x;
+    Mat3 X;
+    for (int i = 0; i < MINIMUM_SAMPLES; ++i) {
+      x.col(i) = x_camera_.col(samples[i]);
+      X.col(i) = X_.col(samples[i]);
+    }
+    Mat3 Rs[4];
+    Vec3 ts[4];
+    int num_solutions = EuclideanResectionP3P(x, X, Rs, ts);
+    for (int i = 0; i < num_solutions; ++i) {
+      Mat34 P;
+      P << Rs[i], ts[i];
+      models->push_back(P);
+    }
+  }
 };
 
 }  // namespace kernel
@@ -60,5 +60,30 @@ TEST(EuclideanResectionKernel, RobustEuclideanResection) {
   }
 }
 
+TEST(EuclideanResectionKernel, RobustP3PResection) {
+  typedef libmv::euclidean_resection::kernel::P3PKernel P3PKernel;
+  int nviews = 5;
+  int npoints = 60;
+  int noutliers = 0.3*npoints;
+  double threshold_inlier = Square(0.2);
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+  for (int i = 0; i < nviews; ++i) {
+    Mat2X x = d.x[i];
+    x.block(0, 0, 2, noutliers).setRandom();
+
+    P3PKernel kernel(x, d.X, d.K[i]);
+    vector<int> inliers;
+    Mat34 P = Estimate(kernel, 
+                       MLEScorer<P3PKernel>(threshold_inlier), 
+                       &inliers, NULL, 1e-2, NULL, NULL, true);
+    Mat34 P_expected = d.K[i].inverse() * d.P(i);
+    EXPECT_MATRIX_PROP(P_expected, P, 3e-8);
+    EXPECT_EQ(npoints-noutliers, inliers.size());
+    for (int j = 0; j < inliers.size(); ++j) {
+      EXPECT_EQ(j + noutliers, inliers[j]);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace libmv
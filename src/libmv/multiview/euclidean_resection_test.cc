@@ -235,3 +235,55 @@ TEST(EuclideanResection, Points6AllRandomInput) {
     EXPECT_MATRIX_NEAR(R_output, R_expected, 1e-7);
   }
 }
+
+TEST(EuclideanResection, P3PFindsThePose) {
+  Mat3 KK;
+  KK << 2796, 0,    804,
+        0 ,   2796, 641,
+        0,    0,    1;
+  int w = 1600;
+  int h = 1200;
+  int num_points = 3;
+  for (int trial = 0; trial < 20; ++trial) {
+    Mat3X x_image(3, num_points);
+    x_image.row(0) = w * Vec::Random(num_points).array().abs();
+    x_image.row(1) = h * Vec::Random(num_points).array().abs();
+    x_image.row(2).setOnes();
+    Vec X_distances = 10 + 100 * Vec::Random(num_points).array().abs();
+
+    Mat3 R_input;
+    R_input = Eigen::AngleAxisd(rand(), Eigen::Vector3d::UnitZ())
+            * Eigen::AngleAxisd(rand(), Eigen::Vector3d::UnitY())
+            * Eigen::AngleAxisd(rand(), Eigen::Vector3d::UnitZ());
+    Vec3 T_input;
+    T_input.setRandom();
+    T_input = 100 * T_input;
+
+    Mat3 R_expected;
+    Vec3 T_expected;
+    Mat2X x_camera;
+    Mat3X X_world;
+    CreateCameraSystem(KK, x_image, X_distances, R_input, T_input,
+                       &x_camera, &X_world, &R_expected, &T_expected);
+
+    Mat3 Rs[4];
+    Vec3 ts[4];
+    int num_solutions = EuclideanResectionP3P(x_camera, X_world, Rs, ts);
+    EXPECT_LE(1, num_solutions);
+    EXPECT_GE(4, num_solutions);
+
+    // Every solution explains the points, and one is the expected pose.
+    double best_error = HUGE_VAL;
+    for (int i = 0; i < num_solutions; ++i) {
+      EXPECT_NEAR(1.0, Rs[i].determinant(), 1e-8);
+      for (int j = 0; j < num_points; ++j) {
+        Vec3 x = Rs[i] * X_world.col(j) + ts[i];
+        EXPECT_NEAR(0, (x.head<2>() / x(2) - x_camera.col(j)).norm(), 1e-6);
+      }
+      best_error = std::min(best_error,
+                            (Rs[i] - R_expected).norm() +
+                            (ts[i] - T_expected).norm() / 100);
+    }
+    EXPECT_NEAR(0, best_error, 1e-6);
+  }
+}
@@ -18,6 +18,8 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <complex>
+
 #include <Eigen/QR>
  
 #include "libmv/multiview/fundamental.h"
@@ -27,16 +29,31 @@
 
 namespace libmv {
 
-Mat FivePointsNullspaceBasis(const Mat2X &x1, const Mat2X &x2) {
-  Matrix<double, 9, 9> A;
-  A.setZero();  // Make A square until Eigen supports rectangular SVD.
+Mat94 FivePointsNullspaceBasis(const Mat25 &x1, const Mat25 &x2) {
+  Matrix<double, 5, 9> A;
   fundamental::kernel::EncodeEpipolarEquation(x1, x2, &A);
+  // The last 4 columns of the Q factor of A^T are orthogonal to the 5 rows
+  // of A.
+  Eigen::HouseholderQR<Matrix<double, 9, 5> > qr(A.transpose());
+  Matrix<double, 9, 9> Q = qr.householderQ();
+  return Q.block<9, 4>(0, 5);
+}
+
+Mat94 FivePointsNullspaceBasis(const Mat2X &x1, const Mat2X &x2) {
+  if (x1.cols() == 5) {
+    return FivePointsNullspaceBasis(Mat25(x1), Mat25(x2));
+  }
+  // Least squares nullspace: the right singular vectors of A are the
+  // eigenvectors of A^T A.
+  Mat A(x1.cols(), 9);
+  fundamental::kernel::EncodeEpipolarEquation(x1, x2, &A);
+  Matrix<double, 9, 9> AtA = A.transpose() * A;
   Eigen::JacobiSVD<Matrix<double, 9, 9> > svd;
-  return svd.compute(A, Eigen::ComputeFullV).matrixV().topRightCorner<9,4>();
+  return svd.compute(AtA, Eigen::ComputeFullV).matrixV().block<9, 4>(0, 5);
 }
 
-Vec o1(const Vec &a, const Vec &b) {
-  Vec res = Vec::Zero(20);
+Vec20 o1(const Vec20 &a, const Vec20 &b) {
+  Vec20 res = Vec20::Zero();
 
   res(coef_xx) = a(coef_x) * b(coef_x);
   res(coef_xy) = a(coef_x) * b(coef_y)
@@ -58,8 +75,8 @@ Vec o1(const Vec &a, const Vec &b) {
   return res;
 }
 
-Vec o2(const Vec &a, const Vec &b) {
-  Vec res(20);
+Vec20 o2(const Vec20 &a, const Vec20 &b) {
+  Vec20 res;
 
   res(coef_xxx) = a(coef_xx) * b(coef_x);
   res(coef_xxy) = a(coef_xx) * b(coef_y)
@@ -105,13 +122,12 @@ Vec o2(const Vec &a, const Vec &b) {
   return res;
 }
 
-// Builds the polynomial constraint matrix M.
-Mat FivePointsPolynomialConstraints(const Mat &E_basis) {
+void FivePointsPolynomialConstraints(const Mat94 &E_basis, RMat1020 *Mp) {
   // Build the polynomial form of E (equation (8) in Stewenius et al. [1])
-  Vec E[3][3];
+  Vec20 E[3][3];
   for (int i = 0; i < 3; ++i) {
     for (int j = 0; j < 3; ++j) {
-      E[i][j] = Vec::Zero(20);
+      E[i][j].setZero();
       E[i][j](coef_x) = E_basis(3 * i + j, 0);
       E[i][j](coef_y) = E_basis(3 * i + j, 1);
       E[i][j](coef_z) = E_basis(3 * i + j, 2);
@@ -120,7 +136,7 @@ Mat FivePointsPolynomialConstraints(const Mat &E_basis) {
   }
 
   // The constraint matrix.
-  Mat M(10, 20);
+  RMat1020 &M = *Mp;
   int mrow = 0;
 
   // Determinant constraint det(E) = 0; equation (19) of Nister [2].
@@ -130,7 +146,7 @@ Mat FivePointsPolynomialConstraints(const Mat &E_basis) {
 
   // Cubic singular values constraint.
   // Equation (20).
-  Vec EET[3][3];
+  Vec20 EET[3][3];
   for (int i = 0; i < 3; ++i) {    // Since EET is symmetric, we only compute
     for (int j = 0; j < 3; ++j) {  // its upper triangular part.
       if (i <= j) {
@@ -144,8 +160,8 @@ Mat FivePointsPolynomialConstraints(const Mat &E_basis) {
   }
 
   // Equation (21).
-  Vec (&L)[3][3] = EET;
-  Vec trace  = 0.5 * (EET[0][0] + EET[1][1] + EET[2][2]);
+  Vec20 (&L)[3][3] = EET;
+  Vec20 trace  = 0.5 * (EET[0][0] + EET[1][1] + EET[2][2]);
   for (int i = 0; i < 3; ++i) {
     L[i][i] -= trace;
   }
@@ -153,44 +169,21 @@ Mat FivePointsPolynomialConstraints(const Mat &E_basis) {
   // Equation (23).
   for (int i = 0; i < 3; ++i) {
     for (int j = 0; j < 3; ++j) {
-      Vec LEij = o2(L[i][0], E[0][j])
+      Vec20 LEij = o2(L[i][0], E[0][j])
                + o2(L[i][1], E[1][j])
                + o2(L[i][2], E[2][j]);
       M.row(mrow++) = LEij;
     }
   }
-
-  return M;
-}
-
-// Gauss--Jordan elimination for the constraint matrix.
-void FivePointsGaussJordan(Mat *Mp) {
-  Mat &M = *Mp;
-
-  // Gauss Elimination.
-  for (int i = 0; i < 10; ++i) {
-    M.row(i) /= M(i,i);
-    for (int j = i + 1; j < 10; ++j) {
-      M.row(j) = M.row(j) / M(j,i) - M.row(i);
-    }
-  }
-
-  // Backsubstitution.
-  for (int i = 9; i >= 0; --i) {
-    for (int j = 0; j < i; ++j) {
-      M.row(j) = M.row(j) - M(j,i) * M.row(i);
-    }
-  }
 }
 
-void FivePointsRelativePose(const Mat2X &x1,
-                            const Mat2X &x2,
-                            vector<Mat3> *Es) {
-  // Step 1: Nullspace exrtraction.
-  Mat E_basis = FivePointsNullspaceBasis(x1, x2);
+namespace {
 
+// Steps 2 to 5 of the solver, on fixed size matrices only.
+void FivePointsFromNullspace(const Mat94 &E_basis, vector<Mat3> *Es) {
   // Step 2: Constraint expansion.
-  Mat M = FivePointsPolynomialConstraints(E_basis);
+  RMat1020 M;
+  FivePointsPolynomialConstraints(E_basis, &M);
 
   // Step 3: Gauss-Jordan elimination.
   FivePointsGaussJordan(&M);
@@ -198,8 +191,9 @@ void FivePointsRelativePose(const Mat2X &x1,
   // For the next steps, follow the matlab code given in Stewenius et al [1].
 
   // Build the action matrix.
-  Mat B = M.topRightCorner<10,10>();
-  Mat At = Mat::Zero(10,10);
+  typedef Matrix<double, 10, 10> Mat10;
+  Mat10 B = M.block<10, 10>(0, 10);
+  Mat10 At = Mat10::Zero();
   At.row(0) = -B.row(0);
   At.row(1) = -B.row(1);
   At.row(2) = -B.row(2);
@@ -212,17 +206,18 @@ void FivePointsRelativePose(const Mat2X &x1,
   At(9,6) = 1;
 
   // Compute the solutions from action matrix's eigenvectors.
-  Eigen::EigenSolver<Mat> es(At);
-  typedef Eigen::EigenSolver<Mat>::EigenvectorsType Matc;
-  Matc V = es.eigenvectors();
-  Matc solutions(4, 10);
+  Eigen::EigenSolver<Mat10> es(At);
+  typedef Eigen::EigenSolver<Mat10>::EigenvectorsType Mat10c;
+  Mat10c V = es.eigenvectors();
+  Matrix<std::complex<double>, 4, 10> solutions;
   solutions.row(0) = V.row(6).array() / V.row(9).array();
   solutions.row(1) = V.row(7).array() / V.row(9).array();
   solutions.row(2) = V.row(8).array() / V.row(9).array();
   solutions.row(3).setOnes();
 
   // Get the ten candidate E matrices in vector form.
-  Matc Evec = E_basis * solutions;
+  Matrix<std::complex<double>, 9, 10> Evec =
+      E_basis.cast<std::complex<double> >() * solutions;
 
   // Build the essential matrices for the real solutions.
   Es->reserve(10);
@@ -246,6 +241,21 @@ void FivePointsRelativePose(const Mat2X &x1,
     }
   }
 }
+
+}  // namespace
+
+void FivePointsRelativePose(const Mat25 &x1,
+                            const Mat25 &x2,
+                            vector<Mat3> *Es) {
+  FivePointsFromNullspace(FivePointsNullspaceBasis(x1, x2), Es);
+}
+
+void FivePointsRelativePose(const Mat2X &x1,
+                            const Mat2X &x2,
+                            vector<Mat3> *Es) {
+  // Step 1: Nullspace extraction.
+  FivePointsFromNullspace(FivePointsNullspaceBasis(x1, x2), Es);
+}
   
 } // namespace libmv
 
@@ -44,6 +44,15 @@ namespace libmv {
  */
 void FivePointsRelativePose(const Mat2X &x1, const Mat2X &x2,
                             vector<Mat3> *Es);
+
+/**
+ * Same as above for exactly 5 correspondences. All the intermediate
+ * matrices have a fixed size, so the only allocation is the growth of Es;
+ * this is the version used by the RANSAC kernel.
+ */
+void FivePointsRelativePose(const Eigen::Matrix<double, 2, 5> &x1,
+                            const Eigen::Matrix<double, 2, 5> &x2,
+                            vector<Mat3> *Es);
   
 } // namespace libmv
 
@@ -65,16 +65,46 @@ enum {
   coef_1
 };
 
+typedef Eigen::Matrix<double, 2, 5> Mat25;  // Five matches.
+typedef Eigen::Matrix<double, 9, 4> Mat94;
+typedef Eigen::Matrix<double, 10, 20, Eigen::RowMajor> RMat1020;
+
 // Compute the nullspace of the linear constraints given by the matches.
-Mat FivePointsNullspaceBasis(const Mat2X &x1, const Mat2X &x2);
+// With exactly 5 matches a QR decomposition of the 9x5 transposed system is
+// used; with more, the least squares nullspace.
+Mat94 FivePointsNullspaceBasis(const Mat25 &x1, const Mat25 &x2);
+Mat94 FivePointsNullspaceBasis(const Mat2X &x1, const Mat2X &x2);
 
 // Multiply two polynomials of degree 1.
-Vec o1(const Vec &a, const Vec &b);
+Vec20 o1(const Vec20 &a, const Vec20 &b);
 
 // Multiply a polynomial of degree 2, a, by a polynomial of degree 1, b.
-Vec o2(const Vec &a, const Vec &b);
+Vec20 o2(const Vec20 &a, const Vec20 &b);
+
+// Builds the 10x20 polynomial constraint matrix from the nullspace basis.
+void FivePointsPolynomialConstraints(const Mat94 &E_basis, RMat1020 *M);
+
+// Gauss--Jordan elimination of the 10x20 constraint matrix, without
+// pivoting. TMat is RMat1020 in the solver; Mat works too.
+template<typename TMat>
+void FivePointsGaussJordan(TMat *Mp) {
+  TMat &M = *Mp;
+
+  // Gauss Elimination.
+  for (int i = 0; i < 10; ++i) {
+    M.row(i) /= M(i,i);
+    for (int j = i + 1; j < 10; ++j) {
+      M.row(j) = M.row(j) / M(j,i) - M.row(i);
+    }
+  }
 
-void FivePointsGaussJordan(Mat *Mp);
+  // Backsubstitution.
+  for (int i = 9; i >= 0; --i) {
+    for (int j = 0; j < i; ++j) {
+      M.row(j) = M.row(j) - M(j,i) * M.row(i);
+    }
+  }
+}
   
 } // namespace libmv
 
@@ -33,7 +33,13 @@ namespace kernel {
 struct FivePointSolver {
   enum { MINIMUM_SAMPLES = 5 };
   static void Solve(const Mat &x1, const Mat &x2, vector<Mat3> *Es) {
-    FivePointsRelativePose(x1, x2, Es);
+    if (x1.cols() == MINIMUM_SAMPLES) {
+      // Minimal sample, as drawn by RANSAC: use the fixed size solver.
+      const Eigen::Matrix<double, 2, 5> x1_fixed = x1, x2_fixed = x2;
+      FivePointsRelativePose(x1_fixed, x2_fixed, Es);
+    } else {
+      FivePointsRelativePose(Mat2X(x1), Mat2X(x2), Es);
+    }
   }
 };
 
@@ -258,5 +258,32 @@ TEST(FivePointsRelativePose, test_data_sets) {
   }
 }
  
+TEST(FivePointsRelativePose, FixedSizeMatchesLeastSquares) {
+  TestData d = SomeTestData();
+
+  // Exactly 5 matches: QR nullspace and fixed size matrices.
+  Eigen::Matrix<double, 2, 5> x1 = d.x1, x2 = d.x2;
+  vector<Mat3> Es;
+  FivePointsRelativePose(x1, x2, &Es);
+
+  // Every match twice: least squares nullspace of the same space.
+  Mat2X x1_twice(2, 10), x2_twice(2, 10);
+  x1_twice << d.x1, d.x1;
+  x2_twice << d.x2, d.x2;
+  vector<Mat3> Es_twice;
+  FivePointsRelativePose(x1_twice, x2_twice, &Es_twice);
+
+  ASSERT_EQ(Es_twice.size(), Es.size());
+  ASSERT_LT(0, Es.size());
+  for (int i = 0; i < Es.size(); ++i) {
+    double best = HUGE_VAL;
+    for (int j = 0; j < Es_twice.size(); ++j) {
+      best = std::min(best, std::min((Es[i] - Es_twice[j]).norm(),
+                                     (Es[i] + Es_twice[j]).norm()));
+    }
+    EXPECT_NEAR(0, best, 1e-6);
+  }
+}
+
 } // namespace
 } // namespace libmv
@@ -20,6 +20,10 @@
 
 #include <cstdio>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // TODO(keir): This code is plain unfinished! Doesn't even compile!
 
 #include "libmv/base/vector.h"
@@ -31,6 +35,86 @@
 namespace libmv {
 namespace fundamental {
 namespace kernel {
+namespace {
+
+// Sampson (kSymmetric false) or symmetric epipolar distance of all the
+// correspondences; see SampsonError and SymmetricEpipolarDistanceError.
+template<bool kSymmetric>
+void EpipolarErrors(const Mat3 &F, const RMat &x1, const RMat &x2,
+                    int begin, int end, double *errors) {
+  assert(2 == x1.rows());
+  assert(2 == x2.rows());
+  assert(x1.cols() == x2.cols());
+  assert(0 <= begin && begin <= end && end <= x1.cols());
+  const int n = x1.cols();
+  const double *px = x1.data(), *py = x1.data() + n;
+  const double *qx = x2.data(), *qy = x2.data() + n;
+  int i = begin;
+#ifdef __SSE2__
+  const __m128d f00 = _mm_set1_pd(F(0, 0)), f01 = _mm_set1_pd(F(0, 1)),
+                f02 = _mm_set1_pd(F(0, 2)), f10 = _mm_set1_pd(F(1, 0)),
+                f11 = _mm_set1_pd(F(1, 1)), f12 = _mm_set1_pd(F(1, 2)),
+                f20 = _mm_set1_pd(F(2, 0)), f21 = _mm_set1_pd(F(2, 1)),
+                f22 = _mm_set1_pd(F(2, 2));
+  const __m128d one = _mm_set1_pd(1.0), quarter = _mm_set1_pd(0.25);
+  for (; i + 1 < end; i += 2) {
+    __m128d x = _mm_loadu_pd(px + i), y = _mm_loadu_pd(py + i);
+    __m128d u = _mm_loadu_pd(qx + i), v = _mm_loadu_pd(qy + i);
+    // F * x.
+    __m128d a0 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(f00, x),
+                                       _mm_mul_pd(f01, y)), f02);
+    __m128d a1 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(f10, x),
+                                       _mm_mul_pd(f11, y)), f12);
+    __m128d a2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(f20, x),
+                                       _mm_mul_pd(f21, y)), f22);
+    // First two coordinates of F^T * y.
+    __m128d b0 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(f00, u),
+                                       _mm_mul_pd(f10, v)), f20);
+    __m128d b1 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(f01, u),
+                                       _mm_mul_pd(f11, v)), f21);
+    __m128d d = _mm_add_pd(_mm_add_pd(_mm_mul_pd(u, a0),
+                                      _mm_mul_pd(v, a1)), a2);
+    __m128d d2 = _mm_mul_pd(d, d);
+    __m128d na = _mm_add_pd(_mm_mul_pd(a0, a0), _mm_mul_pd(a1, a1));
+    __m128d nb = _mm_add_pd(_mm_mul_pd(b0, b0), _mm_mul_pd(b1, b1));
+    __m128d e;
+    if (kSymmetric) {
+      e = _mm_mul_pd(_mm_mul_pd(d2, quarter),
+                     _mm_add_pd(_mm_div_pd(one, na), _mm_div_pd(one, nb)));
+    } else {
+      e = _mm_div_pd(d2, _mm_add_pd(na, nb));
+    }
+    _mm_storeu_pd(errors + i, e);
+  }
+#endif
+  for (; i < end; ++i) {
+    const double x = px[i], y = py[i], u = qx[i], v = qy[i];
+    const double a0 = F(0, 0) * x + F(0, 1) * y + F(0, 2);
+    const double a1 = F(1, 0) * x + F(1, 1) * y + F(1, 2);
+    const double a2 = F(2, 0) * x + F(2, 1) * y + F(2, 2);
+    const double b0 = F(0, 0) * u + F(1, 0) * v + F(2, 0);
+    const double b1 = F(0, 1) * u + F(1, 1) * v + F(2, 1);
+    const double d2 = Square(u * a0 + v * a1 + a2);
+    const double na = a0 * a0 + a1 * a1;
+    const double nb = b0 * b0 + b1 * b1;
+    errors[i] = kSymmetric ? d2 * (1 / na + 1 / nb) / 4.0 : d2 / (na + nb);
+  }
+}
+
+}  // namespace
+
+void SampsonError::Errors(const Mat3 &F, const RMat &x1, const RMat &x2,
+                          int begin, int end, double *errors) {
+  EpipolarErrors<false>(F, x1, x2, begin, end, errors);
+}
+
+void SymmetricEpipolarDistanceError::Errors(const Mat3 &F,
+                                            const RMat &x1,
+                                            const RMat &x2,
+                                            int begin, int end,
+                                            double *errors) {
+  EpipolarErrors<true>(F, x1, x2, begin, end, errors);
+}
 
 void SevenPointSolver::Solve(const Mat &x1, const Mat &x2, vector<Mat3> *F) {
   assert(2 == x1.rows());
@@ -38,13 +122,21 @@ void SevenPointSolver::Solve(const Mat &x1, const Mat &x2, vector<Mat3> *F) {
   assert(x1.rows() == x2.rows());
   assert(x1.cols() == x2.cols());
 
-  // Set up the homogeneous system Af = 0 from the equations x'T*F*x = 0.
-  MatX9 A(x1.cols(), 9);
-  EncodeEpipolarEquation(x1, x2, &A);
-
-  // Find the two F matrices in the nullspace of A.
+  // Set up the homogeneous system Af = 0 from the equations x'T*F*x = 0 and
+  // find the two F matrices in the nullspace of A.
   Vec9 f1, f2;
-  Nullspace2(&A, &f1, &f2);
+  if (x1.cols() <= 9) {
+    // Minimal sample of a robust estimation: zero rows do not change the
+    // nullspace, so pad the system to 9x9 and keep the SVD on the stack.
+    Eigen::Matrix<double, 9, 9> A;
+    A.setZero();
+    EncodeEpipolarEquation(x1, x2, &A);
+    Nullspace2(&A, &f1, &f2);
+  } else {
+    MatX9 A(x1.cols(), 9);
+    EncodeEpipolarEquation(x1, x2, &A);
+    Nullspace2(&A, &f1, &f2);
+  }
   Mat3 F1 = Map<RMat3>(f1.data());
   Mat3 F2 = Map<RMat3>(f2.data());
 
@@ -88,11 +180,18 @@ void EightPointSolver::Solve(const Mat &x1, const Mat &x2, vector<Mat3> *Fs) {
   assert(x1.rows() == x2.rows());
   assert(x1.cols() == x2.cols());
 
-  MatX9 A(x1.cols(), 9);
-  EncodeEpipolarEquation(x1, x2, &A);
-
   Vec9 f;
-  Nullspace(&A, &f);
+  if (x1.cols() <= 9) {
+    // See SevenPointSolver::Solve.
+    Eigen::Matrix<double, 9, 9> A;
+    A.setZero();
+    EncodeEpipolarEquation(x1, x2, &A);
+    Nullspace(&A, &f);
+  } else {
+    MatX9 A(x1.cols(), 9);
+    EncodeEpipolarEquation(x1, x2, &A);
+    Nullspace(&A, &f);
+  }
   Mat3 F = Map<RMat3>(f.data());
 
   // Force the fundamental property if the A matrix has full rank.
@@ -44,6 +44,20 @@ struct SampsonError {
     return Square(y.dot(F_x)) / (  F_x.head<2>().squaredNorm()
                                 + Ft_y.head<2>().squaredNorm());
   }
+  /**
+   * Batch version of the above, vectorized with SSE2 when available.
+   *
+   * \param[in]  F      The fundamental matrix.
+   * \param[in]  x1     2xN points of the first image; row-major, so that the
+   *                    x and y coordinates are contiguous.
+   * \param[in]  x2     2xN points of the second image, same layout.
+   * \param[in]  begin  First correspondence to evaluate.
+   * \param[in]  end    One past the last correspondence to evaluate.
+   * \param[out] errors errors[i] receives the error of correspondence i, for
+   *                    i in [begin, end).
+   */
+  static void Errors(const Mat3 &F, const RMat &x1, const RMat &x2,
+                     int begin, int end, double *errors);
 };
 
 struct SymmetricEpipolarDistanceError {
@@ -57,6 +71,9 @@ struct SymmetricEpipolarDistanceError {
                                 + 1 / Ft_y.head<2>().squaredNorm())
       / 4.0;  // The divide by 4 is to make this match the sampson distance.
   }
+  /// Batch version of the above; see SampsonError::Errors.
+  static void Errors(const Mat3 &F, const RMat &x1, const RMat &x2,
+                     int begin, int end, double *errors);
 };
 
 /**
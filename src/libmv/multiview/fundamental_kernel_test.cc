@@ -202,4 +202,23 @@ TYPED_TEST(FundamentalErrorTest, FundamentalErrorTest2) {
   EXPECT_EQ(2 * Square(10. / 2), dists[5]);
 }
 
+TYPED_TEST(FundamentalErrorTest, BatchErrorsMatchPointErrors) {
+  Mat3 F;
+  F << 1e-5, 2e-4, -3e-2,
+       -1e-4, 3e-6, 4e-2,
+       2e-2, -5e-2, 1;
+  // An odd number of points also exercises the scalar tail.
+  const int n = 7;
+  Mat x1 = 100 * Mat::Random(2, n);
+  Mat x2 = 100 * Mat::Random(2, n);
+  RMat x1_rows = x1, x2_rows = x2;
+  vector<double> errors(n);
+  TypeParam::Errors(F, x1_rows, x2_rows, 0, n, &errors[0]);
+  for (int i = 0; i < n; ++i) {
+    Vec2 a = x1.col(i), b = x2.col(i);
+    double expected = TypeParam::Error(F, a, b);
+    EXPECT_NEAR(expected, errors[i], 1e-9 * std::max(1.0, expected));
+  }
+}
+
 }  // namespace
@@ -0,0 +1,92 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "libmv/multiview/homography_error.h"
+
+namespace libmv {
+namespace homography {
+namespace homography2D {
+namespace {
+
+// Squared asymmetric error ||x2 - Psi(H * x1)||^2 of all the points, added to
+// errors when accumulate is true and stored otherwise.
+void AsymmetricErrors(const Mat3 &H, const RMat &x1, const RMat &x2,
+                      int begin, int end, bool accumulate, double *errors) {
+  assert(2 == x1.rows());
+  assert(2 == x2.rows());
+  assert(x1.cols() == x2.cols());
+  assert(0 <= begin && begin <= end && end <= x1.cols());
+  const int n = x1.cols();
+  const double *px = x1.data(), *py = x1.data() + n;
+  const double *qx = x2.data(), *qy = x2.data() + n;
+  int i = begin;
+#ifdef __SSE2__
+  const __m128d h00 = _mm_set1_pd(H(0, 0)), h01 = _mm_set1_pd(H(0, 1)),
+                h02 = _mm_set1_pd(H(0, 2)), h10 = _mm_set1_pd(H(1, 0)),
+                h11 = _mm_set1_pd(H(1, 1)), h12 = _mm_set1_pd(H(1, 2)),
+                h20 = _mm_set1_pd(H(2, 0)), h21 = _mm_set1_pd(H(2, 1)),
+                h22 = _mm_set1_pd(H(2, 2));
+  for (; i + 1 < end; i += 2) {
+    __m128d x = _mm_loadu_pd(px + i), y = _mm_loadu_pd(py + i);
+    __m128d w = _mm_add_pd(_mm_add_pd(_mm_mul_pd(h20, x),
+                                      _mm_mul_pd(h21, y)), h22);
+    __m128d ex = _mm_add_pd(_mm_add_pd(_mm_mul_pd(h00, x),
+                                       _mm_mul_pd(h01, y)), h02);
+    __m128d ey = _mm_add_pd(_mm_add_pd(_mm_mul_pd(h10, x),
+                                       _mm_mul_pd(h11, y)), h12);
+    ex = _mm_sub_pd(_mm_loadu_pd(qx + i), _mm_div_pd(ex, w));
+    ey = _mm_sub_pd(_mm_loadu_pd(qy + i), _mm_div_pd(ey, w));
+    __m128d e = _mm_add_pd(_mm_mul_pd(ex, ex), _mm_mul_pd(ey, ey));
+    if (accumulate) {
+      e = _mm_add_pd(e, _mm_loadu_pd(errors + i));
+    }
+    _mm_storeu_pd(errors + i, e);
+  }
+#endif
+  for (; i < end; ++i) {
+    const double x = px[i], y = py[i];
+    const double w = H(2, 0) * x + H(2, 1) * y + H(2, 2);
+    const double ex = qx[i] - (H(0, 0) * x + H(0, 1) * y + H(0, 2)) / w;
+    const double ey = qy[i] - (H(1, 0) * x + H(1, 1) * y + H(1, 2)) / w;
+    const double e = ex * ex + ey * ey;
+    errors[i] = accumulate ? errors[i] + e : e;
+  }
+}
+
+}  // namespace
+
+void AsymmetricError::Errors(const Mat3 &H, const RMat &x1, const RMat &x2,
+                             int begin, int end, double *errors) {
+  AsymmetricErrors(H, x1, x2, begin, end, false, errors);
+}
+
+void SymmetricError::Errors(const Mat3 &H, const RMat &x1, const RMat &x2,
+                            int begin, int end, double *errors) {
+  AsymmetricErrors(H, x1, x2, begin, end, false, errors);
+  AsymmetricErrors(H.inverse(), x2, x1, begin, end, true, errors);
+}
+
+}  // namespace homography2D
+}  // namespace homography
+}  // namespace libmv
@@ -86,6 +86,24 @@ struct AsymmetricError {
     else
       *dx = HomogeneousToEuclidean(static_cast<Vec3>(x2)) - x2h_est.head<2>() / x2h_est[2];
   }
+  /**
+   * Fixed size version of the above for euclidean points; it does not
+   * allocate and is the one used by the robust estimation kernels.
+   *
+   * \param[in]  H The 3x3 homography matrix.
+   * \param[in]  x1 A 2D point (euclidean coordinates).
+   * \param[in]  x2 A 2D point (euclidean coordinates).
+   * \param[out] dx  A vector of size 2 of the residual error
+   */
+  template <typename T>
+  static void Residuals(const Eigen::Matrix<T, 3, 3> &H,
+                        const Eigen::Matrix<T, 2, 1> &x1,
+                        const Eigen::Matrix<T, 2, 1> &x2,
+                        Eigen::Matrix<T, 2, 1> *dx) {
+    const T w = H(2, 0) * x1(0) + H(2, 1) * x1(1) + H(2, 2);
+    (*dx)(0) = x2(0) - (H(0, 0) * x1(0) + H(0, 1) * x1(1) + H(0, 2)) / w;
+    (*dx)(1) = x2(1) - (H(1, 0) * x1(0) + H(1, 1) * x1(1) + H(1, 2)) / w;
+  }
   /**
    * Computes the squared norm of the residuals between a set of 2D points x2 
    * and the transformed 2D point set x1 such that  
@@ -119,6 +137,37 @@ struct AsymmetricError {
     Residuals(H, x1, x2, &dx);
     return dx.squaredNorm();
   }
+  /**
+   * Fixed size version of the above for euclidean points.
+   *
+   * \param[in]  H The 3x3 homography matrix.
+   * \param[in]  x1 A 2D point (euclidean coordinates).
+   * \param[in]  x2 A 2D point (euclidean coordinates).
+   * \return  The squared norm of the asymmetric residual error
+   */
+  template <typename T>
+  static T Error(const Eigen::Matrix<T, 3, 3> &H,
+                 const Eigen::Matrix<T, 2, 1> &x1,
+                 const Eigen::Matrix<T, 2, 1> &x2) {
+    Eigen::Matrix<T, 2, 1> dx;
+    Residuals(H, x1, x2, &dx);
+    return dx.squaredNorm();
+  }
+  /**
+   * Computes the squared norm of the asymmetric residuals of all the
+   * correspondences at once, vectorized with SSE2 when available.
+   *
+   * \param[in]  H The 3x3 homography matrix.
+   * \param[in]  x1 2xN euclidean points; row-major, so that the x and y
+   *                coordinates are contiguous.
+   * \param[in]  x2 2xN euclidean points, same layout.
+   * \param[in]  begin First correspondence to evaluate.
+   * \param[in]  end   One past the last correspondence to evaluate.
+   * \param[out] errors errors[i] receives the error of correspondence i, for
+   *                    i in [begin, end).
+   */
+  static void Errors(const Mat3 &H, const RMat &x1, const RMat &x2,
+                     int begin, int end, double *errors);
 };
 
  /**
@@ -148,6 +197,28 @@ struct SymmetricError {
     return AsymmetricError::Error(H,    x1, x2) +
            AsymmetricError::Error(Hinv, x2, x1);
   }
+  /**
+   * Fixed size version of the above for euclidean points.
+   *
+   * \param[in]  H The 3x3 homography matrix.
+   * \param[in]  x1 A 2D point (euclidean coordinates).
+   * \param[in]  x2 A 2D point (euclidean coordinates).
+   * \return  The squared norm of the symmetric residuals errors
+   */
+  template <typename T>
+  static T Error(const Eigen::Matrix<T, 3, 3> &H,
+                 const Eigen::Matrix<T, 2, 1> &x1,
+                 const Eigen::Matrix<T, 2, 1> &x2) {
+    const Eigen::Matrix<T, 3, 3> Hinv = H.inverse();
+    return AsymmetricError::Error(H,    x1, x2) +
+           AsymmetricError::Error(Hinv, x2, x1);
+  }
+  /**
+   * Batch version of the above; H is inverted once for all the points.
+   * \see AsymmetricError::Errors
+   */
+  static void Errors(const Mat3 &H, const RMat &x1, const RMat &x2,
+                     int begin, int end, double *errors);
   // TODO(julien) Add residuals function \see AsymmetricError
 };
  /**
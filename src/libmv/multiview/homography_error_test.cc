@@ -76,6 +76,48 @@ TEST(Homography2D, AsymmetricError) {
 }
 // TODO(julien) Make tests for symmetric errors
 
+TEST(Homography2D, FixedSizeErrorsMatchDynamicErrors) {
+  Mat3 H;
+  H << 1.2, 0.1, -4,
+       0.05, 0.9, 5,
+       1e-3, 2e-3, 1;
+  Vec2 x1, x2;
+  x1 << 3.5, -2;
+  x2 << 0.5, 7.25;
+  Mat H_dynamic = H;
+  Vec x1_dynamic = x1, x2_dynamic = x2;
+
+  Vec2 dx, dx_dynamic;
+  AsymmetricError::Residuals(H, x1, x2, &dx);
+  AsymmetricError::Residuals(H_dynamic, x1_dynamic, x2_dynamic, &dx_dynamic);
+  EXPECT_MATRIX_NEAR(dx_dynamic, dx, 1e-12);
+
+  EXPECT_NEAR(AsymmetricError::Error(H_dynamic, x1_dynamic, x2_dynamic),
+              AsymmetricError::Error(H, x1, x2), 1e-12);
+  EXPECT_NEAR(SymmetricError::Error(H_dynamic, x1_dynamic, x2_dynamic),
+              SymmetricError::Error(H, x1, x2), 1e-12);
+}
+
+TEST(Homography2D, BatchErrorsMatchPointErrors) {
+  Mat3 H;
+  H << 1.2, 0.1, -4,
+       0.05, 0.9, 5,
+       1e-3, 2e-3, 1;
+  // An odd number of points also exercises the scalar tail.
+  const int n = 5;
+  Mat x1 = 10 * Mat::Random(2, n);
+  Mat x2 = 10 * Mat::Random(2, n);
+  RMat x1_rows = x1, x2_rows = x2;
+  Vec asymmetric(n), symmetric(n);
+  AsymmetricError::Errors(H, x1_rows, x2_rows, 0, n, asymmetric.data());
+  SymmetricError::Errors(H, x1_rows, x2_rows, 0, n, symmetric.data());
+  for (int i = 0; i < n; ++i) {
+    Vec2 a = x1.col(i), b = x2.col(i);
+    EXPECT_NEAR(AsymmetricError::Error(H, a, b), asymmetric(i), 1e-9);
+    EXPECT_NEAR(SymmetricError::Error(H, a, b), symmetric(i), 1e-9);
+  }
+}
+
 TEST(Homography2D, AlgebraicError) {
   Mat3 H;
   H << 1, 0, -4,
@@ -18,6 +18,10 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "libmv/multiview/projection.h"
 #include "libmv/numeric/numeric.h"
 
@@ -218,4 +222,49 @@ double Depth(const Mat3 &R, const Vec3 &t, const Vec4 &X) {
   return Depth(R, t, Xe);
 }
 
+void SquaredReprojectionErrors(const Mat34 &P, const RMat &X, const RMat &x,
+                               int begin, int end, double *errors) {
+  assert(3 == X.rows() || 4 == X.rows());
+  assert(2 == x.rows());
+  assert(X.cols() == x.cols());
+  assert(0 <= begin && begin <= end && end <= X.cols());
+  const int n = X.cols();
+  const double *px = X.data(), *py = px + n, *pz = py + n;
+  // Euclidean points have an implicit w = 1.
+  const double *pw = X.rows() == 4 ? pz + n : NULL;
+  const double *qx = x.data(), *qy = qx + n;
+  int i = begin;
+#ifdef __SSE2__
+  __m128d p[12];
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      p[4 * r + c] = _mm_set1_pd(P(r, c));
+    }
+  }
+  const __m128d one = _mm_set1_pd(1.0);
+  for (; i + 1 < end; i += 2) {
+    __m128d X0 = _mm_loadu_pd(px + i), X1 = _mm_loadu_pd(py + i),
+            X2 = _mm_loadu_pd(pz + i), X3 = pw ? _mm_loadu_pd(pw + i) : one;
+    __m128d h[3];
+    for (int r = 0; r < 3; ++r) {
+      h[r] = _mm_add_pd(_mm_add_pd(_mm_mul_pd(p[4 * r + 0], X0),
+                                   _mm_mul_pd(p[4 * r + 1], X1)),
+                        _mm_add_pd(_mm_mul_pd(p[4 * r + 2], X2),
+                                   _mm_mul_pd(p[4 * r + 3], X3)));
+    }
+    __m128d ex = _mm_sub_pd(_mm_loadu_pd(qx + i), _mm_div_pd(h[0], h[2]));
+    __m128d ey = _mm_sub_pd(_mm_loadu_pd(qy + i), _mm_div_pd(h[1], h[2]));
+    _mm_storeu_pd(errors + i, _mm_add_pd(_mm_mul_pd(ex, ex),
+                                         _mm_mul_pd(ey, ey)));
+  }
+#endif
+  for (; i < end; ++i) {
+    const Vec4 HX(px[i], py[i], pz[i], pw ? pw[i] : 1.0);
+    const Vec3 hx = P * HX;
+    const double ex = qx[i] - hx(0) / hx(2);
+    const double ey = qy[i] - hx(1) / hx(2);
+    errors[i] = ex * ex + ey * ey;
+  }
+}
+
 }  // namespace libmv
@@ -173,6 +173,13 @@ inline Mat2X Project(const Mat34 &P, const Mat3X &X, const Vecu &ids) {
   return x;
 }
 
+// Squared reprojection errors ||x_i - Psi(P * X_i)||^2 of all the points,
+// vectorized with SSE2 when available. X is 3xN (euclidean) or 4xN
+// (homogeneous) and x is 2xN; both are row-major so that each coordinate is
+// contiguous. errors[i] receives the error of point i, for i in [begin, end).
+void SquaredReprojectionErrors(const Mat34 &P, const RMat &X, const RMat &x,
+                               int begin, int end, double *errors);
+
 double Depth(const Mat3 &R, const Vec3 &t, const Vec3 &X);
 double Depth(const Mat3 &R, const Vec3 &t, const Vec4 &X);
 
@@ -114,4 +114,27 @@ TEST(AutoCalibration, ProjectionChangeAspectRatio) {
   EXPECT_MATRIX_EQ(P2, P2_computed);
 }
 
+TEST(Projection, SquaredReprojectionErrors) {
+  Mat34 P;
+  P << 500,   0, 320, 10,
+         0, 500, 240, -5,
+         0,   0,   1,  4;
+  const int n = 5;
+  Mat3X X = Mat3X::Random(3, n);
+  Mat2X x = 100 * Mat2X::Random(2, n);
+  Mat4X X_homogeneous = 2 * EuclideanToHomogeneous(X);
+  RMat X_rows = X, X_homogeneous_rows = X_homogeneous, x_rows = x;
+
+  Vec euclidean(n), homogeneous(n);
+  SquaredReprojectionErrors(P, X_rows, x_rows, 0, n, euclidean.data());
+  SquaredReprojectionErrors(P, X_homogeneous_rows, x_rows, 0, n,
+                            homogeneous.data());
+  Mat2X projected = Project(P, X);
+  for (int i = 0; i < n; ++i) {
+    double expected = (projected.col(i) - x.col(i)).squaredNorm();
+    EXPECT_NEAR(expected, euclidean(i), 1e-9 * expected);
+    EXPECT_NEAR(expected, homogeneous(i), 1e-9 * expected);
+  }
+}
+
 } // namespace
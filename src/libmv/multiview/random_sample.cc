@@ -0,0 +1,87 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "libmv/logging/logging.h"
+#include "libmv/multiview/random_sample.h"
+
+namespace libmv {
+
+ProsacSampler::ProsacSampler(const vector<double> &scores, int max_iterations)
+  : max_iterations_(max_iterations), num_samples_(0), t_(0), n_(0),
+    tn_(0), tn_prime_(0) {
+  std::vector<std::pair<double, int> > ranked(scores.size());
+  for (int i = 0; i < scores.size(); ++i) {
+    ranked[i] = std::make_pair(scores[i], i);
+  }
+  // Stable, so that equal scores keep the order of the correspondences.
+  std::stable_sort(ranked.begin(), ranked.end());
+  order_.resize(scores.size());
+  for (int i = 0; i < scores.size(); ++i) {
+    order_[i] = ranked[i].second;
+  }
+}
+
+void ProsacSampler::Sample(int num_samples, int total_samples, Rng *rng,
+                           vector<int> *samples) {
+  CHECK_EQ(total_samples, order_.size());
+  CHECK_LE(num_samples, total_samples);
+  if (num_samples != num_samples_) {
+    // T_m, the expected number of draws containing only the top m
+    // correspondences among max_iterations uniform draws. See equation (3)
+    // of the paper.
+    num_samples_ = num_samples;
+    n_ = num_samples;
+    t_ = 0;
+    tn_ = max_iterations_;
+    for (int i = 0; i < num_samples; ++i) {
+      tn_ *= double(n_ - i) / (total_samples - i);
+    }
+    tn_prime_ = 1;
+  }
+
+  ++t_;
+  if (t_ > tn_prime_ && n_ < total_samples) {
+    // Grow the top ranked set; every size is used at least once.
+    double tn_next = tn_ * (n_ + 1) / (n_ + 1 - num_samples);
+    tn_prime_ += std::max(1.0, std::ceil(tn_next - tn_));
+    tn_ = tn_next;
+    ++n_;
+  }
+
+  if (t_ > tn_prime_) {
+    // All the correspondences are in play: plain RANSAC.
+    UniformSample(num_samples, n_, rng, &subset_);
+  } else {
+    // The newest correspondence of the set and m - 1 others from the set.
+    UniformSample(num_samples - 1, n_ - 1, rng, &subset_);
+    subset_.push_back(n_ - 1);
+  }
+  samples->resize(num_samples);
+  for (int i = 0; i < num_samples; ++i) {
+    (*samples)[i] = order_[subset_[i]];
+  }
+}
+
+}  // namespace libmv
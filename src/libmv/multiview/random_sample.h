@@ -26,6 +26,50 @@
 
 namespace libmv {
 
+/**
+ * Seedable pseudo random number generator (xorshift128 [1]).
+ *
+ * Unlike rand() the state lives in the object, so each robust estimation
+ * owns its generator: the draws are reproducible for a given seed and
+ * estimations running on different threads do not share any state.
+ *
+ * [1] Xorshift RNGs, G. Marsaglia, Journal of Statistical Software 2003
+ */
+class Rng {
+ public:
+  explicit Rng(unsigned int seed = 0) { Seed(seed); }
+
+  void Seed(unsigned int seed) {
+    // Hash the seed into the state so that close seeds give unrelated
+    // sequences.
+    for (int i = 0; i < 4; ++i) {
+      seed += 0x9e3779b9u;
+      unsigned int z = seed;
+      z = (z ^ (z >> 16)) * 0x85ebca6bu;
+      z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+      state_[i] = z ^ (z >> 16);
+    }
+    if (!(state_[0] | state_[1] | state_[2] | state_[3])) {
+      state_[0] = 1;
+    }
+  }
+
+  unsigned int Next() {
+    unsigned int t = state_[0] ^ (state_[0] << 11);
+    state_[0] = state_[1];
+    state_[1] = state_[2];
+    state_[2] = state_[3];
+    state_[3] ^= (state_[3] >> 19) ^ t ^ (t >> 8);
+    return state_[3];
+  }
+
+  /// Returns a number of [0, n).
+  int Uniform(int n) { return Next() % n; }
+
+ private:
+  unsigned int state_[4];
+};
+
 /**
  * Pick a random subset of the integers [0, total), in random order.
  * Note that this can behave badly if num_samples is close to total; runtime
@@ -39,7 +83,7 @@ namespace libmv {
  * \param samples       num_samples of numbers in [0, total_samples) is placed
  *                      here on return.
  */
-static void UniformSample(int num_samples,
+inline void UniformSample(int num_samples,
                           int total_samples,
                           vector<int> *samples) {
   samples->resize(0);
@@ -58,6 +102,94 @@ static void UniformSample(int num_samples,
   }
 }
 
+/// Same as above, drawing from rng instead of rand().
+inline void UniformSample(int num_samples,
+                          int total_samples,
+                          Rng *rng,
+                          vector<int> *samples) {
+  samples->resize(0);
+  while (samples->size() < num_samples) {
+    int sample = rng->Uniform(total_samples);
+    bool found = false;
+    for (int j = 0; j < samples->size(); ++j) {
+      found = (*samples)[j] == sample;
+      if (found) {
+        break;
+      }
+    }
+    if (!found) {
+      samples->push_back(sample);
+    }
+  }
+}
+
+/**
+ * Draws the minimal subsets of a robust estimation; see Estimate.
+ */
+class Sampler {
+ public:
+  virtual ~Sampler() {}
+  /**
+   * Places num_samples distinct numbers of [0, total_samples) in samples,
+   * using rng as the only source of randomness. Called once per iteration of
+   * the robust estimator.
+   */
+  virtual void Sample(int num_samples,
+                      int total_samples,
+                      Rng *rng,
+                      vector<int> *samples) = 0;
+};
+
+/// Sampler drawing every subset with the same probability (plain RANSAC).
+class UniformSampler : public Sampler {
+ public:
+  virtual void Sample(int num_samples, int total_samples, Rng *rng,
+                      vector<int> *samples) {
+    UniformSample(num_samples, total_samples, rng, samples);
+  }
+};
+
+/**
+ * Progressive sample consensus (PROSAC) sampler [1].
+ *
+ * The correspondences are ranked by quality and the subsets are drawn from
+ * a set of top ranked correspondences that grows with the number of
+ * iterations, so that the first hypotheses are fitted on the most reliable
+ * matches. After max_iterations draws the sampler behaves like
+ * UniformSampler. With good matches ranked first, a correct model is found
+ * in a handful of iterations and the adaptive iteration count of Estimate
+ * stops the search early.
+ *
+ * [1] Matching with PROSAC - Progressive Sample Consensus,
+ *     O. Chum and J. Matas, CVPR 2005
+ */
+class ProsacSampler : public Sampler {
+ public:
+  /**
+   * \param scores         Quality of each correspondence, lower is better
+   *                       (e.g. the descriptor distance of the match).
+   * \param max_iterations Number of draws after which all the
+   *                       correspondences are sampled uniformly (T_N).
+   */
+  ProsacSampler(const vector<double> &scores, int max_iterations = 200000);
+
+  virtual void Sample(int num_samples, int total_samples, Rng *rng,
+                      vector<int> *samples);
+
+  /// Size of the set of top ranked correspondences used by the last draw.
+  int SubsetSize() const { return n_; }
+
+ private:
+  vector<int> order_;     // Correspondences by increasing score.
+  int max_iterations_;
+  int num_samples_;       // m; 0 until the first draw.
+  int t_;                 // Number of draws so far.
+  int n_;                 // Size of the current top ranked set.
+  double tn_;             // Expected draws from the top n_ (T_n).
+  double tn_prime_;       // Draw at which the set grows (T'_n).
+  vector<int> subset_;
+};
+
 }  // namespace libmv
 
 #endif  // LIBMV_MULTIVIEW_RANDOM_SAMPLE_H_
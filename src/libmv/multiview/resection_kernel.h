@@ -36,20 +36,25 @@ class Kernel {
   typedef Mat34 Model;
   enum { MINIMUM_SAMPLES = 6 };
 
-  Kernel(const Mat2X &x, const Mat4X &X) : x_(x), X_(X) {
+  Kernel(const Mat2X &x, const Mat4X &X)
+    : x_(x), X_(X), x_rows_(x), X_rows_(X) {
     CHECK(x.cols() == X.cols());
   }
   void Fit(const vector<int> &samples, vector<Model> *models) const {
-    Mat2X x = ExtractColumns(x_, samples);
-    Mat4X X = ExtractColumns(X_, samples);
+    ExtractColumns(x_, samples, &x_samples_);
+    ExtractColumns(X_, samples, &X_samples_);
     Mat34 P;
-    Resection(x, X, &P);
+    Resection(x_samples_, X_samples_, &P);
     models->push_back(P);
   }
   double Error(int sample, const Model &model) const {
-    Mat4X X = X_.col(sample);
-    Mat2X error = Project(model, X) - x_.col(sample);
-    return error.col(0).squaredNorm();
+    const Vec4 X = X_.col(sample);
+    const Vec3 x = model * X;
+    const Vec2 error = x.head<2>() / x(2) - x_.col(sample);
+    return error.squaredNorm();
+  }
+  void Errors(const Model &model, int begin, int end, double *errors) const {
+    SquaredReprojectionErrors(model, X_rows_, x_rows_, begin, end, errors);
   }
   int NumSamples() const {
     return x_.cols();
@@ -57,6 +62,12 @@ class Kernel {
  private:
   const Mat2X &x_;
   const Mat4X &X_;
+  // Row-major copies of the points for Errors.
+  const RMat x_rows_;
+  const RMat X_rows_;
+  // Scratch space of Fit.
+  mutable Mat2X x_samples_;
+  mutable Mat4X X_samples_;
 };
 
 }  // namespace kernel
@@ -18,6 +18,7 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include "libmv/base/scoped_ptr.h"
 #include "libmv/base/vector.h"
 #include "libmv/multiview/affine_kernel.h"
 #include "libmv/multiview/robust_affine.h"
@@ -34,15 +35,18 @@ double Affine2DFromCorrespondences3PointRobust(
     double max_error,
     Mat3 *H,
     vector<int> *inliers,
-    double outliers_probability)
+    double outliers_probability,
+    const vector<double> *scores)
 {
   // The threshold is on the sum of the squared errors in the two images.
   double threshold = 2 * Square(max_error);
   double best_score = HUGE_VAL;
   typedef affine::affine2D::kernel::Kernel KernelH;
   KernelH kernel(x1, x2);
-  *H = Estimate(kernel, MLEScorer<KernelH>(threshold), inliers, 
-                &best_score, outliers_probability);
+  scoped_ptr<Sampler> sampler(scores ? new ProsacSampler(*scores) : NULL);
+  *H = Estimate(kernel, BatchMLEScorer<KernelH>(threshold), inliers, 
+                &best_score, outliers_probability,
+                sampler.get());
   if (best_score == HUGE_VAL)
     return HUGE_VAL;
   else
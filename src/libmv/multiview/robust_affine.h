@@ -46,6 +46,10 @@ namespace libmv {
  * The number of iterations is controlled using the following equation:
  *    n_iter = log(outliers_prob) / log(1.0 - pow(inlier_ratio, min_samples)))
  * The more this value is high, the less the function selects ramdom samples.
+ * \param[in] scores optional quality of each correspondence, lower is better
+ *          (e.g. the descriptor distance of the match). When given, the
+ *          samples are drawn from the best ranked correspondences first
+ *          (PROSAC), which usually needs far fewer iterations.
  * 
  * \return the best error found (in pixels), associated to the solution H
  * 
@@ -58,7 +62,8 @@ double Affine2DFromCorrespondences3PointRobust(
     double max_error,
     Mat3 *H,
     vector<int> *inliers = NULL,
-    double outliers_probability = 1e-2);
+    double outliers_probability = 1e-2,
+    const vector<double> *scores = NULL);
 
 } // namespace libmv
 
@@ -23,9 +23,52 @@
 #include <algorithm>
 #include <set>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "libmv/multiview/robust_estimation.h"
 #include "libmv/numeric/numeric.h"
 
 namespace libmv {
 
+double TruncatedCost(const double *errors,
+                     const int *samples,
+                     int n,
+                     double threshold,
+                     vector<int> *inliers) {
+  // Write the inliers without branching on the error, then drop the unused
+  // tail.
+  const int first = inliers->size();
+  inliers->resize(first + n);
+  int *out = inliers->begin() + first;
+  int num_inliers = 0;
+  double cost = 0.0;
+  int i = 0;
+#ifdef __SSE2__
+  const __m128d t = _mm_set1_pd(threshold);
+  __m128d sum = _mm_setzero_pd();
+  for (; i + 1 < n; i += 2) {
+    __m128d e = _mm_loadu_pd(errors + i);
+    sum = _mm_add_pd(sum, _mm_min_pd(e, t));
+    const int mask = _mm_movemask_pd(_mm_cmplt_pd(e, t));
+    out[num_inliers] = samples[i];
+    num_inliers += mask & 1;
+    out[num_inliers] = samples[i + 1];
+    num_inliers += mask >> 1;
+  }
+  double sums[2];
+  _mm_storeu_pd(sums, sum);
+  cost = sums[0] + sums[1];
+#endif
+  for (; i < n; ++i) {
+    const bool inlier = errors[i] < threshold;
+    cost += inlier ? errors[i] : threshold;
+    out[num_inliers] = samples[i];
+    num_inliers += inlier;
+  }
+  inliers->resize(first + num_inliers);
+  return cost;
+}
+
 } // namespace libmv
@@ -21,8 +21,12 @@
 #ifndef LIBMV_MULTIVIEW_ROBUST_ESTIMATION_H_
 #define LIBMV_MULTIVIEW_ROBUST_ESTIMATION_H_
 
+#include <algorithm>
 #include <set>
+#include <utility>
+#include <vector>
 
+#include "libmv/base/timer.h"
 #include "libmv/base/vector.h"
 #include "libmv/logging/logging.h"
 #include "libmv/multiview/random_sample.h"
@@ -30,6 +34,16 @@
 
 namespace libmv {
 
+// Scorers compute the cost of a model over a set of samples:
+//
+//   Scorer::Score(kernel, model, samples, inliers) -> cost
+//   Scorer::Score(kernel, model, samples, max_cost, inliers) -> cost
+//
+// The second form may stop as soon as the cost reaches max_cost. Since the
+// cost only grows while the samples are visited, a hypothesis that reaches
+// the cost of the best model so far can never replace it; Estimate uses this
+// to reject bad hypotheses after a few residuals. The returned cost is then
+// only a lower bound and inliers is incomplete.
 template<typename Kernel>
 class MLEScorer {
  public:
@@ -38,8 +52,15 @@ class MLEScorer {
                const typename Kernel::Model &model,
                const vector<int> &samples,
                vector<int> *inliers) const {
+    return Score(kernel, model, samples, HUGE_VAL, inliers);
+  }
+  double Score(const Kernel &kernel,
+               const typename Kernel::Model &model,
+               const vector<int> &samples,
+               double max_cost,
+               vector<int> *inliers) const {
     double cost = 0.0;
-    for (int j = 0; j < samples.size(); ++j) {
+    for (int j = 0; j < samples.size() && cost < max_cost; ++j) {
       double error = kernel.Error(samples[j], model);
       if (error < threshold_) {
         cost += error;
@@ -54,6 +75,83 @@ class MLEScorer {
   double threshold_;
 };
 
+/**
+ * Computes the cost of the MLEScorer from per-sample errors: the sum of the
+ * errors truncated at threshold. The samples whose error is below threshold
+ * are appended to inliers. errors[j] must be the error of samples[j], for j
+ * in [0, n); the pass is vectorized with SSE2 when available.
+ */
+double TruncatedCost(const double *errors,
+                     const int *samples,
+                     int n,
+                     double threshold,
+                     vector<int> *inliers);
+
+/**
+ * Same cost as MLEScorer, for kernels that can compute their errors in
+ * batches with
+ *
+ *   Kernel::Errors(Model, int begin, int end, double *errors)
+ *
+ * which writes the errors of the samples [begin, end) to errors[begin, end).
+ * The kernel evaluates the residuals over its structure of arrays point
+ * buffers one block at a time in a vectorized pass, then TruncatedCost
+ * thresholds and accumulates them in a second one. Working by blocks lets a
+ * hypothesis be rejected once it exceeds the bound, without evaluating the
+ * residuals of the remaining samples. This is what the robust_* wrappers
+ * use; MLEScorer remains for kernels that only offer Error.
+ */
+template<typename Kernel>
+class BatchMLEScorer {
+ public:
+  BatchMLEScorer(double threshold) : threshold_(threshold) {}
+  double Score(const Kernel &kernel,
+               const typename Kernel::Model &model,
+               const vector<int> &samples,
+               vector<int> *inliers) const {
+    return Score(kernel, model, samples, HUGE_VAL, inliers);
+  }
+  double Score(const Kernel &kernel,
+               const typename Kernel::Model &model,
+               const vector<int> &samples,
+               double max_cost,
+               vector<int> *inliers) const {
+    const int num_samples = kernel.NumSamples();
+    const int num_blocks = (num_samples + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    errors_.resize(num_samples);
+    computed_.resize(num_blocks);
+    std::fill(computed_.begin(), computed_.end(), 0);
+    sample_errors_.resize(BLOCK_SIZE);
+
+    double cost = 0.0;
+    for (int j0 = 0; j0 < samples.size() && cost < max_cost;
+         j0 += BLOCK_SIZE) {
+      const int count = std::min<int>(BLOCK_SIZE, samples.size() - j0);
+      for (int j = 0; j < count; ++j) {
+        const int sample = samples[j0 + j];
+        const int block = sample / BLOCK_SIZE;
+        if (!computed_[block]) {
+          const int begin = block * BLOCK_SIZE;
+          const int end = std::min(begin + BLOCK_SIZE, num_samples);
+          kernel.Errors(model, begin, end, errors_.begin());
+          computed_[block] = 1;
+        }
+        sample_errors_[j] = errors_[sample];
+      }
+      cost += TruncatedCost(sample_errors_.begin(), samples.begin() + j0,
+                            count, threshold_, inliers);
+    }
+    return cost;
+  }
+ private:
+  enum { BLOCK_SIZE = 256 };
+  double threshold_;
+  // Reused between hypotheses.
+  mutable vector<double> errors_;
+  mutable vector<char> computed_;
+  mutable vector<double> sample_errors_;
+};
+
 static uint IterationsRequired(int min_samples,
                         double outliers_probability,
                         double inlier_ratio) {
@@ -70,12 +168,28 @@ static uint IterationsRequired(int min_samples,
 // 2. Kernel::MINIMUM_SAMPLES
 // 3. Kernel::Fit(vector<int>, vector<Kernel::Model> *)
 // 4. Kernel::Error(Model, int) -> error
+//
+// The minimal subsets are drawn by sampler, or uniformly if it is NULL; pass
+// a ProsacSampler when the quality of the correspondences is known. All the
+// randomness comes from rng, or from an Rng seeded with 0 if it is NULL, so
+// the result is reproducible and concurrent estimations are independent.
+//
+// With local_optimization, each new best model is refined as in LO-RANSAC
+// [1]: the model is refitted on all its inliers with Kernel::Fit, and the
+// refit is kept and repeated while it lowers the cost. The larger inlier set
+// lowers the number of iterations required, and the returned model is fitted
+// on more than a minimal sample.
+//
+// [1] Locally Optimized RANSAC, O. Chum, J. Matas and J. Kittler, DAGM 2003
 template<typename Kernel, typename Scorer>
 typename Kernel::Model Estimate(const Kernel &kernel,
                                 const Scorer &scorer,
                                 vector<int> *best_inliers = NULL,
                                 double *best_score = NULL,
-                                double outliers_probability = 1e-2) {
+                                double outliers_probability = 1e-2,
+                                Sampler *sampler = NULL,
+                                Rng *rng = NULL,
+                                bool local_optimization = false) {
   CHECK(outliers_probability < 1.0);
   CHECK(outliers_probability > 0.0);
   size_t iteration = 0;
@@ -101,24 +215,52 @@ typename Kernel::Model Estimate(const Kernel &kernel,
   // In this robust estimator, the scorer always works on all the data points
   // at once. So precompute the list ahead of time.
   vector<int> all_samples;
+  all_samples.reserve(total_samples);
   for (int i = 0; i < total_samples; ++i) {
     all_samples.push_back(i);
   }
 
+  // The buffers of the loop are allocated once; the iterations only reset
+  // their size so that hypothesis generation and scoring stay off the heap.
+  UniformSampler uniform_sampler;
+  if (!sampler) {
+    sampler = &uniform_sampler;
+  }
+  Rng default_rng;
+  if (!rng) {
+    rng = &default_rng;
+  }
   vector<int> sample;
+  sample.reserve(min_samples);
+  vector<typename Kernel::Model> models;
+  vector<int> inliers;
+  inliers.reserve(total_samples);
+  // The local optimization needs the inliers of the best model even if the
+  // caller does not.
+  vector<int> local_best_inliers;
+  if (!best_inliers && local_optimization) {
+    best_inliers = &local_best_inliers;
+  }
+  if (best_inliers) {
+    best_inliers->reserve(total_samples);
+  }
+  const int max_local_steps = 4;
+  vector<typename Kernel::Model> refits;
   for (iteration = 0;
        iteration < max_iterations &&
        iteration < really_max_iterations; ++iteration) {
-    UniformSample(min_samples, total_samples, &sample);
+    sampler->Sample(min_samples, total_samples, rng, &sample);
 
-    vector<typename Kernel::Model> models;
+    models.resize(0);
     kernel.Fit(sample, &models);
     VLOG(4) << "Fitted subset; found " << models.size() << " model(s).";
 
     // Compute costs for each fit.
     for (int i = 0; i < models.size(); ++i) {
-      vector<int> inliers;
-      double cost = scorer.Score(kernel, models[i], all_samples, &inliers);
+      inliers.resize(0);
+      // Scoring stops once the hypothesis cannot beat the best model.
+      double cost = scorer.Score(kernel, models[i], all_samples, best_cost,
+                                 &inliers);
       VLOG(5) << "Fit cost: " << cost
               << ", number of inliers: " << inliers.size();
 
@@ -133,6 +275,31 @@ typename Kernel::Model Estimate(const Kernel &kernel,
         VLOG(4) << "New best cost: " << best_cost << " with "
                 << best_num_inliers << " inlying of "
                 << total_samples << " total samples.";
+
+        for (int step = 0; local_optimization && step < max_local_steps &&
+                           best_inliers->size() > min_samples; ++step) {
+          refits.resize(0);
+          kernel.Fit(*best_inliers, &refits);
+          bool improved = false;
+          for (int j = 0; j < refits.size(); ++j) {
+            inliers.resize(0);
+            double refit_cost = scorer.Score(kernel, refits[j], all_samples,
+                                             best_cost, &inliers);
+            if (refit_cost < best_cost) {
+              best_cost = refit_cost;
+              best_model = refits[j];
+              best_inliers->swap(inliers);
+              improved = true;
+            }
+          }
+          if (!improved) {
+            break;
+          }
+          best_num_inliers = best_inliers->size();
+          best_inlier_ratio = best_num_inliers / double(total_samples);
+          VLOG(4) << "Local optimization " << step << ": cost " << best_cost
+                  << " with " << best_num_inliers << " inliers.";
+        }
       }
       if (best_inlier_ratio) {
         max_iterations = IterationsRequired(min_samples, 
@@ -149,6 +316,268 @@ typename Kernel::Model Estimate(const Kernel &kernel,
   return best_model;
 }
 
+// Same as Estimate with uniform sampling, but the hypotheses are generated
+// and scored on all the OpenMP threads.
+//
+// The iterations run in blocks of up to 32 hypotheses. The threads share the
+// best model and the adaptive iteration bound at the end of each block, and
+// a hypothesis is only scored until it cannot beat the best model of the
+// previous blocks. Hypothesis i draws its sample from an Rng seeded with
+// seed + i, so the result depends on seed but not on the number of threads
+// or on their scheduling.
+//
+// The kernel and the scorer are copied once per thread so that their scratch
+// buffers are not shared.
+template<typename Kernel, typename Scorer>
+typename Kernel::Model EstimateParallel(const Kernel &kernel,
+                                        const Scorer &scorer,
+                                        vector<int> *best_inliers = NULL,
+                                        double *best_score = NULL,
+                                        double outliers_probability = 1e-2,
+                                        unsigned int seed = 0) {
+  CHECK(outliers_probability < 1.0);
+  CHECK(outliers_probability > 0.0);
+  const int min_samples = Kernel::MINIMUM_SAMPLES;
+  const int total_samples = kernel.NumSamples();
+  const int block_size = 32;
+
+  int max_iterations = 100;
+  const int really_max_iterations = 1000;
+
+  double best_cost = HUGE_VAL;
+  typename Kernel::Model best_model;
+
+  if (total_samples < min_samples)  {
+    if (best_inliers) {
+      best_inliers->resize(0);
+    }
+    return best_model;
+  }
+
+  vector<int> all_samples;
+  all_samples.reserve(total_samples);
+  for (int i = 0; i < total_samples; ++i) {
+    all_samples.push_back(i);
+  }
+
+  // The outcome of each hypothesis of the current block.
+  vector<typename Kernel::Model> block_models(block_size);
+  vector<double> block_costs(block_size);
+  std::vector<vector<int> > block_inliers(block_size);
+
+  int block_begin = 0, block_end = 0;
+#pragma omp parallel
+  {
+    Kernel thread_kernel(kernel);
+    Scorer thread_scorer(scorer);
+    Rng rng;
+    vector<int> sample;
+    sample.reserve(min_samples);
+    vector<typename Kernel::Model> models;
+    vector<int> inliers;
+    inliers.reserve(total_samples);
+    for (;;) {
+#pragma omp single
+      {
+        block_end = std::min(block_begin + block_size,
+                             std::min(max_iterations, really_max_iterations));
+      }
+      if (block_begin >= block_end) {
+        break;
+      }
+#pragma omp for schedule(dynamic, 1)
+      for (int i = block_begin; i < block_end; ++i) {
+        const int slot = i - block_begin;
+        rng.Seed(seed + i);
+        UniformSample(min_samples, total_samples, &rng, &sample);
+        models.resize(0);
+        thread_kernel.Fit(sample, &models);
+        block_costs[slot] = HUGE_VAL;
+        for (int j = 0; j < models.size(); ++j) {
+          inliers.resize(0);
+          double cost = thread_scorer.Score(thread_kernel, models[j],
+                                            all_samples,
+                                            std::min(best_cost,
+                                                     block_costs[slot]),
+                                            &inliers);
+          if (cost < block_costs[slot]) {
+            block_costs[slot] = cost;
+            block_models[slot] = models[j];
+            block_inliers[slot].swap(inliers);
+          }
+        }
+      }
+#pragma omp single
+      {
+        // Merge in iteration order, as the serial loop would.
+        for (int slot = 0; slot < block_end - block_begin; ++slot) {
+          if (block_costs[slot] < best_cost) {
+            best_cost = block_costs[slot];
+            best_model = block_models[slot];
+            if (block_inliers[slot].size()) {
+              max_iterations = std::min<uint>(
+                  really_max_iterations,
+                  IterationsRequired(min_samples, outliers_probability,
+                                     block_inliers[slot].size() /
+                                     double(total_samples)));
+            }
+            if (best_inliers) {
+              best_inliers->swap(block_inliers[slot]);
+            }
+            VLOG(4) << "New best cost: " << best_cost << " at iteration "
+                    << block_begin + slot << "; max iterations needed: "
+                    << max_iterations;
+          }
+        }
+        block_begin = block_end;
+      }
+    }
+  }
+  if (best_score)
+    *best_score = best_cost;
+  return best_model;
+}
+
+// Options of EstimatePreemptive.
+struct PreemptiveOptions {
+  PreemptiveOptions()
+    : num_hypotheses(300),
+      block_size(100),
+      time_budget(0) {}
+
+  int num_hypotheses;  // Hypotheses generated before any scoring (M).
+  int block_size;      // Data points scored between two preemptions (B).
+  double time_budget;  // In seconds from the call; <= 0 means no deadline.
+};
+
+// Preemptive RANSAC [1]: a fixed number of hypotheses is generated up front
+// and scored breadth first. The data points are visited in random order, B
+// at a time; after i points only the best M * 2^-floor(i / B) hypotheses are
+// kept, until one remains or the data is exhausted. The work is therefore
+// bounded by about M fits plus 2 * M * B error evaluations whatever the
+// inlier ratio, which suits real-time use.
+//
+// If options.time_budget is positive, hypothesis generation and scoring stop
+// once it is spent, and the best hypothesis on the points scored so far is
+// returned. The inliers and the score of the returned model are always
+// computed on all the points.
+//
+// The cost of a point is its error truncated at threshold; the returned model
+// is scored with MLEScorer. Only Kernel::Fit and Kernel::Error are used.
+//
+// [1] Preemptive RANSAC for live structure and motion estimation,
+//     D. Nister, ICCV 2003
+template<typename Kernel>
+typename Kernel::Model EstimatePreemptive(
+    const Kernel &kernel,
+    double threshold,
+    const PreemptiveOptions &options = PreemptiveOptions(),
+    vector<int> *best_inliers = NULL,
+    double *best_score = NULL,
+    Rng *rng = NULL) {
+  CHECK_GT(options.num_hypotheses, 0);
+  CHECK_GT(options.block_size, 0);
+  WallTimer timer;
+  const bool has_deadline = options.time_budget > 0;
+  const int min_samples = Kernel::MINIMUM_SAMPLES;
+  const int total_samples = kernel.NumSamples();
+  typename Kernel::Model best_model;
+  if (best_inliers) {
+    best_inliers->resize(0);
+  }
+  if (best_score) {
+    *best_score = HUGE_VAL;
+  }
+  if (total_samples < min_samples) {
+    return best_model;
+  }
+  Rng default_rng;
+  if (!rng) {
+    rng = &default_rng;
+  }
+
+  // The hypotheses. A fit may give several models; all are kept.
+  vector<typename Kernel::Model> hypotheses;
+  hypotheses.reserve(options.num_hypotheses);
+  vector<typename Kernel::Model> models;
+  vector<int> sample;
+  for (int i = 0; i < options.num_hypotheses &&
+                  hypotheses.size() < options.num_hypotheses; ++i) {
+    if (has_deadline && hypotheses.size() &&
+        timer.Seconds() > options.time_budget) {
+      VLOG(2) << "Deadline reached after " << i << " fits.";
+      break;
+    }
+    UniformSample(min_samples, total_samples, rng, &sample);
+    models.resize(0);
+    kernel.Fit(sample, &models);
+    for (int j = 0; j < models.size() &&
+                    hypotheses.size() < options.num_hypotheses; ++j) {
+      hypotheses.push_back(models[j]);
+    }
+  }
+  if (!hypotheses.size()) {
+    return best_model;
+  }
+
+  // Visit the points in random order, so that a block is a random subset.
+  vector<int> order(total_samples);
+  for (int i = 0; i < total_samples; ++i) {
+    order[i] = i;
+  }
+  for (int i = total_samples - 1; i > 0; --i) {
+    std::swap(order[i], order[rng->Uniform(i + 1)]);
+  }
+
+  // The surviving hypotheses, as (cost, index) pairs.
+  const int num_hypotheses = hypotheses.size();
+  std::vector<std::pair<double, int> > alive(num_hypotheses);
+  for (int h = 0; h < num_hypotheses; ++h) {
+    alive[h] = std::make_pair(0.0, h);
+  }
+  int num_scored = 0;
+  while (alive.size() > 1 && num_scored < total_samples) {
+    const int end = std::min(num_scored + options.block_size, total_samples);
+    for (int h = 0; h < alive.size(); ++h) {
+      const typename Kernel::Model &model = hypotheses[alive[h].second];
+      double cost = 0;
+      for (int i = num_scored; i < end; ++i) {
+        cost += std::min(kernel.Error(order[i], model), threshold);
+      }
+      alive[h].first += cost;
+    }
+    num_scored = end;
+    if (has_deadline && timer.Seconds() > options.time_budget) {
+      VLOG(2) << "Deadline reached after scoring " << num_scored
+              << " points.";
+      break;
+    }
+    const int shift = num_scored / options.block_size;
+    const int keep = shift < 31 ? std::max(1, num_hypotheses >> shift) : 1;
+    if (keep < alive.size()) {
+      // Ties go to the hypothesis generated first.
+      std::nth_element(alive.begin(), alive.begin() + keep, alive.end());
+      alive.resize(keep);
+    }
+  }
+  best_model = hypotheses[std::min_element(alive.begin(),
+                                           alive.end())->second];
+
+  // On all the points, in order.
+  for (int i = 0; i < total_samples; ++i) {
+    order[i] = i;
+  }
+  vector<int> inliers;
+  const double cost = MLEScorer<Kernel>(threshold).Score(
+      kernel, best_model, order, best_inliers ? best_inliers : &inliers);
+  VLOG(2) << "Preemptive estimation: " << num_hypotheses << " hypotheses, "
+          << num_scored << " points scored, " << timer.Seconds() << " s.";
+  if (best_score) {
+    *best_score = cost;
+  }
+  return best_model;
+}
+
 } // namespace libmv
 
 #endif  // LIBMV_MULTIVIEW_ROBUST_ESTIMATION_H_
@@ -43,6 +43,76 @@ TEST(UniformSampleTest, NoRepetions) {
   }
 }
 
+TEST(Rng, SeedGivesTheSameSequence) {
+  Rng a(7), b(7), c(8);
+  int num_differences = 0;
+  for (int i = 0; i < 100; ++i) {
+    unsigned int x = a.Next();
+    EXPECT_EQ(x, b.Next());
+    num_differences += x != c.Next();
+  }
+  EXPECT_LT(90, num_differences);
+
+  a.Seed(7);
+  b.Seed(7);
+  vector<int> samples_a, samples_b;
+  for (int i = 0; i < 10; ++i) {
+    UniformSample(4, 30, &a, &samples_a);
+    UniformSample(4, 30, &b, &samples_b);
+    ASSERT_EQ(4, samples_a.size());
+    for (int j = 0; j < 4; ++j) {
+      EXPECT_EQ(samples_a[j], samples_b[j]);
+      EXPECT_LE(0, samples_a[j]);
+      EXPECT_GT(30, samples_a[j]);
+    }
+  }
+}
+
+TEST(ProsacSampler, FirstDrawIsTopRanked) {
+  vector<double> scores;
+  for (int i = 0; i < 20; ++i) {
+    scores.push_back(20 - i);
+  }
+  ProsacSampler sampler(scores);
+  vector<int> samples;
+  Rng rng;
+  sampler.Sample(3, 20, &rng, &samples);
+  ASSERT_EQ(3, samples.size());
+  EXPECT_EQ(3, sampler.SubsetSize());
+  std::vector<bool> in_set(20, false);
+  for (int i = 0; i < samples.size(); ++i) {
+    in_set[samples[i]] = true;
+  }
+  EXPECT_TRUE(in_set[19]);
+  EXPECT_TRUE(in_set[18]);
+  EXPECT_TRUE(in_set[17]);
+}
+
+TEST(ProsacSampler, GrowsToAllCorrespondences) {
+  const int total = 50, num_samples = 4;
+  vector<double> scores;
+  for (int i = 0; i < total; ++i) {
+    scores.push_back(i);
+  }
+  ProsacSampler sampler(scores, 1000);
+  Rng rng;
+  vector<int> samples;
+  int last_size = 0;
+  for (int t = 0; t < 2000; ++t) {
+    sampler.Sample(num_samples, total, &rng, &samples);
+    EXPECT_LE(last_size, sampler.SubsetSize());
+    last_size = sampler.SubsetSize();
+    std::vector<bool> in_set(total, false);
+    for (int i = 0; i < num_samples; ++i) {
+      // Scores are the identity, so the ranks are the indices.
+      EXPECT_LT(samples[i], sampler.SubsetSize());
+      EXPECT_FALSE(in_set[samples[i]]);
+      in_set[samples[i]] = true;
+    }
+  }
+  EXPECT_EQ(total, last_size);
+}
+
 struct LineKernel {
   LineKernel(const Mat2X &xs) : xs_(xs) {}
 
@@ -76,6 +146,12 @@ struct LineKernel {
     return e*e;
   }
 
+  void Errors(const Vec2 &ba, int begin, int end, double *errors) const {
+    for (int i = begin; i < end; ++i) {
+      errors[i] = Error(i, ba);
+    }
+  }
+
   const Mat2X &xs_;
 };
 
@@ -137,8 +213,199 @@ TEST(RobustLineFitter, OneOutlier) {
   ASSERT_EQ(5, inliers.size());
 }
 
+TEST(TruncatedCost, MatchesMLEScorer) {
+  Mat2X xy(2, 7);
+  // y = 2x + 1 with two outliers.
+  xy << 1, 2, 3, 4,  5,  100,  6,
+        3, 5, 7, 9, 11, -123, 20;
+  LineKernel kernel(xy);
+  Vec2 ba(1, 2);
+  vector<int> samples;
+  for (int i = xy.cols() - 1; i >= 0; --i) {
+    samples.push_back(i);
+  }
+  vector<int> inliers, batch_inliers;
+  double cost = MLEScorer<LineKernel>(4).Score(kernel, ba, samples, &inliers);
+  double batch_cost = BatchMLEScorer<LineKernel>(4).Score(kernel, ba, samples,
+                                                          &batch_inliers);
+  EXPECT_EQ(cost, batch_cost);
+  ASSERT_EQ(5, batch_inliers.size());
+  ASSERT_EQ(inliers.size(), batch_inliers.size());
+  for (int i = 0; i < inliers.size(); ++i) {
+    EXPECT_EQ(inliers[i], batch_inliers[i]);
+  }
+}
+
+TEST(MLEScorer, StopsAtMaxCost) {
+  // y = 2x + 1 for the first two points only.
+  Mat2X xy(2, 600);
+  xy.row(0).setZero();
+  xy.row(1).setConstant(100);
+  xy(0, 0) = 1; xy(1, 0) = 3;
+  xy(0, 1) = 2; xy(1, 1) = 5;
+  LineKernel kernel(xy);
+  Vec2 ba(1, 2);
+  vector<int> samples;
+  for (int i = 0; i < xy.cols(); ++i) {
+    samples.push_back(i);
+  }
+  // All the other points are outliers, with a cost of 4 each.
+  vector<int> inliers, batch_inliers;
+  double full = MLEScorer<LineKernel>(4).Score(kernel, ba, samples, &inliers);
+  EXPECT_EQ(4.0 * 598, full);
+  EXPECT_EQ(2, inliers.size());
+
+  inliers.resize(0);
+  double bounded = MLEScorer<LineKernel>(4).Score(kernel, ba, samples, 20,
+                                                  &inliers);
+  EXPECT_EQ(20, bounded);
+  EXPECT_EQ(2, inliers.size());
+
+  // The batch scorer stops at the end of the first block.
+  double batch = BatchMLEScorer<LineKernel>(4).Score(kernel, ba, samples, 20,
+                                                     &batch_inliers);
+  EXPECT_LE(20, batch);
+  EXPECT_GT(full, batch);
+  EXPECT_EQ(2, batch_inliers.size());
+}
+
+TEST(RobustLineFitter, BatchScorerOneOutlier) {
+  Mat2X xy(2, 6);
+  // y = 2x + 1 with an outlier
+  xy << 1, 2, 3, 4,  5, /* outlier! */  100,
+        3, 5, 7, 9, 11, /* outlier! */ -123;
+
+  LineKernel kernel(xy);
+  vector<int> inliers;
+  Vec2 ba = Estimate(kernel, BatchMLEScorer<LineKernel>(4), &inliers);
+  EXPECT_NEAR(2.0, ba[1], 1e-9);
+  EXPECT_NEAR(1.0, ba[0], 1e-9);
+  ASSERT_EQ(5, inliers.size());
+}
+
 // Test if the robust estimator do not return inlier if too few point
 // was given for an estimation.
+TEST(RobustLineFitter, ProsacManyOutliers) {
+  // y = 2x + 1 for the first 8 points, then 92 outliers. The inliers have the
+  // best scores, so PROSAC fits them first.
+  const int n = 100;
+  Mat2X xy(2, n);
+  vector<double> scores;
+  for (int i = 0; i < n; ++i) {
+    xy(0, i) = i;
+    xy(1, i) = i < 8 ? 2 * i + 1 : 1000 + 37 * (i % 11) - 5 * i;
+    scores.push_back(i < 8 ? 0.1 * i : 10 + (i * 7) % 13);
+  }
+
+  LineKernel kernel(xy);
+  ProsacSampler sampler(scores);
+  vector<int> inliers;
+  Vec2 ba = Estimate(kernel, MLEScorer<LineKernel>(4), &inliers, NULL,
+                     1e-2, &sampler);
+  EXPECT_NEAR(2.0, ba[1], 1e-9);
+  EXPECT_NEAR(1.0, ba[0], 1e-9);
+  EXPECT_EQ(8, inliers.size());
+}
+
+TEST(RobustLineFitter, ParallelManyOutliers) {
+  // y = 2x + 1 for one point out of three.
+  const int n = 90;
+  Mat2X xy(2, n);
+  for (int i = 0; i < n; ++i) {
+    xy(0, i) = i;
+    xy(1, i) = i % 3 == 0 ? 2 * i + 1 : 500 - 7 * i + 10 * (i % 5);
+  }
+
+  LineKernel kernel(xy);
+  vector<int> inliers, inliers_again;
+  double score, score_again;
+  Vec2 ba = EstimateParallel(kernel, MLEScorer<LineKernel>(4), &inliers,
+                             &score, 1e-2, 3);
+  EXPECT_NEAR(2.0, ba[1], 1e-9);
+  EXPECT_NEAR(1.0, ba[0], 1e-9);
+  ASSERT_EQ(n / 3, inliers.size());
+
+  Vec2 ba_again = EstimateParallel(kernel, MLEScorer<LineKernel>(4),
+                                   &inliers_again, &score_again, 1e-2, 3);
+  EXPECT_EQ(ba[0], ba_again[0]);
+  EXPECT_EQ(ba[1], ba_again[1]);
+  EXPECT_EQ(score, score_again);
+}
+
+TEST(RobustLineFitter, PreemptiveManyOutliers) {
+  // y = 2x + 1 for one point out of three.
+  const int n = 600;
+  Mat2X xy(2, n);
+  for (int i = 0; i < n; ++i) {
+    xy(0, i) = i;
+    xy(1, i) = i % 3 == 0 ? 2 * i + 1 : 500 - 7 * i + 10 * (i % 5);
+  }
+
+  LineKernel kernel(xy);
+  PreemptiveOptions options;
+  options.num_hypotheses = 100;
+  options.block_size = 50;
+  vector<int> inliers;
+  double score;
+  Vec2 ba = EstimatePreemptive(kernel, 4, options, &inliers, &score);
+  EXPECT_NEAR(2.0, ba[1], 1e-9);
+  EXPECT_NEAR(1.0, ba[0], 1e-9);
+  ASSERT_EQ(n / 3, inliers.size());
+  EXPECT_NEAR(4 * (n - n / 3), score, 1e-6);
+}
+
+TEST(RobustLineFitter, PreemptiveDeadline) {
+  Mat2X xy(2, 6);
+  xy << 1, 2, 3, 4,  5,  100,
+        3, 5, 7, 9, 11, -123;
+
+  // A budget that is spent at once still gives the first hypothesis, with
+  // its inliers counted on all the points.
+  LineKernel kernel(xy);
+  PreemptiveOptions options;
+  options.time_budget = 1e-12;
+  vector<int> inliers;
+  double score = 0;
+  Vec2 ba = EstimatePreemptive(kernel, 4, options, &inliers, &score);
+  int num_inliers = 0;
+  for (int i = 0; i < xy.cols(); ++i) {
+    num_inliers += kernel.Error(i, ba) < 4;
+  }
+  EXPECT_EQ(num_inliers, inliers.size());
+  EXPECT_LE(2, inliers.size());
+  EXPECT_GT(HUGE_VAL, score);
+}
+
+TEST(RobustLineFitter, LocalOptimization) {
+  // y = 2x + 1 with noise, then outliers.
+  const int n = 50;
+  Mat2X xy(2, n);
+  for (int i = 0; i < n; ++i) {
+    xy(0, i) = i;
+    xy(1, i) = 2 * i + 1 + 0.3 * ((i * 7) % 5 - 2) / 2.0;
+  }
+  for (int i = 40; i < n; ++i) {
+    xy(1, i) = -10 * i;
+  }
+
+  LineKernel kernel(xy);
+  vector<int> inliers, lo_inliers;
+  double score, lo_score;
+  Estimate(kernel, MLEScorer<LineKernel>(4), &inliers, &score);
+  Vec2 ba = Estimate(kernel, MLEScorer<LineKernel>(4), &lo_inliers, &lo_score,
+                     1e-2, NULL, NULL, true);
+  EXPECT_LE(lo_score, score);
+  EXPECT_EQ(40, lo_inliers.size());
+  EXPECT_NEAR(2.0, ba[1], 1e-2);
+  EXPECT_NEAR(1.0, ba[0], 2e-1);
+
+  // The result is the least squares fit on the inliers.
+  vector<Vec2> refit;
+  kernel.Fit(lo_inliers, &refit);
+  EXPECT_NEAR(refit[0][0], ba[0], 1e-9);
+  EXPECT_NEAR(refit[0][1], ba[1], 1e-9);
+}
+
 TEST(RobustLineFitter, TooFewPoints) {
   Mat2X xy(2, 1);
   // y = 2x + 1
@@ -18,29 +18,72 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include "libmv/base/scoped_ptr.h"
 #include "libmv/multiview/euclidean_resection_kernel.h"
 #include "libmv/multiview/robust_estimation.h"
 #include "libmv/multiview/robust_euclidean_resection.h"
 #include "libmv/numeric/numeric.h"
 
 namespace libmv {
+namespace {
+
+typedef euclidean_resection::kernel::P3PKernel P3PKernel;
+
+// Refits the best P3P hypothesis P with EPnP on its inliers, and keeps the
+// refit and its inliers if it scores better.
+void RefitWithEPnP(const P3PKernel &kernel,
+                   double threshold,
+                   Mat34 *P,
+                   vector<int> *inliers,
+                   double *best_score) {
+  if (inliers->size() <= P3PKernel::MINIMUM_SAMPLES) {
+    return;
+  }
+  vector<Mat34> refits;
+  kernel.Fit(*inliers, &refits);
+  vector<int> all_samples(kernel.NumSamples());
+  for (int i = 0; i < all_samples.size(); ++i) {
+    all_samples[i] = i;
+  }
+  vector<int> refit_inliers;
+  double refit_score = MLEScorer<P3PKernel>(threshold).Score(
+      kernel, refits[0], all_samples, &refit_inliers);
+  if (refit_score < *best_score) {
+    *P = refits[0];
+    *best_score = refit_score;
+    inliers->swap(refit_inliers);
+  }
+}
+
+}  // namespace
+
 // Estimate robustly the the extrinsic parameters, R and t for a calibrated
 // camera from 4 or more 3D points and their images.
-// The euclidean resection solver relies on the EPnP method.
+// The hypotheses are computed with P3P and the best one is refitted with EPnP
+// on its inliers. With local_optimization, each new best hypothesis is also
+// refitted inside the RANSAC loop.
 double EuclideanResectionEPnPRobust(const Mat2X &x_image, 
                                     const Mat3X &X_world,
                                     const Mat3  &K,
                                     double max_error,
                                     Mat3 *R, Vec3 *t,
                                     vector<int> *inliers,
-                                    double outliers_probability) {
+                                    double outliers_probability,
+                                    const vector<double> *scores,
+                                    bool local_optimization) {
   // The threshold is on the sum of the squared errors.
   double threshold = Square(max_error);
   double best_score = HUGE_VAL;
-  typedef libmv::euclidean_resection::kernel::Kernel Kernel;
-  Kernel kernel(x_image, X_world, K);
-  Mat34 P = Estimate(kernel, MLEScorer<Kernel>(threshold), 
-                     inliers, &best_score, outliers_probability);
+  P3PKernel kernel(x_image, X_world, K);
+  vector<int> local_inliers;
+  if (!inliers) {
+    inliers = &local_inliers;
+  }
+  scoped_ptr<Sampler> sampler(scores ? new ProsacSampler(*scores) : NULL);
+  Mat34 P = Estimate(kernel, BatchMLEScorer<P3PKernel>(threshold),
+                     inliers, &best_score, outliers_probability,
+                     sampler.get(), NULL, local_optimization);
+  RefitWithEPnP(kernel, threshold, &P, inliers, &best_score);
   Mat3 K_unused;
   KRt_From_P(P, &K_unused, R, t);
   if (best_score == HUGE_VAL)
@@ -49,4 +92,29 @@ double EuclideanResectionEPnPRobust(const Mat2X &x_image,
     return std::sqrt(best_score / 2.0);  
 }
 
+double EuclideanResectionEPnPPreemptive(const Mat2X &x_image,
+                                        const Mat3X &X_world,
+                                        const Mat3 &K,
+                                        double max_error,
+                                        Mat3 *R, Vec3 *t,
+                                        vector<int> *inliers,
+                                        const PreemptiveOptions &options) {
+  double threshold = Square(max_error);
+  double best_score = HUGE_VAL;
+  P3PKernel kernel(x_image, X_world, K);
+  vector<int> local_inliers;
+  if (!inliers) {
+    inliers = &local_inliers;
+  }
+  Mat34 P = EstimatePreemptive(kernel, threshold, options, inliers,
+                               &best_score);
+  RefitWithEPnP(kernel, threshold, &P, inliers, &best_score);
+  Mat3 K_unused;
+  KRt_From_P(P, &K_unused, R, t);
+  if (best_score == HUGE_VAL)
+    return HUGE_VAL;
+  else
+    return std::sqrt(best_score / 2.0);
+}
+
 }  // namespace libmv
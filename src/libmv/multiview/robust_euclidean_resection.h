@@ -22,21 +22,42 @@
 #define LIBMV_MULTIVIEW_ROBUST_EUCLIDEAN_RESECTION_H_
 
 #include "libmv/base/vector.h"
+#include "libmv/multiview/robust_estimation.h"
 #include "libmv/numeric/numeric.h"
 
 namespace libmv {
 
 // Estimate robustly the the extrinsic parameters, R and t for a calibrated
 // camera from 4 or more 3D points and their images.
-// The euclidean resection solver relies on the EPnP method.
+// The hypotheses are computed with the closed-form P3P solver, and the best
+// one is refitted with EPnP on its inliers. With local_optimization each new
+// best hypothesis is also refitted inside the RANSAC loop (LO-RANSAC), which
+// finds the inliers more reliably but costs a fit per new best model.
 // Returns the score associated to the solution (R,t)
+// If scores is given (one per correspondence, lower is better, e.g. the
+// descriptor distance of the match), the samples are drawn from the best
+// ranked correspondences first (PROSAC).
 double EuclideanResectionEPnPRobust(const Mat2X &x_image, 
                                     const Mat3X &X_world,
                                     const Mat3  &K,
                                     double max_error,
                                     Mat3 *R, Vec3 *t,
                                     vector<int> *inliers = NULL,
-                                    double outliers_probability = 1e-2);
+                                    double outliers_probability = 1e-2,
+                                    const vector<double> *scores = NULL,
+                                    bool local_optimization = false);
+
+// Same as EuclideanResectionEPnPRobust, with a bounded amount of work (see
+// EstimatePreemptive). Meant for live tracking: set options.time_budget to
+// get the best pose found within the frame budget.
+double EuclideanResectionEPnPPreemptive(
+    const Mat2X &x_image,
+    const Mat3X &X_world,
+    const Mat3 &K,
+    double max_error,
+    Mat3 *R, Vec3 *t,
+    vector<int> *inliers = NULL,
+    const PreemptiveOptions &options = PreemptiveOptions());
 
 } // namespace libmv
 
@@ -19,6 +19,7 @@
 // IN THE SOFTWARE.
 
 #include "libmv/logging/logging.h"
+#include "libmv/multiview/euclidean_resection.h"
 #include "libmv/multiview/projection.h"
 #include "libmv/multiview/robust_euclidean_resection.h"
 #include "libmv/multiview/robust_estimation.h"
@@ -41,21 +42,88 @@ TEST(EuclideanResectionRobustKernel, TestSynthetic6FullViews) {
     // Now make 40% of the points in x totally wrong.
     x.block(0, 0, 2, noutliers).setRandom();
     
+    // With and without the EPnP refinement of the best P3P hypotheses.
+    for (int local_optimization = 0; local_optimization < 2;
+         ++local_optimization) {
+      Mat3 R;
+      Vec3 t;
+      vector<int> inliers;
+      EuclideanResectionEPnPRobust(x, d.X, d.K[i], threshold_inlier,
+                                   &R, &t, &inliers, 1e-2, NULL,
+                                   local_optimization);
+
+      EXPECT_MATRIX_PROP(R, d.R[i], 3e-8);
+      EXPECT_MATRIX_PROP(t, d.t[i], 3e-8);
+
+      // Make sure inliers were classified properly.
+      for (int i = 0; i < inliers.size(); ++i) {
+        LOG(INFO) << inliers[i];
+        EXPECT_EQ(i + noutliers, inliers[i]);  // 0..19 are outliers.
+      }
+      EXPECT_EQ(npoints-noutliers, inliers.size());
+    }
+  }
+}
+
+// With the default arguments the returned pose is the EPnP fit of the
+// inliers, not the P3P hypothesis of three of them.
+TEST(EuclideanResectionRobustKernel, RefitsNoisyInliersWithEPnP) {
+  int nviews = 6;
+  int npoints = 50;
+  int noutliers = 0.4*npoints;
+  double threshold_inlier = 0.2;
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+  for (int i = 0; i < nviews; ++i) {
+    Mat2X x = d.x[i];
+    x.block(0, noutliers, 2, npoints - noutliers) +=
+        Mat2X::Random(2, npoints - noutliers);
+    x.block(0, 0, 2, noutliers).setRandom();
+
     Mat3 R;
     Vec3 t;
     vector<int> inliers;
-    EuclideanResectionEPnPRobust(x, d.X, d.K[i], threshold_inlier, 
+    EuclideanResectionEPnPRobust(x, d.X, d.K[i], threshold_inlier,
                                  &R, &t, &inliers);
-    
+    ASSERT_EQ(npoints - noutliers, inliers.size());
+    for (int j = 0; j < inliers.size(); ++j) {
+      EXPECT_EQ(j + noutliers, inliers[j]);
+    }
+
+    Mat2X x_camera;
+    EuclideanToNormalizedCamera(x, d.K[i], &x_camera);
+    Mat3 R_epnp;
+    Vec3 t_epnp;
+    euclidean_resection::EuclideanResection(
+        x_camera.rightCols(npoints - noutliers),
+        d.X.rightCols(npoints - noutliers),
+        &R_epnp, &t_epnp, euclidean_resection::RESECTION_EPNP);
+    EXPECT_MATRIX_NEAR(R, R_epnp, 1e-12);
+    EXPECT_MATRIX_NEAR(t, t_epnp, 1e-12);
+  }
+}
+
+TEST(EuclideanResectionRobustKernel, PreemptiveSynthetic6FullViews) {
+  int nviews = 6;
+  int npoints = 300;
+  int noutliers = 0.3*npoints;
+  double threshold_inlier = 0.2;
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+  for (int i = 0; i < nviews; ++i) {
+    Mat2X x = d.x[i];
+    x.block(0, 0, 2, noutliers).setRandom();
+
+    Mat3 R;
+    Vec3 t;
+    vector<int> inliers;
+    EuclideanResectionEPnPPreemptive(x, d.X, d.K[i], threshold_inlier,
+                                     &R, &t, &inliers);
+
     EXPECT_MATRIX_PROP(R, d.R[i], 3e-8);
     EXPECT_MATRIX_PROP(t, d.t[i], 3e-8);
-    
-    // Make sure inliers were classified properly.
-    for (int i = 0; i < inliers.size(); ++i) {
-      LOG(INFO) << inliers[i];
-      EXPECT_EQ(i + noutliers, inliers[i]);  // 0..19 are outliers.
+    ASSERT_EQ(npoints - noutliers, inliers.size());
+    for (int j = 0; j < inliers.size(); ++j) {
+      EXPECT_EQ(j + noutliers, inliers[j]);
     }
-    EXPECT_EQ(npoints-noutliers, inliers.size());
   }
 }
 
@@ -18,6 +18,7 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include "libmv/base/scoped_ptr.h"
 #include "libmv/multiview/fundamental_kernel.h"
 #include "libmv/multiview/robust_estimation.h"
 #include "libmv/multiview/robust_fundamental.h"
@@ -31,15 +32,19 @@ double FundamentalFromCorrespondences8PointRobust(const Mat &x1,
                                                   double max_error,
                                                   Mat3 *F,
                                                   vector<int> *inliers,
-                                                  double outliers_probability) {
+                                                  double outliers_probability,
+                                                  const vector<double> *scores,
+                                                  bool local_optimization) {
   // The threshold is on the sum of the squared errors in the two images.
   // Actually, Sampson's approximation of this error.
   double threshold = 2 * Square(max_error);
   double best_score = HUGE_VAL;
   typedef fundamental::kernel::NormalizedEightPointKernel Kernel;
   Kernel kernel(x1, x2);
-  *F = Estimate(kernel, MLEScorer<Kernel>(threshold), inliers, 
-                &best_score, outliers_probability);
+  scoped_ptr<Sampler> sampler(scores ? new ProsacSampler(*scores) : NULL);
+  *F = Estimate(kernel, BatchMLEScorer<Kernel>(threshold), inliers, 
+                &best_score, outliers_probability,
+                sampler.get(), NULL, local_optimization);
   if (best_score == HUGE_VAL)
     return HUGE_VAL;
   else
@@ -51,19 +56,61 @@ double FundamentalFromCorrespondences7PointRobust(const Mat &x1,
                                                   double max_error,
                                                   Mat3 * F,
                                                   vector<int> *inliers,
-                                                  double outliers_probability) {
+                                                  double outliers_probability,
+                                                  const vector<double> *scores,
+                                                  bool local_optimization) {
   // The threshold is on the sum of the squared errors in the two images.
   // Actually, Sampson's approximation of this error.
   double threshold = 2 * Square(max_error);
   double best_score = HUGE_VAL;
   typedef fundamental::kernel::NormalizedSevenPointKernel Kernel;
   Kernel kernel(x1, x2);
-  *F = Estimate(kernel, MLEScorer<Kernel>(threshold), inliers, 
-                &best_score, outliers_probability);
+  scoped_ptr<Sampler> sampler(scores ? new ProsacSampler(*scores) : NULL);
+  *F = Estimate(kernel, BatchMLEScorer<Kernel>(threshold), inliers, 
+                &best_score, outliers_probability,
+                sampler.get(), NULL, local_optimization);
   if (best_score == HUGE_VAL)
     return HUGE_VAL;
   else
     return std::sqrt(best_score / 2.0);  
 }
 
+double FundamentalFromCorrespondences7PointRobustParallel(
+    const Mat &x1,
+    const Mat &x2,
+    double max_error,
+    Mat3 *F,
+    vector<int> *inliers,
+    double outliers_probability,
+    unsigned int seed) {
+  double threshold = 2 * Square(max_error);
+  double best_score = HUGE_VAL;
+  typedef fundamental::kernel::NormalizedSevenPointKernel Kernel;
+  Kernel kernel(x1, x2);
+  *F = EstimateParallel(kernel, BatchMLEScorer<Kernel>(threshold), inliers,
+                        &best_score, outliers_probability, seed);
+  if (best_score == HUGE_VAL)
+    return HUGE_VAL;
+  else
+    return std::sqrt(best_score / 2.0);
+}
+
+double FundamentalFromCorrespondences7PointPreemptive(
+    const Mat &x1,
+    const Mat &x2,
+    double max_error,
+    Mat3 *F,
+    vector<int> *inliers,
+    const PreemptiveOptions &options) {
+  double threshold = 2 * Square(max_error);
+  double best_score = HUGE_VAL;
+  typedef fundamental::kernel::NormalizedSevenPointKernel Kernel;
+  Kernel kernel(x1, x2);
+  *F = EstimatePreemptive(kernel, threshold, options, inliers, &best_score);
+  if (best_score == HUGE_VAL)
+    return HUGE_VAL;
+  else
+    return std::sqrt(best_score / 2.0);
+}
+
 }  // namespace libmv
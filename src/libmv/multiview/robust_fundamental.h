@@ -22,6 +22,7 @@
 #define LIBMV_MULTIVIEW_ROBUST_FUNDAMENTAL_H_
 
 #include "libmv/base/vector.h"
+#include "libmv/multiview/robust_estimation.h"
 #include "libmv/numeric/numeric.h"
 
 namespace libmv {
@@ -29,24 +30,60 @@ namespace libmv {
 // Estimate robustly the fundamental matrix between two dataset of 2D point
 // (image coords space). The fundamental solver relies on the 8 point solution.
 // Returns the score associated to the solution F
+// With local_optimization, each new best model is refitted on its inliers
+// (LO-RANSAC).
+// If scores is given (one per correspondence, lower is better, e.g. the
+// descriptor distance of the match), the samples are drawn from the best
+// ranked correspondences first (PROSAC).
 double FundamentalFromCorrespondences8PointRobust(
     const Mat &x1,
     const Mat &x2,
     double max_error,
     Mat3 *F,
     vector<int> *inliers = NULL,
-    double outliers_probability = 1e-2);
+    double outliers_probability = 1e-2,
+    const vector<double> *scores = NULL,
+    bool local_optimization = false);
 
 // Estimate robustly the fundamental matrix between two dataset of 2D point
 // (image coords space). The fundamental solver relies on the 7 point solution.
 // Returns the score associated to the solution F
+// With local_optimization, each new best model is refitted on its inliers
+// (LO-RANSAC).
+// If scores is given (one per correspondence, lower is better, e.g. the
+// descriptor distance of the match), the samples are drawn from the best
+// ranked correspondences first (PROSAC).
 double FundamentalFromCorrespondences7PointRobust(
     const Mat &x1,
     const Mat &x2,
     double max_error,
     Mat3 * F,
     vector<int> *inliers = NULL,
-    double outliers_probability = 1e-2);
+    double outliers_probability = 1e-2,
+    const vector<double> *scores = NULL,
+    bool local_optimization = false);
+
+// Same as FundamentalFromCorrespondences7PointRobust, but the hypotheses are
+// generated and scored on all the OpenMP threads (see EstimateParallel). The
+// result depends on seed, not on the number of threads.
+double FundamentalFromCorrespondences7PointRobustParallel(
+    const Mat &x1,
+    const Mat &x2,
+    double max_error,
+    Mat3 *F,
+    vector<int> *inliers = NULL,
+    double outliers_probability = 1e-2,
+    unsigned int seed = 0);
+
+// Same as FundamentalFromCorrespondences7PointRobust, with a bounded amount
+// of work (see EstimatePreemptive).
+double FundamentalFromCorrespondences7PointPreemptive(
+    const Mat &x1,
+    const Mat &x2,
+    double max_error,
+    Mat3 *F,
+    vector<int> *inliers = NULL,
+    const PreemptiveOptions &options = PreemptiveOptions());
 
 } // namespace libmv
 
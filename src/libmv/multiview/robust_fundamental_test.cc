@@ -195,4 +195,32 @@ TEST(RobustFundamental, FundamentalFromCorrespondences7PointRealisticNoOutliers)
   ExpectFundamentalProperties( F_estimated, d.x1, d.x2, 1e-6 );
 }
 
+TEST(RobustFundamental, FundamentalFromCorrespondences7PointRobustParallel) {
+  TwoViewDataSet d = TwoRealisticCameras();
+  // Replace a quarter of the second view by outliers.
+  for (int i = 0; i < d.x2.cols(); i += 4) {
+    d.x2(0, i) += 50 + 7 * (i % 5);
+    d.x2(1, i) -= 40 + 3 * (i % 7);
+  }
+
+  Mat3 F, F_again;
+  vector<int> inliers, inliers_again;
+  FundamentalFromCorrespondences7PointRobustParallel(d.x1, d.x2, 1.0,
+                                                     &F, &inliers, 1e-2, 42);
+  FundamentalFromCorrespondences7PointRobustParallel(d.x1, d.x2, 1.0,
+                                                     &F_again, &inliers_again,
+                                                     1e-2, 42);
+  // Same seed, same result.
+  EXPECT_MATRIX_EQ(F, F_again);
+  ASSERT_EQ(inliers.size(), inliers_again.size());
+
+  int num_outliers = (d.x2.cols() + 3) / 4;
+  EXPECT_EQ(d.x2.cols() - num_outliers, inliers.size());
+  for (int i = 0; i < inliers.size(); ++i) {
+    EXPECT_NE(0, inliers[i] % 4);
+  }
+  ExpectFundamentalProperties(F, ExtractColumns(d.x1, inliers),
+                              ExtractColumns(d.x2, inliers), 1e-6);
+}
+
 } // namespace
@@ -19,6 +19,7 @@
 // IN THE SOFTWARE.
 
 #include "libmv/numeric/numeric.h"
+#include "libmv/base/scoped_ptr.h"
 #include "libmv/multiview/robust_homography.h"
 #include "libmv/multiview/homography_kernel.h"
 #include "libmv/multiview/panography_kernel.h"
@@ -32,14 +33,18 @@ double Homography2DFromCorrespondences4PointRobust(const Mat &x1,
                                                    double max_error,
                                                    Mat3 *H,
                                                    vector<int> *inliers,
-                                                   double outliers_probability) {
+                                                   double outliers_probability,
+                                                   const vector<double> *scores,
+                                                   bool local_optimization) {
   // The threshold is on the sum of the squared errors in the two images.
   double threshold = 2 * Square(max_error);
   double best_score = HUGE_VAL;
   typedef homography::homography2D::kernel::Kernel KernelH;
   KernelH kernel(x1, x2);
-  *H = Estimate(kernel, MLEScorer<KernelH>(threshold), inliers, 
-                &best_score, outliers_probability);
+  scoped_ptr<Sampler> sampler(scores ? new ProsacSampler(*scores) : NULL);
+  *H = Estimate(kernel, BatchMLEScorer<KernelH>(threshold), inliers, 
+                &best_score, outliers_probability,
+                sampler.get(), NULL, local_optimization);
   if (best_score == HUGE_VAL)
     return HUGE_VAL;
   else
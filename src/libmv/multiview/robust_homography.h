@@ -35,6 +35,8 @@ namespace libmv {
  * - 3D points on a plane (+ general moving camera)
  * - 3D points + rotating camera (pure rotation)
  * - 3D points + differents focal lengths (or plan projection)
+ * With local_optimization, each new best model is refitted on its inliers
+ * (LO-RANSAC).
  * 
  * \param[in] x1 The first 2xN matrix of euclidean points
  * \param[in] x2 The second 2xN matrix of euclidean points
@@ -50,6 +52,12 @@ namespace libmv {
  * The number of iterations is controlled using the following equation:
  *    n_iter = log(outliers_prob) / log(1.0 - pow(inlier_ratio, min_samples)))
  * The more this value is high, the less the function selects ramdom samples.
+ * \param[in] scores optional quality of each correspondence, lower is better
+ *          (e.g. the descriptor distance of the match). When given, the
+ *          samples are drawn from the best ranked correspondences first
+ *          (PROSAC), which usually needs far fewer iterations.
+ * \param[in] local_optimization refit each new best model on its inliers,
+ *          for a more accurate H at the cost of a fit per new best model.
  * 
  * \return the best error found (in pixels), associated to the solution H
  * 
@@ -62,7 +70,9 @@ double Homography2DFromCorrespondences4PointRobust(
     double max_error,
     Mat3 *H,
     vector<int> *inliers = NULL,
-    double outliers_probability = 1e-2);
+    double outliers_probability = 1e-2,
+    const vector<double> *scores = NULL,
+    bool local_optimization = false);
 
 } // namespace libmv
 
@@ -18,6 +18,7 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include "libmv/base/scoped_ptr.h"
 #include "libmv/multiview/resection_kernel.h"
 #include "libmv/multiview/robust_estimation.h"
 #include "libmv/multiview/robust_resection.h"
@@ -31,14 +32,17 @@ double ResectionRobust(const Mat2X &x_image,
                        double max_error,
                        Mat34 *P,
                        vector<int> *inliers,
-                       double outliers_probability) {
+                       double outliers_probability,
+                       const vector<double> *scores) {
   // The threshold is on the sum of the squared errors.
   double threshold = Square(max_error);
   double best_score = HUGE_VAL;
   typedef libmv::resection::kernel::Kernel Kernel;
   Kernel kernel(x_image, X_world);
-  *P = Estimate(kernel, MLEScorer<Kernel>(threshold), inliers, 
-                &best_score, outliers_probability);
+  scoped_ptr<Sampler> sampler(scores ? new ProsacSampler(*scores) : NULL);
+  *P = Estimate(kernel, BatchMLEScorer<Kernel>(threshold), inliers, 
+                &best_score, outliers_probability,
+                sampler.get());
   if (best_score == HUGE_VAL)
     return HUGE_VAL;
   else
@@ -29,12 +29,16 @@ namespace libmv {
 // Estimate robustly the the projection matrix of a uncalibrated
 // camera from 6 or more 3D points and their images.
 // Returns the score associated to the solution P
+// If scores is given (one per correspondence, lower is better, e.g. the
+// descriptor distance of the match), the samples are drawn from the best
+// ranked correspondences first (PROSAC).
 double ResectionRobust(const Mat2X &x_image, 
                        const Mat4X &X_world,
                        double max_error,
                        Mat34 *P,
                        vector<int> *inliers = NULL,
-                       double outliers_probability = 1e-2);
+                       double outliers_probability = 1e-2,
+                       const vector<double> *scores = NULL);
 
 } // namespace libmv
 
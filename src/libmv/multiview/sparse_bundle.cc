@@ -0,0 +1,1673 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/timer.h"
+#include "libmv/base/vector.h"
+#include "libmv/logging/logging.h"
+#include "libmv/multiview/bundle.h"
+#include "libmv/numeric/numeric.h"
+#include "third_party/colamd/Include/colamd.h"
+extern "C" {
+#include "third_party/ldl/Include/ldl.h"
+}
+
+namespace libmv {
+namespace {
+
+// Camera parameters refined by the bundle adjustment. The focal length f
+// scales both fx = f and fy = aspect * f; the aspect ratio and the skew are
+// held fixed.
+struct BundleCamera {
+  Mat3 R;
+  Vec3 t;
+  double f, aspect, skew, cx, cy;
+};
+
+void ToBundleCamera(const Mat3 &K, const Mat3 &R, const Vec3 &t,
+                    BundleCamera *camera) {
+  camera->R = R;
+  camera->t = t;
+  camera->f = K(0, 0);
+  camera->aspect = K(1, 1) / K(0, 0);
+  camera->skew = K(0, 1);
+  camera->cx = K(0, 2);
+  camera->cy = K(1, 2);
+}
+
+void FromBundleCamera(const BundleCamera &camera, Mat3 *K, Mat3 *R, Vec3 *t) {
+  *K << camera.f, camera.skew,                camera.cx,
+        0,        camera.aspect * camera.f,   camera.cy,
+        0,        0,                          1;
+  *R = camera.R;
+  *t = camera.t;
+}
+
+// Reprojection residual of the point X observed at x. If J_camera is not
+// NULL, also computes the Jacobians with respect to the camera block (a
+// rotation update R <- exp([w]x) R, the translation, then the NI refined
+// intrinsics f, cx, cy) and to the point.
+template <int NI>
+inline Vec2 Residual(const BundleCamera &camera,
+                     const Vec3 &X,
+                     const double *x,
+                     Eigen::Matrix<double, 2, 6 + NI> *J_camera,
+                     Mat23 *J_point) {
+  const Vec3 RX = camera.R * X;
+  const Vec3 X_camera = RX + camera.t;
+  const double inverse_depth = 1.0 / X_camera(2);
+  const double u = X_camera(0) * inverse_depth;
+  const double v = X_camera(1) * inverse_depth;
+  const double fx = camera.f;
+  const double fy = camera.aspect * camera.f;
+  Vec2 residual;
+  residual << fx * u + camera.skew * v + camera.cx - x[0],
+              fy * v + camera.cy - x[1];
+  if (J_camera) {
+    Mat23 J_X_camera;
+    J_X_camera << fx * inverse_depth, camera.skew * inverse_depth,
+                  -(fx * u + camera.skew * v) * inverse_depth,
+                  0, fy * inverse_depth, -fy * v * inverse_depth;
+    J_camera->template block<2, 3>(0, 0) = -J_X_camera * CrossProductMatrix(RX);
+    J_camera->template block<2, 3>(0, 3) = J_X_camera;
+    if (NI >= 1) {
+      (*J_camera)(0, 6) = u;
+      (*J_camera)(1, 6) = camera.aspect * v;
+    }
+    if (NI == 3) {
+      (*J_camera)(0, 7) = 1;
+      (*J_camera)(1, 7) = 0;
+      (*J_camera)(0, 8) = 0;
+      (*J_camera)(1, 8) = 1;
+    }
+    *J_point = J_X_camera * camera.R;
+  }
+  return residual;
+}
+
+template <int NI>
+void UpdateCamera(const BundleCamera &camera, const double *delta,
+                  BundleCamera *updated) {
+  *updated = camera;
+  Vec3 w(delta[0], delta[1], delta[2]);
+  double angle = w.norm();
+  if (angle > 0) {
+    updated->R = Eigen::AngleAxisd(angle, w / angle).toRotationMatrix() *
+                 camera.R;
+  }
+  updated->t += Vec3(delta[3], delta[4], delta[5]);
+  if (NI >= 1) {
+    updated->f += delta[6];
+  }
+  if (NI == 3) {
+    updated->cx += delta[7];
+    updated->cy += delta[8];
+  }
+}
+
+// A block of the reduced camera system as seen from a block column.
+struct SchurBlockEntry {
+  int row;          // Block row.
+  int block;        // Index of the stored block.
+  int transposed;   // The stored block is the transposed one, (col, row).
+};
+
+// The interface of SchurBundleAdjuster that does not depend on NI, for
+// BundleProblem which keeps one alive between solves.
+class BundleAdjuster {
+ public:
+  virtual ~BundleAdjuster() {}
+  virtual void Solve(vector<BundleCamera> *cameras, Mat3X *X,
+                     BundleSummary *summary) = 0;
+  // Initial damping of Solve(), which leaves it to its final damping.
+  virtual double lambda() const = 0;
+  virtual void set_lambda(double lambda) = 0;
+  // The cameras that are not constant, in the order in which LDL eliminates
+  // them. Empty with eBUNDLE_ITERATIVE_SCHUR.
+  virtual void GetCameraOrdering(vector<int> *cameras) const = 0;
+};
+
+// Levenberg-Marquardt on cameras with 6 + NI parameters and points, with the
+// points eliminated by a Schur complement.
+//
+// The observations are numbered camera by camera. With eBUNDLE_SPARSE_SCHUR
+// the reduced camera system S is stored as dense C x C blocks, the upper
+// triangle row by row; it is added into a compressed column matrix holding
+// both triangles for LDL. With eBUNDLE_ITERATIVE_SCHUR S is never formed.
+//
+// The unknowns of the reduced camera system are its columns: each parameter
+// of a block maps to one, except the constant ones, and the intrinsics of
+// the cameras of a group map to the same columns.
+template <int NI>
+class SchurBundleAdjuster : public BundleAdjuster {
+ public:
+  enum { C = 6 + NI };
+  typedef Eigen::Matrix<double, C, C> MatCC;
+  typedef Eigen::Matrix<double, C, 3> MatC3;
+  typedef Eigen::Matrix<double, 2, C> Mat2C;
+  typedef Eigen::Matrix<double, C, 1> VecC;
+
+  // camera_ordering, if not NULL, replaces the SYMAMD ordering of the cameras
+  // that are not constant; see GetCameraOrdering().
+  SchurBundleAdjuster(const vector<Mat2X> &x,
+                      const vector<Vecu> &x_ids,
+                      int num_points,
+                      const BundleOptions &options,
+                      const vector<int> *camera_ordering = NULL);
+
+  virtual void Solve(vector<BundleCamera> *cameras, Mat3X *X,
+                     BundleSummary *summary);
+  virtual double lambda() const { return lambda_; }
+  virtual void set_lambda(double lambda) { lambda_ = lambda; }
+  virtual void GetCameraOrdering(vector<int> *cameras) const;
+
+ private:
+  void BuildStructure();
+  void BuildReducedSystemPattern();
+  void AnalyzeReducedSystem(const vector<int> *camera_ordering);
+  // Computes the Jacobian blocks, the blocks of J^T J and J^T r, with each
+  // observation reweighted by the robust loss. Returns the cost
+  // 1/2 sum rho(|r|^2) and sets squared_error to |r|^2.
+  double Linearize(const vector<BundleCamera> &cameras, const Mat3X &X,
+                   double *squared_error);
+  double Cost(const vector<BundleCamera> &cameras, const Mat3X &X,
+              double *squared_error) const;
+  double MaxGradient() const;
+  // Whether parameter a of camera i is held fixed by the options.
+  bool IsConstantParameter(int i, int a) const;
+  // Gives the cameras of each intrinsics group the same intrinsics.
+  void ShareIntrinsics(vector<BundleCamera> *cameras) const;
+  // Sums the C parameters of each block into their columns.
+  void GatherColumns(const double *parameters, Vec *columns) const;
+  // The parameters of the blocks, 0 for the constant ones.
+  void ExpandColumns(const Vec &columns, Vec *parameters) const;
+  // Position of S(row, column) in Ai_ and Ax_.
+  int Entry(int row, int column) const;
+  // Decrease of the cost predicted by the linearization for a step.
+  double PredictedDecrease(const Vec &delta_cameras,
+                           const Mat3X &delta_points) const;
+  // Solves the damped normal equations. Returns false if the reduced camera
+  // system is not positive definite.
+  bool ComputeStep(double lambda, Vec *delta_cameras, Mat3X *delta_points);
+  // Forms S and its right hand side in rhs_ and solves with LDL^T for the
+  // columns.
+  bool SolveReducedSystemDirect(Vec *columns);
+  // Solves with preconditioned conjugate gradients on the implicit S.
+  bool SolveReducedSystemIterative(Vec *columns);
+  // y = S x = (U - W V^-1 W^T) x + damping x over the columns, one factor at
+  // a time.
+  void MultiplyReducedSystem(const Vec &x, Vec *y);
+  void ApplyPreconditioner(const Vec &x, Vec *y) const;
+
+  BundleOptions options_;
+  int num_cameras_;
+  int num_points_;
+  int num_observations_;
+  int num_block_rows_;         // Number of cameras that are not constant.
+  int num_linear_iterations_;
+  double lambda_;
+
+  // Cameras that are not constant have a block in the reduced camera system.
+  vector<int> camera_block_;   // Block of camera i, or -1 if it is constant.
+  vector<int> block_camera_;   // Camera of block b.
+  int num_columns_;
+  vector<int> columns_;        // Column of parameter a of block b at b C + a,
+                               // or -1 if it is constant.
+  vector<int> column_count_;   // Number of parameters of each column.
+  bool shared_columns_;        // Some column has several parameters.
+
+  // Observations.
+  vector<int> camera_begin_;   // Observations of camera i.
+  vector<int> point_;          // Point of each observation.
+  vector<int> camera_;         // Camera of each observation.
+  vector<int> block_;          // Block of the camera of each observation.
+  vector<double> x_;           // Two coordinates per observation.
+  vector<int> point_begin_;    // Range in point_observations_ of point j.
+  vector<int> point_observations_;
+
+  // Pattern of the reduced camera system.
+  vector<int> row_begin_;      // Blocks of block row b, diagonal first.
+  vector<int> row_cols_;       // Block column of each stored block.
+  vector<int> pair_begin_;     // Range in pair_block_ of block row b.
+  vector<int> pair_block_;     // Target block of each observation pair.
+  vector<int> col_begin_;      // Entries of block column b.
+  vector<SchurBlockEntry> col_entries_;
+
+  // LDL^T factorization of the reduced camera system.
+  vector<int> block_ordering_;  // Block eliminated in position k.
+  vector<int> Ap_, Ai_;
+  vector<double> Ax_;
+  vector<int> targets_;        // Positions in Ax_ of the entries of each
+                               // stored block then of its transpose, or -1.
+  vector<int> diagonal_;       // Position in Ax_ of S(c, c).
+  vector<int> P_, Pinv_, Lp_, Parent_, Lnz_, Li_, Flag_, Pattern_;
+  vector<double> Lx_, D_, Y_;
+
+  // Linearization.
+  vector<double> W_;           // J_camera^T J_point, C x 3 per observation.
+  vector<double> J_point_;     // 2 x 3 per observation.
+  vector<double> r_;           // 2 per observation.
+  vector<double> U_;           // J_camera^T J_camera, C x C per block.
+  vector<double> g_camera_;    // C per block.
+  vector<double> V_;           // J_point^T J_point, 3 x 3 per point.
+  vector<double> g_point_;     // 3 per point.
+
+  // Scratch space of ComputeStep.
+  vector<double> V_inverse_;
+  vector<double> S_;
+  vector<double> rhs_;
+  vector<double> damping_;         // Added to the diagonal of each column.
+  vector<double> preconditioner_;  // Inverse, C x C per block, restricted to
+                                   // the columns of the block alone.
+  vector<double> preconditioner_diagonal_;  // C per block.
+  vector<double> shared_inverse_;  // Jacobi preconditioner of the shared
+                                   // columns.
+  vector<double> point_product_;   // V^-1 W^T x, 3 per point.
+  Vec x_blocks_, y_blocks_;        // C per block.
+};
+
+template <int NI>
+SchurBundleAdjuster<NI>::SchurBundleAdjuster(
+    const vector<Mat2X> &x,
+    const vector<Vecu> &x_ids,
+    int num_points,
+    const BundleOptions &options,
+    const vector<int> *camera_ordering)
+    : options_(options),
+      num_cameras_(x.size()),
+      num_points_(num_points),
+      num_linear_iterations_(0),
+      lambda_(options.initial_lambda) {
+  const vector<int> &groups = options.intrinsics_groups;
+  int num_groups = num_cameras_;
+  if (groups.size()) {
+    CHECK_EQ(groups.size(), num_cameras_);
+    num_groups = 1 + *std::max_element(groups.begin(), groups.end());
+    CHECK_GE(*std::min_element(groups.begin(), groups.end()), 0);
+  }
+  CHECK(options.constant_camera_parameters.size() == 0 ||
+        options.constant_camera_parameters.size() == num_cameras_);
+  CHECK(options.constant_intrinsics.size() == 0 ||
+        options.constant_intrinsics.size() >= num_groups);
+
+  const vector<int> &constant_cameras = options.constant_cameras;
+  camera_block_.resize(num_cameras_);
+  std::fill(camera_block_.begin(), camera_block_.end(), 0);
+  for (int c = 0; c < constant_cameras.size(); ++c) {
+    CHECK_LT(constant_cameras[c], num_cameras_);
+    camera_block_[constant_cameras[c]] = -1;
+  }
+  block_camera_.resize(0);
+  for (int i = 0; i < num_cameras_; ++i) {
+    int num_constant_parameters = 0;
+    for (int a = 0; a < C; ++a) {
+      num_constant_parameters += IsConstantParameter(i, a);
+    }
+    if (camera_block_[i] == 0 && num_constant_parameters < C) {
+      camera_block_[i] = block_camera_.size();
+      block_camera_.push_back(i);
+    } else {
+      camera_block_[i] = -1;
+    }
+  }
+  num_block_rows_ = block_camera_.size();
+
+  // The columns of the reduced camera system: none for the constant
+  // parameters, and one per group for the shared intrinsics.
+  vector<int> group_columns(num_groups * C, -1);
+  columns_.resize(num_block_rows_ * C);
+  column_count_.resize(0);
+  for (int r = 0; r < num_block_rows_; ++r) {
+    const int i = block_camera_[r];
+    for (int a = 0; a < C; ++a) {
+      int &column = columns_[r * C + a];
+      if (IsConstantParameter(i, a)) {
+        column = -1;
+        continue;
+      }
+      if (a >= 6 && groups.size()) {
+        int &group_column = group_columns[groups[i] * C + a];
+        if (group_column < 0) {
+          group_column = column_count_.size();
+          column_count_.push_back(0);
+        }
+        column = group_column;
+      } else {
+        column = column_count_.size();
+        column_count_.push_back(0);
+      }
+      column_count_[column]++;
+    }
+  }
+  num_columns_ = column_count_.size();
+  shared_columns_ = false;
+  for (int c = 0; c < num_columns_; ++c) {
+    shared_columns_ = shared_columns_ || column_count_[c] > 1;
+  }
+
+  camera_begin_.resize(num_cameras_ + 1);
+  camera_begin_[0] = 0;
+  for (int i = 0; i < num_cameras_; ++i) {
+    CHECK_EQ(x[i].cols(), x_ids[i].size());
+    camera_begin_[i + 1] = camera_begin_[i] + x[i].cols();
+  }
+  num_observations_ = camera_begin_[num_cameras_];
+  point_.resize(num_observations_);
+  camera_.resize(num_observations_);
+  block_.resize(num_observations_);
+  x_.resize(2 * num_observations_);
+  for (int i = 0; i < num_cameras_; ++i) {
+    for (int k = camera_begin_[i], c = 0; k < camera_begin_[i + 1]; ++k, ++c) {
+      CHECK_LT(x_ids[i][c], num_points_);
+      point_[k] = x_ids[i][c];
+      camera_[k] = i;
+      block_[k] = camera_block_[i];
+      x_[2 * k + 0] = x[i](0, c);
+      x_[2 * k + 1] = x[i](1, c);
+    }
+  }
+  BuildStructure();
+  if (options_.linear_solver == eBUNDLE_SPARSE_SCHUR) {
+    BuildReducedSystemPattern();
+    AnalyzeReducedSystem(camera_ordering);
+  }
+}
+
+template <int NI>
+bool SchurBundleAdjuster<NI>::IsConstantParameter(int i, int a) const {
+  const vector<int> &pose = options_.constant_camera_parameters;
+  const vector<int> &intrinsics = options_.constant_intrinsics;
+  if (a < 6) {
+    const int mask = pose.size() ? pose[i] : 0;
+    return mask & (a < 3 ? eBUNDLE_CONSTANT_ROTATION
+                         : eBUNDLE_CONSTANT_TRANSLATION);
+  }
+  const vector<int> &groups = options_.intrinsics_groups;
+  const int group = groups.size() ? groups[i] : i;
+  const int mask = intrinsics.size() ? intrinsics[group] : 0;
+  return mask & (a == 6 ? eBUNDLE_CONSTANT_FOCAL_LENGTH
+                        : eBUNDLE_CONSTANT_PRINCIPAL_POINT);
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::ShareIntrinsics(
+    vector<BundleCamera> *cameras) const {
+  // From the first camera of the group with a block.
+  vector<int> first(num_columns_, -1);
+  for (int r = 0; r < num_block_rows_; ++r) {
+    const int i = block_camera_[r];
+    for (int a = 6; a < C; ++a) {
+      const int column = columns_[r * C + a];
+      if (column < 0 || column_count_[column] == 1) {
+        continue;
+      }
+      if (first[column] < 0) {
+        first[column] = i;
+        continue;
+      }
+      const BundleCamera &source = (*cameras)[first[column]];
+      BundleCamera &camera = (*cameras)[i];
+      if (a == 6) {
+        camera.f = source.f;
+      } else if (a == 7) {
+        camera.cx = source.cx;
+      } else {
+        camera.cy = source.cy;
+      }
+    }
+  }
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::GatherColumns(const double *parameters,
+                                            Vec *columns) const {
+  columns->setZero(num_columns_);
+  for (int p = 0; p < num_block_rows_ * C; ++p) {
+    if (columns_[p] >= 0) {
+      (*columns)(columns_[p]) += parameters[p];
+    }
+  }
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::ExpandColumns(const Vec &columns,
+                                            Vec *parameters) const {
+  parameters->resize(num_block_rows_ * C);
+  for (int p = 0; p < num_block_rows_ * C; ++p) {
+    (*parameters)(p) = columns_[p] >= 0 ? columns(columns_[p]) : 0;
+  }
+}
+
+template <int NI>
+int SchurBundleAdjuster<NI>::Entry(int row, int column) const {
+  const int *begin = Ai_.begin() + Ap_[column];
+  const int *end = Ai_.begin() + Ap_[column + 1];
+  const int *entry = std::lower_bound(begin, end, row);
+  CHECK(entry != end && *entry == row);
+  return entry - Ai_.begin();
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::GetCameraOrdering(vector<int> *cameras) const {
+  cameras->resize(block_ordering_.size());
+  for (int k = 0; k < block_ordering_.size(); ++k) {
+    (*cameras)[k] = block_camera_[block_ordering_[k]];
+  }
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::BuildStructure() {
+  // Observations of each point, in camera order.
+  point_begin_.resize(num_points_ + 1);
+  std::fill(point_begin_.begin(), point_begin_.end(), 0);
+  for (int k = 0; k < num_observations_; ++k) {
+    point_begin_[point_[k] + 1]++;
+  }
+  for (int j = 0; j < num_points_; ++j) {
+    point_begin_[j + 1] += point_begin_[j];
+  }
+  point_observations_.resize(num_observations_);
+  vector<int> fill(point_begin_);
+  for (int k = 0; k < num_observations_; ++k) {
+    point_observations_[fill[point_[k]]++] = k;
+  }
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::BuildReducedSystemPattern() {
+  // Two cameras are coupled in S if they see the same point. Block row r
+  // holds the blocks (r, c) with c >= r. The pairs (k, l) of observations of
+  // a point with block_[l] >= block_[k] are enumerated once here and in the
+  // same order by ComputeStep, which adds W_k V^-1 W_l^T to pair_block_.
+  // Constant cameras have no block and only enter through V.
+  vector<int> slot(num_block_rows_, -1);
+  vector<int> cols;
+  row_begin_.resize(num_block_rows_ + 1);
+  pair_begin_.resize(num_block_rows_ + 1);
+  row_begin_[0] = 0;
+  pair_begin_[0] = 0;
+  row_cols_.resize(0);
+  pair_block_.resize(0);
+  for (int r = 0; r < num_block_rows_; ++r) {
+    const int i = block_camera_[r];
+    cols.resize(0);
+    cols.push_back(r);
+    slot[r] = 0;
+    for (int k = camera_begin_[i]; k < camera_begin_[i + 1]; ++k) {
+      const int j = point_[k];
+      for (int p = point_begin_[j]; p < point_begin_[j + 1]; ++p) {
+        const int c = block_[point_observations_[p]];
+        if (c > r && slot[c] < 0) {
+          slot[c] = 0;
+          cols.push_back(c);
+        }
+      }
+    }
+    std::sort(cols.begin(), cols.end());
+    for (int b = 0; b < cols.size(); ++b) {
+      slot[cols[b]] = row_cols_.size();
+      row_cols_.push_back(cols[b]);
+    }
+    row_begin_[r + 1] = row_cols_.size();
+    for (int k = camera_begin_[i]; k < camera_begin_[i + 1]; ++k) {
+      const int j = point_[k];
+      for (int p = point_begin_[j]; p < point_begin_[j + 1]; ++p) {
+        const int c = block_[point_observations_[p]];
+        if (c >= r) {
+          pair_block_.push_back(slot[c]);
+        }
+      }
+    }
+    pair_begin_[r + 1] = pair_block_.size();
+    for (int b = 0; b < cols.size(); ++b) {
+      slot[cols[b]] = -1;
+    }
+  }
+
+  // The same blocks seen by block columns: (i, c) is in column c, and its
+  // transpose is in column i. Rows come out sorted since the block rows are
+  // visited in order.
+  const int num_blocks = row_cols_.size();
+  col_begin_.resize(num_block_rows_ + 1);
+  std::fill(col_begin_.begin(), col_begin_.end(), 0);
+  for (int i = 0; i < num_block_rows_; ++i) {
+    for (int b = row_begin_[i]; b < row_begin_[i + 1]; ++b) {
+      col_begin_[row_cols_[b] + 1]++;
+      if (row_cols_[b] != i) {
+        col_begin_[i + 1]++;
+      }
+    }
+  }
+  for (int i = 0; i < num_block_rows_; ++i) {
+    col_begin_[i + 1] += col_begin_[i];
+  }
+  col_entries_.resize(col_begin_[num_block_rows_]);
+  vector<int> col_fill(col_begin_);
+  for (int i = 0; i < num_block_rows_; ++i) {
+    for (int b = row_begin_[i]; b < row_begin_[i + 1]; ++b) {
+      const int c = row_cols_[b];
+      SchurBlockEntry upper = { i, b, 0 };
+      col_entries_[col_fill[c]++] = upper;
+      if (c != i) {
+        SchurBlockEntry lower = { c, b, 1 };
+        col_entries_[col_fill[i]++] = lower;
+      }
+    }
+  }
+  S_.resize(num_blocks * C * C);
+  VLOG(2) << "Reduced camera system: " << num_block_rows_ << " cameras, "
+          << num_blocks << " blocks, " << pair_block_.size() << " pairs.";
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::AnalyzeReducedSystem(
+    const vector<int> *camera_ordering) {
+  const int n = num_columns_;
+
+  // Fill reducing ordering of the blocks, applied to their columns.
+  vector<int> &block_perm = block_ordering_;
+  block_perm.resize(num_block_rows_ + 1);
+  if (camera_ordering) {
+    CHECK_EQ(camera_ordering->size(), num_block_rows_);
+    for (int k = 0; k < num_block_rows_; ++k) {
+      block_perm[k] = camera_block_[(*camera_ordering)[k]];
+      CHECK_GE(block_perm[k], 0);
+    }
+  } else {
+    vector<int> block_rows(col_entries_.size());
+    for (int e = 0; e < col_entries_.size(); ++e) {
+      block_rows[e] = col_entries_[e].row;
+    }
+    int stats[COLAMD_STATS];
+    if (!col_entries_.size() ||
+        !symamd(num_block_rows_, block_rows.begin(), col_begin_.begin(),
+                block_perm.begin(), (double *) NULL, stats, &calloc, &free)) {
+      for (int i = 0; i < num_block_rows_; ++i) {
+        block_perm[i] = i;
+      }
+    }
+  }
+  block_perm.resize(num_block_rows_);
+  P_.resize(n);
+  Pinv_.resize(n);
+  int position = 0;
+  for (int k = 0; k < num_block_rows_; ++k) {
+    for (int a = 0; a < C; ++a) {
+      const int column = columns_[block_perm[k] * C + a];
+      if (column >= 0 && column_count_[column] == 1) {
+        P_[position++] = column;
+      }
+    }
+  }
+  // The shared columns couple all the cameras of their group: last.
+  for (int c = 0; c < n; ++c) {
+    if (column_count_[c] > 1) {
+      P_[position++] = c;
+    }
+  }
+
+  // Both triangles of S, as LDL permutes it. The rows of a column are those
+  // of the block columns of its parameters.
+  vector<int> parameter_begin(n + 1, 0);
+  for (int p = 0; p < num_block_rows_ * C; ++p) {
+    if (columns_[p] >= 0) {
+      parameter_begin[columns_[p] + 1]++;
+    }
+  }
+  for (int c = 0; c < n; ++c) {
+    parameter_begin[c + 1] += parameter_begin[c];
+  }
+  vector<int> parameters(parameter_begin[n]);
+  vector<int> fill(parameter_begin);
+  for (int p = 0; p < num_block_rows_ * C; ++p) {
+    if (columns_[p] >= 0) {
+      parameters[fill[columns_[p]]++] = p;
+    }
+  }
+  Ap_.resize(n + 1);
+  Ap_[0] = 0;
+  Ai_.resize(0);
+  vector<int> rows;
+  for (int c = 0; c < n; ++c) {
+    rows.resize(0);
+    for (int q = parameter_begin[c]; q < parameter_begin[c + 1]; ++q) {
+      const int i = parameters[q] / C;
+      for (int e = col_begin_[i]; e < col_begin_[i + 1]; ++e) {
+        for (int a = 0; a < C; ++a) {
+          const int row = columns_[col_entries_[e].row * C + a];
+          if (row >= 0) {
+            rows.push_back(row);
+          }
+        }
+      }
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.resize(std::unique(rows.begin(), rows.end()) - rows.begin());
+    for (int e = 0; e < rows.size(); ++e) {
+      Ai_.push_back(rows[e]);
+    }
+    Ap_[c + 1] = Ai_.size();
+  }
+  Ax_.resize(Ap_[n]);
+
+  // Where the entries of the stored blocks go, (r, c) column major and then
+  // (c, r) for the blocks off the diagonal.
+  const int num_blocks = row_cols_.size();
+  targets_.resize(2 * num_blocks * C * C);
+  for (int r = 0; r < num_block_rows_; ++r) {
+    for (int b = row_begin_[r]; b < row_begin_[r + 1]; ++b) {
+      const int c = row_cols_[b];
+      int *upper = &targets_[2 * b * C * C];
+      int *lower = upper + C * C;
+      for (int e = 0; e < C * C; ++e) {
+        const int row = columns_[r * C + e % C];
+        const int column = columns_[c * C + e / C];
+        upper[e] = -1;
+        lower[e] = -1;
+        if (row >= 0 && column >= 0) {
+          upper[e] = Entry(row, column);
+          if (c != r) {
+            lower[e] = Entry(column, row);
+          }
+        }
+      }
+    }
+  }
+  diagonal_.resize(n);
+  for (int c = 0; c < n; ++c) {
+    diagonal_[c] = Entry(c, c);
+  }
+
+  Lp_.resize(n + 1);
+  Parent_.resize(n);
+  Lnz_.resize(n);
+  Flag_.resize(n);
+  Pattern_.resize(n);
+  D_.resize(n);
+  Y_.resize(n);
+  ldl_symbolic(n, Ap_.begin(), Ai_.begin(), Lp_.begin(), Parent_.begin(),
+               Lnz_.begin(), Flag_.begin(), P_.begin(), Pinv_.begin());
+  Li_.resize(Lp_[n]);
+  Lx_.resize(Lp_[n]);
+  VLOG(2) << "Nonzeros in S: " << Ap_[n] << ", in L: " << Lp_[n];
+}
+
+template <int NI>
+double SchurBundleAdjuster<NI>::Linearize(const vector<BundleCamera> &cameras,
+                                          const Mat3X &X,
+                                          double *squared_error) {
+  W_.resize(num_observations_ * C * 3);
+  J_point_.resize(num_observations_ * 6);
+  r_.resize(num_observations_ * 2);
+  U_.resize(num_block_rows_ * C * C);
+  g_camera_.resize(num_block_rows_ * C);
+  V_.resize(num_points_ * 9);
+  g_point_.resize(num_points_ * 3);
+
+  const RobustLoss &loss = options_.loss;
+  double cost = 0, error = 0;
+#pragma omp parallel for schedule(dynamic, 4) reduction(+:cost, error)
+  for (int i = 0; i < num_cameras_; ++i) {
+    MatCC U = MatCC::Zero();
+    VecC g = VecC::Zero();
+    Mat2C J_camera;
+    Mat23 J_point;
+    for (int k = camera_begin_[i]; k < camera_begin_[i + 1]; ++k) {
+      Vec2 r = Residual<NI>(cameras[i], X.col(point_[k]), &x_[2 * k],
+                            &J_camera, &J_point);
+      const double s = r.squaredNorm();
+      cost += 0.5 * loss.Cost(s);
+      error += s;
+      if (loss.type != TRIVIAL_LOSS) {
+        const double w = std::sqrt(loss.Weight(s));
+        r *= w;
+        J_camera *= w;
+        J_point *= w;
+      }
+      U.noalias() += J_camera.transpose() * J_camera;
+      g.noalias() += J_camera.transpose() * r;
+      Eigen::Map<MatC3>(W_.begin() + k * C * 3) =
+          J_camera.transpose() * J_point;
+      Eigen::Map<Mat23>(J_point_.begin() + k * 6) = J_point;
+      Eigen::Map<Vec2>(r_.begin() + k * 2) = r;
+    }
+    const int b = camera_block_[i];
+    if (b >= 0) {
+      Eigen::Map<MatCC>(U_.begin() + b * C * C) = U;
+      Eigen::Map<VecC>(g_camera_.begin() + b * C) = g;
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int j = 0; j < num_points_; ++j) {
+    Mat3 V = Mat3::Zero();
+    Vec3 g = Vec3::Zero();
+    for (int p = point_begin_[j]; p < point_begin_[j + 1]; ++p) {
+      const int k = point_observations_[p];
+      Eigen::Map<const Mat23> J_point(&J_point_[k * 6]);
+      Eigen::Map<const Vec2> r(&r_[k * 2]);
+      V.noalias() += J_point.transpose() * J_point;
+      g.noalias() += J_point.transpose() * r;
+    }
+    Eigen::Map<Mat3>(V_.begin() + j * 9) = V;
+    Eigen::Map<Vec3>(g_point_.begin() + j * 3) = g;
+  }
+  *squared_error = error;
+  return cost;
+}
+
+template <int NI>
+double SchurBundleAdjuster<NI>::Cost(const vector<BundleCamera> &cameras,
+                                     const Mat3X &X,
+                                     double *squared_error) const {
+  const RobustLoss &loss = options_.loss;
+  double cost = 0, error = 0;
+#pragma omp parallel for schedule(dynamic, 4) reduction(+:cost, error)
+  for (int i = 0; i < num_cameras_; ++i) {
+    for (int k = camera_begin_[i]; k < camera_begin_[i + 1]; ++k) {
+      Vec2 r = Residual<NI>(cameras[i], X.col(point_[k]), &x_[2 * k],
+                            NULL, NULL);
+      const double s = r.squaredNorm();
+      cost += 0.5 * loss.Cost(s);
+      error += s;
+    }
+  }
+  *squared_error = error;
+  return cost;
+}
+
+template <int NI>
+double SchurBundleAdjuster<NI>::MaxGradient() const {
+  double max_gradient = 0;
+  Vec g_columns;
+  GatherColumns(g_camera_.begin(), &g_columns);
+  for (int c = 0; c < num_columns_; ++c) {
+    max_gradient = std::max(max_gradient, std::fabs(g_columns(c)));
+  }
+  for (int i = 0; i < g_point_.size(); ++i) {
+    max_gradient = std::max(max_gradient, std::fabs(g_point_[i]));
+  }
+  return max_gradient;
+}
+
+// Levenberg-Marquardt damping of a diagonal entry of J^T J. The lower bound
+// keeps the unconstrained directions, e.g. of a point seen once, invertible.
+inline double Damped(double diagonal, double lambda) {
+  return diagonal + lambda * std::max(diagonal, 1e-6);
+}
+
+template <int NI>
+bool SchurBundleAdjuster<NI>::ComputeStep(double lambda,
+                                          Vec *delta_cameras,
+                                          Mat3X *delta_points) {
+  V_inverse_.resize(num_points_ * 9);
+  rhs_.resize(num_block_rows_ * C);
+#pragma omp parallel for schedule(static)
+  for (int j = 0; j < num_points_; ++j) {
+    Mat3 V = Eigen::Map<const Mat3>(&V_[j * 9]);
+    for (int d = 0; d < 3; ++d) {
+      V(d, d) = Damped(V(d, d), lambda);
+    }
+    Eigen::Map<Mat3>(V_inverse_.begin() + j * 9) = V.inverse();
+  }
+
+  // Levenberg-Marquardt damping of the columns, from the diagonal of J^T J.
+  damping_.resize(num_columns_);
+  std::fill(damping_.begin(), damping_.end(), 0.0);
+  for (int p = 0; p < num_block_rows_ * C; ++p) {
+    if (columns_[p] >= 0) {
+      damping_[columns_[p]] += U_[(p / C) * C * C + (p % C) * (C + 1)];
+    }
+  }
+  for (int c = 0; c < num_columns_; ++c) {
+    damping_[c] = Damped(damping_[c], lambda) - damping_[c];
+  }
+
+  Vec columns;
+  bool solved = options_.linear_solver == eBUNDLE_ITERATIVE_SCHUR ?
+                SolveReducedSystemIterative(&columns) :
+                SolveReducedSystemDirect(&columns);
+  if (!solved) {
+    return false;
+  }
+  ExpandColumns(columns, delta_cameras);
+
+  // Back substitution: dp = V^-1 (-g_p - W^T dc).
+  delta_points->resize(3, num_points_);
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int j = 0; j < num_points_; ++j) {
+    Vec3 b = -Eigen::Map<const Vec3>(&g_point_[j * 3]);
+    for (int p = point_begin_[j]; p < point_begin_[j + 1]; ++p) {
+      const int k = point_observations_[p];
+      if (block_[k] >= 0) {
+        b.noalias() -= Eigen::Map<const MatC3>(&W_[k * C * 3]).transpose() *
+                       delta_cameras->template segment<C>(block_[k] * C);
+      }
+    }
+    delta_points->col(j) = Eigen::Map<const Mat3>(&V_inverse_[j * 9]) * b;
+  }
+  return true;
+}
+
+template <int NI>
+bool SchurBundleAdjuster<NI>::SolveReducedSystemDirect(Vec *columns) {
+  // S = U - W V^-1 W^T and its right hand side -g_c + W V^-1 g_p, one block
+  // row per thread.
+#pragma omp parallel for schedule(dynamic, 4)
+  for (int r = 0; r < num_block_rows_; ++r) {
+    const int i = block_camera_[r];
+    for (int b = row_begin_[r]; b < row_begin_[r + 1]; ++b) {
+      Eigen::Map<MatCC>(&S_[b * C * C]).setZero();
+    }
+    Eigen::Map<MatCC> S_rr(&S_[row_begin_[r] * C * C]);
+    S_rr = Eigen::Map<const MatCC>(&U_[r * C * C]);
+    VecC rhs = -Eigen::Map<const VecC>(&g_camera_[r * C]);
+    int pair = pair_begin_[r];
+    for (int k = camera_begin_[i]; k < camera_begin_[i + 1]; ++k) {
+      const int j = point_[k];
+      const MatC3 Y = Eigen::Map<const MatC3>(&W_[k * C * 3]) *
+                      Eigen::Map<const Mat3>(&V_inverse_[j * 9]);
+      rhs.noalias() += Y * Eigen::Map<const Vec3>(&g_point_[j * 3]);
+      for (int p = point_begin_[j]; p < point_begin_[j + 1]; ++p) {
+        const int l = point_observations_[p];
+        if (block_[l] >= r) {
+          Eigen::Map<MatCC>(&S_[pair_block_[pair++] * C * C]).noalias() -=
+              Y * Eigen::Map<const MatC3>(&W_[l * C * 3]).transpose();
+        }
+      }
+    }
+    Eigen::Map<VecC>(rhs_.begin() + r * C) = rhs;
+  }
+
+  // Add into the compressed columns, one block row per thread unless some
+  // columns are shared by several blocks, then damp the diagonal.
+  const int n = num_columns_;
+  std::fill(Ax_.begin(), Ax_.end(), 0.0);
+#pragma omp parallel for schedule(dynamic, 4) if (!shared_columns_)
+  for (int r = 0; r < num_block_rows_; ++r) {
+    for (int b = row_begin_[r]; b < row_begin_[r + 1]; ++b) {
+      const double *block = &S_[b * C * C];
+      const int *upper = &targets_[2 * b * C * C];
+      const int *lower = upper + C * C;
+      for (int e = 0; e < C * C; ++e) {
+        if (upper[e] >= 0) {
+          Ax_[upper[e]] += block[e];
+        }
+        if (lower[e] >= 0) {
+          Ax_[lower[e]] += block[e];
+        }
+      }
+    }
+  }
+  for (int c = 0; c < n; ++c) {
+    Ax_[diagonal_[c]] += damping_[c];
+  }
+
+  int rank = ldl_numeric(n, Ap_.begin(), Ai_.begin(), Ax_.begin(),
+                         Lp_.begin(), Parent_.begin(), Lnz_.begin(),
+                         Li_.begin(), Lx_.begin(), D_.begin(), Y_.begin(),
+                         Pattern_.begin(), Flag_.begin(), P_.begin(),
+                         Pinv_.begin());
+  if (rank != n) {
+    VLOG(2) << "Reduced camera system not positive definite (rank " << rank
+            << " of " << n << ").";
+    return false;
+  }
+  Vec b;
+  GatherColumns(rhs_.begin(), &b);
+  columns->resize(n);
+  ldl_perm(n, Y_.begin(), b.data(), P_.begin());
+  ldl_lsolve(n, Y_.begin(), Lp_.begin(), Li_.begin(), Lx_.begin());
+  ldl_dsolve(n, Y_.begin(), D_.begin());
+  ldl_ltsolve(n, Y_.begin(), Lp_.begin(), Li_.begin(), Lx_.begin());
+  ldl_permt(n, columns->data(), Y_.begin(), P_.begin());
+  return true;
+}
+
+template <int NI>
+bool SchurBundleAdjuster<NI>::SolveReducedSystemIterative(Vec *columns) {
+  const int n = num_columns_;
+  preconditioner_.resize(num_block_rows_ * C * C);
+  preconditioner_diagonal_.resize(num_block_rows_ * C);
+  point_product_.resize(num_points_ * 3);
+
+  // Right hand side -g_c + W V^-1 g_p, and the preconditioner: the inverse
+  // of the damped U blocks, minus W V^-1 W^T of the camera for Schur-Jacobi,
+  // over the columns of the block alone.
+#pragma omp parallel for schedule(dynamic, 4)
+  for (int r = 0; r < num_block_rows_; ++r) {
+    const int i = block_camera_[r];
+    MatCC M = Eigen::Map<const MatCC>(&U_[r * C * C]);
+    VecC rhs = -Eigen::Map<const VecC>(&g_camera_[r * C]);
+    for (int k = camera_begin_[i]; k < camera_begin_[i + 1]; ++k) {
+      const int j = point_[k];
+      const MatC3 Y = Eigen::Map<const MatC3>(&W_[k * C * 3]) *
+                      Eigen::Map<const Mat3>(&V_inverse_[j * 9]);
+      rhs.noalias() += Y * Eigen::Map<const Vec3>(&g_point_[j * 3]);
+      if (options_.preconditioner == eBUNDLE_SCHUR_JACOBI) {
+        for (int p = point_begin_[j]; p < point_begin_[j + 1]; ++p) {
+          const int l = point_observations_[p];
+          if (block_[l] == r) {
+            M.noalias() -=
+                Y * Eigen::Map<const MatC3>(&W_[l * C * 3]).transpose();
+          }
+        }
+      }
+    }
+    Eigen::Map<VecC>(rhs_.begin() + r * C) = rhs;
+    int own[C];
+    int num_own = 0;
+    for (int d = 0; d < C; ++d) {
+      const int column = columns_[r * C + d];
+      preconditioner_diagonal_[r * C + d] = M(d, d);
+      if (column >= 0 && column_count_[column] == 1) {
+        M(d, d) += damping_[column];
+        own[num_own++] = d;
+      }
+    }
+    Eigen::Map<MatCC> inverse(preconditioner_.begin() + r * C * C);
+    inverse.setZero();
+    if (num_own == C) {
+      inverse = M.llt().solve(MatCC::Identity());
+    } else if (num_own > 0) {
+      Mat M_own(num_own, num_own);
+      for (int a = 0; a < num_own; ++a) {
+        for (int d = 0; d < num_own; ++d) {
+          M_own(a, d) = M(own[a], own[d]);
+        }
+      }
+      const Mat M_own_inverse =
+          M_own.llt().solve(Mat::Identity(num_own, num_own));
+      for (int a = 0; a < num_own; ++a) {
+        for (int d = 0; d < num_own; ++d) {
+          inverse(own[a], own[d]) = M_own_inverse(a, d);
+        }
+      }
+    }
+  }
+  // The diagonal of the blocks, summed, for the shared columns.
+  shared_inverse_.resize(n);
+  if (shared_columns_) {
+    std::fill(shared_inverse_.begin(), shared_inverse_.end(), 0.0);
+    for (int p = 0; p < num_block_rows_ * C; ++p) {
+      const int column = columns_[p];
+      if (column >= 0 && column_count_[column] > 1) {
+        shared_inverse_[column] += preconditioner_diagonal_[p];
+      }
+    }
+    for (int c = 0; c < n; ++c) {
+      if (column_count_[c] > 1) {
+        shared_inverse_[c] = 1 / (shared_inverse_[c] + damping_[c]);
+      }
+    }
+  }
+
+  Vec b;
+  GatherColumns(rhs_.begin(), &b);
+  const double b_norm = b.norm();
+  columns->setZero(n);
+  if (b_norm == 0) {
+    return true;
+  }
+  Vec residual = b, z, p, q;
+  ApplyPreconditioner(residual, &z);
+  p = z;
+  double residual_z = residual.dot(z);
+  int iteration = 0;
+  while (iteration < options_.max_linear_iterations) {
+    MultiplyReducedSystem(p, &q);
+    const double curvature = p.dot(q);
+    if (!(curvature > 0)) {
+      VLOG(2) << "Reduced camera system not positive definite.";
+      if (iteration == 0) {
+        return false;
+      }
+      break;
+    }
+    ++iteration;
+    const double alpha = residual_z / curvature;
+    *columns += alpha * p;
+    residual -= alpha * q;
+    if (residual.norm() < options_.linear_tolerance * b_norm) {
+      break;
+    }
+    ApplyPreconditioner(residual, &z);
+    const double previous_residual_z = residual_z;
+    residual_z = residual.dot(z);
+    p = z + (residual_z / previous_residual_z) * p;
+  }
+  VLOG(3) << "Conjugate gradients: " << iteration << " iterations, relative "
+          << "residual " << residual.norm() / b_norm;
+  num_linear_iterations_ += iteration;
+  return true;
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::MultiplyReducedSystem(const Vec &x, Vec *y) {
+  ExpandColumns(x, &x_blocks_);
+
+  // V^-1 W^T x, one point per thread.
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int j = 0; j < num_points_; ++j) {
+    Vec3 t = Vec3::Zero();
+    for (int p = point_begin_[j]; p < point_begin_[j + 1]; ++p) {
+      const int k = point_observations_[p];
+      if (block_[k] >= 0) {
+        t.noalias() += Eigen::Map<const MatC3>(&W_[k * C * 3]).transpose() *
+                       x_blocks_.template segment<C>(block_[k] * C);
+      }
+    }
+    Eigen::Map<Vec3>(point_product_.begin() + j * 3) =
+        Eigen::Map<const Mat3>(&V_inverse_[j * 9]) * t;
+  }
+
+  // U x - W (V^-1 W^T x), one camera per thread.
+  y_blocks_.resize(num_block_rows_ * C);
+#pragma omp parallel for schedule(dynamic, 4)
+  for (int r = 0; r < num_block_rows_; ++r) {
+    const int i = block_camera_[r];
+    VecC y_r = Eigen::Map<const MatCC>(&U_[r * C * C]) *
+               x_blocks_.template segment<C>(r * C);
+    for (int k = camera_begin_[i]; k < camera_begin_[i + 1]; ++k) {
+      y_r.noalias() -= Eigen::Map<const MatC3>(&W_[k * C * 3]) *
+                       Eigen::Map<const Vec3>(&point_product_[point_[k] * 3]);
+    }
+    y_blocks_.template segment<C>(r * C) = y_r;
+  }
+  GatherColumns(y_blocks_.data(), y);
+  *y += Eigen::Map<const Vec>(damping_.begin(), x.rows()).cwiseProduct(x);
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::ApplyPreconditioner(const Vec &x,
+                                                  Vec *y) const {
+  y->resize(x.rows());
+#pragma omp parallel for schedule(static)
+  for (int r = 0; r < num_block_rows_; ++r) {
+    VecC x_r;
+    for (int a = 0; a < C; ++a) {
+      const int column = columns_[r * C + a];
+      x_r(a) = column >= 0 && column_count_[column] == 1 ? x(column) : 0;
+    }
+    const VecC y_r = Eigen::Map<const MatCC>(&preconditioner_[r * C * C]) *
+                     x_r;
+    for (int a = 0; a < C; ++a) {
+      const int column = columns_[r * C + a];
+      if (column >= 0 && column_count_[column] == 1) {
+        (*y)(column) = y_r(a);
+      }
+    }
+  }
+  if (shared_columns_) {
+    for (int c = 0; c < x.rows(); ++c) {
+      if (column_count_[c] > 1) {
+        (*y)(c) = shared_inverse_[c] * x(c);
+      }
+    }
+  }
+}
+
+template <int NI>
+double SchurBundleAdjuster<NI>::PredictedDecrease(
+    const Vec &delta_cameras, const Mat3X &delta_points) const {
+  // -g^T h - 1/2 h^T J^T J h, with the blocks U, W and V of J^T J.
+  double gradient = 0, curvature = 0;
+  for (int r = 0; r < num_block_rows_; ++r) {
+    const VecC h = delta_cameras.template segment<C>(r * C);
+    gradient += Eigen::Map<const VecC>(&g_camera_[r * C]).dot(h);
+    curvature += h.dot(Eigen::Map<const MatCC>(&U_[r * C * C]) * h);
+  }
+#pragma omp parallel for schedule(static) reduction(+:gradient, curvature)
+  for (int j = 0; j < num_points_; ++j) {
+    const Vec3 h = delta_points.col(j);
+    gradient += Eigen::Map<const Vec3>(&g_point_[j * 3]).dot(h);
+    curvature += h.dot(Eigen::Map<const Mat3>(&V_[j * 9]) * h);
+  }
+#pragma omp parallel for schedule(static) reduction(+:curvature)
+  for (int k = 0; k < num_observations_; ++k) {
+    if (block_[k] >= 0) {
+      const Vec3 h = delta_points.col(point_[k]);
+      curvature += 2 * delta_cameras.template segment<C>(block_[k] * C).dot(
+          Eigen::Map<const MatC3>(&W_[k * C * 3]) * h);
+    }
+  }
+  return -gradient - 0.5 * curvature;
+}
+
+template <int NI>
+void SchurBundleAdjuster<NI>::Solve(vector<BundleCamera> *cameras,
+                                    Mat3X *X,
+                                    BundleSummary *summary) {
+  const BundleOptions &options = options_;
+  const double num_residuals = std::max(1, num_observations_);
+  if (options.linear_solver == eBUNDLE_SPARSE_SCHUR) {
+    summary->reduced_system_nonzeros = Ap_.back();
+    summary->factor_nonzeros = Lp_.back();
+  }
+  num_linear_iterations_ = 0;
+  ShareIntrinsics(cameras);
+  WallTimer timer;
+  double squared_error;
+  double cost = Linearize(*cameras, *X, &squared_error);
+  summary->jacobian_time += timer.Seconds();
+  summary->initial_cost = cost;
+  summary->initial_rms = std::sqrt(squared_error / num_residuals);
+  VLOG(2) << "Initial RMS: " << summary->initial_rms;
+
+  double lambda = lambda_;
+  vector<BundleCamera> candidate_cameras;
+  Mat3X candidate_X;
+  Vec delta_cameras;
+  Mat3X delta_points;
+  for (int iteration = 0; iteration < options.max_iterations; ++iteration) {
+    BundleIterationSummary trace;
+    trace.iteration = iteration;
+    trace.gradient_max_norm = MaxGradient();
+    trace.lambda = lambda;
+    if (trace.gradient_max_norm < options.gradient_tolerance) {
+      VLOG(2) << "Gradient tolerance reached.";
+      break;
+    }
+    summary->num_iterations++;
+    const int num_linear_iterations = num_linear_iterations_;
+    timer.Start();
+    const bool solved = ComputeStep(lambda, &delta_cameras, &delta_points);
+    trace.linear_solver_time = timer.Seconds();
+    trace.linear_iterations = num_linear_iterations_ - num_linear_iterations;
+
+    bool stop = false;
+    if (solved) {
+      double parameters_norm2 = X->squaredNorm();
+      for (int r = 0; r < num_block_rows_; ++r) {
+        const BundleCamera &camera = (*cameras)[block_camera_[r]];
+        parameters_norm2 += camera.t.squaredNorm();
+        parameters_norm2 += NI >= 1 ? Square(camera.f) : 0;
+        parameters_norm2 += NI == 3 ? Square(camera.cx) + Square(camera.cy)
+                                    : 0;
+      }
+      trace.step_norm = std::sqrt(delta_cameras.squaredNorm() +
+                                  delta_points.squaredNorm());
+      if (trace.step_norm < options.parameter_tolerance *
+          (std::sqrt(parameters_norm2) + options.parameter_tolerance)) {
+        VLOG(2) << "Parameter tolerance reached.";
+        stop = true;
+      }
+    }
+
+    if (solved && !stop) {
+      candidate_cameras = *cameras;
+      for (int r = 0; r < num_block_rows_; ++r) {
+        const int i = block_camera_[r];
+        UpdateCamera<NI>((*cameras)[i], &delta_cameras(r * C),
+                         &candidate_cameras[i]);
+      }
+      candidate_X = *X + delta_points;
+      timer.Start();
+      double candidate_squared_error;
+      double candidate_cost = Cost(candidate_cameras, candidate_X,
+                                   &candidate_squared_error);
+      trace.residual_time = timer.Seconds();
+      // A zero predicted decrease, e.g. for a zero step, records a quality
+      // of 0 rather than a non-finite ratio.
+      const double predicted_decrease = PredictedDecrease(delta_cameras,
+                                                          delta_points);
+      trace.step_quality = predicted_decrease != 0 ?
+          (cost - candidate_cost) / predicted_decrease : 0;
+      VLOG(3) << "Iteration " << iteration << ": lambda " << lambda
+              << ", cost " << cost << " -> " << candidate_cost;
+      if (candidate_cost < cost) {
+        const double relative_decrease = (cost - candidate_cost) / cost;
+        trace.step_is_successful = true;
+        trace.cost_change = cost - candidate_cost;
+        cameras->swap(candidate_cameras);
+        std::swap(*X, candidate_X);
+        cost = candidate_cost;
+        squared_error = candidate_squared_error;
+        lambda = std::max(lambda / 10, 1e-16);
+        summary->num_successful_iterations++;
+        if (relative_decrease < options.function_tolerance) {
+          VLOG(2) << "Function tolerance reached.";
+          stop = true;
+        } else {
+          timer.Start();
+          cost = Linearize(*cameras, *X, &squared_error);
+          trace.jacobian_time = timer.Seconds();
+        }
+      } else {
+        lambda *= 10;
+      }
+    } else if (!solved) {
+      lambda *= 10;
+    }
+    if (lambda > 1e16) {
+      VLOG(2) << "Damping too large.";
+      stop = true;
+    }
+
+    trace.cost = cost;
+    summary->jacobian_time += trace.jacobian_time;
+    summary->linear_solver_time += trace.linear_solver_time;
+    summary->residual_time += trace.residual_time;
+    summary->iterations.push_back(trace);
+    if (options.callback && !(*options.callback)(trace)) {
+      VLOG(2) << "Stopped by the callback.";
+      stop = true;
+    }
+    if (stop) {
+      break;
+    }
+  }
+  lambda_ = lambda;
+  summary->num_linear_iterations = num_linear_iterations_;
+  summary->final_cost = cost;
+  summary->final_rms = std::sqrt(squared_error / num_residuals);
+  VLOG(2) << "Final RMS: " << summary->final_rms << " after "
+          << summary->num_iterations << " iterations.";
+}
+
+BundleAdjuster *NewBundleAdjuster(const vector<Mat2X> &x,
+                                  const vector<Vecu> &x_ids,
+                                  int num_points,
+                                  const BundleOptions &options,
+                                  const vector<int> *camera_ordering = NULL) {
+  switch (options.type) {
+    case eBUNDLE_METRIC:
+      return new SchurBundleAdjuster<0>(x, x_ids, num_points, options,
+                                        camera_ordering);
+    case eBUNDLE_FOCAL_LENGTH:
+      return new SchurBundleAdjuster<1>(x, x_ids, num_points, options,
+                                        camera_ordering);
+    default:
+      return new SchurBundleAdjuster<3>(x, x_ids, num_points, options,
+                                        camera_ordering);
+  }
+}
+
+}  // namespace
+
+double EuclideanBA(const vector<Mat2X> &x,
+                   const vector<Vecu> &x_ids,
+                   vector<Mat3> *Ks,
+                   vector<Mat3> *Rs,
+                   vector<Vec3> *ts,
+                   Mat3X *X,
+                   const BundleOptions &options,
+                   BundleSummary *summary) {
+  const int num_cameras = Rs->size();
+  CHECK_EQ(x.size(), num_cameras);
+  CHECK_EQ(x_ids.size(), num_cameras);
+  CHECK_EQ(Ks->size(), num_cameras);
+  CHECK_EQ(ts->size(), num_cameras);
+
+  vector<BundleCamera> cameras(num_cameras);
+  for (int i = 0; i < num_cameras; ++i) {
+    ToBundleCamera((*Ks)[i], (*Rs)[i], (*ts)[i], &cameras[i]);
+  }
+  BundleSummary local_summary;
+  if (!summary) {
+    summary = &local_summary;
+  }
+  *summary = BundleSummary();
+  WallTimer timer;
+  scoped_ptr<BundleAdjuster> bundle(
+      NewBundleAdjuster(x, x_ids, X->cols(), options));
+  bundle->Solve(&cameras, X, summary);
+  summary->total_time = timer.Seconds();
+  for (int i = 0; i < num_cameras; ++i) {
+    FromBundleCamera(cameras[i], &(*Ks)[i], &(*Rs)[i], &(*ts)[i]);
+  }
+  return summary->final_rms;
+}
+
+// An observation of a BundleProblem. The observations of a camera and the
+// ones of a point are chained in doubly linked lists, so that they can be
+// removed in O(1).
+struct BundleObservation {
+  int camera;        // -1 once removed.
+  int point;
+  Vec2 x;
+  int next_in_camera, previous_in_camera;
+  int next_in_point, previous_in_point;
+};
+
+class BundleProblemImpl {
+ public:
+  BundleProblemImpl(const BundleOptions &options)
+    : options(options),
+      num_cameras(0),
+      num_points(0),
+      num_observations(0),
+      adjuster(NULL),
+      lambda(options.initial_lambda),
+      num_appended_cameras(0) {}
+
+  // Unlinks the observation k from its camera and its point.
+  void Unlink(int k);
+  // Sets up the solver of the current observations.
+  void Build();
+
+  BundleOptions options;
+
+  // Slots of the cameras, points and observations. The removed ones are
+  // kept in free lists, reused by the next additions.
+  vector<BundleCamera> cameras;
+  vector<char> camera_alive, camera_constant;
+  vector<int> camera_observations;  // First observation, or -1.
+  vector<int> free_cameras;
+  vector<Vec3> points;
+  vector<char> point_alive;
+  vector<int> point_observations;   // First observation, or -1.
+  vector<int> free_points;
+  vector<BundleObservation> observations;
+  vector<int> free_observations;
+  int num_cameras, num_points, num_observations;
+
+  // Set up by Build(), NULL if the problem changed since.
+  scoped_ptr<BundleAdjuster> adjuster;
+  double lambda;
+  // The elimination order of the last solver, and whether each camera slot
+  // is in it and still holds the same camera.
+  vector<int> camera_ordering;
+  vector<char> camera_ordered;
+  // Cameras appended to the ordering since SYMAMD was last run.
+  int num_appended_cameras;
+};
+
+void BundleProblemImpl::Unlink(int k) {
+  BundleObservation &observation = observations[k];
+  if (observation.previous_in_camera >= 0) {
+    observations[observation.previous_in_camera].next_in_camera =
+        observation.next_in_camera;
+  } else {
+    camera_observations[observation.camera] = observation.next_in_camera;
+  }
+  if (observation.next_in_camera >= 0) {
+    observations[observation.next_in_camera].previous_in_camera =
+        observation.previous_in_camera;
+  }
+  if (observation.previous_in_point >= 0) {
+    observations[observation.previous_in_point].next_in_point =
+        observation.next_in_point;
+  } else {
+    point_observations[observation.point] = observation.next_in_point;
+  }
+  if (observation.next_in_point >= 0) {
+    observations[observation.next_in_point].previous_in_point =
+        observation.previous_in_point;
+  }
+  observation.camera = -1;
+  free_observations.push_back(k);
+  num_observations--;
+  adjuster.reset(NULL);
+}
+
+void BundleProblemImpl::Build() {
+  // The solver sees every slot; the removed cameras are constant and have no
+  // observations, and neither do the removed points.
+  const int num_camera_slots = cameras.size();
+  vector<Mat2X> x(num_camera_slots);
+  vector<Vecu> x_ids(num_camera_slots);
+  BundleOptions solver_options = options;
+  solver_options.constant_cameras.resize(0);
+  solver_options.intrinsics_groups.resize(0);
+  solver_options.constant_camera_parameters.resize(0);
+  solver_options.constant_intrinsics.resize(0);
+  for (int i = 0; i < num_camera_slots; ++i) {
+    if (!camera_alive[i] || camera_constant[i]) {
+      solver_options.constant_cameras.push_back(i);
+    }
+    int num_camera_observations = 0;
+    for (int k = camera_observations[i]; k >= 0;
+         k = observations[k].next_in_camera) {
+      num_camera_observations++;
+    }
+    x[i].resize(2, num_camera_observations);
+    x_ids[i].resize(num_camera_observations);
+    int c = 0;
+    for (int k = camera_observations[i]; k >= 0;
+         k = observations[k].next_in_camera, ++c) {
+      x[i].col(c) = observations[k].x;
+      x_ids[i](c) = observations[k].point;
+    }
+  }
+
+  // Keeps the previous ordering and eliminates the new cameras last.
+  vector<int> ordering;
+  bool keep_ordering = false;
+  if (options.linear_solver == eBUNDLE_SPARSE_SCHUR &&
+      camera_ordering.size()) {
+    vector<char> in_ordering(num_camera_slots, 0);
+    for (int k = 0; k < camera_ordering.size(); ++k) {
+      const int i = camera_ordering[k];
+      if (camera_ordered[i] && camera_alive[i] && !camera_constant[i]) {
+        ordering.push_back(i);
+        in_ordering[i] = 1;
+      }
+    }
+    const int num_kept = ordering.size();
+    for (int i = 0; i < num_camera_slots; ++i) {
+      if (!in_ordering[i] && camera_alive[i] && !camera_constant[i]) {
+        ordering.push_back(i);
+      }
+    }
+    const int num_appended = ordering.size() - num_kept;
+    keep_ordering = 4 * (num_appended_cameras + num_appended) <=
+                    ordering.size();
+    num_appended_cameras = keep_ordering ?
+                           num_appended_cameras + num_appended : 0;
+  }
+  adjuster.reset(NewBundleAdjuster(x, x_ids, points.size(), solver_options,
+                                   keep_ordering ? &ordering : NULL));
+  adjuster->GetCameraOrdering(&camera_ordering);
+  camera_ordered.resize(num_camera_slots);
+  std::fill(camera_ordered.begin(), camera_ordered.end(), 0);
+  for (int k = 0; k < camera_ordering.size(); ++k) {
+    camera_ordered[camera_ordering[k]] = 1;
+  }
+  VLOG(2) << "Bundle problem set up with " << num_cameras << " cameras, "
+          << num_points << " points and " << num_observations
+          << " observations, " << (keep_ordering ? "keeping" : "computing")
+          << " the camera ordering.";
+}
+
+BundleProblem::BundleProblem(const BundleOptions &options)
+    : impl_(new BundleProblemImpl(options)) {
+}
+
+BundleProblem::~BundleProblem() {
+  delete impl_;
+}
+
+int BundleProblem::AddCamera(const Mat3 &K, const Mat3 &R, const Vec3 &t) {
+  int camera;
+  if (impl_->free_cameras.size()) {
+    camera = impl_->free_cameras.back();
+    impl_->free_cameras.pop_back();
+  } else {
+    camera = impl_->cameras.size();
+    impl_->cameras.push_back(BundleCamera());
+    impl_->camera_alive.push_back(0);
+    impl_->camera_constant.push_back(0);
+    impl_->camera_observations.push_back(-1);
+    impl_->camera_ordered.push_back(0);
+  }
+  ToBundleCamera(K, R, t, &impl_->cameras[camera]);
+  impl_->camera_alive[camera] = 1;
+  impl_->camera_constant[camera] = 0;
+  impl_->camera_ordered[camera] = 0;
+  impl_->num_cameras++;
+  impl_->adjuster.reset(NULL);
+  return camera;
+}
+
+void BundleProblem::RemoveCamera(int camera) {
+  CHECK(impl_->camera_alive[camera]);
+  while (impl_->camera_observations[camera] >= 0) {
+    impl_->Unlink(impl_->camera_observations[camera]);
+  }
+  impl_->camera_alive[camera] = 0;
+  impl_->camera_ordered[camera] = 0;
+  impl_->free_cameras.push_back(camera);
+  impl_->num_cameras--;
+  impl_->adjuster.reset(NULL);
+}
+
+void BundleProblem::SetCamera(int camera,
+                              const Mat3 &K, const Mat3 &R, const Vec3 &t) {
+  CHECK(impl_->camera_alive[camera]);
+  ToBundleCamera(K, R, t, &impl_->cameras[camera]);
+}
+
+void BundleProblem::GetCamera(int camera, Mat3 *K, Mat3 *R, Vec3 *t) const {
+  CHECK(impl_->camera_alive[camera]);
+  FromBundleCamera(impl_->cameras[camera], K, R, t);
+}
+
+void BundleProblem::SetCameraConstant(int camera, bool constant) {
+  CHECK(impl_->camera_alive[camera]);
+  if (impl_->camera_constant[camera] != constant) {
+    impl_->camera_constant[camera] = constant;
+    impl_->adjuster.reset(NULL);
+  }
+}
+
+int BundleProblem::AddPoint(const Vec3 &X) {
+  int point;
+  if (impl_->free_points.size()) {
+    point = impl_->free_points.back();
+    impl_->free_points.pop_back();
+    impl_->points[point] = X;
+  } else {
+    point = impl_->points.size();
+    impl_->points.push_back(X);
+    impl_->point_alive.push_back(0);
+    impl_->point_observations.push_back(-1);
+    impl_->adjuster.reset(NULL);
+  }
+  impl_->point_alive[point] = 1;
+  impl_->num_points++;
+  return point;
+}
+
+void BundleProblem::RemovePoint(int point) {
+  CHECK(impl_->point_alive[point]);
+  while (impl_->point_observations[point] >= 0) {
+    impl_->Unlink(impl_->point_observations[point]);
+  }
+  impl_->point_alive[point] = 0;
+  impl_->free_points.push_back(point);
+  impl_->num_points--;
+}
+
+void BundleProblem::SetPoint(int point, const Vec3 &X) {
+  CHECK(impl_->point_alive[point]);
+  impl_->points[point] = X;
+}
+
+Vec3 BundleProblem::GetPoint(int point) const {
+  CHECK(impl_->point_alive[point]);
+  return impl_->points[point];
+}
+
+int BundleProblem::AddObservation(int camera, int point, const Vec2 &x) {
+  CHECK(impl_->camera_alive[camera]);
+  CHECK(impl_->point_alive[point]);
+  int k;
+  if (impl_->free_observations.size()) {
+    k = impl_->free_observations.back();
+    impl_->free_observations.pop_back();
+  } else {
+    k = impl_->observations.size();
+    impl_->observations.push_back(BundleObservation());
+  }
+  BundleObservation &observation = impl_->observations[k];
+  observation.camera = camera;
+  observation.point = point;
+  observation.x = x;
+  observation.previous_in_camera = -1;
+  observation.next_in_camera = impl_->camera_observations[camera];
+  if (observation.next_in_camera >= 0) {
+    impl_->observations[observation.next_in_camera].previous_in_camera = k;
+  }
+  impl_->camera_observations[camera] = k;
+  observation.previous_in_point = -1;
+  observation.next_in_point = impl_->point_observations[point];
+  if (observation.next_in_point >= 0) {
+    impl_->observations[observation.next_in_point].previous_in_point = k;
+  }
+  impl_->point_observations[point] = k;
+  impl_->num_observations++;
+  impl_->adjuster.reset(NULL);
+  return k;
+}
+
+void BundleProblem::RemoveObservation(int observation) {
+  CHECK_GE(impl_->observations[observation].camera, 0);
+  impl_->Unlink(observation);
+}
+
+int BundleProblem::num_cameras() const {
+  return impl_->num_cameras;
+}
+
+int BundleProblem::num_points() const {
+  return impl_->num_points;
+}
+
+int BundleProblem::num_observations() const {
+  return impl_->num_observations;
+}
+
+double BundleProblem::Solve(BundleSummary *summary) {
+  BundleSummary local_summary;
+  if (!summary) {
+    summary = &local_summary;
+  }
+  *summary = BundleSummary();
+  WallTimer timer;
+  if (!impl_->adjuster.get()) {
+    impl_->Build();
+  }
+  // A converged solve ends with a tiny damping, which would make the first
+  // steps of the next one fail if the problem changed a lot in between.
+  const double kMinimumWarmLambda = 1e-4;
+  impl_->adjuster->set_lambda(std::max(
+      impl_->lambda, kMinimumWarmLambda * impl_->options.initial_lambda));
+
+  const int num_point_slots = impl_->points.size();
+  Mat3X X(3, num_point_slots);
+  for (int j = 0; j < num_point_slots; ++j) {
+    X.col(j) = impl_->points[j];
+  }
+  impl_->adjuster->Solve(&impl_->cameras, &X, summary);
+  for (int j = 0; j < num_point_slots; ++j) {
+    impl_->points[j] = X.col(j);
+  }
+  impl_->lambda = impl_->adjuster->lambda();
+  summary->total_time = timer.Seconds();
+  return summary->final_rms;
+}
+
+}  // namespace libmv
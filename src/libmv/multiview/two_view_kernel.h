@@ -97,6 +97,10 @@ struct IsotropicNormalizedSolver {
 //   3. Kernel::Fit(vector<int>, vector<Kernel::Model> *)
 //   4. Kernel::Error(int, Model) -> error
 //
+// Kernels may also offer Errors(Model, begin, end, double *errors), which
+// computes the errors of the samples [begin, end) in one pass; see
+// BatchMLEScorer.
+//
 // The fit routine must not clear existing entries in the vector of models; it
 // should append new solutions to the end.
 template<typename SolverArg,
@@ -104,20 +108,40 @@ template<typename SolverArg,
          typename ModelArg = Mat3>
 class Kernel {
  public:
-  Kernel(const Mat &x1, const Mat &x2) : x1_(x1), x2_(x2) {}
+  Kernel(const Mat &x1, const Mat &x2)
+    : x1_(x1), x2_(x2), rows_built_(false) {}
   typedef SolverArg Solver;
   typedef ModelArg  Model;
   enum { MINIMUM_SAMPLES = Solver::MINIMUM_SAMPLES };
   void Fit(const vector<int> &samples, vector<Model> *models) const {
-    Mat x1 = ExtractColumns(x1_, samples);
-    Mat x2 = ExtractColumns(x2_, samples);
-    Solver::Solve(x1, x2, models);
+    // The subsets have always the same size in a robust estimation loop, so
+    // the extracted columns reuse the storage of the previous call.
+    ExtractColumns(x1_, samples, &x1_samples_);
+    ExtractColumns(x2_, samples, &x2_samples_);
+    Solver::Solve(x1_samples_, x2_samples_, models);
   }
   double Error(int sample, const Model &model) const {
-    return ErrorArg::Error(model, 
+    // Euclidean points go through the fixed size path of the error functor,
+    // which does not touch the heap.
+    if (x1_.rows() == 2 && x2_.rows() == 2) {
+      const Vec2 x1(x1_(0, sample), x1_(1, sample));
+      const Vec2 x2(x2_(0, sample), x2_(1, sample));
+      return ErrorArg::Error(model, x1, x2);
+    }
+    return ErrorArg::Error(model,
                            static_cast<Vec>(x1_.col(sample)),
                            static_cast<Vec>(x2_.col(sample)));
   }
+  void Errors(const Model &model, int begin, int end, double *errors) const {
+    if (x1_.rows() == 2 && x2_.rows() == 2) {
+      BuildRows();
+      ErrorArg::Errors(model, x1_rows_, x2_rows_, begin, end, errors);
+    } else {
+      for (int i = begin; i < end; ++i) {
+        errors[i] = Error(i, model);
+      }
+    }
+  }
   int NumSamples() const {
     return x1_.cols();
   }
@@ -126,8 +150,25 @@ class Kernel {
     Solver::Solve(x1, x2, models);
   }
  protected:
+  // Copies the points to x1_rows_ and x2_rows_ on the first call, so that
+  // only the kernels scored by the batch error functors pay for it.
+  void BuildRows() const {
+    if (!rows_built_) {
+      x1_rows_ = x1_;
+      x2_rows_ = x2_;
+      rows_built_ = true;
+    }
+  }
+
   const Mat &x1_;
   const Mat &x2_;
+  // Row-major copies of the points for the batch error functors.
+  mutable RMat x1_rows_;
+  mutable RMat x2_rows_;
+  mutable bool rows_built_;
+  // Scratch space of Fit.
+  mutable Mat x1_samples_;
+  mutable Mat x2_samples_;
 };
 
 }  // namespace kernel
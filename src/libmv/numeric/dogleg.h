@@ -30,7 +30,6 @@
 #define LIBMV_NUMERIC_DOGLEG_H
 
 #include <cmath>
-#include <cstdio>
 
 #include "libmv/numeric/numeric.h"
 #include "libmv/numeric/function_derivative.h"
@@ -97,10 +96,17 @@ class Dogleg {
 
   Status Update(const Parameters &x, const SolverParameters &params,
                 JMatrixType *J, AMatrixType *A, FVec *error, Parameters *g) {
+    return Update(x, f_(x), params, J, A, error, g);
+  }
+
+  // Same as above when f(x) = fx is already known.
+  Status Update(const Parameters &x, const FVec &fx,
+                const SolverParameters &params,
+                JMatrixType *J, AMatrixType *A, FVec *error, Parameters *g) {
     *J = df_(x);
     // TODO(keir): In the case of m = n, avoid computing A and just do J^-1 directly.
     *A = (*J).transpose() * (*J);
-    *error = f_(x);
+    *error = fx;
     *g = (*J).transpose() * *error;
     if (g->array().abs().maxCoeff() < params.gradient_threshold) {
       return GRADIENT_TOO_SMALL;
@@ -154,7 +160,7 @@ class Dogleg {
     Parameters &x = *x_and_min;
     JMatrixType J;
     AMatrixType A;
-    FVec error;
+    FVec error, f_new;
     Parameters g;
 
     Results results;
@@ -167,16 +173,9 @@ class Dogleg {
     Parameters dx_sd;  // Steepest descent step.
     Parameters dx_dl;  // Dogleg step.
     Parameters dx_gn;  // Gauss-Newton step.
-      printf("iteration     ||f(x)||      max(g)       radius\n");
     int i = 0;
     for (; results.status == RUNNING && i < params.max_iterations; ++i) {
-      printf("%9d %12g %12g %12g",
-          i, f_(x).norm(), g.array().abs().maxCoeff(), radius);
-
-      //LG << "iteration: " << i;
-      //LG << "||f(x)||: " << f_(x).norm();
-      //LG << "max(g): " << g.cwise().abs().maxCoeff();
-      //LG << "radius: " << radius;
+      const Scalar error2 = error.squaredNorm();
       // Eqn 3.19 from [1]
       Scalar alpha = g.squaredNorm() / (J*g).squaredNorm();
 
@@ -209,28 +208,28 @@ class Dogleg {
       }
 
       x_new = x + dx_dl;
-      Scalar actual = f_(x).squaredNorm() - f_(x_new).squaredNorm();
+      f_new = f_(x_new);
+      Scalar actual = error2 - f_new.squaredNorm();
       Scalar predicted = 0;
       if (step == GAUSS_NEWTON) {
-        predicted = f_(x).squaredNorm();
+        predicted = error2;
       } else if (step == STEEPEST_DESCENT) {
         predicted = radius * (2*alpha*g.norm() - radius) / 2 / alpha;
       } else if (step == DOGLEG) {
         predicted = 0.5 * alpha * (1-beta)*(1-beta)*g.squaredNorm() +
-                    beta*(2-beta)*f_(x).squaredNorm();
+                    beta*(2-beta)*error2;
       }
       Scalar rho = actual / predicted;
-
-      if (step == GAUSS_NEWTON) printf("  GAUSS");
-      if (step == STEEPEST_DESCENT) printf("   STEE");
-      if (step == DOGLEG) printf("   DOGL");
-
-      printf(" %12g %12g %12g\n", rho, actual, predicted);
+      VLOG(3) << "iteration: " << i << " ||f(x)||: " << sqrt(error2)
+              << " max(g): " << g.array().abs().maxCoeff()
+              << " radius: " << radius << " step: " << step
+              << " rho: " << rho << " actual: " << actual
+              << " predicted: " << predicted;
 
       if (rho > 0) {
         // Accept update because the linear model is a good fit.
         x = x_new;
-        results.status = Update(x, params, &J, &A, &error, &g);
+        results.status = Update(x, f_new, params, &J, &A, &error, &g);
         x_updated = true;
       }
       if (rho > 0.75) {
@@ -251,6 +250,9 @@ class Dogleg {
     return results;
   }
 
+  // Gives access to the jacobian, e.g. to set up a NumericJacobian.
+  Jacobian &jacobian() { return df_; }
+
  private:
   const Function &f_;
   Jacobian df_;
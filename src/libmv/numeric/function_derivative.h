@@ -21,8 +21,10 @@
 #ifndef LIBMV_NUMERIC_DERIVATIVE_H
 #define LIBMV_NUMERIC_DERIVATIVE_H
 
+#include <algorithm>
 #include <cmath>
 
+#include "libmv/base/vector.h"
 #include "libmv/numeric/numeric.h"
 #include "libmv/logging/logging.h"
 
@@ -36,6 +38,20 @@ enum NumericJacobianMode {
   FORWARD,
 };
 
+// By default the columns are evaluated one after the other, which costs
+// 2 * n evaluations of f in CENTRAL mode and n + 1 in FORWARD mode. Two
+// optional speedups give exactly the same jacobian:
+//
+//  - set_num_threads() evaluates the columns concurrently with OpenMP, each
+//    thread perturbing its own copy of the parameters. f must then be safe
+//    to call from several threads at once.
+//  - set_sparsity_pattern() declares which residuals depend on which
+//    parameters. Columns that share no residual are perturbed together [1],
+//    so a banded jacobian costs a number of evaluations proportional to the
+//    band width instead of the number of parameters.
+//
+// [1] On the estimation of sparse jacobian matrices,
+//     A. R. Curtis, M. J. D. Powell and J. K. Reid, IMA J. Appl. Math. 1974
 template<typename Function, NumericJacobianMode mode=CENTRAL>
 class NumericJacobian {
  public:
@@ -47,10 +63,65 @@ class NumericJacobian {
                  Function::XMatrixType::RowsAtCompileTime>
           JMatrixType;
 
-  NumericJacobian(const Function &f) : f_(f) {}
+  NumericJacobian(const Function &f) : f_(f), num_threads_(1) {}
+
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+  // pattern(r, c) != 0 iff residual r may depend on parameter c. Entries out
+  // of the pattern are returned as zero.
+  void set_sparsity_pattern(const Mat &pattern) {
+    const int rows = pattern.rows(), cols = pattern.cols();
+    pattern_rows_ = rows;
+    column_row_begin_.resize(0);
+    column_rows_.resize(0);
+    for (int c = 0; c < cols; ++c) {
+      column_row_begin_.push_back(column_rows_.size());
+      for (int r = 0; r < rows; ++r) {
+        if (pattern(r, c) != 0) {
+          column_rows_.push_back(r);
+        }
+      }
+    }
+    column_row_begin_.push_back(column_rows_.size());
+
+    // Greedy coloring of the column intersection graph, in column order.
+    vector<int> color(cols), forbidden(cols);
+    int num_colors = 0;
+    for (int c = 0; c < cols; ++c) {
+      color[c] = -1;
+      forbidden[c] = -1;
+    }
+    for (int c = 0; c < cols; ++c) {
+      for (int k = column_row_begin_[c]; k < column_row_begin_[c + 1]; ++k) {
+        for (int other = 0; other < c; ++other) {
+          if (pattern(column_rows_[k], other) != 0) {
+            forbidden[color[other]] = c;
+          }
+        }
+      }
+      color[c] = 0;
+      while (forbidden[color[c]] == c) {
+        ++color[c];
+      }
+      num_colors = std::max(num_colors, color[c] + 1);
+    }
+    group_begin_.resize(0);
+    group_columns_.resize(0);
+    for (int g = 0; g < num_colors; ++g) {
+      group_begin_.push_back(group_columns_.size());
+      for (int c = 0; c < cols; ++c) {
+        if (color[c] == g) {
+          group_columns_.push_back(c);
+        }
+      }
+    }
+    group_begin_.push_back(group_columns_.size());
+    VLOG(2) << "Jacobian with " << cols << " columns evaluated in "
+            << num_colors << " groups.";
+  }
 
   // TODO(keir): Perhaps passing the jacobian back by value is not a good idea.
-  JMatrixType operator()(const Parameters &x) {
+  JMatrixType operator()(const Parameters &x) const {
     // Empirically determined constant.
     Parameters eps = x.array().abs() * XScalar(1e-5);
     // To handle cases where a paremeter is exactly zero, instead use the mean
@@ -60,35 +131,118 @@ class NumericJacobian {
       // TODO(keir): Do something better here.
       mean_eps = 1e-8; // ~sqrt(machine precision).
     }
-    // TODO(keir): Elimininate this needless function evaluation for the
-    // central difference case.
-    FMatrixType fx = f_(x);
-    const int rows = fx.rows();
     const int cols = x.rows();
-    JMatrixType jacobian(rows, cols);
-    Parameters x_plus_delta = x;
     for (int c = 0; c < cols; ++c) {
       if (eps(c) == XScalar(0)) {
         eps(c) = mean_eps;
       }
-      x_plus_delta(c) = x(c) + eps(c);
-      jacobian.col(c) = f_(x_plus_delta);
+    }
+    // Only the forward difference needs f(x).
+    FMatrixType fx;
+    if (mode == FORWARD) {
+      fx = f_(x);
+    }
+    const bool sparse = group_begin_.size() > 0;
+    const int num_groups = sparse ? group_begin_.size() - 1 : cols;
+    if (sparse) {
+      CHECK_EQ(cols, column_row_begin_.size() - 1);
+    }
 
+    // The first group is done alone since it gives the number of residuals.
+    JMatrixType jacobian;
+    Parameters x_plus_delta = x;
+    FMatrixType df = Difference(x, eps, fx, 0, &x_plus_delta);
+    if (sparse) {
+      CHECK_EQ(pattern_rows_, df.rows());
+      jacobian.setZero(df.rows(), cols);
+    } else {
+      jacobian.resize(df.rows(), cols);
+    }
+    Scatter(df, eps, 0, &jacobian);
+
+    #pragma omp parallel num_threads(num_threads_) if (num_threads_ > 1)
+    {
+      Parameters thread_x_plus_delta = x;
+      #pragma omp for schedule(dynamic)
+      for (int g = 1; g < num_groups; ++g) {
+        FMatrixType thread_df =
+            Difference(x, eps, fx, g, &thread_x_plus_delta);
+        Scatter(thread_df, eps, g, &jacobian);
+      }
+    }
+    return jacobian;
+  }
+
+ private:
+  int GroupBegin(int g) const {
+    return group_begin_.size() > 0 ? group_begin_[g] : g;
+  }
+  int GroupEnd(int g) const {
+    return group_begin_.size() > 0 ? group_begin_[g + 1] : g + 1;
+  }
+  int GroupColumn(int k) const {
+    return group_begin_.size() > 0 ? group_columns_[k] : k;
+  }
+
+  // Difference of f between the parameters with the columns of group g moved
+  // forward and moved backward (or not moved, in FORWARD mode).
+  FMatrixType Difference(const Parameters &x,
+                         const Parameters &eps,
+                         const FMatrixType &fx,
+                         int g,
+                         Parameters *x_plus_delta) const {
+    for (int k = GroupBegin(g); k < GroupEnd(g); ++k) {
+      const int c = GroupColumn(k);
+      (*x_plus_delta)(c) = x(c) + eps(c);
+    }
+    FMatrixType df = f_(*x_plus_delta);
+    if (mode == CENTRAL) {
+      for (int k = GroupBegin(g); k < GroupEnd(g); ++k) {
+        const int c = GroupColumn(k);
+        (*x_plus_delta)(c) = x(c) - eps(c);
+      }
+      df -= f_(*x_plus_delta);
+    } else {
+      df -= fx;
+    }
+    for (int k = GroupBegin(g); k < GroupEnd(g); ++k) {
+      const int c = GroupColumn(k);
+      (*x_plus_delta)(c) = x(c);
+    }
+    return df;
+  }
+
+  // Divides the difference by the step of each column of group g.
+  void Scatter(const FMatrixType &df,
+               const Parameters &eps,
+               int g,
+               JMatrixType *jacobian) const {
+    for (int k = GroupBegin(g); k < GroupEnd(g); ++k) {
+      const int c = GroupColumn(k);
       XScalar one_over_h = 1 / eps(c);
       if (mode == CENTRAL) {
-        x_plus_delta(c) = x(c) - eps(c);
-        jacobian.col(c) -= f_(x_plus_delta);
         one_over_h /= 2;
+      }
+      if (group_begin_.size() > 0) {
+        for (int i = column_row_begin_[c]; i < column_row_begin_[c + 1]; ++i) {
+          const int r = column_rows_[i];
+          (*jacobian)(r, c) = df(r) * one_over_h;
+        }
       } else {
-        jacobian.col(c) -= fx;
+        jacobian->col(c) = df * one_over_h;
       }
-      x_plus_delta(c) = x(c);
-      jacobian.col(c) = jacobian.col(c) * one_over_h;
     }
-    return jacobian;
   }
- private:
+
   const Function &f_;
+  int num_threads_;
+
+  // Set by set_sparsity_pattern(); empty otherwise.
+  int pattern_rows_;
+  vector<int> column_row_begin_;  // Rows of column c are column_rows_[
+  vector<int> column_rows_;       //   column_row_begin_[c], [c + 1]).
+  vector<int> group_begin_;       // Columns of group g are group_columns_[
+  vector<int> group_columns_;     //   group_begin_[g], [g + 1]).
 };
 
 template<typename Function, typename Jacobian>
@@ -54,4 +54,83 @@ TEST(FunctionDerivative, SimpleCase) {
   EXPECT_MATRIX_NEAR(f.J(x), J_forward(x), 1e-5);
 }
 
+// Residual i only depends on parameters i, i + 1 and i + 2.
+class Banded {
+ public:
+  typedef Vec FMatrixType;
+  typedef Vec XMatrixType;
+  Banded(int *num_evaluations) : num_evaluations_(num_evaluations) {}
+  Vec operator()(const Vec &x) const {
+    if (num_evaluations_) {
+      ++*num_evaluations_;
+    }
+    Vec fx(x.rows() - 2);
+    for (int i = 0; i < fx.rows(); ++i) {
+      fx(i) = sin(x(i)) * x(i + 1) + x(i + 2) * x(i + 2) - exp(0.1 * x(i));
+    }
+    return fx;
+  }
+ private:
+  int *num_evaluations_;
+};
+
+Vec BandedParameters(int n) {
+  Vec x(n);
+  for (int i = 0; i < n; ++i) {
+    x(i) = 0.3 + 0.17 * i;
+  }
+  return x;
+}
+
+TEST(FunctionDerivative, SparsityPatternMatchesDense) {
+  const int n = 40;
+  Vec x = BandedParameters(n);
+  Mat pattern = Mat::Zero(n - 2, n);
+  for (int i = 0; i < n - 2; ++i) {
+    pattern.block(i, i, 1, 3).setOnes();
+  }
+
+  int num_evaluations = 0;
+  Banded f(&num_evaluations);
+  NumericJacobian<Banded> J(f);
+  Mat expected = J(x);
+  EXPECT_EQ(2 * n, num_evaluations);
+
+  // Three groups of columns, perturbed in both directions.
+  num_evaluations = 0;
+  J.set_sparsity_pattern(pattern);
+  Mat sparse = J(x);
+  EXPECT_MATRIX_EQ(expected, sparse);
+  EXPECT_EQ(2 * 3, num_evaluations);
+
+  num_evaluations = 0;
+  NumericJacobian<Banded, FORWARD> J_forward(f);
+  Mat expected_forward = J_forward(x);
+  EXPECT_EQ(n + 1, num_evaluations);
+  num_evaluations = 0;
+  J_forward.set_sparsity_pattern(pattern);
+  Mat sparse_forward = J_forward(x);
+  EXPECT_MATRIX_EQ(expected_forward, sparse_forward);
+  EXPECT_EQ(3 + 1, num_evaluations);
+}
+
+TEST(FunctionDerivative, ThreadsMatchSerial) {
+  const int n = 40;
+  Vec x = BandedParameters(n);
+  Banded f(NULL);
+  NumericJacobian<Banded> J(f);
+  Mat expected = J(x);
+  J.set_num_threads(4);
+  Mat threaded = J(x);
+  EXPECT_MATRIX_EQ(expected, threaded);
+
+  Mat pattern = Mat::Zero(n - 2, n);
+  for (int i = 0; i < n - 2; ++i) {
+    pattern.block(i, i, 1, 3).setOnes();
+  }
+  J.set_sparsity_pattern(pattern);
+  Mat threaded_sparse = J(x);
+  EXPECT_MATRIX_EQ(expected, threaded_sparse);
+}
+
 }  // namespace
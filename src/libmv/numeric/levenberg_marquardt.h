@@ -20,6 +20,12 @@
 //
 // A simple implementation of levenberg marquardt.
 //
+// SolverParameters::loss makes it minimize a robust cost (robust_loss.h);
+// each coefficient of f(x) is then a residual block.
+//
+// Results::trace records every iteration, with the time spent in f, in the
+// Jacobian and in the solver.
+//
 // [1] K. Madsen, H. Nielsen, O. Tingleoff. Methods for Non-linear Least
 // Squares Problems.
 // http://www2.imm.dtu.dk/pubdb/views/edoc_download.php/3215/pdf/imm3215.pdf
@@ -31,8 +37,11 @@
 
 #include <cmath>
 
+#include "libmv/base/timer.h"
+#include "libmv/base/vector.h"
 #include "libmv/numeric/numeric.h"
 #include "libmv/numeric/function_derivative.h"
+#include "libmv/numeric/robust_loss.h"
 #include "libmv/logging/logging.h"
 
 namespace libmv {
@@ -80,6 +89,20 @@ class LevenbergMarquardt {
     Scalar error_threshold;          // eps > ||f(x)||
     Scalar initial_scale_factor;     // Initial u for solving normal equations.
     int    max_iterations;           // Maximum number of solver iterations.
+    RobustLoss loss;                 // Applied to each coefficient of f(x).
+  };
+
+  // One iteration of minimize().
+  struct IterationSummary {
+    int    iteration;
+    Scalar error_magnitude;     // ||f(x)|| before the step.
+    Scalar gradient_max;        // max(J'*f(x)) before the step.
+    Scalar u;                   // Damping of the step.
+    Scalar rho;                 // Actual over predicted decrease, or 0.
+    bool   accepted;
+    double jacobian_seconds;    // Linearizing at the accepted step.
+    double solve_seconds;       // Solving the damped normal equations.
+    double residual_seconds;    // Evaluating f at the step.
   };
 
   struct Results {
@@ -87,14 +110,31 @@ class LevenbergMarquardt {
     Scalar gradient_magnitude;  // ||J'f(x)||
     int    iterations;
     Status status;
+    vector<IterationSummary> trace;
   };
 
   Status Update(const Parameters &x, const SolverParameters &params,
                 JMatrixType *J, AMatrixType *A, FVec *error, Parameters *g) {
+    return Update(x, f_(x), params, J, A, error, g);
+  }
+
+  // Same as above when f(x) = fx is already known.
+  Status Update(const Parameters &x, const FVec &fx,
+                const SolverParameters &params,
+                JMatrixType *J, AMatrixType *A, FVec *error, Parameters *g) {
     *J = df_(x);
-    *A = (*J).transpose() * (*J);
-    *error = -f_(x);
-    *g = (*J).transpose() * *error;
+    *error = -fx;
+    if (params.loss.type == TRIVIAL_LOSS) {
+      *A = (*J).transpose() * (*J);
+      *g = (*J).transpose() * *error;
+    } else {
+      FVec weights(fx.rows());
+      for (int i = 0; i < fx.rows(); ++i) {
+        weights(i) = params.loss.Weight(fx(i) * fx(i));
+      }
+      *A = (*J).transpose() * weights.asDiagonal() * (*J);
+      *g = (*J).transpose() * weights.asDiagonal() * *error;
+    }
     if (g->array().abs().maxCoeff() < params.gradient_threshold) {
       return GRADIENT_TOO_SMALL;
     } else if (error->norm() < params.error_threshold) {
@@ -105,14 +145,14 @@ class LevenbergMarquardt {
 
   Results minimize(Parameters *x_and_min) {
     SolverParameters params;
-    minimize(params, x_and_min);
+    return minimize(params, x_and_min);
   }
 
   Results minimize(const SolverParameters &params, Parameters *x_and_min) {
     Parameters &x = *x_and_min;
     JMatrixType J;
     AMatrixType A;
-    FVec error;
+    FVec error, f_new;
     Parameters g;
 
     Results results;
@@ -122,40 +162,61 @@ class LevenbergMarquardt {
     Scalar v = 2;
 
     Parameters dx, x_new;
+    WallTimer timer;
     int i;
     for (i = 0; results.status == RUNNING && i < params.max_iterations; ++i) {
-      LOG(INFO) << "iteration: " << i;
-      LOG(INFO) << "||f(x)||: " << f_(x).norm();
-      LOG(INFO) << "max(g): " << g.array().abs().maxCoeff();
-      LOG(INFO) << "u: " << u;
-      LOG(INFO) << "v: " << v;
-
+      VLOG(3) << "iteration: " << i << " ||f(x)||: " << error.norm()
+              << " max(g): " << g.array().abs().maxCoeff()
+              << " u: " << u << " v: " << v;
+      IterationSummary trace;
+      trace.iteration = i;
+      trace.error_magnitude = error.norm();
+      trace.gradient_max = g.array().abs().maxCoeff();
+      trace.u = u;
+      trace.rho = 0;
+      trace.accepted = false;
+      trace.jacobian_seconds = 0;
+      trace.residual_seconds = 0;
+
+      timer.Start();
       AMatrixType A_augmented = A + u*AMatrixType::Identity(J.cols(), J.cols());
       Solver solver(A_augmented);
       dx = solver.solve(g);
       bool solved = (A_augmented * dx).isApprox(g);
+      trace.solve_seconds = timer.Seconds();
       if (!solved) LOG(ERROR) << "Failed to solve";
       if (solved && dx.norm() <= params.relative_step_threshold * x.norm()) {
           results.status = RELATIVE_STEP_SIZE_TOO_SMALL;
+          results.trace.push_back(trace);
           break;
       } 
       if (solved) {
         x_new = x + dx;
+        timer.Start();
+        f_new = f_(x_new);
+        trace.residual_seconds = timer.Seconds();
         // Rho is the ratio of the actual reduction in error to the reduction
         // in error that would be obtained if the problem was linear.
         // See [1] for details.
-        Scalar rho((error.squaredNorm() - f_(x_new).squaredNorm())
+        Scalar rho((RobustSquaredNorm(params.loss, error) -
+                    RobustSquaredNorm(params.loss, f_new))
                    / dx.dot(u*dx + g));
+        trace.rho = rho;
         if (rho > 0) {
           // Accept the Gauss-Newton step because the linear model fits well.
           x = x_new;
-          results.status = Update(x, params, &J, &A, &error, &g);
+          timer.Start();
+          results.status = Update(x, f_new, params, &J, &A, &error, &g);
+          trace.jacobian_seconds = timer.Seconds();
+          trace.accepted = true;
+          results.trace.push_back(trace);
           Scalar tmp = Scalar(2*rho-1);
           u = u*std::max(1/3., 1 - (tmp*tmp*tmp));
           v = 2;
           continue;
         } 
       } 
+      results.trace.push_back(trace);
       // Reject the update because either the normal equations failed to solve
       // or the local linear model was not good (rho < 0). Instead, increase u
       // to move closer to gradient descent.
@@ -171,6 +232,9 @@ class LevenbergMarquardt {
     return results;
   }
 
+  // Gives access to the jacobian, e.g. to set up a NumericJacobian.
+  Jacobian &jacobian() { return df_; }
+
  private:
   const Function &f_;
   Jacobian df_;
@@ -50,6 +50,59 @@ TEST(LevenbergMarquardt, SimpleCase) {
   Vec3 expected_min_x(2, 5, 0);
 
   EXPECT_MATRIX_NEAR(expected_min_x, x, 1e-5);
+
+  // The error decreases with each accepted step.
+  EXPECT_EQ(results.iterations, results.trace.size());
+  double error = results.trace[0].error_magnitude;
+  for (int i = 0; i < results.trace.size(); ++i) {
+    EXPECT_EQ(i, results.trace[i].iteration);
+    EXPECT_LE(results.trace[i].error_magnitude, error);
+    EXPECT_EQ(results.trace[i].accepted, results.trace[i].rho > 0);
+    error = results.trace[i].error_magnitude;
+  }
+  EXPECT_LE(results.error_magnitude, error);
+}
+
+// Residuals of the line y = a t + b through points of which a few are
+// outliers.
+class LineResiduals {
+ public:
+  typedef Vec FMatrixType;
+  typedef Vec2 XMatrixType;
+  LineResiduals(const Vec &t, const Vec &y) : t_(t), y_(y) {}
+  Vec operator()(const Vec2 &x) const {
+    return (x(0) * t_).array() + x(1) - y_.array();
+  }
+ private:
+  const Vec &t_, &y_;
+};
+
+TEST(LevenbergMarquardt, RobustLoss) {
+  const int n = 30;
+  Vec t(n), y(n);
+  for (int i = 0; i < n; ++i) {
+    t(i) = i;
+    y(i) = 2 * i + 1 + 0.01 * ((i * 7) % 5 - 2);
+  }
+  y(3) += 40;
+  y(17) -= 25;
+  y(25) += 60;
+  LineResiduals f(t, y);
+  typedef LevenbergMarquardt<LineResiduals> Solver;
+  Solver lm(f);
+
+  Vec2 least_squares(0, 0);
+  Solver::SolverParameters params;
+  lm.minimize(params, &least_squares);
+  EXPECT_GT((least_squares - Vec2(2, 1)).norm(), 0.5);
+
+  RobustLossType types[] = { HUBER_LOSS, CAUCHY_LOSS };
+  for (int l = 0; l < 2; ++l) {
+    Vec2 x(0, 0);
+    params.loss = RobustLoss(types[l], 0.1);
+    lm.minimize(params, &x);
+    EXPECT_MATRIX_NEAR(Vec2(2, 1), x, 0.05);
+  }
 }
 
 }  // namespace
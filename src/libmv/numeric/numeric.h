@@ -127,6 +127,10 @@ typedef Eigen::Vector2i Vec2i;
 typedef Eigen::Vector3i Vec3i;
 typedef Eigen::Vector4i Vec4i;
 
+typedef Eigen::Matrix<double,
+                      Eigen::Dynamic,
+                      Eigen::Dynamic,
+                      Eigen::RowMajor> RMat;
 typedef Eigen::Matrix<float,
                       Eigen::Dynamic,
                       Eigen::Dynamic,
@@ -431,6 +435,16 @@ TMat ExtractColumns(const TMat &A, const TCols &columns) {
   return compressed;
 }
 
+// Same as above but writes into an existing matrix, so that a caller looping
+// over same-sized subsets (e.g. RANSAC) reuses its storage.
+template <typename TMat, typename TCols, typename TDest>
+void ExtractColumns(const TMat &A, const TCols &columns, TDest *compressed) {
+  compressed->resize(A.rows(), columns.size());
+  for (int i = 0; i < columns.size(); ++i) {
+    compressed->col(i) = A.col(columns[i]);
+  }
+}
+
 template <typename TMat, typename TDest>
 void reshape(const TMat &a, int rows, int cols, TDest *b) {
   assert(a.rows()*a.cols() == rows*cols);
@@ -0,0 +1,99 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_NUMERIC_ROBUST_LOSS_H
+#define LIBMV_NUMERIC_ROBUST_LOSS_H
+
+#include <cmath>
+
+namespace libmv {
+
+// Robust loss functions rho(s) of the squared norm s = |r|^2 of a residual
+// block r.
+//
+// A robust problem minimizes 1/2 sum_i rho(|r_i|^2) instead of 1/2 |r|^2.
+// The solvers handle it by iteratively reweighted least squares: at each
+// linearization the residual and the jacobian of block i are scaled by
+// sqrt(rho'(|r_i|^2)), and the steps are accepted or rejected on the robust
+// cost itself. The scale a is the norm from which a block is downweighted;
+// blocks with |r| < a count as in plain least squares.
+enum RobustLossType {
+  TRIVIAL_LOSS,    // rho(s) = s.
+  HUBER_LOSS,      // rho(s) = s if s < a^2, 2 a sqrt(s) - a^2 otherwise.
+  CAUCHY_LOSS,     // rho(s) = a^2 log(1 + s / a^2).
+  TRUNCATED_LOSS   // rho(s) = min(s, a^2); the blocks beyond a are ignored.
+};
+
+struct RobustLoss {
+  RobustLoss(RobustLossType type = TRIVIAL_LOSS, double scale = 1.0)
+    : type(type), scale(scale) {}
+
+  // rho(s).
+  double Cost(double s) const {
+    const double b = scale * scale;
+    switch (type) {
+      case HUBER_LOSS:
+        return s < b ? s : 2 * scale * std::sqrt(s) - b;
+      case CAUCHY_LOSS:
+        return b * std::log(1 + s / b);
+      case TRUNCATED_LOSS:
+        return s < b ? s : b;
+      default:
+        return s;
+    }
+  }
+
+  // rho'(s), the weight of a block in the reweighted least squares.
+  double Weight(double s) const {
+    const double b = scale * scale;
+    switch (type) {
+      case HUBER_LOSS:
+        return s < b ? 1 : scale / std::sqrt(s);
+      case CAUCHY_LOSS:
+        return 1 / (1 + s / b);
+      case TRUNCATED_LOSS:
+        return s < b ? 1 : 0;
+      default:
+        return 1;
+    }
+  }
+
+  RobustLossType type;
+  double scale;
+};
+
+// sum_i rho(v_i^2), the robust cost of v with one residual block per
+// coefficient; |v|^2 for TRIVIAL_LOSS.
+template<typename TVec>
+typename TVec::RealScalar RobustSquaredNorm(const RobustLoss &loss,
+                                           const TVec &v) {
+  if (loss.type == TRIVIAL_LOSS) {
+    return v.squaredNorm();
+  }
+  typename TVec::RealScalar sum = 0;
+  for (int i = 0; i < v.rows(); ++i) {
+    sum += loss.Cost(v(i) * v(i));
+  }
+  return sum;
+}
+
+}  // namespace libmv
+
+#endif  // LIBMV_NUMERIC_ROBUST_LOSS_H
@@ -0,0 +1,61 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/numeric/robust_loss.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+TEST(RobustLoss, WeightIsTheDerivativeOfTheCost) {
+  RobustLossType types[] = {
+    TRIVIAL_LOSS, HUBER_LOSS, CAUCHY_LOSS, TRUNCATED_LOSS
+  };
+  const double h = 1e-6;
+  for (int l = 0; l < 4; ++l) {
+    RobustLoss loss(types[l], 2.0);
+    for (double s = 0.5; s < 20; s += 1.0) {
+      double derivative = (loss.Cost(s + h) - loss.Cost(s - h)) / (2 * h);
+      EXPECT_NEAR(derivative, loss.Weight(s), 1e-8) << l << " " << s;
+    }
+  }
+}
+
+TEST(RobustLoss, QuadraticBelowTheScale) {
+  RobustLoss huber(HUBER_LOSS, 2.0), truncated(TRUNCATED_LOSS, 2.0);
+  EXPECT_EQ(3.0, huber.Cost(3.0));
+  EXPECT_EQ(1.0, huber.Weight(3.0));
+  EXPECT_EQ(3.0, truncated.Cost(3.0));
+  EXPECT_EQ(4.0, truncated.Cost(100.0));
+  EXPECT_EQ(0.0, truncated.Weight(100.0));
+  // Linear in |r| beyond the scale, and continuous at the scale.
+  EXPECT_DOUBLE_EQ(2 * 2 * 10 - 4, huber.Cost(100.0));
+  EXPECT_DOUBLE_EQ(4.0, huber.Cost(4.0));
+}
+
+TEST(RobustLoss, RobustSquaredNorm) {
+  Vec3 v(1, -3, 0.5);
+  EXPECT_EQ(v.squaredNorm(), RobustSquaredNorm(RobustLoss(), v));
+  RobustLoss huber(HUBER_LOSS, 2.0);
+  EXPECT_DOUBLE_EQ(1 + (2 * 2 * 3 - 4) + 0.25, RobustSquaredNorm(huber, v));
+}
+
+}  // namespace
@@ -0,0 +1,75 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/numeric/sparse_dogleg.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+// Extended Rosenbrock function: n / 2 independent Rosenbrock valleys, with
+// the minimum at (1, ..., 1).
+class ExtendedRosenbrock {
+ public:
+  typedef Vec FMatrixType;
+  typedef Vec XMatrixType;
+  Vec operator()(const Vec &x) const {
+    Vec fx(x.rows());
+    for (int i = 0; i < x.rows(); i += 2) {
+      fx(i) = 10 * (x(i + 1) - x(i) * x(i));
+      fx(i + 1) = 1 - x(i);
+    }
+    return fx;
+  }
+};
+
+class ExtendedRosenbrockJacobian {
+ public:
+  ExtendedRosenbrockJacobian(const ExtendedRosenbrock &f) { (void) f; }
+  void operator()(const Vec &x, SparseJacobian *J) const {
+    J->Clear(x.rows());
+    for (int i = 0; i < x.rows(); i += 2) {
+      J->StartRow();
+      J->Add(i, -20 * x(i));
+      J->Add(i + 1, 10);
+      J->StartRow();
+      J->Add(i, -1);
+    }
+  }
+};
+
+TEST(SparseDogleg, ExtendedRosenbrock) {
+  const int n = 200;
+  Vec x(n);
+  for (int i = 0; i < n; i += 2) {
+    x(i) = -1.2;
+    x(i + 1) = 1;
+  }
+  ExtendedRosenbrock f;
+  typedef SparseDogleg<ExtendedRosenbrock, ExtendedRosenbrockJacobian> Solver;
+  Solver dogleg(f);
+  Solver::Results results = dogleg.minimize(&x);
+
+  EXPECT_MATRIX_NEAR(Vec::Ones(n), x, 1e-6);
+  EXPECT_LT(results.error_magnitude, 1e-6);
+}
+
+}  // namespace
@@ -0,0 +1,230 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+// Levenberg-Marquardt for problems with a sparse Jacobian.
+//
+// Same algorithm and parameters as LevenbergMarquardt in
+// levenberg_marquardt.h, for functions with many parameters:
+//  - the Jacobian is a SparseJacobian filled by the Jacobian functor,
+//    void operator()(const Parameters &x, SparseJacobian *J),
+//  - the normal equations are updated in place and solved with a sparse
+//    LDL^T factorization (SparseNormalEquations),
+//  - f is evaluated once per iteration, and the progress is only logged
+//    at VLOG(3),
+//  - Results::trace records every iteration, with the time spent in f, in
+//    the Jacobian and in the factorization.
+//
+// Function::XMatrixType and Function::FMatrixType must be dynamic vectors.
+
+#ifndef LIBMV_NUMERIC_SPARSE_LEVENBERG_MARQUARDT_H
+#define LIBMV_NUMERIC_SPARSE_LEVENBERG_MARQUARDT_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "libmv/base/timer.h"
+#include "libmv/base/vector.h"
+#include "libmv/logging/logging.h"
+#include "libmv/numeric/numeric.h"
+#include "libmv/numeric/robust_loss.h"
+#include "libmv/numeric/sparse_normal_equations.h"
+
+namespace libmv {
+
+template<typename Function, typename Jacobian>
+class SparseLevenbergMarquardt {
+ public:
+  typedef typename Function::XMatrixType::RealScalar Scalar;
+  typedef typename Function::FMatrixType FVec;
+  typedef typename Function::XMatrixType Parameters;
+
+  enum Status {
+    RUNNING,
+    GRADIENT_TOO_SMALL,            // eps > max(J'*f(x))
+    RELATIVE_STEP_SIZE_TOO_SMALL,  // eps > ||dx|| / ||x||
+    ERROR_TOO_SMALL,               // eps > ||f(x)||
+    HIT_MAX_ITERATIONS,
+  };
+
+  SparseLevenbergMarquardt(const Function &f)
+      : f_(f), df_(f) {}
+
+  struct SolverParameters {
+   SolverParameters()
+       : gradient_threshold(1e-16),
+         relative_step_threshold(1e-16),
+         error_threshold(1e-16),
+         initial_scale_factor(1e-3),
+         max_iterations(100) {}
+    Scalar gradient_threshold;       // eps > max(J'*f(x))
+    Scalar relative_step_threshold;  // eps > ||dx|| / ||x||
+    Scalar error_threshold;          // eps > ||f(x)||
+    Scalar initial_scale_factor;     // Initial u for solving normal equations.
+    int    max_iterations;           // Maximum number of solver iterations.
+    RobustLoss loss;                 // Applied to each coefficient of f(x).
+  };
+
+  // One iteration of minimize().
+  struct IterationSummary {
+    int    iteration;
+    Scalar error_magnitude;     // ||f(x)|| before the step.
+    Scalar gradient_max;        // max(J'*f(x)) before the step.
+    Scalar u;                   // Damping of the step.
+    Scalar rho;                 // Actual over predicted decrease, or 0.
+    bool   accepted;
+    double jacobian_seconds;    // Linearizing at the accepted step.
+    double solve_seconds;       // Factoring the damped normal equations.
+    double residual_seconds;    // Evaluating f at the step.
+  };
+
+  struct Results {
+    Scalar error_magnitude;     // ||f(x)||
+    Scalar gradient_magnitude;  // ||J'f(x)||
+    int    iterations;
+    Status status;
+    // Nonzeros of J^T J, both triangles, and of its LDL^T factor.
+    int    normal_equations_nonzeros;
+    int    factor_nonzeros;
+    vector<IterationSummary> trace;
+  };
+
+  // Linearizes at x, where f(x) = fx is already known.
+  Status Update(const Parameters &x, const FVec &fx,
+                const SolverParameters &params, FVec *error, Parameters *g) {
+    df_(x, &J_);
+    *error = -fx;
+    if (params.loss.type == TRIVIAL_LOSS) {
+      normal_equations_.Update(J_);
+      J_.MultiplyTranspose(*error, g);
+    } else {
+      // Reweighting scales each row of J and of the error by sqrt(rho').
+      FVec weighted_error(fx.rows());
+      for (int r = 0; r < fx.rows(); ++r) {
+        const Scalar w = std::sqrt(params.loss.Weight(fx(r) * fx(r)));
+        J_.ScaleRow(r, w);
+        weighted_error(r) = w * (*error)(r);
+      }
+      normal_equations_.Update(J_);
+      J_.MultiplyTranspose(weighted_error, g);
+    }
+    if (g->array().abs().maxCoeff() < params.gradient_threshold) {
+      return GRADIENT_TOO_SMALL;
+    } else if (error->norm() < params.error_threshold) {
+      return ERROR_TOO_SMALL;
+    }
+    return RUNNING;
+  }
+
+  Results minimize(Parameters *x_and_min) {
+    SolverParameters params;
+    return minimize(params, x_and_min);
+  }
+
+  Results minimize(const SolverParameters &params, Parameters *x_and_min) {
+    Parameters &x = *x_and_min;
+    FVec error, f_new;
+    Parameters g;
+
+    Results results;
+    results.status = Update(x, f_(x), params, &error, &g);
+
+    Scalar u = Scalar(params.initial_scale_factor *
+                      normal_equations_.MaxDiagonal());
+    Scalar v = 2;
+
+    Parameters dx, x_new;
+    WallTimer timer;
+    int i;
+    for (i = 0; results.status == RUNNING && i < params.max_iterations; ++i) {
+      VLOG(3) << "iteration: " << i << " ||f(x)||: " << error.norm()
+              << " max(g): " << g.array().abs().maxCoeff()
+              << " u: " << u << " v: " << v;
+      IterationSummary trace;
+      trace.iteration = i;
+      trace.error_magnitude = error.norm();
+      trace.gradient_max = g.array().abs().maxCoeff();
+      trace.u = u;
+      trace.rho = 0;
+      trace.accepted = false;
+      trace.jacobian_seconds = 0;
+      trace.residual_seconds = 0;
+
+      timer.Start();
+      bool solved = normal_equations_.Solve(u, g, &dx);
+      trace.solve_seconds = timer.Seconds();
+      if (!solved) LOG(ERROR) << "Failed to solve";
+      if (solved && dx.norm() <= params.relative_step_threshold * x.norm()) {
+          results.status = RELATIVE_STEP_SIZE_TOO_SMALL;
+          results.trace.push_back(trace);
+          break;
+      }
+      if (solved) {
+        x_new = x + dx;
+        timer.Start();
+        f_new = f_(x_new);
+        trace.residual_seconds = timer.Seconds();
+        // Rho is the ratio of the actual reduction in error to the reduction
+        // in error that would be obtained if the problem was linear.
+        Scalar rho((RobustSquaredNorm(params.loss, error) -
+                    RobustSquaredNorm(params.loss, f_new))
+                   / dx.dot(u*dx + g));
+        trace.rho = rho;
+        if (rho > 0) {
+          // Accept the Gauss-Newton step because the linear model fits well.
+          x = x_new;
+          timer.Start();
+          results.status = Update(x, f_new, params, &error, &g);
+          trace.jacobian_seconds = timer.Seconds();
+          trace.accepted = true;
+          results.trace.push_back(trace);
+          Scalar tmp = Scalar(2*rho-1);
+          u = u*std::max(1/3., 1 - (tmp*tmp*tmp));
+          v = 2;
+          continue;
+        }
+      }
+      results.trace.push_back(trace);
+      // Reject the update because either the normal equations failed to solve
+      // or the local linear model was not good (rho < 0). Instead, increase u
+      // to move closer to gradient descent.
+      u *= v;
+      v *= 2;
+    }
+    if (results.status == RUNNING) {
+      results.status = HIT_MAX_ITERATIONS;
+    }
+    results.error_magnitude = error.norm();
+    results.gradient_magnitude = g.norm();
+    results.iterations = i;
+    results.normal_equations_nonzeros = normal_equations_.num_nonzeros();
+    results.factor_nonzeros = normal_equations_.factor_nonzeros();
+    return results;
+  }
+
+ private:
+  const Function &f_;
+  Jacobian df_;
+  SparseJacobian J_;
+  SparseNormalEquations normal_equations_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_NUMERIC_SPARSE_LEVENBERG_MARQUARDT_H
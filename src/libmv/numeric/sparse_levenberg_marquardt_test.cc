@@ -0,0 +1,142 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/numeric/sparse_levenberg_marquardt.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+// Extended Rosenbrock function: n / 2 independent Rosenbrock valleys, with
+// the minimum at (1, ..., 1).
+class ExtendedRosenbrock {
+ public:
+  typedef Vec FMatrixType;
+  typedef Vec XMatrixType;
+  Vec operator()(const Vec &x) const {
+    Vec fx(x.rows());
+    for (int i = 0; i < x.rows(); i += 2) {
+      fx(i) = 10 * (x(i + 1) - x(i) * x(i));
+      fx(i + 1) = 1 - x(i);
+    }
+    return fx;
+  }
+};
+
+class ExtendedRosenbrockJacobian {
+ public:
+  ExtendedRosenbrockJacobian(const ExtendedRosenbrock &f) { (void) f; }
+  void operator()(const Vec &x, SparseJacobian *J) const {
+    J->Clear(x.rows());
+    for (int i = 0; i < x.rows(); i += 2) {
+      J->StartRow();
+      J->Add(i, -20 * x(i));
+      J->Add(i + 1, 10);
+      J->StartRow();
+      J->Add(i, -1);
+    }
+  }
+};
+
+TEST(SparseLevenbergMarquardt, ExtendedRosenbrock) {
+  const int n = 200;
+  Vec x(n);
+  for (int i = 0; i < n; i += 2) {
+    x(i) = -1.2;
+    x(i + 1) = 1;
+  }
+  ExtendedRosenbrock f;
+  SparseLevenbergMarquardt<ExtendedRosenbrock,
+                           ExtendedRosenbrockJacobian> lm(f);
+  SparseLevenbergMarquardt<ExtendedRosenbrock,
+                           ExtendedRosenbrockJacobian>::Results results =
+      lm.minimize(&x);
+
+  EXPECT_MATRIX_NEAR(Vec::Ones(n), x, 1e-6);
+  EXPECT_LT(results.error_magnitude, 1e-6);
+
+  // J^T J is made of 2 x 2 diagonal blocks.
+  EXPECT_EQ(2 * n, results.normal_equations_nonzeros);
+  EXPECT_EQ(n / 2, results.factor_nonzeros);
+  EXPECT_EQ(results.iterations, results.trace.size());
+  for (int i = 0; i < results.trace.size(); ++i) {
+    EXPECT_EQ(results.trace[i].accepted, results.trace[i].rho > 0);
+    EXPECT_GE(results.trace[i].solve_seconds, 0);
+  }
+}
+
+// Five measurements y of each parameter, the last one being an outlier.
+class Measurements {
+ public:
+  typedef Vec FMatrixType;
+  typedef Vec XMatrixType;
+  explicit Measurements(const Vec &y) : y_(y) {}
+  Vec operator()(const Vec &x) const {
+    Vec fx(y_.rows());
+    for (int i = 0; i < y_.rows(); ++i) {
+      fx(i) = x(i / 5) - y_(i);
+    }
+    return fx;
+  }
+ private:
+  const Vec &y_;
+};
+
+class MeasurementsJacobian {
+ public:
+  MeasurementsJacobian(const Measurements &f) { (void) f; }
+  void operator()(const Vec &x, SparseJacobian *J) const {
+    J->Clear(x.rows());
+    for (int i = 0; i < 5 * x.rows(); ++i) {
+      J->StartRow();
+      J->Add(i / 5, 1);
+    }
+  }
+};
+
+TEST(SparseLevenbergMarquardt, RobustLoss) {
+  const int n = 50;
+  Vec y(5 * n);
+  for (int i = 0; i < 5 * n; ++i) {
+    y(i) = i / 5 + (i % 5 == 4 ? 10 : 0.01 * (i % 5 - 1.5));
+  }
+  Measurements f(y);
+  typedef SparseLevenbergMarquardt<Measurements, MeasurementsJacobian> Solver;
+  Solver lm(f);
+  Solver::SolverParameters params;
+  Vec expected(n);
+  for (int j = 0; j < n; ++j) {
+    expected(j) = j;
+  }
+
+  Vec x = Vec::Zero(n);
+  lm.minimize(params, &x);
+  // The outliers pull the least squares estimates by 10 / 5.
+  Vec least_squares = expected.array() + 2;
+  EXPECT_MATRIX_NEAR(least_squares, x, 1e-6);
+
+  x.setZero();
+  params.loss = RobustLoss(CAUCHY_LOSS, 0.1);
+  lm.minimize(params, &x);
+  EXPECT_MATRIX_NEAR(expected, x, 0.01);
+}
+
+}  // namespace
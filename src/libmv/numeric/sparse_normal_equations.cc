@@ -0,0 +1,210 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#include "libmv/logging/logging.h"
+#include "libmv/numeric/sparse_normal_equations.h"
+#include "third_party/colamd/Include/colamd.h"
+extern "C" {
+#include "third_party/ldl/Include/ldl.h"
+}
+
+namespace libmv {
+
+void SparseJacobian::Multiply(const Vec &x, Vec *y) const {
+  CHECK_EQ(x.rows(), num_cols_);
+  y->resize(rows());
+  for (int r = 0; r < rows(); ++r) {
+    double sum = 0;
+    for (int k = row_begin_[r]; k < row_begin_[r + 1]; ++k) {
+      sum += values_[k] * x(cols_[k]);
+    }
+    (*y)(r) = sum;
+  }
+}
+
+void SparseJacobian::MultiplyTranspose(const Vec &x, Vec *y) const {
+  CHECK_EQ(x.rows(), rows());
+  y->setZero(num_cols_);
+  for (int r = 0; r < rows(); ++r) {
+    for (int k = row_begin_[r]; k < row_begin_[r + 1]; ++k) {
+      (*y)(cols_[k]) += values_[k] * x(r);
+    }
+  }
+}
+
+bool SparseJacobian::SamePattern(const SparseJacobian &other) const {
+  if (num_cols_ != other.num_cols_ || rows() != other.rows() ||
+      num_nonzeros() != other.num_nonzeros()) {
+    return false;
+  }
+  return std::equal(row_begin_.begin(), row_begin_.end(),
+                    other.row_begin_.begin()) &&
+         std::equal(cols_.begin(), cols_.end(), other.cols_.begin());
+}
+
+// Position of the entry (row, col) in the compressed columns Ap, Ai, whose
+// columns are sorted.
+static int FindEntry(const vector<int> &Ap, const vector<int> &Ai,
+                     int row, int col) {
+  const int *begin = Ai.begin() + Ap[col];
+  const int *end = Ai.begin() + Ap[col + 1];
+  const int *it = std::lower_bound(begin, end, row);
+  CHECK(it != end && *it == row);
+  return it - Ai.begin();
+}
+
+void SparseNormalEquations::Analyze(const SparseJacobian &J) {
+  num_parameters_ = J.cols();
+  const int n = num_parameters_;
+
+  // Pattern of J^T J: the diagonal and the pairs of columns sharing a row,
+  // in both triangles since LDL reads the upper triangle of P A P^T.
+  std::vector<std::pair<int, int> > entries;  // (column, row)
+  for (int c = 0; c < n; ++c) {
+    entries.push_back(std::make_pair(c, c));
+  }
+  for (int r = 0; r < J.rows(); ++r) {
+    for (int a = J.row_begin(r); a < J.row_begin(r + 1); ++a) {
+      for (int b = a + 1; b < J.row_begin(r + 1); ++b) {
+        CHECK_NE(J.col(a), J.col(b));
+        entries.push_back(std::make_pair(J.col(a), J.col(b)));
+        entries.push_back(std::make_pair(J.col(b), J.col(a)));
+      }
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+  Ap_.resize(n + 1);
+  Ai_.resize(entries.size());
+  Ap_[0] = 0;
+  for (int e = 0, c = 0; c < n; ++c) {
+    for (; e < entries.size() && entries[e].first == c; ++e) {
+      Ai_[e] = entries[e].second;
+    }
+    Ap_[c + 1] = e;
+  }
+  Ax_.resize(Ai_.size());
+  Ax_shifted_.resize(Ai_.size());
+  diagonal_.resize(n);
+  for (int c = 0; c < n; ++c) {
+    diagonal_[c] = FindEntry(Ap_, Ai_, c, c);
+  }
+
+  // Where the product of each pair of nonzeros of a row goes.
+  upper_target_.resize(0);
+  lower_target_.resize(0);
+  for (int r = 0; r < J.rows(); ++r) {
+    for (int a = J.row_begin(r); a < J.row_begin(r + 1); ++a) {
+      upper_target_.push_back(diagonal_[J.col(a)]);
+      lower_target_.push_back(-1);
+      for (int b = a + 1; b < J.row_begin(r + 1); ++b) {
+        upper_target_.push_back(FindEntry(Ap_, Ai_, J.col(a), J.col(b)));
+        lower_target_.push_back(FindEntry(Ap_, Ai_, J.col(b), J.col(a)));
+      }
+    }
+  }
+
+  // Fill reducing ordering and symbolic factorization.
+  P_.resize(n + 1);
+  Pinv_.resize(n);
+  int stats[COLAMD_STATS];
+  if (!symamd(n, Ai_.begin(), Ap_.begin(), P_.begin(), (double *) NULL,
+              stats, &calloc, &free)) {
+    for (int c = 0; c < n; ++c) {
+      P_[c] = c;
+    }
+  }
+  Lp_.resize(n + 1);
+  Parent_.resize(n);
+  Lnz_.resize(n);
+  Flag_.resize(n);
+  Pattern_.resize(n);
+  D_.resize(n);
+  Y_.resize(n);
+  b_.resize(n);
+  ldl_symbolic(n, Ap_.begin(), Ai_.begin(), Lp_.begin(), Parent_.begin(),
+               Lnz_.begin(), Flag_.begin(), P_.begin(), Pinv_.begin());
+  Li_.resize(Lp_[n]);
+  Lx_.resize(Lp_[n]);
+  pattern_ = J;
+  VLOG(2) << "Normal equations: " << n << " parameters, " << Ap_[n]
+          << " nonzeros, " << Lp_[n] << " in L.";
+}
+
+void SparseNormalEquations::Update(const SparseJacobian &J) {
+  if (!J.SamePattern(pattern_) || Ap_.size() == 0) {
+    Analyze(J);
+  }
+  std::fill(Ax_.begin(), Ax_.end(), 0.0);
+  int pair = 0;
+  for (int r = 0; r < J.rows(); ++r) {
+    for (int a = J.row_begin(r); a < J.row_begin(r + 1); ++a) {
+      const double value = J.value(a);
+      Ax_[upper_target_[pair++]] += value * value;
+      for (int b = a + 1; b < J.row_begin(r + 1); ++b) {
+        const double product = value * J.value(b);
+        Ax_[upper_target_[pair]] += product;
+        Ax_[lower_target_[pair]] += product;
+        ++pair;
+      }
+    }
+  }
+}
+
+double SparseNormalEquations::MaxDiagonal() const {
+  double max_diagonal = 0;
+  for (int c = 0; c < num_parameters_; ++c) {
+    max_diagonal = std::max(max_diagonal, Ax_[diagonal_[c]]);
+  }
+  return max_diagonal;
+}
+
+bool SparseNormalEquations::Solve(double shift, const Vec &b, Vec *x) {
+  const int n = num_parameters_;
+  CHECK_EQ(b.rows(), n);
+  std::copy(Ax_.begin(), Ax_.end(), Ax_shifted_.begin());
+  for (int c = 0; c < n; ++c) {
+    Ax_shifted_[diagonal_[c]] += shift;
+  }
+  int rank = ldl_numeric(n, Ap_.begin(), Ai_.begin(), Ax_shifted_.begin(),
+                         Lp_.begin(), Parent_.begin(), Lnz_.begin(),
+                         Li_.begin(), Lx_.begin(), D_.begin(), Y_.begin(),
+                         Pattern_.begin(), Flag_.begin(), P_.begin(),
+                         Pinv_.begin());
+  if (rank != n) {
+    return false;
+  }
+  for (int c = 0; c < n; ++c) {
+    b_[c] = b(c);
+  }
+  x->resize(n);
+  ldl_perm(n, Y_.begin(), b_.begin(), P_.begin());
+  ldl_lsolve(n, Y_.begin(), Lp_.begin(), Li_.begin(), Lx_.begin());
+  ldl_dsolve(n, Y_.begin(), D_.begin());
+  ldl_ltsolve(n, Y_.begin(), Lp_.begin(), Li_.begin(), Lx_.begin());
+  ldl_permt(n, x->data(), Y_.begin(), P_.begin());
+  return true;
+}
+
+}  // namespace libmv
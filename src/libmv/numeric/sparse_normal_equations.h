@@ -0,0 +1,136 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+// Sparse Jacobians and their normal equations, for the sparse variants of the
+// Levenberg-Marquardt and dogleg solvers.
+
+#ifndef LIBMV_NUMERIC_SPARSE_NORMAL_EQUATIONS_H
+#define LIBMV_NUMERIC_SPARSE_NORMAL_EQUATIONS_H
+
+#include "libmv/base/vector.h"
+#include "libmv/numeric/numeric.h"
+
+namespace libmv {
+
+// Jacobian stored by rows, each row holding the columns and values of its
+// nonzeros. A Jacobian functor rebuilds it at every evaluation:
+//
+//   J->Clear(num_parameters);
+//   for each residual:
+//     J->StartRow();
+//     for each parameter the residual depends on:
+//       J->Add(column, derivative);
+//
+// The columns of a row must be distinct. The pattern is expected to be the
+// same at every evaluation; SparseNormalEquations only redoes its symbolic
+// analysis when it changes.
+class SparseJacobian {
+ public:
+  SparseJacobian() : num_cols_(0) { row_begin_.push_back(0); }
+
+  // Removes all the rows but keeps the allocated memory.
+  void Clear(int num_cols) {
+    num_cols_ = num_cols;
+    row_begin_.resize(1);
+    cols_.resize(0);
+    values_.resize(0);
+  }
+  void StartRow() { row_begin_.push_back(cols_.size()); }
+  void Add(int col, double value) {
+    cols_.push_back(col);
+    values_.push_back(value);
+    row_begin_.back() = cols_.size();
+  }
+
+  int rows() const { return row_begin_.size() - 1; }
+  int cols() const { return num_cols_; }
+  int num_nonzeros() const { return cols_.size(); }
+  int row_begin(int row) const { return row_begin_[row]; }
+  int col(int nonzero) const { return cols_[nonzero]; }
+  double value(int nonzero) const { return values_[nonzero]; }
+
+  // Multiplies the row by s, e.g. to weight a residual.
+  void ScaleRow(int row, double s) {
+    for (int k = row_begin_[row]; k < row_begin_[row + 1]; ++k) {
+      values_[k] *= s;
+    }
+  }
+
+  // y = J x.
+  void Multiply(const Vec &x, Vec *y) const;
+  // y = J^T x.
+  void MultiplyTranspose(const Vec &x, Vec *y) const;
+  // True if the two Jacobians have the same rows and columns of nonzeros.
+  bool SamePattern(const SparseJacobian &other) const;
+
+ private:
+  int num_cols_;
+  vector<int> row_begin_;   // Row r is [row_begin_[r], row_begin_[r + 1]).
+  vector<int> cols_;
+  vector<double> values_;
+};
+
+// The normal equations (J^T J + shift I) dx = b of a SparseJacobian, solved
+// with a sparse LDL^T factorization.
+//
+// The pattern of J^T J, its fill reducing ordering (SYMAMD) and the symbolic
+// factorization are computed once. Then J^T J is updated in place: each pair
+// of nonzeros in a row of J adds its product to a precomputed position, so
+// neither J^T nor J^T J is formed as a new matrix at each iteration.
+class SparseNormalEquations {
+ public:
+  SparseNormalEquations() : num_parameters_(0) {}
+
+  // Recomputes J^T J; redoes the symbolic analysis if the pattern of J is
+  // not the one of the previous call.
+  void Update(const SparseJacobian &J);
+
+  // Largest diagonal entry of J^T J.
+  double MaxDiagonal() const;
+
+  // Nonzeros of J^T J, both triangles, and of its LDL^T factor.
+  int num_nonzeros() const { return Ai_.size(); }
+  int factor_nonzeros() const { return Li_.size(); }
+
+  // Solves (J^T J + shift I) x = b. Returns false if the shifted matrix is
+  // singular.
+  bool Solve(double shift, const Vec &b, Vec *x);
+
+ private:
+  void Analyze(const SparseJacobian &J);
+
+  int num_parameters_;
+  SparseJacobian pattern_;   // Jacobian used for the symbolic analysis.
+  // Full symmetric J^T J in compressed columns.
+  vector<int> Ap_, Ai_;
+  vector<double> Ax_, Ax_shifted_;
+  vector<int> diagonal_;     // Position of the diagonal entry of column c.
+  // Positions in Ax_ of the product of each pair (a, b), a <= b, of
+  // nonzeros of a row of J, in the order the rows are enumerated. The pair
+  // with a != b adds its product to two symmetric positions.
+  vector<int> upper_target_, lower_target_;
+  // LDL^T factorization.
+  vector<int> P_, Pinv_, Lp_, Parent_, Lnz_, Li_, Flag_, Pattern_;
+  vector<double> Lx_, D_, Y_, b_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_NUMERIC_SPARSE_NORMAL_EQUATIONS_H
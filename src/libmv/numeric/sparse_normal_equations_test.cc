@@ -0,0 +1,103 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "libmv/numeric/numeric.h"
+#include "libmv/numeric/sparse_normal_equations.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+// A banded Jacobian with a few far off-diagonal entries.
+void FillJacobian(int num_rows, int num_cols, double scale,
+                  SparseJacobian *J, Mat *dense) {
+  J->Clear(num_cols);
+  dense->setZero(num_rows, num_cols);
+  for (int r = 0; r < num_rows; ++r) {
+    J->StartRow();
+    int cols[3] = { r % num_cols, (r + 1) % num_cols, (7 * r) % num_cols };
+    for (int k = 0; k < 3; ++k) {
+      if ((k == 1 && cols[1] == cols[0]) ||
+          (k == 2 && (cols[2] == cols[0] || cols[2] == cols[1]))) {
+        continue;
+      }
+      double value = scale * (1 + 0.1 * k + 0.01 * r);
+      J->Add(cols[k], value);
+      (*dense)(r, cols[k]) = value;
+    }
+  }
+}
+
+TEST(SparseJacobian, Multiply) {
+  SparseJacobian J;
+  Mat dense;
+  FillJacobian(30, 12, 1.0, &J, &dense);
+  EXPECT_EQ(30, J.rows());
+  EXPECT_EQ(12, J.cols());
+
+  Vec x = Vec::Random(12), y;
+  J.Multiply(x, &y);
+  Vec expected = dense * x;
+  EXPECT_MATRIX_NEAR(expected, y, 1e-12);
+
+  Vec z = Vec::Random(30);
+  J.MultiplyTranspose(z, &y);
+  expected = dense.transpose() * z;
+  EXPECT_MATRIX_NEAR(expected, y, 1e-12);
+}
+
+TEST(SparseNormalEquations, MatchesDenseSolve) {
+  SparseJacobian J;
+  Mat dense;
+  SparseNormalEquations normal_equations;
+  Vec b = Vec::Random(12), x;
+
+  // The second update reuses the symbolic analysis of the first one.
+  for (int i = 0; i < 2; ++i) {
+    FillJacobian(30, 12, 1.0 + i, &J, &dense);
+    normal_equations.Update(J);
+    Mat A = dense.transpose() * dense;
+    EXPECT_NEAR(A.diagonal().maxCoeff(), normal_equations.MaxDiagonal(),
+                1e-12);
+    ASSERT_TRUE(normal_equations.Solve(0.5, b, &x));
+    Mat A_shifted = A + 0.5 * Mat::Identity(12, 12);
+    Vec expected = A_shifted.lu().solve(b);
+    EXPECT_MATRIX_NEAR(expected, x, 1e-10);
+  }
+}
+
+TEST(SparseNormalEquations, SingularSystem) {
+  // The last parameter is not observed.
+  SparseJacobian J;
+  J.Clear(3);
+  J.StartRow();
+  J.Add(0, 1.0);
+  J.Add(1, 2.0);
+  J.StartRow();
+  J.Add(1, 1.0);
+  SparseNormalEquations normal_equations;
+  normal_equations.Update(J);
+  Vec x;
+  EXPECT_FALSE(normal_equations.Solve(0, Vec::Ones(3), &x));
+  EXPECT_TRUE(normal_equations.Solve(1e-3, Vec::Ones(3), &x));
+}
+
+}  // namespace
@@ -0,0 +1,104 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBMV_OPTIMIZE_AUTODIFF_JACOBIAN_H_
+#define LIBMV_OPTIMIZE_AUTODIFF_JACOBIAN_H_
+
+#include <algorithm>
+
+#include "libmv/numeric/numeric.h"
+#include "libmv/optimize/jet.h"
+
+namespace libmv {
+
+// Exact jacobian of a function by forward mode automatic differentiation.
+//
+// This is a drop-in replacement for NumericJacobian, e.g. as the Jacobian
+// argument of LevenbergMarquardt or Dogleg, for functions whose operator() is
+// a template on the scalar type:
+//
+//   struct F {
+//     typedef Vec2 FMatrixType;
+//     typedef Vec3 XMatrixType;
+//     template<typename T>
+//     Eigen::Matrix<T, 2, 1> operator()(const Eigen::Matrix<T, 3, 1> &x) const;
+//   };
+//
+// The function is evaluated once on jets carrying kStride derivatives; wider
+// parameter vectors are differentiated kStride columns at a time. Parameters
+// with a size fixed at compile time are done in a single evaluation by
+// default.
+template<typename Function,
+         int kStride = Function::XMatrixType::RowsAtCompileTime == Dynamic
+                     ? 4 : Function::XMatrixType::RowsAtCompileTime>
+class AutoDiffJacobian {
+ public:
+  typedef typename Function::XMatrixType Parameters;
+  typedef typename Function::XMatrixType::RealScalar XScalar;
+  typedef typename Function::FMatrixType FMatrixType;
+  typedef Matrix<typename Function::FMatrixType::RealScalar,
+                 Function::FMatrixType::RowsAtCompileTime,
+                 Function::XMatrixType::RowsAtCompileTime>
+          JMatrixType;
+
+  typedef Jet<kStride, XScalar> JetType;
+  typedef Matrix<JetType, Function::XMatrixType::RowsAtCompileTime, 1>
+          JetParameters;
+  typedef Matrix<JetType, Function::FMatrixType::RowsAtCompileTime, 1>
+          JetResiduals;
+
+  AutoDiffJacobian(const Function &f) : f_(f) {}
+
+  JMatrixType operator()(const Parameters &x) const {
+    const int cols = x.rows();
+    JetParameters x_jet;
+    x_jet.resize(cols);
+    for (int c = 0; c < cols; ++c) {
+      x_jet(c) = JetType(x(c));
+    }
+    JMatrixType jacobian;
+    for (int c0 = 0; c0 < cols; c0 += kStride) {
+      const int block = std::min(kStride, cols - c0);
+      for (int k = 0; k < block; ++k) {
+        x_jet(c0 + k).d[k] = XScalar(1.0);
+      }
+      JetResiduals fx = f_(x_jet);
+      if (c0 == 0) {
+        jacobian.resize(fx.rows(), cols);
+      }
+      for (int r = 0; r < fx.rows(); ++r) {
+        for (int k = 0; k < block; ++k) {
+          jacobian(r, c0 + k) = fx(r).d[k];
+        }
+      }
+      for (int k = 0; k < block; ++k) {
+        x_jet(c0 + k).d[k] = XScalar(0.0);
+      }
+    }
+    return jacobian;
+  }
+
+ private:
+  const Function &f_;
+};
+
+}  // namespace libmv
+
+#endif  // LIBMV_OPTIMIZE_AUTODIFF_JACOBIAN_H_
@@ -0,0 +1,139 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <cmath>
+
+#include "libmv/numeric/dogleg.h"
+#include "libmv/numeric/function_derivative.h"
+#include "libmv/numeric/levenberg_marquardt.h"
+#include "libmv/numeric/numeric.h"
+#include "libmv/optimize/autodiff_jacobian.h"
+#include "testing/testing.h"
+
+using namespace libmv;
+
+namespace {
+
+// Same function as in function_derivative_test.cc.
+class F {
+ public:
+  typedef Vec2 FMatrixType;
+  typedef Vec3 XMatrixType;
+  template<typename T>
+  Eigen::Matrix<T, 2, 1> operator()(const Eigen::Matrix<T, 3, 1> &x) const {
+    Eigen::Matrix<T, 2, 1> fx;
+    fx << 0.19*x(0) + 0.19*x(1)*x(1) + x(2),
+          3.0*sin(x(0)) + 2.0*cos(x(1));
+    return fx;
+  }
+  Mat23 J(const Vec3 &x) const {
+    Mat23 jacobian;
+    jacobian << 0.19, 2*0.19*x(1), 1.0,
+                3*cos(x(0)), -2*sin(x(1)), 0;
+    return jacobian;
+  }
+};
+
+TEST(AutoDiffJacobian, SimpleCase) {
+  Vec3 x; x << 0.76026643, 0.01799744, 0.55192142;
+  F f;
+  AutoDiffJacobian<F> J(f);
+  EXPECT_MATRIX_NEAR(f.J(x), J(x), 1e-15);
+}
+
+// f_i(x) = exp(x_i) * x_{i+1} - sqrt(1 + x_i^2), on a parameter vector whose
+// size is only known at run time.
+class Chain {
+ public:
+  typedef Vec FMatrixType;
+  typedef Vec XMatrixType;
+  template<typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, 1> operator()(
+      const Eigen::Matrix<T, Eigen::Dynamic, 1> &x) const {
+    Eigen::Matrix<T, Eigen::Dynamic, 1> fx(x.rows() - 1);
+    for (int i = 0; i + 1 < x.rows(); ++i) {
+      fx(i) = exp(x(i)) * x(i + 1) - sqrt(1.0 + x(i) * x(i));
+    }
+    return fx;
+  }
+};
+
+TEST(AutoDiffJacobian, DynamicSizeInSeveralPasses) {
+  const int n = 11;
+  Vec x(n);
+  for (int i = 0; i < n; ++i) {
+    x(i) = 0.1 * i - 0.25;
+  }
+  Chain f;
+  Mat expected = Mat::Zero(n - 1, n);
+  for (int i = 0; i + 1 < n; ++i) {
+    expected(i, i) = exp(x(i)) * x(i + 1) - x(i) / sqrt(1 + x(i) * x(i));
+    expected(i, i + 1) = exp(x(i));
+  }
+  // 11 parameters take three passes of 4 derivatives.
+  AutoDiffJacobian<Chain> J(f);
+  EXPECT_MATRIX_NEAR(expected, J(x), 1e-14);
+  AutoDiffJacobian<Chain, 11> J_one_pass(f);
+  EXPECT_MATRIX_NEAR(expected, J_one_pass(x), 1e-14);
+
+  NumericJacobian<Chain> J_numeric(f);
+  EXPECT_MATRIX_NEAR(J_numeric(x), J(x), 1e-8);
+}
+
+// Same function as in levenberg_marquardt_test.cc.
+class G {
+ public:
+  typedef Vec4 FMatrixType;
+  typedef Vec3 XMatrixType;
+  template<typename T>
+  Eigen::Matrix<T, 4, 1> operator()(const Eigen::Matrix<T, 3, 1> &x) const {
+    T x1 = x(0) - 2.0;
+    T y1 = x(1) - 5.0;
+    T z1 = x(2);
+    Eigen::Matrix<T, 4, 1> fx;
+    fx << x1*x1 + z1*z1,
+          y1*y1 + z1*z1,
+          z1*z1,
+          x1*x1;
+    return fx;
+  }
+};
+
+TEST(AutoDiffJacobian, LevenbergMarquardt) {
+  Vec3 x(0.76026643, -30.01799744, 0.55192142);
+  G g;
+  typedef LevenbergMarquardt<G, AutoDiffJacobian<G> > Solver;
+  Solver::SolverParameters params;
+  Solver lm(g);
+  lm.minimize(params, &x);
+  EXPECT_MATRIX_NEAR(Vec3(2, 5, 0), x, 1e-5);
+}
+
+TEST(AutoDiffJacobian, Dogleg) {
+  Vec3 x(0.76026643, -30.01799744, 0.55192142);
+  G g;
+  typedef Dogleg<G, AutoDiffJacobian<G> > Solver;
+  Solver::SolverParameters params;
+  Solver dogleg(g);
+  dogleg.minimize(params, &x);
+  EXPECT_MATRIX_NEAR(Vec3(2, 5, 0), x, 1e-5);
+}
+
+}  // namespace
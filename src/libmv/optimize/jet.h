@@ -21,73 +21,366 @@
 #ifndef LIBMV_OPTIMIZE_JET_H_
 #define LIBMV_OPTIMIZE_JET_H_
 
+#include <cmath>
+
 #include "libmv/logging/logging.h"
 #include "libmv/numeric/numeric.h"
 
-// TODO(keir): Consider wrapping some of these operations with eigen arrays to
-// exploit eigen's vectorization.
-
 namespace libmv {
 
 // Poor man's forward mode automatic differentaition.
+//
+// A Jet carries a value x and its partial derivatives d with respect to N
+// independent variables. The derivatives are stored in a fixed size Eigen
+// vector, so the arithmetic on them is unrolled and vectorized by Eigen.
+// Jets nest, so Jet<N, Jet<N> > computes second derivatives.
+//
+// Code to be differentiated is written as a template on the scalar type,
+// calling the math functions unqualified (sqrt(x), not std::sqrt(x)) so that
+// the overloads below are found by argument dependent lookup.
 template<int N, typename T = double>
 struct Jet {
+  typedef Eigen::Matrix<T, N, 1> DerivativeType;
+
   Jet() {}
 
   // Constant constructor; for things like 1.0.
   template<typename Tin>
-  explicit Jet(Tin x0) {
-    x = T(x0);
-    for (int i = 0; i < N; ++i) {
-      d[i] = T(0.0);
-    }
+  explicit Jet(Tin x0) : x(x0) {
+    d.setConstant(T(0.0));
   }
 
   // Constructor for variables. This only works for first derivatives!
   template<typename Tin>
-  Jet(Tin x0, int independent) {
-    x = T(x0);
-    for (int i = 0; i < N; ++i) {
-      d[i] = T(0.0);
-    }
+  Jet(Tin x0, int independent) : x(x0) {
+    d.setConstant(T(0.0));
     d[independent] = T(1.0);
   }
 
-  // Operators: + * /
+  Jet(const T &x0, const DerivativeType &d0) : x(x0), d(d0) {}
+
+  Jet<N, T> &operator+=(const Jet<N, T> &other) {
+    x += other.x;
+    d += other.d;
+    return *this;
+  }
 
-  template<typename OtherJet>
-  Jet<N, T> operator*(const OtherJet &other) const {
-    Jet<N, T> res;
-    res.x = x * T(other.x);
-    for (int i = 0; i < N; ++i) {
-      res.d[i] = other.d[i] * x + d[i] * other.x;
-    }
-    return res;
+  Jet<N, T> &operator-=(const Jet<N, T> &other) {
+    x -= other.x;
+    d -= other.d;
+    return *this;
   }
 
-  template<typename OtherJet>
-  Jet<N, T> operator+(const OtherJet &other) const {
-    Jet<N, T> res;
-    res.x = x + other.x;
-    for (int i = 0; i < N; ++i) {
-      res.d[i] = d[i] + other.d[i];
-    }
-    return res;
+  Jet<N, T> &operator*=(const Jet<N, T> &other) {
+    d = d * other.x + other.d * x;
+    x *= other.x;
+    return *this;
   }
 
-  template<typename OtherJet>
-  Jet<N, T> operator/(const OtherJet &other) const {
-    Jet<N, T> res;
-    res.x = x / other.x;
-    for (int i = 0; i < N; ++i) {
-      res.d[i] = (other.x * d[i] - x * other.d[i]) / (other.x * other.x);
-    }
-    return res;
+  Jet<N, T> &operator/=(const Jet<N, T> &other) {
+    x /= other.x;
+    d = (d - other.d * x) / other.x;
+    return *this;
   }
 
+  Jet<N, T> &operator+=(const T &s) { x += s; return *this; }
+  Jet<N, T> &operator-=(const T &s) { x -= s; return *this; }
+  Jet<N, T> &operator*=(const T &s) { x *= s; d *= s; return *this; }
+  Jet<N, T> &operator/=(const T &s) { x /= s; d /= s; return *this; }
+
   T x;
-  T d[N];
+  DerivativeType d;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
+// Operators: unary + -, binary + - * / between jets and with scalars.
+
+template<int N, typename T> inline
+const Jet<N, T> &operator+(const Jet<N, T> &f) {
+  return f;
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator-(const Jet<N, T> &f) {
+  return Jet<N, T>(-f.x, -f.d);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator+(const Jet<N, T> &f, const Jet<N, T> &g) {
+  return Jet<N, T>(f.x + g.x, f.d + g.d);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator+(const Jet<N, T> &f, const T &s) {
+  return Jet<N, T>(f.x + s, f.d);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator+(const T &s, const Jet<N, T> &f) {
+  return Jet<N, T>(f.x + s, f.d);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator-(const Jet<N, T> &f, const Jet<N, T> &g) {
+  return Jet<N, T>(f.x - g.x, f.d - g.d);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator-(const Jet<N, T> &f, const T &s) {
+  return Jet<N, T>(f.x - s, f.d);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator-(const T &s, const Jet<N, T> &f) {
+  return Jet<N, T>(s - f.x, -f.d);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator*(const Jet<N, T> &f, const Jet<N, T> &g) {
+  return Jet<N, T>(f.x * g.x, g.d * f.x + f.d * g.x);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator*(const Jet<N, T> &f, const T &s) {
+  return Jet<N, T>(f.x * s, f.d * s);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator*(const T &s, const Jet<N, T> &f) {
+  return Jet<N, T>(f.x * s, f.d * s);
+}
+
+// (f / g)' = (f' - (f / g) g') / g
+template<int N, typename T> inline
+Jet<N, T> operator/(const Jet<N, T> &f, const Jet<N, T> &g) {
+  const T x = f.x / g.x;
+  return Jet<N, T>(x, (f.d - g.d * x) / g.x);
+}
+
+template<int N, typename T> inline
+Jet<N, T> operator/(const Jet<N, T> &f, const T &s) {
+  return Jet<N, T>(f.x / s, f.d / s);
+}
+
+// (s / g)' = -s g' / g^2
+template<int N, typename T> inline
+Jet<N, T> operator/(const T &s, const Jet<N, T> &g) {
+  const T x = s / g.x;
+  return Jet<N, T>(x, g.d * (-x / g.x));
+}
+
+// Comparisons only look at the value, so that branches in the differentiated
+// code take the same path as with plain scalars.
+
+#define LIBMV_JET_COMPARISON(op)                                          \
+template<int N, typename T> inline                                        \
+bool operator op(const Jet<N, T> &f, const Jet<N, T> &g) {                \
+  return f.x op g.x;                                                      \
+}                                                                         \
+template<int N, typename T> inline                                        \
+bool operator op(const Jet<N, T> &f, const T &s) {                        \
+  return f.x op s;                                                        \
+}                                                                         \
+template<int N, typename T> inline                                        \
+bool operator op(const T &s, const Jet<N, T> &g) {                        \
+  return s op g.x;                                                        \
+}
+LIBMV_JET_COMPARISON(<)
+LIBMV_JET_COMPARISON(<=)
+LIBMV_JET_COMPARISON(>)
+LIBMV_JET_COMPARISON(>=)
+LIBMV_JET_COMPARISON(==)
+LIBMV_JET_COMPARISON(!=)
+#undef LIBMV_JET_COMPARISON
+
+// Math functions. Each one brings the std versions it calls on the value into
+// its own scope, and the calls on nested jets are found by argument dependent
+// lookup.
+
+template<int N, typename T> inline
+Jet<N, T> abs(const Jet<N, T> &f) {
+  return f.x < T(0.0) ? -f : f;
+}
+
+// log(a + h) ~= log(a) + h / a
+template<int N, typename T> inline
+Jet<N, T> log(const Jet<N, T> &f) {
+  using std::log;
+  return Jet<N, T>(log(f.x), f.d / f.x);
+}
+
+// exp(a + h) ~= exp(a) + exp(a) h
+template<int N, typename T> inline
+Jet<N, T> exp(const Jet<N, T> &f) {
+  using std::exp;
+  const T x = exp(f.x);
+  return Jet<N, T>(x, f.d * x);
+}
+
+// sqrt(a + h) ~= sqrt(a) + h / (2 sqrt(a))
+template<int N, typename T> inline
+Jet<N, T> sqrt(const Jet<N, T> &f) {
+  using std::sqrt;
+  const T x = sqrt(f.x);
+  return Jet<N, T>(x, f.d / (T(2.0) * x));
+}
+
+template<int N, typename T> inline
+Jet<N, T> cos(const Jet<N, T> &f) {
+  using std::cos;
+  using std::sin;
+  return Jet<N, T>(cos(f.x), f.d * -sin(f.x));
+}
+
+template<int N, typename T> inline
+Jet<N, T> sin(const Jet<N, T> &f) {
+  using std::cos;
+  using std::sin;
+  return Jet<N, T>(sin(f.x), f.d * cos(f.x));
+}
+
+// tan'(a) = 1 + tan(a)^2
+template<int N, typename T> inline
+Jet<N, T> tan(const Jet<N, T> &f) {
+  using std::tan;
+  const T x = tan(f.x);
+  return Jet<N, T>(x, f.d * (T(1.0) + x * x));
+}
+
+template<int N, typename T> inline
+Jet<N, T> acos(const Jet<N, T> &f) {
+  using std::acos;
+  using std::sqrt;
+  return Jet<N, T>(acos(f.x),
+                   f.d * (T(-1.0) / sqrt(T(1.0) - f.x * f.x)));
+}
+
+template<int N, typename T> inline
+Jet<N, T> asin(const Jet<N, T> &f) {
+  using std::asin;
+  using std::sqrt;
+  return Jet<N, T>(asin(f.x),
+                   f.d * (T(1.0) / sqrt(T(1.0) - f.x * f.x)));
+}
+
+template<int N, typename T> inline
+Jet<N, T> atan(const Jet<N, T> &f) {
+  using std::atan;
+  return Jet<N, T>(atan(f.x), f.d * (T(1.0) / (T(1.0) + f.x * f.x)));
+}
+
+template<int N, typename T> inline
+Jet<N, T> sinh(const Jet<N, T> &f) {
+  using std::cosh;
+  using std::sinh;
+  return Jet<N, T>(sinh(f.x), f.d * cosh(f.x));
+}
+
+template<int N, typename T> inline
+Jet<N, T> cosh(const Jet<N, T> &f) {
+  using std::cosh;
+  using std::sinh;
+  return Jet<N, T>(cosh(f.x), f.d * sinh(f.x));
+}
+
+// tanh'(a) = 1 - tanh(a)^2
+template<int N, typename T> inline
+Jet<N, T> tanh(const Jet<N, T> &f) {
+  using std::tanh;
+  const T x = tanh(f.x);
+  return Jet<N, T>(x, f.d * (T(1.0) - x * x));
+}
+
+// atan2(b, a) = atan(b / a), so its derivative is (a b' - b a') / (a^2 + b^2).
+template<int N, typename T> inline
+Jet<N, T> atan2(const Jet<N, T> &g, const Jet<N, T> &f) {
+  using std::atan2;
+  const T inverse_norm2 = T(1.0) / (f.x * f.x + g.x * g.x);
+  return Jet<N, T>(atan2(g.x, f.x),
+                   (g.d * f.x - f.d * g.x) * inverse_norm2);
+}
+
+// pow(f, s) = f^s, so its derivative is s f^(s - 1) f'.
+template<int N, typename T> inline
+Jet<N, T> pow(const Jet<N, T> &f, const T &s) {
+  using std::pow;
+  const T x = pow(f.x, s - T(1.0));
+  return Jet<N, T>(x * f.x, f.d * (s * x));
+}
+
+// pow(s, g) = exp(g log(s)), so its derivative is log(s) s^g g'.
+template<int N, typename T> inline
+Jet<N, T> pow(const T &s, const Jet<N, T> &g) {
+  using std::log;
+  using std::pow;
+  const T x = pow(s, g.x);
+  return Jet<N, T>(x, g.d * (log(s) * x));
+}
+
+// pow(f, g) = exp(g log(f)), valid for f > 0.
+template<int N, typename T> inline
+Jet<N, T> pow(const Jet<N, T> &f, const Jet<N, T> &g) {
+  using std::log;
+  using std::pow;
+  const T x = pow(f.x, g.x);
+  return Jet<N, T>(x, (f.d * (g.x / f.x) + g.d * log(f.x)) * x);
+}
+
+template<int N, typename T> inline
+std::ostream &operator<<(std::ostream &os, const Jet<N, T> &f) {
+  return os << "[" << f.x << " ; " << f.d.transpose() << "]";
+}
+
 }  // namespace libmv
-#endif  // LIBMV_OPTIMIZE_RESIDUAL_H_
+
+namespace Eigen {
+
+// Lets Eigen matrices hold jets, e.g. to rotate a point with a matrix of
+// jets, and makes Eigen's own norm() and abs() use the jet versions.
+template<int N, typename T>
+struct NumTraits<libmv::Jet<N, T> > {
+  typedef libmv::Jet<N, T> Real;
+  typedef libmv::Jet<N, T> NonInteger;
+  typedef libmv::Jet<N, T> Nested;
+
+  static Real epsilon() {
+    return Real(NumTraits<T>::epsilon());
+  }
+  static Real dummy_precision() {
+    return Real(NumTraits<T>::dummy_precision());
+  }
+  static Real highest() { return Real(NumTraits<T>::highest()); }
+  static Real lowest() { return Real(NumTraits<T>::lowest()); }
+
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = 1,
+    ReadCost = 1,
+    AddCost = 1,
+    MulCost = 3
+  };
+};
+
+namespace internal {
+
+template<int N, typename T>
+struct abs_impl<libmv::Jet<N, T> > {
+  static libmv::Jet<N, T> run(const libmv::Jet<N, T> &f) {
+    return libmv::abs(f);
+  }
+};
+
+template<int N, typename T>
+struct sqrt_impl<libmv::Jet<N, T> > {
+  static libmv::Jet<N, T> run(const libmv::Jet<N, T> &f) {
+    return libmv::sqrt(f);
+  }
+};
+
+}  // namespace internal
+}  // namespace Eigen
+
+#endif  // LIBMV_OPTIMIZE_JET_H_
@@ -114,3 +114,126 @@ TEST(JetTest, QuotentRulePartials) {
   EXPECT_EQ(-3./32./32.,      f.d[1]);
   EXPECT_EQ(-3./32./32.*2*5,  f.d[2]);
 }
+
+TEST(JetTest, ScalarOperators) {
+  Jet<2> x(3, 0);
+  Jet<2> y(4, 1);
+  Jet<2> f = 2.0 * x - y / 2.0 + 1.0;  // f = 2x - y/2 + 1
+
+  EXPECT_EQ(5, f.x);
+  EXPECT_EQ(2, f.d[0]);
+  EXPECT_EQ(-0.5, f.d[1]);
+
+  Jet<2> g = 1.0 / y;  // g = 1/y, dg/dy = -1/y^2
+  EXPECT_EQ(0.25, g.x);
+  EXPECT_EQ(0, g.d[0]);
+  EXPECT_EQ(-1./16., g.d[1]);
+
+  f = x;
+  f *= y;
+  f -= x;
+  f /= y;  // f = x - x/y
+  EXPECT_DOUBLE_EQ(3 - 3./4., f.x);
+  EXPECT_DOUBLE_EQ(1 - 1./4., f.d[0]);
+  EXPECT_DOUBLE_EQ(3./16., f.d[1]);
+
+  EXPECT_TRUE(x < y);
+  EXPECT_TRUE(x < 3.5);
+  EXPECT_TRUE(2.5 < x);
+  EXPECT_FALSE(x == y);
+}
+
+// Compares the derivatives of the math functions with central differences.
+TEST(JetTest, MathFunctions) {
+  const double a = 0.3, b = 0.7, h = 1e-6;
+  Jet<2> x(a, 0);
+  Jet<2> y(b, 1);
+  // The scalar versions, the jet ones are found by argument dependent lookup.
+  using std::abs;
+  using std::acos;
+  using std::asin;
+  using std::atan;
+  using std::atan2;
+  using std::cos;
+  using std::cosh;
+  using std::exp;
+  using std::log;
+  using std::pow;
+  using std::sin;
+  using std::sinh;
+  using std::sqrt;
+  using std::tan;
+  using std::tanh;
+
+#define EXPECT_JET_DERIVATIVES(expr)                                         \
+  {                                                                          \
+    Jet<2> jet = (expr);                                                     \
+    double value;                                                            \
+    {                                                                        \
+      double x = a, y = b;                                                   \
+      (void)x; (void)y;                                                      \
+      value = (expr);                                                        \
+    }                                                                        \
+    double dx, dy;                                                           \
+    {                                                                        \
+      double x = a + h, y = b;                                               \
+      (void)x; (void)y;                                                      \
+      dx = (expr);                                                           \
+      x = a - h;                                                             \
+      dx = (dx - (expr)) / (2 * h);                                          \
+    }                                                                        \
+    {                                                                        \
+      double x = a, y = b + h;                                               \
+      (void)x; (void)y;                                                      \
+      dy = (expr);                                                           \
+      y = b - h;                                                             \
+      dy = (dy - (expr)) / (2 * h);                                          \
+    }                                                                        \
+    EXPECT_NEAR(value, jet.x, 1e-15) << #expr;                               \
+    EXPECT_NEAR(dx, jet.d[0], 1e-8) << #expr;                                \
+    EXPECT_NEAR(dy, jet.d[1], 1e-8) << #expr;                                \
+  }
+
+  EXPECT_JET_DERIVATIVES(abs(x - y));
+  EXPECT_JET_DERIVATIVES(sqrt(x * y));
+  EXPECT_JET_DERIVATIVES(exp(x * y));
+  EXPECT_JET_DERIVATIVES(log(x + y));
+  EXPECT_JET_DERIVATIVES(sin(x * y));
+  EXPECT_JET_DERIVATIVES(cos(x - y));
+  EXPECT_JET_DERIVATIVES(tan(x + y));
+  EXPECT_JET_DERIVATIVES(asin(x * y));
+  EXPECT_JET_DERIVATIVES(acos(x * y));
+  EXPECT_JET_DERIVATIVES(atan(x / y));
+  EXPECT_JET_DERIVATIVES(sinh(x - y));
+  EXPECT_JET_DERIVATIVES(cosh(x * y));
+  EXPECT_JET_DERIVATIVES(tanh(x + y));
+  EXPECT_JET_DERIVATIVES(atan2(y, x));
+  EXPECT_JET_DERIVATIVES(atan2(-x, -y));
+  EXPECT_JET_DERIVATIVES(pow(x, 2.5));
+  EXPECT_JET_DERIVATIVES(pow(2.5, y));
+  EXPECT_JET_DERIVATIVES(pow(x, y));
+#undef EXPECT_JET_DERIVATIVES
+}
+
+TEST(JetTest, EigenMatrixOfJets) {
+  typedef Jet<3> J;
+  Eigen::Matrix<J, 3, 1> X;
+  X << J(1, 0), J(2, 1), J(2, 2);
+  J norm = X.norm();  // d|X|/dX = X / |X|
+
+  EXPECT_EQ(3, norm.x);
+  EXPECT_DOUBLE_EQ(1./3., norm.d[0]);
+  EXPECT_DOUBLE_EQ(2./3., norm.d[1]);
+  EXPECT_DOUBLE_EQ(2./3., norm.d[2]);
+
+  Mat3 R = Mat3::Identity();
+  R(0, 1) = 2;
+  Eigen::Matrix<J, 3, 3> R_jet;
+  for (int i = 0; i < 9; ++i) {
+    R_jet(i) = J(R(i));
+  }
+  Eigen::Matrix<J, 3, 1> RX = R_jet * X;
+  EXPECT_EQ(5, RX(0).x);
+  EXPECT_EQ(1, RX(0).d[0]);
+  EXPECT_EQ(2, RX(0).d[1]);
+}
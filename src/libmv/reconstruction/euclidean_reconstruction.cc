@@ -18,6 +18,8 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <algorithm>
+
 #include "libmv/base/vector_utils.h"
 #include "libmv/camera/pinhole_camera.h"
 #include "libmv/correspondence/matches.h"
@@ -237,12 +239,21 @@ bool IncrementalReconstructionKeyframes(const Matches &matches,
                                         const int first_keyframe_index,
                                         const Mat3 &K,
                                         const Vec2u &image_size,
+                                        const IncrementalBundleOptions
+                                            &bundle_options,
                                         Reconstruction *reconstruction,
                                         int *keyframe_stopped_index) {
   bool is_good = true;
   int keyframe_index = first_keyframe_index;
   int min_num_views_for_triangulation = 2;
   uint num_new_points = 0;
+  // Keyframes refined by local bundle adjustments only since the last global
+  // one.
+  int num_keyframes_since_global_bundle = 0;
+  // The problem of the global bundle adjustments grows with the keyframes.
+  MetricBundleProblem global_problem(matches, reconstruction,
+                                     bundle_options.linear_solver,
+                                     bundle_options.loss);
   Matches::ImageID image_id;
   // Estimates the pose every other images by resection-intersection
   for (; keyframe_index < kframes.size(); ++keyframe_index) {
@@ -260,6 +271,10 @@ bool IncrementalReconstructionKeyframes(const Matches &matches,
       // we cannot estimate the camera pose by resection so we create 
       // a new reconstruction (since the new one will not share the same
       // scale and coordinate frame.
+      if (num_keyframes_since_global_bundle > 0) {
+        VLOG(2) << " -- Global bundle adjustment --  " << std::endl;
+        global_problem.Solve();
+      }
       return false;
     }
     SetImageSize(*reconstruction, image_id, image_size);
@@ -272,15 +287,36 @@ bool IncrementalReconstructionKeyframes(const Matches &matches,
                      min_num_views_for_triangulation, 
                      reconstruction);    
     VLOG(2) << num_new_points << " points reconstructed." << std::endl;
+    global_problem.AddCamera(image_id);
     
     // Performs a bundle adjustment
     if (num_new_points > 0) {
-      VLOG(2) << " -- Bundle adjustment --  " << std::endl;
-      MetricBundleAdjust(matches, reconstruction);
-      // TODO(julien) is a local BA sufficient here?
-      // TODO(julien) Remove outliers RemoveOutliers() + BA again
+      num_keyframes_since_global_bundle++;
+      if (bundle_options.local_window_size <= 0 ||
+          (bundle_options.global_bundle_interval > 0 &&
+           num_keyframes_since_global_bundle >=
+           bundle_options.global_bundle_interval)) {
+        VLOG(2) << " -- Global bundle adjustment --  " << std::endl;
+        global_problem.Solve();
+        num_keyframes_since_global_bundle = 0;
+      } else {
+        VLOG(2) << " -- Local bundle adjustment --  " << std::endl;
+        vector<CameraID> local_cameras;
+        int first_local_keyframe = std::max(
+            0, keyframe_index - bundle_options.local_window_size + 1);
+        for (int i = first_local_keyframe; i <= keyframe_index; ++i) {
+          local_cameras.push_back(kframes[i]);
+        }
+        LocalMetricBundleAdjust(matches, local_cameras, reconstruction,
+                                bundle_options.linear_solver,
+                                bundle_options.loss);
+      }
     }
   }
+  if (num_keyframes_since_global_bundle > 0) {
+    VLOG(2) << " -- Global bundle adjustment --  " << std::endl;
+    global_problem.Solve();
+  }
   return true;
 }
 
@@ -350,11 +386,53 @@ bool ReconstructionNonKeyframes(const Matches &matches,
   return true;
 }
 
+namespace {
+
+// The bundle adjustments of the signatures without IncrementalBundleOptions:
+// a global one without loss each time new points are reconstructed.
+IncrementalBundleOptions LegacyBundleOptions() {
+  IncrementalBundleOptions bundle_options;
+  bundle_options.local_window_size = 0;
+  bundle_options.loss = RobustLoss();
+  return bundle_options;
+}
+
+}  // namespace
+
+bool IncrementalReconstructionKeyframes(const Matches &matches,
+                                        const vector<Matches::ImageID> &kframes,
+                                        const int first_keyframe_index,
+                                        const Mat3 &K,
+                                        const Vec2u &image_size,
+                                        Reconstruction *reconstruction,
+                                        int *keyframe_stopped_index) {
+  return IncrementalReconstructionKeyframes(matches, kframes,
+                                            first_keyframe_index,
+                                            K, image_size,
+                                            LegacyBundleOptions(),
+                                            reconstruction,
+                                            keyframe_stopped_index);
+}
+
+bool EuclideanReconstructionFromVideo(
+    const Matches &matches, 
+    int image_width, 
+    int image_height,
+    double focal,
+    std::list<Reconstruction *> *reconstructions) {
+  return EuclideanReconstructionFromVideo(matches,
+                                          image_width, image_height,
+                                          focal,
+                                          LegacyBundleOptions(),
+                                          reconstructions);
+}
+
 bool EuclideanReconstructionFromVideo(
     const Matches &matches, 
     int image_width, 
     int image_height,
     double focal,
+    const IncrementalBundleOptions &bundle_options,
     std::list<Reconstruction *> *reconstructions) {
   if (matches.NumImages() < 2)
     return false;
@@ -401,6 +479,7 @@ bool EuclideanReconstructionFromVideo(
                                           keyframes,
                                           keyframe_index,
                                           K, image_size,
+                                          bundle_options,
                                           cur_recons,
                                           &keyframe_index);
       std::stringstream s;
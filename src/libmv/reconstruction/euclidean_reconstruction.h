@@ -21,10 +21,35 @@
 #ifndef LIBMV_RECONSTRUCTION_EUCLIDEAN_RECONSTRUCTION_H_
 #define LIBMV_RECONSTRUCTION_EUCLIDEAN_RECONSTRUCTION_H_
 
+#include "libmv/multiview/bundle.h"
 #include "libmv/reconstruction/reconstruction.h"
 
 namespace libmv {
 
+// Controls the bundle adjustments performed while the keyframes of a video
+// are added to a reconstruction.
+struct IncrementalBundleOptions {
+  IncrementalBundleOptions()
+    : local_window_size(10),
+      global_bundle_interval(20),
+      linear_solver(eBUNDLE_SPARSE_SCHUR),
+      loss(HUBER_LOSS, 2.0) {}
+
+  // Number of the last keyframes refined, with the points they see, after a
+  // keyframe is added. The older cameras seeing these points are held
+  // constant. If it is 0, the whole reconstruction is refined every time.
+  int local_window_size;
+  // A global bundle adjustment is performed every global_bundle_interval
+  // keyframes and once all the keyframes are localized. If it is 0, only the
+  // last one is performed.
+  int global_bundle_interval;
+  // Solver of the local and global bundle adjustments.
+  eLibmvBundleLinearSolver linear_solver;
+  // Loss of the reprojection errors, in pixels. The default Huber loss keeps
+  // the outlying tracks from pulling the cameras.
+  RobustLoss loss;
+};
+
 // Estimates the pose of the camera using the already reconstructed points.
 // The method:
 //  - selects the tracks that have an already reconstructed structure
@@ -72,12 +97,25 @@ bool InitialReconstructionTwoViews(const Matches &matches,
 //  - the keyframe is localized (by resection)
 //  - if the resection has not failed, the inliers tracks are reconstructed
 //    by point triangulation
-//  - if new points are created, a global bundle adjustment is performed
-//    TODO(julien) a local bundle adjustment would be sufficient?
+//  - if new points are created, a local bundle adjustment of the last
+//    keyframes is performed, or a global one at the checkpoints set by
+//    bundle_options
 // The method stops when one keyframe cannot be localized (tracking lost),
 // keyframe_stopped_index is the index of this keyframe.
 // Returns true if all keyframes have been localized
 // Returns false if one keyframe cannot be localized (tracking lost).
+bool IncrementalReconstructionKeyframes(const Matches &matches,
+                                        const vector<Matches::ImageID> &kframes,
+                                        const int first_keyframe_index,
+                                        const Mat3 &K,
+                                        const Vec2u &image_size,
+                                        const IncrementalBundleOptions
+                                            &bundle_options,
+                                        Reconstruction *reconstruction,
+                                        int *keyframe_stopped_index);
+
+// Same as above with a global bundle adjustment without loss each time new
+// points are reconstructed.
 bool IncrementalReconstructionKeyframes(const Matches &matches,
                                         const vector<Matches::ImageID> &kframes,
                                         const int first_keyframe_index,
@@ -104,15 +142,24 @@ bool ReconstructionNonKeyframes(const Matches &matches,
 //  - Next the first two keyframes are used to estimate an initial structure
 //  - Then every other keyframe are reconstructed based on an euclidean resection
 //    algorithm with the previously recontructed structures and new structures
-//    are estimated (points triangulation). A bundle adjustment is performed on
-//    all the reconstruction each time a keyframe is localized.
-//    TODO(julien) a local bundle adjustment would be sufficient?
-//    TODO(julien) +a global bundle adjusment on all data at the end?
+//    are estimated (points triangulation). A local bundle adjustment is
+//    performed each time a keyframe is localized, and a global one at the
+//    checkpoints set by bundle_options.
 //  - In a final step, non-keyframes are localized using the resection method.
 //    A bundle adjusment is periodically performed on all the data.
 // In the case that the tracking is lost, a new reconstruction is created.
 // TODO(julien) Add the calibration matrix K as input?
 // TODO(julien) remove outliers from matches or output inliers matches.
+bool EuclideanReconstructionFromVideo(
+    const Matches &matches, 
+    int image_width, 
+    int image_height,
+    double focal,
+    const IncrementalBundleOptions &bundle_options,
+    std::list<Reconstruction *> *reconstructions);
+
+// Same as above with a global bundle adjustment without loss each time new
+// points are reconstructed, as before IncrementalBundleOptions.
 bool EuclideanReconstructionFromVideo(
     const Matches &matches, 
     int image_width, 
@@ -183,5 +183,60 @@ TEST(CalibratedReconstruction, TestSynthetic6FullViews) {
   list_features.clear();
 }
 
+TEST(CalibratedReconstruction, LocalMetricBundleAdjust) {
+  int nviews = 6;
+  int npoints = 50;
+  NViewDataSet d = NRealisticCamerasFull(nviews, npoints);
+
+  Matches matches;
+  std::list<Feature *> list_features;
+  GenerateMatchesFromNViewDataSet(d, 0, &matches, &list_features);
+
+  // The last two cameras and all the points are perturbed.
+  Reconstruction reconstruction;
+  srand(5);
+  for (int i = 0; i < nviews; ++i) {
+    Mat3 R = d.R[i];
+    Vec3 t = d.t[i];
+    if (i >= 4) {
+      R *= RotationAroundX(0.01) * RotationAroundY(-0.01);
+      t += Vec3::Random() * 0.05;
+    }
+    reconstruction.InsertCamera(i, new PinholeCamera(d.K[i], R, t));
+  }
+  for (int j = 0; j < npoints; ++j) {
+    Vec3 X = d.X.col(j) + Vec3::Random() * 0.01;
+    reconstruction.InsertTrack(j, new PointStructure(X));
+  }
+
+  vector<CameraID> local_cameras;
+  local_cameras.push_back(4);
+  local_cameras.push_back(5);
+  double rms = LocalMetricBundleAdjust(matches, local_cameras,
+                                       &reconstruction);
+  // The features are stored in single precision.
+  EXPECT_LT(rms, 1e-4);
+
+  // The other cameras fix the gauge, so they are untouched and the local
+  // ones go back to the ground truth.
+  Mat3 K, R;
+  Vec3 t;
+  for (int i = 0; i < nviews; ++i) {
+    PinholeCamera *camera =
+        dynamic_cast<PinholeCamera *>(reconstruction.GetCamera(i));
+    camera->GetIntrinsicExtrinsicParameters(&K, &R, &t);
+    double precision = i < 4 ? 1e-12 : 1e-4;
+    EXPECT_MATRIX_NEAR(d.R[i], R, precision);
+    EXPECT_MATRIX_NEAR(d.t[i], t, precision);
+  }
+  EXPECT_LT(EstimateRootMeanSquareError(matches, &reconstruction), 1e-4);
+
+  reconstruction.ClearCamerasMap();
+  reconstruction.ClearStructuresMap();
+  std::list<Feature *>::iterator features_iter = list_features.begin();
+  for (; features_iter != list_features.end(); ++features_iter)
+    delete *features_iter;
+}
+
 }  // namespace
 }  // namespace libmv
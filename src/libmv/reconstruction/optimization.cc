@@ -18,6 +18,8 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 // IN THE SOFTWARE.
 
+#include <set>
+
 #include "libmv/multiview/bundle.h"
 #include "libmv/reconstruction/optimization.h"
 #include "libmv/reconstruction/tools.h"
@@ -59,7 +61,10 @@ double EstimateRootMeanSquareError(const Matches &matches,
 }
 
 double MetricBundleAdjust(const Matches &matches, 
-                          Reconstruction *reconstruction) {
+                          Reconstruction *reconstruction,
+                          eLibmvBundleLinearSolver linear_solver,
+                          const RobustLoss &loss,
+                          BundleSummary *summary) {
   double rms = 0, rms0 = EstimateRootMeanSquareError(matches, reconstruction);
   VLOG(1)   << "Initial RMS = " << rms0 << std::endl;
   size_t ncamera = reconstruction->GetNumberCameras();
@@ -116,9 +121,17 @@ double MetricBundleAdjust(const Matches &matches,
     }
   }
   // Performs metric bundle adjustment
-  rms = EuclideanBA(x, x_ids, &Ks, &Rs, &ts, &X, eBUNDLE_METRIC);
+  BundleOptions options;
+  options.type = eBUNDLE_METRIC;
+  options.linear_solver = linear_solver;
+  options.loss = loss;
+  BundleSummary local_summary;
+  if (!summary) {
+    summary = &local_summary;
+  }
+  rms = EuclideanBA(x, x_ids, &Ks, &Rs, &ts, &X, options, summary);
   // Copy the results only if it's better
-  if (rms < rms0) {
+  if (summary->final_cost < summary->initial_cost) {
     cam_id = 0;
     cam_iter = reconstruction->cameras().begin();
     for (; cam_iter != reconstruction->cameras().end(); ++cam_iter) {
@@ -145,6 +158,253 @@ double MetricBundleAdjust(const Matches &matches,
   return rms;
 }
 
+// Selects the observations in the image image_id of the structures indexed
+// by map_structures_ids. Returns the number of observations.
+static int SelectIndexedPointStructures(
+    const Matches &matches,
+    CameraID image_id,
+    const Reconstruction &reconstruction,
+    const std::map<StructureID, uint> &map_structures_ids,
+    Mat2X *x_image,
+    Vecu *x_ids) {
+  vector<StructureID> structures_ids;
+  Mat2X x_all;
+  SelectExistingPointStructures(matches, image_id, reconstruction,
+                                &structures_ids, &x_all);
+  x_image->resize(2, structures_ids.size());
+  x_ids->resize(structures_ids.size());
+  int num_observations = 0;
+  std::map<StructureID, uint>::const_iterator it;
+  for (size_t s = 0; s < structures_ids.size(); ++s) {
+    it = map_structures_ids.find(structures_ids[s]);
+    if (it != map_structures_ids.end()) {
+      x_image->col(num_observations) = x_all.col(s);
+      (*x_ids)[num_observations] = it->second;
+      num_observations++;
+    }
+  }
+  x_image->conservativeResize(2, num_observations);
+  x_ids->conservativeResize(num_observations);
+  return num_observations;
+}
+
+double LocalMetricBundleAdjust(const Matches &matches,
+                               const vector<CameraID> &local_cameras,
+                               Reconstruction *reconstruction,
+                               eLibmvBundleLinearSolver linear_solver,
+                               const RobustLoss &loss,
+                               BundleSummary *summary) {
+  // The local structures are the ones seen by the local cameras.
+  std::map<StructureID, uint> map_structures_ids;
+  vector<StructureID> structures_ids;
+  vector<PointStructure *> structures;
+  std::set<CameraID> local_cameras_set;
+  for (int i = 0; i < local_cameras.size(); ++i) {
+    if (!reconstruction->ImageHasCamera(local_cameras[i]))
+      continue;
+    local_cameras_set.insert(local_cameras[i]);
+    SelectExistingPointStructures(matches, local_cameras[i], *reconstruction,
+                                  &structures_ids);
+    for (size_t s = 0; s < structures_ids.size(); ++s) {
+      if (map_structures_ids.find(structures_ids[s]) !=
+          map_structures_ids.end())
+        continue;
+      PointStructure *pstructure = dynamic_cast<PointStructure *>(
+          reconstruction->GetStructure(structures_ids[s]));
+      if (!pstructure) {
+        LOG(FATAL) << "Error: the bundle adjustment cannot handle non point "
+                   << "structure.";
+        return 0;
+      }
+      map_structures_ids[structures_ids[s]] = structures.size();
+      structures.push_back(pstructure);
+    }
+  }
+  if (structures.size() == 0)
+    return 0;
+
+  // The local cameras come first and are followed by the other cameras that
+  // see local structures, which are held constant.
+  size_t ncamera = reconstruction->GetNumberCameras();
+  vector<Mat2X> x(ncamera);
+  vector<Vecu>  x_ids(ncamera);
+  vector<Mat3>  Ks(ncamera);
+  vector<Mat3>  Rs(ncamera);
+  vector<Vec3>  ts(ncamera);
+  vector<PinholeCamera *> cameras;
+  BundleOptions options;
+  options.type = eBUNDLE_METRIC;
+  options.linear_solver = linear_solver;
+  options.loss = loss;
+  for (int pass = 0; pass < 2; ++pass) {
+    std::map<CameraID, Camera *>::iterator cam_iter =
+      reconstruction->cameras().begin();
+    for (; cam_iter != reconstruction->cameras().end(); ++cam_iter) {
+      bool is_local = local_cameras_set.count(cam_iter->first) > 0;
+      if (is_local != (pass == 0))
+        continue;
+      PinholeCamera *pcamera = dynamic_cast<PinholeCamera *>(cam_iter->second);
+      if (!pcamera) {
+        LOG(FATAL) << "Error: the bundle adjustment cannot handle non pinhole "
+                   << "cameras.";
+        return 0;
+      }
+      const size_t cam_id = cameras.size();
+      if (!SelectIndexedPointStructures(matches, cam_iter->first,
+                                        *reconstruction, map_structures_ids,
+                                        &x[cam_id], &x_ids[cam_id]))
+        continue;
+      pcamera->GetIntrinsicExtrinsicParameters(&Ks[cam_id],
+                                               &Rs[cam_id],
+                                               &ts[cam_id]);
+      if (!is_local)
+        options.constant_cameras.push_back(cam_id);
+      cameras.push_back(pcamera);
+    }
+  }
+  x.resize(cameras.size());
+  x_ids.resize(cameras.size());
+  Ks.resize(cameras.size());
+  Rs.resize(cameras.size());
+  ts.resize(cameras.size());
+
+  Mat3X X(3, structures.size());
+  for (int s = 0; s < structures.size(); ++s) {
+    X.col(s) = structures[s]->coords_affine();
+  }
+  VLOG(1) << "Local bundle adjustment of " << local_cameras_set.size()
+          << " cameras (" << options.constant_cameras.size()
+          << " constant) and " << structures.size() << " points.";
+
+  BundleSummary local_summary;
+  if (!summary) {
+    summary = &local_summary;
+  }
+  double rms = EuclideanBA(x, x_ids, &Ks, &Rs, &ts, &X, options, summary);
+  VLOG(1) << "Local RMS = " << summary->initial_rms << " -> " << rms;
+  // Copy the results only if it's better
+  if (summary->final_cost < summary->initial_cost) {
+    for (int i = 0; i < cameras.size() - options.constant_cameras.size();
+         ++i) {
+      cameras[i]->SetIntrinsicExtrinsicParameters(Ks[i], Rs[i], ts[i]);
+    }
+    for (int s = 0; s < structures.size(); ++s) {
+      structures[s]->set_coords_affine(X.col(s));
+    }
+  }
+  return rms;
+}
+
+static BundleOptions MetricBundleOptions(
+    eLibmvBundleLinearSolver linear_solver, const RobustLoss &loss) {
+  BundleOptions options;
+  options.type = eBUNDLE_METRIC;
+  options.linear_solver = linear_solver;
+  options.loss = loss;
+  return options;
+}
+
+MetricBundleProblem::MetricBundleProblem(
+    const Matches &matches,
+    Reconstruction *reconstruction,
+    eLibmvBundleLinearSolver linear_solver,
+    const RobustLoss &loss)
+    : matches_(matches),
+      reconstruction_(reconstruction),
+      problem_(MetricBundleOptions(linear_solver, loss)) {
+  std::map<CameraID, Camera *>::iterator cam_iter =
+    reconstruction->cameras().begin();
+  for (; cam_iter != reconstruction->cameras().end(); ++cam_iter) {
+    AddCamera(cam_iter->first);
+  }
+}
+
+void MetricBundleProblem::AddCamera(CameraID image_id) {
+  if (camera_handles_.count(image_id))
+    return;
+  PinholeCamera *pcamera = dynamic_cast<PinholeCamera *>(
+      reconstruction_->GetCamera(image_id));
+  if (!pcamera) {
+    LOG(FATAL) << "Error: the bundle adjustment cannot handle non pinhole "
+               << "cameras.";
+    return;
+  }
+  Mat3 K, R;
+  Vec3 t;
+  pcamera->GetIntrinsicExtrinsicParameters(&K, &R, &t);
+  const int camera = problem_.AddCamera(K, R, t);
+  CHECK_EQ(camera, cameras_.size());
+
+  Matches::Features<PointFeature> fp =
+    matches_.InImage<PointFeature>(image_id);
+  for (; fp; ++fp) {
+    if (!reconstruction_->TrackHasStructure(fp.track()))
+      continue;
+    std::map<StructureID, int>::iterator it =
+      structure_handles_.find(fp.track());
+    if (it == structure_handles_.end()) {
+      // A new structure, also seen by the cameras already in the problem.
+      PointStructure *pstructure = dynamic_cast<PointStructure *>(
+          reconstruction_->GetStructure(fp.track()));
+      if (!pstructure) {
+        LOG(FATAL) << "Error: the bundle adjustment cannot handle non point "
+                   << "structure.";
+        return;
+      }
+      const int point = problem_.AddPoint(pstructure->coords_affine());
+      CHECK_EQ(point, structures_.size());
+      structures_.push_back(pstructure);
+      it = structure_handles_.insert(
+          std::make_pair(fp.track(), point)).first;
+      Matches::Features<PointFeature> ft =
+        matches_.InTrack<PointFeature>(fp.track());
+      for (; ft; ++ft) {
+        std::map<CameraID, int>::const_iterator other =
+          camera_handles_.find(ft.image());
+        if (other != camera_handles_.end()) {
+          problem_.AddObservation(other->second, point,
+                                  ft.feature()->coords.cast<double>());
+        }
+      }
+    }
+    problem_.AddObservation(camera, it->second,
+                            fp.feature()->coords.cast<double>());
+  }
+  camera_handles_[image_id] = camera;
+  cameras_.push_back(pcamera);
+}
+
+double MetricBundleProblem::Solve(BundleSummary *summary) {
+  Mat3 K, R;
+  Vec3 t;
+  for (int i = 0; i < cameras_.size(); ++i) {
+    cameras_[i]->GetIntrinsicExtrinsicParameters(&K, &R, &t);
+    problem_.SetCamera(i, K, R, t);
+  }
+  for (int s = 0; s < structures_.size(); ++s) {
+    problem_.SetPoint(s, structures_[s]->coords_affine());
+  }
+  BundleSummary local_summary;
+  if (!summary) {
+    summary = &local_summary;
+  }
+  double rms = problem_.Solve(summary);
+  VLOG(1) << "Global RMS = " << summary->initial_rms << " -> " << rms
+          << " (" << cameras_.size() << " cameras, " << structures_.size()
+          << " points)";
+  // Copy the results only if it's better
+  if (summary->final_cost < summary->initial_cost) {
+    for (int i = 0; i < cameras_.size(); ++i) {
+      problem_.GetCamera(i, &K, &R, &t);
+      cameras_[i]->SetIntrinsicExtrinsicParameters(K, R, t);
+    }
+    for (int s = 0; s < structures_.size(); ++s) {
+      structures_[s]->set_coords_affine(problem_.GetPoint(s));
+    }
+  }
+  return rms;
+}
+
 uint RemoveOutliers(CameraID image_id,
                     Matches *matches,   
                     Reconstruction *reconstruction,
@@ -21,6 +21,9 @@
 #ifndef LIBMV_RECONSTRUCTION_OPTIMIZATION_H_
 #define LIBMV_RECONSTRUCTION_OPTIMIZATION_H_
 
+#include <map>
+
+#include "libmv/multiview/bundle.h"
 #include "libmv/reconstruction/reconstruction.h"
 
 namespace libmv {
@@ -30,8 +33,67 @@ double EstimateRootMeanSquareError(const Matches &matches,
 
 // This method performs an Euclidean Bundle Adjustment
 // and returns the root mean square error.
+// Use eBUNDLE_ITERATIVE_SCHUR for reconstructions whose reduced camera matrix
+// does not fit in memory. With a robust loss (e.g. HUBER_LOSS with a scale of
+// a couple of pixels) the outlying observations are downweighted, so there is
+// no need to remove them and bundle adjust again.
+// If summary is not NULL it receives the iterations and the timings of the
+// bundle adjustment.
 double MetricBundleAdjust(const Matches &matches, 
-                          Reconstruction *reconstruction);
+                          Reconstruction *reconstruction,
+                          eLibmvBundleLinearSolver linear_solver =
+                              eBUNDLE_SPARSE_SCHUR,
+                          const RobustLoss &loss = RobustLoss(),
+                          BundleSummary *summary = NULL);
+
+// This method performs an Euclidean Bundle Adjustment of the cameras
+// local_cameras and of the point structures they see, and returns the root
+// mean square error of the optimized observations. The other cameras that
+// see these structures are held constant and fix the gauge, so the cost of
+// the optimization grows with the number of local cameras and not with the
+// size of the reconstruction.
+double LocalMetricBundleAdjust(const Matches &matches,
+                               const vector<CameraID> &local_cameras,
+                               Reconstruction *reconstruction,
+                               eLibmvBundleLinearSolver linear_solver =
+                                   eBUNDLE_SPARSE_SCHUR,
+                               const RobustLoss &loss = RobustLoss(),
+                               BundleSummary *summary = NULL);
+
+// Keeps the Euclidean bundle adjustment problem of a reconstruction between
+// global bundle adjustments, for a reconstruction that grows one camera at a
+// time. Only the cameras added since the previous Solve() and the structures
+// they see are gathered from the matches, instead of the whole
+// reconstruction.
+class MetricBundleProblem {
+ public:
+  // Adds the cameras already in the reconstruction.
+  MetricBundleProblem(const Matches &matches,
+                      Reconstruction *reconstruction,
+                      eLibmvBundleLinearSolver linear_solver =
+                          eBUNDLE_SPARSE_SCHUR,
+                      const RobustLoss &loss = RobustLoss());
+
+  // Adds the camera of the image image_id, the structures it sees that are
+  // not in the problem yet and their observations in the cameras of the
+  // problem. The structures must be reconstructed before.
+  void AddCamera(CameraID image_id);
+
+  // Refines all the cameras and the structures of the problem, starting from
+  // their parameters in the reconstruction (e.g. as left by a local bundle
+  // adjustment), and returns the root mean square error.
+  double Solve(BundleSummary *summary = NULL);
+
+ private:
+  const Matches &matches_;
+  Reconstruction *reconstruction_;
+  BundleProblem problem_;
+  // Indexed by the handles of the problem.
+  vector<PinholeCamera *> cameras_;
+  vector<PointStructure *> structures_;
+  std::map<CameraID, int> camera_handles_;
+  std::map<StructureID, int> structure_handles_;
+};
 
 // Remove the matches associated to the points structures seen in the image
 // image_id and have a root mean square error bigger than rmse_threshold
@@ -0,0 +1,286 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+// Runs the in-tree bundle adjuster on a synthetic scene and writes its
+// per-iteration trace: cost, gradient, damping, step quality and the time
+// spent linearizing, solving and evaluating the cost, as CSV or JSON.
+//
+// The cameras stand on a circle and look at a cloud of points; each point is
+// seen by a random subset of them. The observations get Gaussian noise and a
+// fraction of them are moved far away, then the poses and the points are
+// perturbed. The first two cameras are held constant to fix the gauge. This
+// is meant to tune the iteration caps and the linear solver on problems of a
+// given size, and to compare runs automatically.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "libmv/base/vector.h"
+#include "libmv/multiview/bundle.h"
+#include "libmv/numeric/numeric.h"
+#include "libmv/tools/tool.h"
+
+DEFINE_int32 (cameras, 50, "number of cameras");
+DEFINE_int32 (points, 2000, "number of points");
+DEFINE_double(visibility, 0.5, "probability that a camera sees a point");
+DEFINE_double(noise, 0.5, "standard deviation of the observations, pixels");
+DEFINE_double(outliers, 0.0, "fraction of the observations moved far away");
+DEFINE_double(perturbation, 0.02, "noise on the rotations (radians), the "
+              "camera centers and the points (scene units)");
+DEFINE_string(linear_solver, "sparse_schur",
+              "reduced camera system solver (sparse_schur,iterative_schur)");
+DEFINE_string(loss, "huber", "robust loss (trivial,huber,cauchy,truncated)");
+DEFINE_double(loss_scale, 2.0, "scale of the robust loss, pixels");
+DEFINE_int32 (max_iterations, 50, "maximum number of iterations");
+DEFINE_int32 (seed, 1, "seed of the random scene");
+DEFINE_string(format, "csv", "output format (csv,json)");
+DEFINE_string(o, "", "output file; the standard output if empty");
+
+using namespace libmv;
+
+namespace {
+
+double Uniform() {
+  return rand() / double(RAND_MAX);
+}
+
+double Gaussian() {
+  // Box-Muller.
+  double u = std::max(Uniform(), 1e-12), v = Uniform();
+  return std::sqrt(-2 * std::log(u)) * std::cos(2 * M_PI * v);
+}
+
+struct Scene {
+  vector<Mat2X> x;
+  vector<Vecu> x_ids;
+  vector<Mat3> Ks, Rs;
+  vector<Vec3> ts;
+  Mat3X X;
+  int num_observations;
+};
+
+// Cameras on a circle of radius 10 looking at points in [-2, 2]^3.
+void MakeScene(Scene *scene) {
+  const int num_cameras = FLAGS_cameras, num_points = FLAGS_points;
+  scene->X = 2 * Mat3X::Random(3, num_points);
+  Mat3 K;
+  K << 1000, 0, 320,
+       0, 1000, 240,
+       0, 0, 1;
+  scene->Ks.resize(num_cameras);
+  scene->Rs.resize(num_cameras);
+  scene->ts.resize(num_cameras);
+  scene->x.resize(num_cameras);
+  scene->x_ids.resize(num_cameras);
+  scene->num_observations = 0;
+  for (int i = 0; i < num_cameras; ++i) {
+    const double angle = 2 * M_PI * i / num_cameras;
+    const Vec3 center(10 * std::cos(angle), 1, 10 * std::sin(angle));
+    const Vec3 z = -center.normalized();
+    const Vec3 x_axis = Vec3(0, 1, 0).cross(z).normalized();
+    Mat3 R;
+    R.row(0) = x_axis;
+    R.row(1) = z.cross(x_axis);
+    R.row(2) = z;
+    scene->Ks[i] = K;
+    scene->Rs[i] = R;
+    scene->ts[i] = -R * center;
+
+    vector<int> seen;
+    for (int j = 0; j < num_points; ++j) {
+      // The first two cameras see every point, so they fix the gauge.
+      if (i < 2 || Uniform() < FLAGS_visibility) {
+        seen.push_back(j);
+      }
+    }
+    scene->x[i].resize(2, seen.size());
+    scene->x_ids[i].resize(seen.size());
+    for (int c = 0; c < seen.size(); ++c) {
+      const Vec3 projected = K * (R * scene->X.col(seen[c]) + scene->ts[i]);
+      scene->x[i].col(c) = projected.head<2>() / projected(2) +
+                           FLAGS_noise * Vec2(Gaussian(), Gaussian());
+      if (Uniform() < FLAGS_outliers) {
+        scene->x[i].col(c) += Vec2(30 + 20 * Uniform(), -30 - 20 * Uniform());
+      }
+      scene->x_ids[i](c) = seen[c];
+    }
+    scene->num_observations += seen.size();
+  }
+
+  // The starting point of the bundle adjustment.
+  for (int i = 2; i < num_cameras; ++i) {
+    const Vec3 center = -scene->Rs[i].transpose() * scene->ts[i];
+    scene->Rs[i] = scene->Rs[i] *
+        RotationAroundX(FLAGS_perturbation * Gaussian()) *
+        RotationAroundY(FLAGS_perturbation * Gaussian()) *
+        RotationAroundZ(FLAGS_perturbation * Gaussian());
+    scene->ts[i] = -scene->Rs[i] *
+        (center + FLAGS_perturbation * Vec3(Gaussian(), Gaussian(),
+                                            Gaussian()));
+  }
+  for (int j = 0; j < num_points; ++j) {
+    scene->X.col(j) += FLAGS_perturbation * Vec3(Gaussian(), Gaussian(),
+                                                 Gaussian());
+  }
+}
+
+void WriteCsv(const BundleSummary &summary, std::ostream &out) {
+  out << "iteration,cost,cost_change,gradient_max_norm,step_norm,lambda,"
+      << "step_quality,step_is_successful,linear_iterations,jacobian_time,"
+      << "linear_solver_time,residual_time\n";
+  for (int i = 0; i < summary.iterations.size(); ++i) {
+    const BundleIterationSummary &it = summary.iterations[i];
+    out << it.iteration << ',' << it.cost << ',' << it.cost_change << ','
+        << it.gradient_max_norm << ',' << it.step_norm << ',' << it.lambda
+        << ',' << it.step_quality << ',' << it.step_is_successful << ','
+        << it.linear_iterations << ',' << it.jacobian_time << ','
+        << it.linear_solver_time << ',' << it.residual_time << '\n';
+  }
+}
+
+// JSON has no NaN nor infinity, these are written as null.
+std::string JsonNumber(double value) {
+  if (value - value != 0) {
+    return "null";
+  }
+  std::ostringstream s;
+  s << value;
+  return s.str();
+}
+
+void WriteJson(const Scene &scene, const BundleSummary &summary,
+               std::ostream &out) {
+  out << "{\n"
+      << "  \"num_cameras\": " << scene.Rs.size() << ",\n"
+      << "  \"num_points\": " << scene.X.cols() << ",\n"
+      << "  \"num_observations\": " << scene.num_observations << ",\n"
+      << "  \"linear_solver\": \"" << FLAGS_linear_solver << "\",\n"
+      << "  \"loss\": \"" << FLAGS_loss << "\",\n"
+      << "  \"num_iterations\": " << summary.num_iterations << ",\n"
+      << "  \"num_successful_iterations\": "
+      << summary.num_successful_iterations << ",\n"
+      << "  \"num_linear_iterations\": " << summary.num_linear_iterations
+      << ",\n"
+      << "  \"initial_cost\": " << JsonNumber(summary.initial_cost) << ",\n"
+      << "  \"final_cost\": " << JsonNumber(summary.final_cost) << ",\n"
+      << "  \"initial_rms\": " << JsonNumber(summary.initial_rms) << ",\n"
+      << "  \"final_rms\": " << JsonNumber(summary.final_rms) << ",\n"
+      << "  \"reduced_system_nonzeros\": " << summary.reduced_system_nonzeros
+      << ",\n"
+      << "  \"factor_nonzeros\": " << summary.factor_nonzeros << ",\n"
+      << "  \"jacobian_time\": " << JsonNumber(summary.jacobian_time) << ",\n"
+      << "  \"linear_solver_time\": "
+      << JsonNumber(summary.linear_solver_time) << ",\n"
+      << "  \"residual_time\": " << JsonNumber(summary.residual_time) << ",\n"
+      << "  \"total_time\": " << JsonNumber(summary.total_time) << ",\n"
+      << "  \"iterations\": [\n";
+  for (int i = 0; i < summary.iterations.size(); ++i) {
+    const BundleIterationSummary &it = summary.iterations[i];
+    out << "    {\"iteration\": " << it.iteration << ", "
+        << "\"cost\": " << JsonNumber(it.cost) << ", "
+        << "\"cost_change\": " << JsonNumber(it.cost_change) << ", "
+        << "\"gradient_max_norm\": " << JsonNumber(it.gradient_max_norm) << ", "
+        << "\"step_norm\": " << JsonNumber(it.step_norm) << ", "
+        << "\"lambda\": " << JsonNumber(it.lambda) << ", "
+        << "\"step_quality\": " << JsonNumber(it.step_quality) << ", "
+        << "\"step_is_successful\": "
+        << (it.step_is_successful ? "true" : "false") << ", "
+        << "\"linear_iterations\": " << it.linear_iterations << ", "
+        << "\"jacobian_time\": " << JsonNumber(it.jacobian_time) << ", "
+        << "\"linear_solver_time\": " << JsonNumber(it.linear_solver_time)
+        << ", "
+        << "\"residual_time\": " << JsonNumber(it.residual_time) << "}"
+        << (i + 1 < summary.iterations.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  libmv::Init("Bundle adjusts a synthetic scene and writes the trace of the "
+              "iterations.\nUsage: bundle_benchmark [flags]",
+              &argc, &argv);
+  if (FLAGS_format != "csv" && FLAGS_format != "json") {
+    LOG(ERROR) << "Unknown output format " << FLAGS_format;
+    return 1;
+  }
+  if (FLAGS_cameras < 3 || FLAGS_points < 1) {
+    LOG(ERROR) << "At least 3 cameras and 1 point are needed.";
+    return 1;
+  }
+
+  BundleOptions options;
+  options.type = eBUNDLE_METRIC;
+  options.max_iterations = FLAGS_max_iterations;
+  options.constant_cameras.push_back(0);
+  options.constant_cameras.push_back(1);
+  if (FLAGS_linear_solver == "sparse_schur") {
+    options.linear_solver = eBUNDLE_SPARSE_SCHUR;
+  } else if (FLAGS_linear_solver == "iterative_schur") {
+    options.linear_solver = eBUNDLE_ITERATIVE_SCHUR;
+  } else {
+    LOG(ERROR) << "Unknown linear solver " << FLAGS_linear_solver;
+    return 1;
+  }
+  if (FLAGS_loss == "trivial") {
+    options.loss = RobustLoss(TRIVIAL_LOSS, FLAGS_loss_scale);
+  } else if (FLAGS_loss == "huber") {
+    options.loss = RobustLoss(HUBER_LOSS, FLAGS_loss_scale);
+  } else if (FLAGS_loss == "cauchy") {
+    options.loss = RobustLoss(CAUCHY_LOSS, FLAGS_loss_scale);
+  } else if (FLAGS_loss == "truncated") {
+    options.loss = RobustLoss(TRUNCATED_LOSS, FLAGS_loss_scale);
+  } else {
+    LOG(ERROR) << "Unknown loss " << FLAGS_loss;
+    return 1;
+  }
+
+  srand(FLAGS_seed);
+  Scene scene;
+  MakeScene(&scene);
+  BundleSummary summary;
+  EuclideanBA(scene.x, scene.x_ids, &scene.Ks, &scene.Rs, &scene.ts,
+              &scene.X, options, &summary);
+  LOG(INFO) << "RMS " << summary.initial_rms << " -> " << summary.final_rms
+            << " in " << summary.num_iterations << " iterations, "
+            << summary.total_time << " s.";
+
+  std::ofstream file;
+  if (!FLAGS_o.empty()) {
+    file.open(FLAGS_o.c_str());
+    if (!file) {
+      LOG(ERROR) << "Cannot open " << FLAGS_o;
+      return 1;
+    }
+  }
+  std::ostream &out = FLAGS_o.empty() ? std::cout : file;
+  if (FLAGS_format == "json") {
+    WriteJson(scene, summary, out);
+  } else {
+    WriteCsv(summary, out);
+  }
+  return 0;
+}
@@ -0,0 +1,478 @@
+// Copyright (c) 2011 libmv authors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Benchmarks every detector / describer / match method combination on a set
+// of images related by known homographies.
+//
+// The first image is the reference; the ground truth homography from the
+// reference to every other image is read from the image file name followed
+// by .txt, e.g. image2.png.txt (row major, same convention as
+// detector_repeatability). For every combination and image the tool reports
+// the stage timings (fastest of --repeat runs; those of the reference in
+// their own columns), the memory used by the features and descriptors, and
+// the precision / recall of the symmetric nearest neighbor matches. The
+// output is CSV or JSON so that runs can be compared automatically, e.g. when
+// upgrading a dependency.
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "libmv/base/scoped_ptr.h"
+#include "libmv/base/timer.h"
+#include "libmv/correspondence/feature_matching.h"
+#include "libmv/correspondence/feature_table.h"
+#include "libmv/descriptor/descriptor.h"
+#include "libmv/descriptor/descriptor_factory.h"
+#include "libmv/detector/detector.h"
+#include "libmv/detector/detector_factory.h"
+#include "libmv/image/image.h"
+#include "libmv/image/image_converter.h"
+#include "libmv/image/image_io.h"
+#include "libmv/numeric/numeric.h"
+#include "libmv/tools/tool.h"
+
+DEFINE_string(detectors, "FAST,FAST_LIMITED,FAST_GRID,SURF,STAR",
+              "comma separated detectors to benchmark "
+              "(FAST,FAST_LIMITED,FAST_GRID,SURF,STAR,MSER)");
+DEFINE_string(describers, "SIMPLIEST,DIPOLE,SURF,DAISY",
+              "comma separated describers to benchmark "
+              "(SIMPLIEST,DIPOLE,SURF,DAISY)");
+DEFINE_string(match_methods, "LINEAR,KDTREE,KDTREE_FLANN",
+              "comma separated match methods to benchmark "
+              "(LINEAR,KDTREE,KDTREE_FLANN)");
+DEFINE_int32 (pyramid_levels, 1,
+              "number of pyramid levels searched by the detectors");
+DEFINE_int32 (repeat, 3,
+              "number of runs of every stage; the fastest one is reported");
+DEFINE_double(tolerance, 2.0,
+              "distance in pixels under which a match agrees with the "
+              "ground truth homography");
+DEFINE_string(format, "csv", "output format (csv,json)");
+DEFINE_string(o, "", "output file; the standard output if empty (some third "
+              "party code logs to the standard output too)");
+
+using namespace libmv;
+
+namespace {
+
+struct Result {
+  std::string image, detector, describer, match_method;
+  int reference_features, image_features;
+  double reference_detect_seconds, reference_describe_seconds;
+  double detect_seconds, features_per_second;
+  double describe_seconds, match_seconds;
+  long feature_bytes, peak_rss_kb;
+  int matches, correct_matches, ground_truth_matches;
+  double precision, recall;
+};
+
+// Features and descriptors of one image for one detector and describer.
+struct DescribedImage {
+  DescribedImage() : detector_data(NULL) {}
+
+  PointFeatureTable features;
+  RMatf descriptors;
+  detector::DetectorData *detector_data;
+};
+
+std::vector<std::string> SplitList(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+bool ReadGrayImage(const std::string &filename, Image *image) {
+  ByteImage byte_image;
+  if (0 == ReadImage(filename.c_str(), &byte_image)) {
+    return false;
+  }
+  if (byte_image.Depth() == 3) {
+    ByteImage gray;
+    Rgb2Gray(byte_image, &gray);
+    *image = Image(new ByteImage(gray));
+  } else {
+    *image = Image(new ByteImage(byte_image));
+  }
+  return true;
+}
+
+bool ReadHomography(const std::string &filename, Mat3 *H) {
+  std::ifstream file(filename.c_str());
+  if (!file.is_open()) {
+    return false;
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      file >> (*H)(i, j);
+    }
+  }
+  return file.good() || file.eof();
+}
+
+long PeakResidentSetKb() {
+#ifdef _WIN32
+  return 0;
+#else
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+long FeatureBytes(const DescribedImage &described) {
+  return 5 * sizeof(float) * described.features.size() +
+         sizeof(float) * described.descriptors.size();
+}
+
+double SquaredTransferError(const Mat3 &H,
+                            const PointFeatureTable &reference, int i,
+                            const PointFeatureTable &features, int j) {
+  Vec3 projected = H * Vec3(reference.x[i], reference.y[i], 1.0);
+  double dx = projected(0) / projected(2) - features.x[j];
+  double dy = projected(1) / projected(2) - features.y[j];
+  return dx * dx + dy * dy;
+}
+
+// Number of reference features with a feature of the image under the
+// tolerance: the number of correct matches of a perfect describer.
+int CountGroundTruthMatches(const Mat3 &H,
+                            const PointFeatureTable &reference,
+                            const PointFeatureTable &features) {
+  const double tolerance2 = FLAGS_tolerance * FLAGS_tolerance;
+  int count = 0;
+  for (int i = 0; i < reference.size(); ++i) {
+    for (int j = 0; j < features.size(); ++j) {
+      if (SquaredTransferError(H, reference, i, features, j) < tolerance2) {
+        ++count;
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+// Detects the features of the image with a new detector for every run, so
+// that detectors adapting their thresholds start from the same state.
+double Detect(detector::eDetector type, const Image &image,
+              DescribedImage *described) {
+  double best = std::numeric_limits<double>::max();
+  described->detector_data = NULL;
+  for (int run = 0; run < FLAGS_repeat; ++run) {
+    scoped_ptr<detector::Detector> detector(
+        detector::detectorFactory(type, FLAGS_pyramid_levels));
+    delete described->detector_data;
+    described->detector_data = NULL;
+    described->features.Clear();
+
+    WallTimer timer;
+    detector->DetectTable(image, &described->features,
+                          &described->detector_data);
+    best = std::min(best, timer.Seconds());
+  }
+  return best;
+}
+
+double Describe(descriptor::Describer *describer, const Image &image,
+                const DescribedImage &detected, DescribedImage *described) {
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < FLAGS_repeat; ++run) {
+    described->features = detected.features;
+
+    WallTimer timer;
+    describer->DescribeTable(&described->features, image,
+                             detected.detector_data,
+                             &described->descriptors);
+    best = std::min(best, timer.Seconds());
+  }
+  return best;
+}
+
+double Match(eLibmvMatchMethod method,
+             const RMatf &reference, const RMatf &descriptors,
+             std::map<size_t, size_t> *matches) {
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < FLAGS_repeat; ++run) {
+    matches->clear();
+
+    WallTimer timer;
+    FindCandidateMatches(reference, descriptors, matches, method);
+    best = std::min(best, timer.Seconds());
+  }
+  return best;
+}
+
+// A JSON string literal holding text.
+std::string JsonString(const std::string &text) {
+  std::string quoted = "\"";
+  for (size_t i = 0; i < text.size(); ++i) {
+    const unsigned char c = text[i];
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+void WriteCsv(const std::vector<Result> &results, std::ostream &out) {
+  out << "image,detector,describer,match_method,reference_features,"
+      << "image_features,reference_detect_seconds,"
+      << "reference_describe_seconds,detect_seconds,features_per_second,"
+      << "describe_seconds,match_seconds,feature_bytes,peak_rss_kb,"
+      << "matches,correct_matches,ground_truth_matches,precision,recall\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    out << r.image << ',' << r.detector << ',' << r.describer << ','
+        << r.match_method << ',' << r.reference_features << ','
+        << r.image_features << ',' << r.reference_detect_seconds << ','
+        << r.reference_describe_seconds << ',' << r.detect_seconds << ','
+        << r.features_per_second << ',' << r.describe_seconds << ','
+        << r.match_seconds << ',' << r.feature_bytes << ','
+        << r.peak_rss_kb << ',' << r.matches << ',' << r.correct_matches
+        << ',' << r.ground_truth_matches << ',' << r.precision << ','
+        << r.recall << '\n';
+  }
+}
+
+void WriteJson(const std::vector<Result> &results, std::ostream &out) {
+  out << "[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    out << "  {\"image\": " << JsonString(r.image) << ", "
+        << "\"detector\": " << JsonString(r.detector) << ", "
+        << "\"describer\": " << JsonString(r.describer) << ", "
+        << "\"match_method\": " << JsonString(r.match_method) << ", "
+        << "\"reference_features\": " << r.reference_features << ", "
+        << "\"image_features\": " << r.image_features << ", "
+        << "\"reference_detect_seconds\": " << r.reference_detect_seconds
+        << ", "
+        << "\"reference_describe_seconds\": "
+        << r.reference_describe_seconds << ", "
+        << "\"detect_seconds\": " << r.detect_seconds << ", "
+        << "\"features_per_second\": " << r.features_per_second << ", "
+        << "\"describe_seconds\": " << r.describe_seconds << ", "
+        << "\"match_seconds\": " << r.match_seconds << ", "
+        << "\"feature_bytes\": " << r.feature_bytes << ", "
+        << "\"peak_rss_kb\": " << r.peak_rss_kb << ", "
+        << "\"matches\": " << r.matches << ", "
+        << "\"correct_matches\": " << r.correct_matches << ", "
+        << "\"ground_truth_matches\": " << r.ground_truth_matches << ", "
+        << "\"precision\": " << r.precision << ", "
+        << "\"recall\": " << r.recall << "}"
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "]\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  libmv::Init("Benchmarks the detector, describer and match method "
+              "combinations.\nUsage: feature_benchmark [flags] reference.png "
+              "image1.png [image2.png ...]\nThe homography from the "
+              "reference to imageX.png is read from imageX.png.txt.",
+              &argc, &argv);
+  if (argc < 3) {
+    LOG(ERROR) << "Missing images; see --help.";
+    return 1;
+  }
+  if (FLAGS_format != "csv" && FLAGS_format != "json") {
+    LOG(ERROR) << "Unknown output format " << FLAGS_format;
+    return 1;
+  }
+  FLAGS_repeat = std::max(1, FLAGS_repeat);
+
+  std::map<std::string, detector::eDetector> detector_names;
+  detector_names["FAST"] = detector::FAST_DETECTOR;
+  detector_names["FAST_LIMITED"] = detector::FAST_LIMITED_DETECTOR;
+  detector_names["FAST_GRID"] = detector::FAST_GRID_DETECTOR;
+  detector_names["SURF"] = detector::SURF_DETECTOR;
+  detector_names["STAR"] = detector::STAR_DETECTOR;
+  detector_names["MSER"] = detector::MSER_DETECTOR;
+  std::map<std::string, descriptor::eDescriber> describer_names;
+  describer_names["SIMPLIEST"] = descriptor::SIMPLEST_DESCRIBER;
+  describer_names["DIPOLE"] = descriptor::DIPOLE_DESCRIBER;
+  describer_names["SURF"] = descriptor::SURF_DESCRIBER;
+  describer_names["DAISY"] = descriptor::DAISY_DESCRIBER;
+  std::map<std::string, eLibmvMatchMethod> method_names;
+  method_names["LINEAR"] = eMATCH_LINEAR;
+  method_names["KDTREE"] = eMATCH_KDTREE;
+  method_names["KDTREE_FLANN"] = eMATCH_KDTREE_FLANN;
+
+  std::vector<std::string> detectors = SplitList(FLAGS_detectors);
+  std::vector<std::string> describers = SplitList(FLAGS_describers);
+  std::vector<std::string> methods = SplitList(FLAGS_match_methods);
+  for (size_t i = 0; i < detectors.size(); ++i) {
+    CHECK(detector_names.count(detectors[i]))
+        << "Unknown detector " << detectors[i];
+  }
+  for (size_t i = 0; i < describers.size(); ++i) {
+    CHECK(describer_names.count(describers[i]))
+        << "Unknown describer " << describers[i];
+  }
+  for (size_t i = 0; i < methods.size(); ++i) {
+    CHECK(method_names.count(methods[i]))
+        << "Unknown match method " << methods[i];
+  }
+
+  // The images (argv[1] is the reference) and their homographies.
+  std::vector<Image> images;
+  std::vector<Mat3> homographies;
+  std::vector<bool> has_homography;
+  for (int i = 1; i < argc; ++i) {
+    Image image(new ByteImage);
+    if (!ReadGrayImage(argv[i], &image)) {
+      LOG(ERROR) << "Cannot read image " << argv[i];
+      return 1;
+    }
+    images.push_back(image);
+    Mat3 H = Mat3::Identity();
+    has_homography.push_back(
+        i == 1 || ReadHomography(std::string(argv[i]) + ".txt", &H));
+    if (!has_homography.back()) {
+      LOG(WARNING) << "No ground truth for " << argv[i]
+                   << "; precision and recall are reported as -1.";
+    }
+    homographies.push_back(H);
+  }
+
+  std::vector<Result> results;
+  for (size_t d = 0; d < detectors.size(); ++d) {
+    const detector::eDetector detector_type = detector_names[detectors[d]];
+    scoped_ptr<detector::Detector> probe(detector::detectorFactory(
+        detector_type, FLAGS_pyramid_levels));
+    if (!probe.get()) {
+      LOG(WARNING) << "Detector " << detectors[d] << " is not available.";
+      continue;
+    }
+
+    std::vector<DescribedImage> detected(images.size());
+    std::vector<double> detect_seconds(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+      detect_seconds[i] = Detect(detector_type, images[i], &detected[i]);
+    }
+
+    for (size_t e = 0; e < describers.size(); ++e) {
+      scoped_ptr<descriptor::Describer> describer(
+          descriptor::describerFactory(describer_names[describers[e]]));
+
+      std::vector<DescribedImage> described(images.size());
+      std::vector<double> describe_seconds(images.size());
+      for (size_t i = 0; i < images.size(); ++i) {
+        describe_seconds[i] = Describe(describer.get(), images[i],
+                                       detected[i], &described[i]);
+      }
+
+      const DescribedImage &reference = described[0];
+      for (size_t i = 1; i < images.size(); ++i) {
+        int ground_truth = has_homography[i] ?
+            CountGroundTruthMatches(homographies[i], reference.features,
+                                    described[i].features) : 0;
+        for (size_t m = 0; m < methods.size(); ++m) {
+          std::map<size_t, size_t> matches;
+          double match_seconds = Match(method_names[methods[m]],
+                                       reference.descriptors,
+                                       described[i].descriptors, &matches);
+          int correct = 0;
+          std::map<size_t, size_t>::const_iterator it;
+          for (it = matches.begin(); it != matches.end(); ++it) {
+            correct += has_homography[i] && SquaredTransferError(
+                homographies[i], reference.features, it->first,
+                described[i].features, it->second) <
+                FLAGS_tolerance * FLAGS_tolerance;
+          }
+
+          Result r;
+          r.image = argv[i + 1];
+          r.detector = detectors[d];
+          r.describer = describers[e];
+          r.match_method = methods[m];
+          r.reference_features = reference.features.size();
+          r.image_features = described[i].features.size();
+          r.reference_detect_seconds = detect_seconds[0];
+          r.reference_describe_seconds = describe_seconds[0];
+          r.detect_seconds = detect_seconds[i];
+          r.features_per_second = r.detect_seconds > 0 ?
+              detected[i].features.size() / r.detect_seconds : 0;
+          r.describe_seconds = describe_seconds[i];
+          r.match_seconds = match_seconds;
+          r.feature_bytes = FeatureBytes(reference) +
+                            FeatureBytes(described[i]);
+          r.peak_rss_kb = PeakResidentSetKb();
+          r.matches = matches.size();
+          r.correct_matches = correct;
+          r.ground_truth_matches = ground_truth;
+          r.precision = !has_homography[i] ? -1 :
+              (r.matches > 0 ? correct / double(r.matches) : 0);
+          r.recall = !has_homography[i] ? -1 :
+              (ground_truth > 0 ? correct / double(ground_truth) : 0);
+          results.push_back(r);
+        }
+      }
+    }
+
+    for (size_t i = 0; i < detected.size(); ++i) {
+      delete detected[i].detector_data;
+    }
+  }
+
+  std::ofstream file;
+  if (!FLAGS_o.empty()) {
+    file.open(FLAGS_o.c_str());
+    if (!file.is_open()) {
+      LOG(ERROR) << "Cannot write " << FLAGS_o;
+      return 1;
+    }
+  }
+  std::ostream &out = FLAGS_o.empty() ? std::cout : file;
+  if (FLAGS_format == "json") {
+    WriteJson(results, out);
+  } else {
+    WriteCsv(results, out);
+  }
+  return 0;
+}
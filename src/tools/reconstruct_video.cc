@@ -43,6 +43,19 @@ DEFINE_double(u0, 0,
 DEFINE_double(v0, 0,
              "Principal point v coordinate (px)");
 
+DEFINE_int32(local_ba_window, 10,
+             "Number of keyframes refined by the local bundle adjustment "
+             "(0 for a global bundle adjustment after every keyframe)");
+DEFINE_int32(global_ba_interval, 20,
+             "Number of keyframes between two global bundle adjustments "
+             "(0 for a single one at the end)");
+DEFINE_bool(iterative_ba, false,
+            "Solve the bundle adjustments with conjugate gradients instead of "
+            "a sparse factorization (for very large reconstructions)");
+DEFINE_double(ba_huber_threshold, 2.0,
+              "Reprojection error (px) above which an observation is "
+              "downweighted by the bundle adjustments (0 for least squares)");
+
 void GetFilePathExtention(const std::string &file, 
                           std::string *path_name, 
                           std::string *ext) {
@@ -83,9 +96,19 @@ int main (int argc, char *argv[]) {
   // TODO(julien) put u and v as arguments of EuclideanReconstructionFromVideo
   VLOG(0) << "Euclidean Reconstruction From Video..." << std::endl;
   std::list<Reconstruction *> reconstructions;
+  IncrementalBundleOptions bundle_options;
+  bundle_options.local_window_size = FLAGS_local_ba_window;
+  bundle_options.global_bundle_interval = FLAGS_global_ba_interval;
+  if (FLAGS_iterative_ba)
+    bundle_options.linear_solver = eBUNDLE_ITERATIVE_SCHUR;
+  if (FLAGS_ba_huber_threshold > 0)
+    bundle_options.loss = RobustLoss(HUBER_LOSS, FLAGS_ba_huber_threshold);
+  else
+    bundle_options.loss = RobustLoss(TRIVIAL_LOSS);
   EuclideanReconstructionFromVideo(fg.matches_, 
                                    w, h,
                                    FLAGS_f,
+                                   bundle_options,
                                    &reconstructions);
   VLOG(0) << "Euclidean Reconstruction From Video...[DONE]" << std::endl;
   
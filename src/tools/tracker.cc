@@ -61,7 +61,10 @@
 
 using namespace libmv;
 
-DEFINE_string(detector, "FAST", "select the detector (FAST,STAR,SURF,MSER)");
+DEFINE_string(detector, "FAST",
+              "select the detector (FAST,FAST_GRID,STAR,SURF,MSER)");
+DEFINE_int32 (pyramid_levels, 1,
+              "number of pyramid levels searched by the detector");
 DEFINE_string(describer, "DAISY",
               "select the descriptor (SIMPLIEST,SURF,DIPOLE,DAISY)");
 DEFINE_bool  (save_features, false,
@@ -287,6 +290,7 @@ int main (int argc, char *argv[]) {
   detector::eDetector edetector = detector::FAST_DETECTOR;
   std::map<std::string, detector::eDetector> detectorMap;
   detectorMap["FAST"] = detector::FAST_DETECTOR;
+  detectorMap["FAST_GRID"] = detector::FAST_GRID_DETECTOR;
   detectorMap["SURF"] = detector::SURF_DETECTOR;
   detectorMap["STAR"] = detector::STAR_DETECTOR;
   detectorMap["MSER"] = detector::MSER_DETECTOR;
@@ -295,7 +299,8 @@ int main (int argc, char *argv[]) {
   } else {
     LOG(FATAL) << "ERROR : undefined Detector !";
   }
-  detector::Detector * pDetector = detectorFactory(edetector);
+  detector::Detector * pDetector = detectorFactory(edetector,
+                                                  FLAGS_pyramid_levels);
   
   // Set the descriptor
   descriptor::eDescriber edescriber = descriptor::DAISY_DESCRIBER;